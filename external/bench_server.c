@@ -0,0 +1,183 @@
+// Servidor de benchmark: várias threads, cada uma com seu socket SO_REUSEPORT e seu loop epoll
+// Modo echo devolve tudo o que recebe (requisição/resposta); modo sink só descarta (streaming)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define SERVER_BUFFER_SIZE (64 * 1024)
+#define SERVER_MAX_EVENTS 256
+
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t pending;            // Bytes de eco ainda não enviados (leitura pausada até zerar)
+    size_t pending_offset;
+} ServerConn;
+
+typedef struct {
+    int port;
+    int echo;
+    unsigned long connections;
+    unsigned long bytes;
+} ServerThread;
+
+static int open_listener(int port) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0) return -1;
+
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 4096) < 0) {
+        close(listen_fd);
+        return -1;
+    }
+
+    return listen_fd;
+}
+
+static void conn_close(int epoll_fd, ServerConn *conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->buffer);
+    free(conn);
+}
+
+// Envia o que falta do eco; com o socket cheio, troca para EPOLLOUT e pausa a leitura
+// @return 0 se ainda há conexão, -1 se ela foi fechada
+static int conn_flush(int epoll_fd, ServerConn *conn) {
+    while (conn->pending > 0) {
+        ssize_t sent = send(conn->fd, conn->buffer + conn->pending_offset, conn->pending, MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EAGAIN) {
+            struct epoll_event event = { .events = EPOLLOUT, .data.ptr = conn };
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+            return 0;
+        }
+        if (sent <= 0) {
+            conn_close(epoll_fd, conn);
+            return -1;
+        }
+
+        conn->pending -= sent;
+        conn->pending_offset += sent;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = conn };
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    return 0;
+}
+
+static void conn_readable(int epoll_fd, ServerConn *conn, ServerThread *thread) {
+    ssize_t received = recv(conn->fd, conn->buffer, SERVER_BUFFER_SIZE, 0);
+
+    if (received < 0 && errno == EAGAIN) return;
+    if (received <= 0) {
+        conn_close(epoll_fd, conn);
+        return;
+    }
+
+    thread->bytes += received;
+    if (!thread->echo) return;
+
+    conn->pending = received;
+    conn->pending_offset = 0;
+    conn_flush(epoll_fd, conn);
+}
+
+static void* server_thread_main(void *args) {
+    ServerThread *thread = (ServerThread*)args;
+
+    int listen_fd = open_listener(thread->port);
+    int epoll_fd = epoll_create1(0);
+
+    if (listen_fd < 0 || epoll_fd < 0) {
+        perror("Erro ao abrir o socket de escuta");
+        exit(1);
+    }
+
+    // data.ptr == NULL identifica o socket de escuta
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+
+    while (1) {
+        int ready = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, -1);
+
+        for (int i = 0; i < ready; i++) {
+            ServerConn *conn = events[i].data.ptr;
+
+            if (!conn) {
+                int client_fd;
+                while ((client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+                    int opt = 1;
+                    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+                    ServerConn *new_conn = calloc(1, sizeof(ServerConn));
+                    new_conn->fd = client_fd;
+                    new_conn->buffer = malloc(SERVER_BUFFER_SIZE);
+
+                    struct epoll_event client_event = { .events = EPOLLIN, .data.ptr = new_conn };
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &client_event);
+                    thread->connections++;
+                }
+                continue;
+            }
+
+            if (events[i].events & EPOLLOUT) {
+                conn_flush(epoll_fd, conn);
+            } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                conn_readable(epoll_fd, conn, thread);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Parametros: <porta> [echo|sink] [threads=4]\n");
+        exit(1);
+    }
+
+    int port = atoi(argv[1]);
+    int echo = argc > 2 ? strcmp(argv[2], "sink") != 0 : 1;
+    int thread_count = argc > 3 ? atoi(argv[3]) : 4;
+    if (thread_count < 1) thread_count = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    ServerThread *threads = calloc(thread_count, sizeof(ServerThread));
+    pthread_t thread_id;
+
+    for (int i = 0; i < thread_count; i++) {
+        threads[i].port = port;
+        threads[i].echo = echo;
+        pthread_create(&thread_id, NULL, server_thread_main, &threads[i]);
+        pthread_detach(thread_id);
+    }
+
+    printf("Servidor de benchmark na porta %d: modo %s, %d threads\n", port, echo ? "echo" : "sink", thread_count);
+    fflush(stdout);
+
+    while (1) pause();
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Benchmark de taxa de conexões: várias threads abrem, usam e fecham conexões o mais rápido possível
+// Cada conexão envia um byte e espera o eco, então mede o ciclo completo através do proxy
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+typedef struct {
+    struct sockaddr_in address;
+    double deadline;
+    unsigned long connections;
+    unsigned long errors;
+    double latency_total_ms;
+    double latency_max_ms;
+} BenchThread;
+
+static double now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+// Abre uma conexão, envia um byte, espera o eco e fecha com RST (evita esgotar portas em TIME_WAIT)
+static int bench_one(const struct sockaddr_in *address) {
+    int sock_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock_fd < 0) return -1;
+
+    struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(sock_fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+
+    int opt = 1;
+    setsockopt(sock_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    int result = -1;
+    char byte = 'x';
+
+    if (connect(sock_fd, (const struct sockaddr*)address, sizeof(*address)) == 0 &&
+        send(sock_fd, &byte, 1, 0) == 1 &&
+        recv(sock_fd, &byte, 1, 0) == 1) {
+        result = 0;
+    }
+
+    close(sock_fd);
+    return result;
+}
+
+static void* bench_thread(void *args) {
+    BenchThread *thread = (BenchThread*)args;
+
+    while (1) {
+        double start = now_ms();
+        if (start >= thread->deadline) break;
+
+        if (bench_one(&thread->address) < 0) {
+            thread->errors++;
+            continue;
+        }
+
+        double elapsed = now_ms() - start;
+        thread->connections++;
+        thread->latency_total_ms += elapsed;
+        if (elapsed > thread->latency_max_ms) thread->latency_max_ms = elapsed;
+    }
+
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        printf("Parametros: <host> <porta> [threads=4] [segundos=10]\n");
+        exit(1);
+    }
+
+    int thread_count = argc > 3 ? atoi(argv[3]) : 4;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    if (thread_count < 1) thread_count = 1;
+    if (seconds < 1) seconds = 1;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(atoi(argv[2]));
+
+    if (inet_pton(AF_INET, argv[1], &address.sin_addr) <= 0) {
+        fprintf(stderr, "Endereço inválido: %s\n", argv[1]);
+        exit(1);
+    }
+
+    BenchThread *threads = calloc(thread_count, sizeof(BenchThread));
+    pthread_t *thread_ids = calloc(thread_count, sizeof(pthread_t));
+    double start = now_ms();
+
+    for (int i = 0; i < thread_count; i++) {
+        threads[i].address = address;
+        threads[i].deadline = start + seconds * 1000.0;
+        pthread_create(&thread_ids[i], NULL, bench_thread, &threads[i]);
+    }
+
+    unsigned long connections = 0, errors = 0;
+    double latency_total_ms = 0, latency_max_ms = 0;
+
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(thread_ids[i], NULL);
+        connections += threads[i].connections;
+        errors += threads[i].errors;
+        latency_total_ms += threads[i].latency_total_ms;
+        if (threads[i].latency_max_ms > latency_max_ms) latency_max_ms = threads[i].latency_max_ms;
+    }
+
+    double elapsed_s = (now_ms() - start) / 1000.0;
+
+    printf("Conexões: %lu em %.2f s (%d threads)\n", connections, elapsed_s, thread_count);
+    printf("Taxa:     %.0f conexões/s\n", connections / elapsed_s);
+    printf("Latência: média %.3f ms | máx %.3f ms\n",
+           connections ? latency_total_ms / connections : 0.0, latency_max_ms);
+    printf("Erros:    %lu\n", errors);
+
+    free(threads);
+    free(thread_ids);
+    return 0;
+}
@@ -0,0 +1,290 @@
+// Decodificador dos despejos do gravador de voo (logs/flight-<ms>.bin, SIGUSR2 ou parada de destino no proxy)
+// Junta os eventos de todos os anéis e mostra a linha do tempo de cada conexão: accept, connect, cada leitura
+// e envio com bytes ou errno, destino bloqueado e liberado, origem pausada, FIN, ajustes do otimizador e a
+// causa do encerramento. Com --summary, só o resumo de cada conexão; com --stalls, só as que tiveram parada
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#include "../proxy/include/flight_format.h"
+
+typedef struct {
+    FlightEvent event;
+    size_t sequence;                // Posição no arquivo: empate no instante mantém a ordem do anel
+} SortedEvent;
+
+typedef struct {
+    uint64_t dumped_ns;
+    uint64_t dumped_wall_ms;
+} DumpClock;
+
+static int compare_events(const void *a, const void *b) {
+    const SortedEvent *x = a, *y = b;
+
+    if (x->event.connection_id != y->event.connection_id) return x->event.connection_id < y->event.connection_id ? -1 : 1;
+    if (x->event.timestamp_ns != y->event.timestamp_ns) return x->event.timestamp_ns < y->event.timestamp_ns ? -1 : 1;
+    return (x->sequence > y->sequence) - (x->sequence < y->sequence);
+}
+
+// Instante do evento no relógio de parede: o despejo guarda os dois relógios no mesmo momento
+static void format_wall(const DumpClock *clock, uint64_t timestamp_ns, char *out, size_t out_len) {
+    int64_t behind_us = (int64_t)(clock->dumped_ns - timestamp_ns) / 1000;
+    int64_t wall_us = (int64_t)clock->dumped_wall_ms * 1000 - behind_us;
+    time_t seconds = (time_t)(wall_us / 1000000);
+    struct tm local;
+
+    localtime_r(&seconds, &local);
+    size_t length = strftime(out, out_len, "%H:%M:%S", &local);
+    snprintf(out + length, out_len - length, ".%06ld", (long)(wall_us % 1000000));
+}
+
+static const char* error_name(int error) {
+    if (error == EAGAIN) return "EAGAIN";
+    if (error == ECONNRESET) return "ECONNRESET";
+    if (error == EPIPE) return "EPIPE";
+    return strerror(error);
+}
+
+// Bytes de uma leitura ou envio, ou o errno
+static void format_io(const FlightEvent *event, char *out, size_t out_len) {
+    if (event->value > 0) snprintf(out, out_len, "%lld bytes", (long long)event->value);
+    else if (event->value == 0) snprintf(out, out_len, "FIN");
+    else snprintf(out, out_len, "%s", error_name(event->error));
+}
+
+static void format_detail(const FlightEvent *event, char *out, size_t out_len) {
+    switch (event->type) {
+        case FLIGHT_EVENT_ACCEPT:
+        case FLIGHT_EVENT_CONNECT_START:
+            snprintf(out, out_len, "fd %lld", (long long)event->value);
+            break;
+        case FLIGHT_EVENT_CONNECT_DONE:
+            if (event->error) snprintf(out, out_len, "falhou: %s (%.3f ms após o accept)", error_name(event->error), event->value / 1e6);
+            else snprintf(out, out_len, "%.3f ms após o accept", event->value / 1e6);
+            break;
+        case FLIGHT_EVENT_READ:
+        case FLIGHT_EVENT_WRITE:
+            format_io(event, out, out_len);
+            break;
+        case FLIGHT_EVENT_BLOCKED:
+        case FLIGHT_EVENT_PAUSED:
+            snprintf(out, out_len, "%lld bytes pendentes", (long long)event->value);
+            break;
+        case FLIGHT_EVENT_UNBLOCKED:
+        case FLIGHT_EVENT_RESUMED:
+            snprintf(out, out_len, "após %.3f ms", event->value / 1e6);
+            break;
+        case FLIGHT_EVENT_SHUTDOWN:
+            snprintf(out, out_len, "propagado ao destino");
+            break;
+        case FLIGHT_EVENT_BUFFER:
+            snprintf(out, out_len, "SO_SNDBUF/SO_RCVBUF %lld bytes%s%s", (long long)event->value,
+                     event->error ? ": " : "", event->error ? error_name(event->error) : "");
+            break;
+        case FLIGHT_EVENT_PACING:
+            if (event->value < 0) snprintf(out, out_len, "sem limite");
+            else snprintf(out, out_len, "%.1f kbit/s", event->value * 8.0 / 1000.0);
+            break;
+        case FLIGHT_EVENT_STALL:
+            snprintf(out, out_len, "destino sem aceitar nada há %.3f ms", event->value / 1e6);
+            break;
+        case FLIGHT_EVENT_CLOSE:
+            snprintf(out, out_len, "%s%s%s", flight_close_reason_name((int)event->value),
+                     event->error ? ": " : "", event->error ? error_name(event->error) : "");
+            break;
+        default:
+            snprintf(out, out_len, "valor %lld, erro %d", (long long)event->value, event->error);
+    }
+}
+
+// Resumo de uma conexão (eventos de first até first + count, já ordenados)
+typedef struct {
+    uint64_t bytes_read[3];         // Por lado (FlightSide)
+    uint64_t bytes_written[3];
+    unsigned long reads, writes, eagain_reads, eagain_writes;
+    unsigned long blocks, pauses, stalls;
+    uint64_t blocked_ns, paused_ns, max_blocked_ns;
+    int has_accept;
+    int close_reason;               // -1 = ainda aberta no despejo
+    int close_errno;
+} ConnectionSummary;
+
+static void summarize(const SortedEvent *events, size_t count, ConnectionSummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    summary->close_reason = -1;
+
+    for (size_t i = 0; i < count; i++) {
+        const FlightEvent *event = &events[i].event;
+        int side = event->side <= FLIGHT_SIDE_SERVER ? event->side : FLIGHT_SIDE_NONE;
+
+        switch (event->type) {
+            case FLIGHT_EVENT_ACCEPT: summary->has_accept = 1; break;
+            case FLIGHT_EVENT_READ:
+                summary->reads++;
+                if (event->value > 0) summary->bytes_read[side] += (uint64_t)event->value;
+                else if (event->value < 0 && event->error == EAGAIN) summary->eagain_reads++;
+                break;
+            case FLIGHT_EVENT_WRITE:
+                summary->writes++;
+                if (event->value > 0) summary->bytes_written[side] += (uint64_t)event->value;
+                else if (event->value < 0 && event->error == EAGAIN) summary->eagain_writes++;
+                break;
+            case FLIGHT_EVENT_BLOCKED: summary->blocks++; break;
+            case FLIGHT_EVENT_UNBLOCKED:
+                summary->blocked_ns += (uint64_t)event->value;
+                if ((uint64_t)event->value > summary->max_blocked_ns) summary->max_blocked_ns = (uint64_t)event->value;
+                break;
+            case FLIGHT_EVENT_PAUSED: summary->pauses++; break;
+            case FLIGHT_EVENT_RESUMED: summary->paused_ns += (uint64_t)event->value; break;
+            case FLIGHT_EVENT_STALL:
+                summary->stalls++;
+                if ((uint64_t)event->value > summary->max_blocked_ns) summary->max_blocked_ns = (uint64_t)event->value;
+                break;
+            case FLIGHT_EVENT_CLOSE:
+                summary->close_reason = (int)event->value;
+                summary->close_errno = event->error;
+                break;
+        }
+    }
+}
+
+static void print_connection(const SortedEvent *events, size_t count, const DumpClock *clock, int summary_only) {
+    ConnectionSummary summary;
+    char when[32];
+    char detail[160];
+    uint64_t start = events[0].event.timestamp_ns;
+    uint64_t span = events[count - 1].event.timestamp_ns - start;
+
+    summarize(events, count, &summary);
+
+    printf("== Conexão %llu: %zu eventos em %.3f ms%s | ", (unsigned long long)events[0].event.connection_id, count, span / 1e6,
+           summary.has_accept ? "" : " (início sobrescrito)");
+    if (summary.close_reason < 0) printf("aberta no despejo");
+    else printf("encerrada: %s%s%s", flight_close_reason_name(summary.close_reason), summary.close_errno ? ", " : "",
+                summary.close_errno ? error_name(summary.close_errno) : "");
+    printf("\n   C->S %llu lidos / %llu entregues, S->C %llu / %llu bytes | %lu leituras (%lu EAGAIN), %lu envios (%lu EAGAIN)\n",
+           (unsigned long long)summary.bytes_read[FLIGHT_SIDE_CLIENT], (unsigned long long)summary.bytes_written[FLIGHT_SIDE_SERVER],
+           (unsigned long long)summary.bytes_read[FLIGHT_SIDE_SERVER], (unsigned long long)summary.bytes_written[FLIGHT_SIDE_CLIENT],
+           summary.reads, summary.eagain_reads, summary.writes, summary.eagain_writes);
+    printf("   Destino bloqueado %lu vezes (%.3f ms, maior %.3f ms) | Origem pausada %lu vezes (%.3f ms) | Paradas: %lu\n",
+           summary.blocks, summary.blocked_ns / 1e6, summary.max_blocked_ns / 1e6, summary.pauses, summary.paused_ns / 1e6, summary.stalls);
+
+    if (summary_only) return;
+
+    for (size_t i = 0; i < count; i++) {
+        const FlightEvent *event = &events[i].event;
+
+        format_wall(clock, event->timestamp_ns, when, sizeof(when));
+        format_detail(event, detail, sizeof(detail));
+        printf("   %s %+12.3f ms  %-10s %-9s %s\n", when, (event->timestamp_ns - start) / 1e6,
+               flight_event_name(event->type), flight_side_name(event->side), detail);
+    }
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Uso: %s [opções] <flight-*.bin>\n", program);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --conn <id>   Mostra só a conexão com esse id\n");
+    fprintf(stderr, "  --stalls      Mostra só as conexões com parada de destino (--flight-stall-ms do proxy)\n");
+    fprintf(stderr, "  --summary     Só o resumo de cada conexão (bytes, EAGAIN, bloqueios, causa do encerramento)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    uint64_t filter_id = 0;
+    int stalls_only = 0;
+    int summary_only = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--conn") == 0 && i + 1 < argc) {
+            filter_id = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stalls") == 0) {
+            stalls_only = 1;
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            summary_only = 1;
+        } else if (argv[i][0] == '-' || path) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (!path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror("Erro ao abrir o despejo");
+        return 1;
+    }
+
+    FlightDumpHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != FLIGHT_MAGIC) {
+        fprintf(stderr, "%s não é um despejo do gravador de voo (ou foi gravado em outra ordem de bytes)\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    if (header.version != FLIGHT_VERSION || header.event_size != sizeof(FlightEvent)) {
+        fprintf(stderr, "%s: versão %u com eventos de %u bytes, este decodificador lê a versão %d (%zu bytes)\n",
+                path, header.version, header.event_size, FLIGHT_VERSION, sizeof(FlightEvent));
+        fclose(file);
+        return 1;
+    }
+
+    SortedEvent *events = malloc(sizeof(SortedEvent) * (header.event_count ? header.event_count : 1));
+    size_t count = 0;
+
+    if (!events) {
+        perror("Erro ao alocar os eventos");
+        fclose(file);
+        return 1;
+    }
+
+    // Um despejo interrompido tem menos eventos que o cabeçalho: decodifica o que chegou ao disco
+    while (count < header.event_count && fread(&events[count].event, sizeof(FlightEvent), 1, file) == 1) {
+        events[count].sequence = count;
+        count++;
+    }
+    fclose(file);
+
+    qsort(events, count, sizeof(SortedEvent), compare_events);
+
+    DumpClock clock = { header.dumped_ns, header.dumped_wall_ms };
+    char when[32];
+    format_wall(&clock, header.dumped_ns, when, sizeof(when));
+
+    printf("# Despejo às %s (%s): %zu eventos de %u anéis%s\n", when,
+           header.reason == FLIGHT_DUMP_SIGNAL ? "SIGUSR2" : "parada de destino", count, header.ring_count,
+           count < header.event_count ? ", arquivo truncado" : "");
+
+    size_t shown = 0;
+
+    for (size_t first = 0; first < count;) {
+        size_t last = first;
+        int stalled = 0;
+
+        while (last < count && events[last].event.connection_id == events[first].event.connection_id) {
+            if (events[last].event.type == FLIGHT_EVENT_STALL) stalled = 1;
+            last++;
+        }
+
+        if ((!filter_id || events[first].event.connection_id == filter_id) && (!stalls_only || stalled)) {
+            print_connection(events + first, last - first, &clock, summary_only);
+            shown++;
+        }
+
+        first = last;
+    }
+
+    printf("# %zu conexões\n", shown);
+    free(events);
+    return 0;
+}
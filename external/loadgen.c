@@ -0,0 +1,425 @@
+// Gerador de carga: N conexões simultâneas divididas entre threads, cada thread com seu loop epoll
+// Modo rr (requisição/resposta contra um servidor echo) ou stream (envio contínuo para um sink),
+// com troca de conexões opcional (churn). Latências vão para histogramas no estilo HDR
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../proxy/include/hdr_histogram.h"
+
+#define LOADGEN_MAX_EVENTS 256
+#define LOADGEN_RECV_BUFFER (64 * 1024)
+
+typedef enum {
+    MODE_RR = 0,           // Envia uma mensagem, espera o eco completo e mede o tempo
+    MODE_STREAM            // Envia sem parar (mede só a vazão)
+} LoadMode;
+
+typedef enum {
+    CONN_CONNECTING = 0,
+    CONN_SENDING,
+    CONN_RECEIVING
+} ConnState;
+
+typedef struct {
+    uint64_t counts[HDR_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+typedef struct {
+    struct sockaddr_in address;
+    LoadMode mode;
+    int connections;
+    int threads;
+    size_t message_size;
+    unsigned long churn;           // Mensagens por conexão antes de reconectar (0 = nunca)
+    int split;                     // Escritas por mensagem; acima de 1 o cliente mantém o Nagle ligado
+    double duration_s;
+    const char *label;
+} LoadConfig;
+
+typedef struct {
+    int fd;
+    ConnState state;
+    size_t sent;
+    size_t received;
+    uint64_t started_ns;           // Início do connect ou da requisição atual
+    unsigned long messages;        // Mensagens nesta conexão (para o churn)
+} LoadConn;
+
+typedef struct {
+    const LoadConfig *config;
+    int conn_count;
+    LoadConn *conns;
+    char *send_buffer;
+    char *recv_buffer;
+    uint64_t deadline_ns;
+    Histogram latency;             // Requisição -> resposta completa (modo rr)
+    Histogram connect_latency;     // connect() -> conexão estabelecida
+    unsigned long requests;
+    unsigned long opened;
+    unsigned long errors;
+    unsigned long long bytes_sent;
+    unsigned long long bytes_received;
+} LoadThread;
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static void hdr_record(Histogram *histogram, uint64_t value) {
+    histogram->counts[hdr_index(value)]++;
+    histogram->total++;
+    if (value > histogram->max) histogram->max = value;
+}
+
+static void hdr_merge(Histogram *into, const Histogram *from) {
+    for (int i = 0; i < HDR_BUCKETS; i++) into->counts[i] += from->counts[i];
+    into->total += from->total;
+    if (from->max > into->max) into->max = from->max;
+}
+
+static uint64_t hdr_percentile(const Histogram *histogram, double percentile) {
+    if (histogram->total == 0) return 0;
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * histogram->total + 0.5);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= target) {
+            uint64_t value = hdr_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+// Abre uma conexão não-bloqueante; o resultado do connect chega como EPOLLOUT
+static void conn_open(LoadThread *thread, int epoll_fd, LoadConn *conn) {
+    conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    conn->state = CONN_CONNECTING;
+    conn->messages = 0;
+    conn->started_ns = now_ns();
+
+    if (conn->fd < 0) {
+        thread->errors++;
+        return;
+    }
+
+    // Mensagem em várias escritas com Nagle: o padrão escrita-escrita-leitura que sofre com o delayed ACK
+    int opt = thread->config->split > 1 ? 0 : 1;
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    // Com churn, fecha com RST para não esgotar portas locais em TIME_WAIT
+    if (thread->config->churn > 0) {
+        struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+        setsockopt(conn->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    }
+
+    if (connect(conn->fd, (const struct sockaddr*)&thread->config->address, sizeof(thread->config->address)) < 0 &&
+        errno != EINPROGRESS) {
+        thread->errors++;
+        close(conn->fd);
+        conn->fd = -1;
+        return;
+    }
+
+    struct epoll_event event = { .events = EPOLLOUT, .data.ptr = conn };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn->fd, &event);
+}
+
+static void conn_reopen(LoadThread *thread, int epoll_fd, LoadConn *conn) {
+    if (conn->fd >= 0) close(conn->fd);
+    conn->fd = -1;
+    if (now_ns() < thread->deadline_ns) conn_open(thread, epoll_fd, conn);
+}
+
+static void conn_start_message(int epoll_fd, LoadConn *conn) {
+    conn->state = CONN_SENDING;
+    conn->sent = 0;
+    conn->received = 0;
+    conn->started_ns = now_ns();
+
+    struct epoll_event event = { .events = EPOLLOUT, .data.ptr = conn };
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+// Mensagem concluída: conta, mede e decide entre a próxima mensagem e uma nova conexão
+static void conn_finish_message(LoadThread *thread, int epoll_fd, LoadConn *conn) {
+    conn->messages++;
+
+    if (thread->config->mode == MODE_RR) {
+        hdr_record(&thread->latency, now_ns() - conn->started_ns);
+        thread->requests++;
+    }
+
+    if (thread->config->churn > 0 && conn->messages >= thread->config->churn) {
+        conn_reopen(thread, epoll_fd, conn);
+    } else {
+        conn_start_message(epoll_fd, conn);
+    }
+}
+
+static void conn_event(LoadThread *thread, int epoll_fd, LoadConn *conn, uint32_t events) {
+    const LoadConfig *config = thread->config;
+
+    if (conn->state == CONN_CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+
+        if (error != 0 || (events & EPOLLERR)) {
+            thread->errors++;
+            conn_reopen(thread, epoll_fd, conn);
+            return;
+        }
+
+        hdr_record(&thread->connect_latency, now_ns() - conn->started_ns);
+        thread->opened++;
+        conn_start_message(epoll_fd, conn);
+    }
+
+    if (conn->state == CONN_SENDING) {
+        size_t piece = (config->message_size + config->split - 1) / config->split;
+
+        while (conn->sent < config->message_size) {
+            size_t length = config->message_size - conn->sent;
+            if (length > piece) length = piece;
+
+            ssize_t sent = send(conn->fd, thread->send_buffer + conn->sent, length, MSG_NOSIGNAL);
+
+            if (sent < 0 && errno == EAGAIN) return;
+            if (sent <= 0) {
+                thread->errors++;
+                conn_reopen(thread, epoll_fd, conn);
+                return;
+            }
+
+            conn->sent += sent;
+            thread->bytes_sent += sent;
+        }
+
+        if (config->mode == MODE_STREAM) {
+            conn_finish_message(thread, epoll_fd, conn);
+            return;
+        }
+
+        conn->state = CONN_RECEIVING;
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = conn };
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    }
+
+    if (conn->state == CONN_RECEIVING) {
+        while (conn->received < config->message_size) {
+            ssize_t received = recv(conn->fd, thread->recv_buffer, LOADGEN_RECV_BUFFER, 0);
+
+            if (received < 0 && errno == EAGAIN) return;
+            if (received <= 0) {
+                thread->errors++;
+                conn_reopen(thread, epoll_fd, conn);
+                return;
+            }
+
+            conn->received += received;
+            thread->bytes_received += received;
+        }
+
+        conn_finish_message(thread, epoll_fd, conn);
+    }
+}
+
+static void* load_thread_main(void *args) {
+    LoadThread *thread = (LoadThread*)args;
+    int epoll_fd = epoll_create1(0);
+
+    for (int i = 0; i < thread->conn_count; i++) {
+        thread->conns[i].fd = -1;
+        conn_open(thread, epoll_fd, &thread->conns[i]);
+    }
+
+    struct epoll_event events[LOADGEN_MAX_EVENTS];
+
+    while (now_ns() < thread->deadline_ns) {
+        int ready = epoll_wait(epoll_fd, events, LOADGEN_MAX_EVENTS, 100);
+
+        for (int i = 0; i < ready; i++) {
+            LoadConn *conn = events[i].data.ptr;
+            if (conn->fd >= 0) conn_event(thread, epoll_fd, conn, events[i].events);
+        }
+
+        // Conexões que falharam ao abrir tentam de novo
+        for (int i = 0; i < thread->conn_count; i++) {
+            if (thread->conns[i].fd < 0) conn_reopen(thread, epoll_fd, &thread->conns[i]);
+        }
+    }
+
+    for (int i = 0; i < thread->conn_count; i++) {
+        if (thread->conns[i].fd >= 0) close(thread->conns[i].fd);
+    }
+    close(epoll_fd);
+    return NULL;
+}
+
+static void print_latency(const char *name, const Histogram *histogram) {
+    printf("%-13s p50 %9.1f | p90 %9.1f | p99 %9.1f | p99.9 %9.1f | máx %9.1f us\n", name,
+           hdr_percentile(histogram, 50) / 1000.0, hdr_percentile(histogram, 90) / 1000.0,
+           hdr_percentile(histogram, 99) / 1000.0, hdr_percentile(histogram, 99.9) / 1000.0,
+           histogram->max / 1000.0);
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Uso: %s <host> <porta> [opções]\n", program);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --mode <rr|stream>  Requisição/resposta contra echo (padrão) ou envio contínuo para sink\n");
+    fprintf(stderr, "  --conns N           Conexões simultâneas (padrão: 16)\n");
+    fprintf(stderr, "  --threads N         Threads geradoras (padrão: 2)\n");
+    fprintf(stderr, "  --size B            Tamanho de cada mensagem em bytes (padrão: 1024)\n");
+    fprintf(stderr, "  --churn N           Reconecta após N mensagens por conexão (padrão: 0, nunca)\n");
+    fprintf(stderr, "  --split N           Envia cada mensagem em N escritas, com Nagle no cliente (padrão: 1)\n");
+    fprintf(stderr, "  --duration S        Duração em segundos (padrão: 10)\n");
+    fprintf(stderr, "  --label NOME        Nome do resultado na linha RESUMO\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    LoadConfig config;
+    memset(&config, 0, sizeof(config));
+    config.mode = MODE_RR;
+    config.connections = 16;
+    config.threads = 2;
+    config.message_size = 1024;
+    config.split = 1;
+    config.duration_s = 10;
+    config.label = "carga";
+
+    config.address.sin_family = AF_INET;
+    config.address.sin_port = htons(atoi(argv[2]));
+    if (inet_pton(AF_INET, argv[1], &config.address.sin_addr) <= 0) {
+        fprintf(stderr, "Endereço inválido: %s\n", argv[1]);
+        exit(1);
+    }
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            config.mode = strcmp(argv[++i], "stream") == 0 ? MODE_STREAM : MODE_RR;
+        } else if (strcmp(argv[i], "--conns") == 0 && i + 1 < argc) {
+            config.connections = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            config.message_size = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--churn") == 0 && i + 1 < argc) {
+            config.churn = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--split") == 0 && i + 1 < argc) {
+            config.split = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            config.duration_s = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            config.label = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (config.connections < 1) config.connections = 1;
+    if (config.threads < 1) config.threads = 1;
+    if (config.threads > config.connections) config.threads = config.connections;
+    if (config.message_size < 1) config.message_size = 1;
+    if (config.split < 1) config.split = 1;
+    if (config.duration_s <= 0) config.duration_s = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    LoadThread *threads = calloc(config.threads, sizeof(LoadThread));
+    pthread_t *thread_ids = calloc(config.threads, sizeof(pthread_t));
+    uint64_t start_ns = now_ns();
+
+    for (int i = 0; i < config.threads; i++) {
+        LoadThread *thread = &threads[i];
+        thread->config = &config;
+        thread->conn_count = config.connections / config.threads + (i < config.connections % config.threads);
+        thread->conns = calloc(thread->conn_count, sizeof(LoadConn));
+        thread->send_buffer = malloc(config.message_size);
+        thread->recv_buffer = malloc(LOADGEN_RECV_BUFFER);
+        thread->deadline_ns = start_ns + (uint64_t)(config.duration_s * 1e9);
+
+        if (!thread->conns || !thread->send_buffer || !thread->recv_buffer) {
+            perror("Erro ao alocar buffers");
+            exit(1);
+        }
+
+        memset(thread->send_buffer, 'x', config.message_size);
+        pthread_create(&thread_ids[i], NULL, load_thread_main, thread);
+    }
+
+    // Soma dos histogramas de todas as threads (alocados: cada um tem ~250 KB)
+    Histogram *latency = calloc(1, sizeof(Histogram));
+    Histogram *connect_latency = calloc(1, sizeof(Histogram));
+    unsigned long requests = 0, opened = 0, errors = 0;
+    unsigned long long bytes_sent = 0, bytes_received = 0;
+
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(thread_ids[i], NULL);
+        hdr_merge(latency, &threads[i].latency);
+        hdr_merge(connect_latency, &threads[i].connect_latency);
+        requests += threads[i].requests;
+        opened += threads[i].opened;
+        errors += threads[i].errors;
+        bytes_sent += threads[i].bytes_sent;
+        bytes_received += threads[i].bytes_received;
+    }
+
+    double elapsed_s = (now_ns() - start_ns) / 1e9;
+    double sent_mbps = bytes_sent * 8.0 / elapsed_s / 1e6;
+    double received_mbps = bytes_received * 8.0 / elapsed_s / 1e6;
+
+    printf("[%s] %s:%d | modo %s | %d conexões em %d threads | mensagens de %zu bytes em %d escrita(s) | churn %lu\n",
+           config.label, argv[1], atoi(argv[2]), config.mode == MODE_RR ? "rr" : "stream",
+           config.connections, config.threads, config.message_size, config.split, config.churn);
+    printf("Duração:      %.2f s\n", elapsed_s);
+    printf("Requisições:  %lu (%.0f req/s)\n", requests, requests / elapsed_s);
+    printf("Conexões:     %lu abertas (%.0f conexões/s) | erros %lu\n", opened, opened / elapsed_s, errors);
+    printf("Vazão:        enviados %.1f Mbit/s | recebidos %.1f Mbit/s\n", sent_mbps, received_mbps);
+    if (latency->total > 0) print_latency("Latência:", latency);
+    print_latency("Connect:", connect_latency);
+
+    // Linha única para comparação automática (scripts/bench.sh)
+    printf("RESUMO %s req_s=%.0f conn_s=%.0f mbit_s=%.1f p50_us=%.1f p99_us=%.1f p999_us=%.1f erros=%lu\n",
+           config.label, requests / elapsed_s, opened / elapsed_s, sent_mbps + received_mbps,
+           hdr_percentile(latency, 50) / 1000.0, hdr_percentile(latency, 99) / 1000.0,
+           hdr_percentile(latency, 99.9) / 1000.0, errors);
+
+    for (int i = 0; i < config.threads; i++) {
+        free(threads[i].conns);
+        free(threads[i].send_buffer);
+        free(threads[i].recv_buffer);
+    }
+    free(threads);
+    free(thread_ids);
+    free(latency);
+    free(connect_latency);
+    return 0;
+}
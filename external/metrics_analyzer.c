@@ -0,0 +1,431 @@
+// Analisador dos logs binários de métricas (logs/metrics.bin*, gerados com --log-format bin)
+// Lê vários arquivos em uma passada (mmap) e calcula p50/p90/p99 de RTT, throughput, CWND
+// e retransmissões por conexão e para todas as conexões, além do limitante (aplicação, receptor, buffer de envio
+// ou rede) mais frequente de cada uma; opcionalmente exporta CSV para o plot_graphs.py. Com --arm, só as
+// amostras de um braço do experimento A/B (--ab do proxy): uma execução por braço compara as políticas
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "../proxy/include/metrics_format.h"
+
+#define METRIC_COUNT 4
+#define HIST_MIN 0.001              // Menor valor distinguível (abaixo disso vai para o bucket 0)
+#define HIST_GROWTH 1.01            // Cada bucket é 1% maior que o anterior (erro relativo <= 1%)
+#define HIST_BUCKETS 3100           // Cobre de HIST_MIN até ~2e10
+#define LIMITED_COUNT 5             // Valores de LimitedBy (proxy.h), 0 = desconhecido
+
+static const char *metric_names[METRIC_COUNT] = { "RTT (ms)", "Throughput (kbps)", "CWND (seg)", "Retrans" };
+static const int metric_integral[METRIC_COUNT] = { 0, 0, 1, 1 }; // Contagens: o valor do bucket é arredondado
+
+// Amostras de uma conexão, guardadas para percentis exatos (4 floats por amostra)
+typedef struct {
+    uint64_t run_start_ms;
+    uint64_t connection_id;
+    uint8_t client_ip[4];
+    int used;
+    size_t count;
+    size_t capacity;
+    float *values[METRIC_COUNT];
+    uint64_t limited[LIMITED_COUNT];  // Amostras por limitante
+} ConnectionStats;
+
+typedef struct {
+    ConnectionStats *slots;
+    size_t capacity;
+    size_t size;
+} ConnectionTable;
+
+// Histograma logarítmico de todas as conexões: memória fixa, independente do volume
+typedef struct {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t total;
+} FleetHistogram;
+
+static FleetHistogram fleet[METRIC_COUNT];
+static uint64_t fleet_limited[LIMITED_COUNT];
+
+static int hist_index(double value) {
+    if (value < HIST_MIN) return 0;
+
+    int index = 1 + (int)(log(value / HIST_MIN) / log(HIST_GROWTH));
+    return index < HIST_BUCKETS ? index : HIST_BUCKETS - 1;
+}
+
+// Valor representativo do bucket (meio geométrico)
+static double hist_value(int index) {
+    if (index == 0) return 0.0;
+    return HIST_MIN * pow(HIST_GROWTH, index - 0.5);
+}
+
+static double hist_percentile(const FleetHistogram *histogram, double percentile) {
+    if (histogram->total == 0) return 0.0;
+
+    uint64_t target = (uint64_t)ceil(percentile / 100.0 * histogram->total);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= target && histogram->buckets[i] > 0) return hist_value(i);
+    }
+
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+static uint64_t hash_key(uint64_t run_start_ms, uint64_t connection_id) {
+    uint64_t hash = run_start_ms * 0x9E3779B97F4A7C15ULL ^ connection_id;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static void table_grow(ConnectionTable *table);
+
+static ConnectionStats* table_find(ConnectionTable *table, uint64_t run_start_ms, uint64_t connection_id) {
+    if ((table->size + 1) * 2 > table->capacity) table_grow(table);
+
+    size_t index = hash_key(run_start_ms, connection_id) & (table->capacity - 1);
+
+    while (table->slots[index].used) {
+        ConnectionStats *stats = &table->slots[index];
+        if (stats->run_start_ms == run_start_ms && stats->connection_id == connection_id) return stats;
+        index = (index + 1) & (table->capacity - 1);
+    }
+
+    ConnectionStats *stats = &table->slots[index];
+    stats->used = 1;
+    stats->run_start_ms = run_start_ms;
+    stats->connection_id = connection_id;
+    table->size++;
+    return stats;
+}
+
+static void table_grow(ConnectionTable *table) {
+    ConnectionTable bigger;
+    bigger.capacity = table->capacity ? table->capacity * 2 : 1024;
+    bigger.size = 0;
+    bigger.slots = calloc(bigger.capacity, sizeof(ConnectionStats));
+
+    if (!bigger.slots) {
+        perror("Erro ao alocar tabela de conexões");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (!table->slots[i].used) continue;
+
+        size_t index = hash_key(table->slots[i].run_start_ms, table->slots[i].connection_id) & (bigger.capacity - 1);
+        while (bigger.slots[index].used) index = (index + 1) & (bigger.capacity - 1);
+
+        bigger.slots[index] = table->slots[i];
+        bigger.size++;
+    }
+
+    free(table->slots);
+    *table = bigger;
+}
+
+static void stats_add(ConnectionStats *stats, const float values[METRIC_COUNT]) {
+    if (stats->count == stats->capacity) {
+        stats->capacity = stats->capacity ? stats->capacity * 2 : 64;
+
+        for (int m = 0; m < METRIC_COUNT; m++) {
+            stats->values[m] = realloc(stats->values[m], stats->capacity * sizeof(float));
+
+            if (!stats->values[m]) {
+                perror("Erro ao alocar amostras");
+                exit(1);
+            }
+        }
+    }
+
+    for (int m = 0; m < METRIC_COUNT; m++) stats->values[m][stats->count] = values[m];
+    stats->count++;
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Percentil pelo método nearest-rank sobre o vetor já ordenado
+static double sorted_percentile(const float *values, size_t count, double percentile) {
+    if (count == 0) return 0.0;
+
+    size_t rank = (size_t)ceil(percentile / 100.0 * count);
+    if (rank < 1) rank = 1;
+    return values[rank - 1];
+}
+
+static void csv_write_header(FILE *csv_file) {
+    fprintf(csv_file, "ConnectionId,ClientIP,TimestampMS,");
+    fprintf(csv_file, "C2P_RTT_ms, C2P_RTTVAR_ms, C2P_Retrans, C2P_CWND, C2P_SSTHRESH, C2P_Throughput_kbps, C2P_Goodput_kbps,");
+    fprintf(csv_file, "P2S_RTT_ms, P2S_RTTVAR_ms, P2S_Retrans, P2S_CWND, P2S_SSTHRESH, P2S_Throughput_kbps, P2S_Goodput_kbps,");
+    fprintf(csv_file, "C2P_DeliveryRate_kbps, C2P_MinRTT_ms, C2P_Retrans_kbps, C2P_NotSent_bytes, C2P_TotalRetrans, C2P_LimitedBy,");
+    fprintf(csv_file, "P2S_DeliveryRate_kbps, P2S_MinRTT_ms, P2S_Retrans_kbps, P2S_NotSent_bytes, P2S_TotalRetrans, P2S_LimitedBy, Arm\n");
+}
+
+static void csv_write_record(FILE *csv_file, const MetricsBinRecord *record) {
+    char ip_str[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, record->client_ip, ip_str, sizeof(ip_str));
+
+    const MetricsBinLeg *c2p = &record->client_proxy;
+    const MetricsBinLeg *p2s = &record->proxy_server;
+
+    fprintf(csv_file, "%llu,%s,%llu,%.3f,%.3f,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%.3f,%.3f,"
+                      "%.3f,%.3f,%.3f,%u,%u,%s,%.3f,%.3f,%.3f,%u,%u,%s,%s\n",
+            (unsigned long long)record->connection_id, ip_str, (unsigned long long)record->timestamp_ms,
+            c2p->rtt_ms, c2p->rtt_var_ms, c2p->retransmits, c2p->cwnd_segments, c2p->ssthresh, c2p->throughput_kbps, c2p->goodput_kbps,
+            p2s->rtt_ms, p2s->rtt_var_ms, p2s->retransmits, p2s->cwnd_segments, p2s->ssthresh, p2s->throughput_kbps, p2s->goodput_kbps,
+            c2p->delivery_rate_kbps, c2p->min_rtt_ms, c2p->retrans_kbps, c2p->notsent_bytes, c2p->total_retrans, metrics_limited_code(c2p->limited_by),
+            p2s->delivery_rate_kbps, p2s->min_rtt_ms, p2s->retrans_kbps, p2s->notsent_bytes, p2s->total_retrans, metrics_limited_code(p2s->limited_by),
+            metrics_arm_code(record->arm));
+}
+
+/**
+ * Processa um arquivo inteiro via mmap
+ * @return Número de registros lidos, ou -1 se o arquivo não pôde ser lido
+ */
+static long process_file(const char *path, ConnectionTable *table, int use_client_leg,
+                         FILE *csv_file, int filter_enabled, uint64_t filter_id, int filter_arm) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0 || file_stat.st_size < METRICS_BIN_HEADER_SIZE) {
+        fprintf(stderr, "%s: arquivo vazio ou ilegível\n", path);
+        close(fd);
+        return -1;
+    }
+
+    size_t length = (size_t)file_stat.st_size;
+    const uint8_t *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    madvise((void*)data, length, MADV_SEQUENTIAL);
+
+    MetricsBinHeader header;
+    if (metrics_bin_decode_header(data, length, &header) < 0) {
+        fprintf(stderr, "%s: não é um log binário de métricas suportado\n", path);
+        munmap((void*)data, length);
+        return -1;
+    }
+
+    long records = 0;
+
+    // Um registro parcial no fim (proxy interrompido no meio da escrita) é ignorado
+    for (size_t offset = METRICS_BIN_HEADER_SIZE; offset + header.record_size <= length; offset += header.record_size) {
+        MetricsBinRecord record;
+        metrics_bin_decode_record(data + offset, header.record_size, &record);
+
+        if (filter_enabled && record.connection_id != filter_id) continue;
+        if (filter_arm >= 0 && record.arm != filter_arm) continue;
+
+        const MetricsBinLeg *leg = use_client_leg ? &record.client_proxy : &record.proxy_server;
+        float values[METRIC_COUNT] = { leg->rtt_ms, leg->throughput_kbps, (float)leg->cwnd_segments, (float)leg->retransmits };
+
+        ConnectionStats *stats = table_find(table, header.run_start_ms, record.connection_id);
+        memcpy(stats->client_ip, record.client_ip, 4);
+        stats_add(stats, values);
+
+        int limited = leg->limited_by < LIMITED_COUNT ? leg->limited_by : 0;
+        stats->limited[limited]++;
+        fleet_limited[limited]++;
+
+        for (int m = 0; m < METRIC_COUNT; m++) {
+            fleet[m].buckets[hist_index(values[m])]++;
+            fleet[m].total++;
+        }
+
+        if (csv_file) csv_write_record(csv_file, &record);
+        records++;
+    }
+
+    munmap((void*)data, length);
+    return records;
+}
+
+// Limitante mais frequente das amostras (desconhecido só se não houver outro), com a fração em %
+static int dominant_limit(const uint64_t *limited, double *share) {
+    uint64_t total = 0;
+    int best = 0;
+
+    for (int l = 0; l < LIMITED_COUNT; l++) {
+        total += limited[l];
+        if (l > 0 && limited[l] > 0 && (best == 0 || limited[l] > limited[best])) best = l;
+    }
+
+    *share = total ? 100.0 * limited[best] / total : 0.0;
+    return best;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Uso: %s [opções] <metrics.bin> [mais arquivos...]\n", program);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --csv <arquivo>   Exporta os registros em CSV (mesmo formato de logs/metrics.csv)\n");
+    fprintf(stderr, "  --conn <id>       Considera apenas a conexão com esse ConnectionId\n");
+    fprintf(stderr, "  --arm <braço>     Considera apenas as amostras de um braço do experimento A/B (none, off, model, legacy)\n");
+    fprintf(stderr, "  --leg <c2p|p2s>   Trecho analisado: Cliente <-> Proxy ou Proxy <-> Servidor (padrão: p2s)\n");
+    fprintf(stderr, "  --fleet-only      Exibe só os percentis de todas as conexões\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv_path = NULL;
+    int filter_enabled = 0;
+    uint64_t filter_id = 0;
+    int filter_arm = -1;
+    int use_client_leg = 0;
+    int fleet_only = 0;
+    int first_file = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (strcmp(argv[i], "--conn") == 0 && i + 1 < argc) {
+            filter_enabled = 1;
+            filter_id = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--arm") == 0 && i + 1 < argc) {
+            const char *arm = argv[++i];
+
+            for (int code = 0; code <= METRICS_ARM_POLICY + 1; code++) {
+                if (strcmp(arm, metrics_arm_code((uint8_t)code)) == 0) filter_arm = code;
+            }
+
+            if (filter_arm < 0) {
+                fprintf(stderr, "Braço '%s' desconhecido. Use none, off, model ou legacy.\n", arm);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--leg") == 0 && i + 1 < argc) {
+            use_client_leg = strcmp(argv[++i], "c2p") == 0;
+        } else if (strcmp(argv[i], "--fleet-only") == 0) {
+            fleet_only = 1;
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+
+    if (first_file >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *csv_file = NULL;
+
+    if (csv_path) {
+        csv_file = fopen(csv_path, "w");
+
+        if (!csv_file) {
+            perror(csv_path);
+            return 1;
+        }
+
+        setvbuf(csv_file, NULL, _IOFBF, 1 << 20);
+        csv_write_header(csv_file);
+    }
+
+    ConnectionTable table = { NULL, 0, 0 };
+    long total_records = 0;
+
+    for (int i = first_file; i < argc; i++) {
+        long records = process_file(argv[i], &table, use_client_leg, csv_file, filter_enabled, filter_id, filter_arm);
+        if (records > 0) total_records += records;
+    }
+
+    if (csv_file) fclose(csv_file);
+
+    printf("Arquivos: %d | Registros: %ld | Conexões: %zu | Trecho: %s",
+           argc - first_file, total_records, table.size, use_client_leg ? "Cliente <-> Proxy" : "Proxy <-> Servidor");
+    if (filter_arm >= 0) printf(" | Braço: %s", metrics_arm_code((uint8_t)filter_arm));
+    printf("\n\n");
+
+    if (!fleet_only) {
+        printf("%-10s %-15s %8s | %-26s | %-26s | %-20s | %-14s | %s\n", "Conexão", "Cliente", "Amostras",
+               "RTT ms p50/p90/p99", "Throughput kbps p50/p90/p99", "CWND p50/p90/p99", "Retrans p50/p90/p99", "Limitado por");
+
+        for (size_t i = 0; i < table.capacity; i++) {
+            ConnectionStats *stats = &table.slots[i];
+            if (!stats->used) continue;
+
+            double percentiles[METRIC_COUNT][3];
+
+            for (int m = 0; m < METRIC_COUNT; m++) {
+                qsort(stats->values[m], stats->count, sizeof(float), compare_float);
+                percentiles[m][0] = sorted_percentile(stats->values[m], stats->count, 50);
+                percentiles[m][1] = sorted_percentile(stats->values[m], stats->count, 90);
+                percentiles[m][2] = sorted_percentile(stats->values[m], stats->count, 99);
+            }
+
+            char ip_str[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, stats->client_ip, ip_str, sizeof(ip_str));
+
+            double limited_share;
+            int limited = dominant_limit(stats->limited, &limited_share);
+
+            printf("%-10llu %-15s %8zu | %8.3f/%8.3f/%8.3f | %8.1f/%8.1f/%8.1f | %6.0f/%6.0f/%6.0f | %4.0f/%4.0f/%4.0f | %s %.0f%%\n",
+                   (unsigned long long)stats->connection_id, ip_str, stats->count,
+                   percentiles[0][0], percentiles[0][1], percentiles[0][2],
+                   percentiles[1][0], percentiles[1][1], percentiles[1][2],
+                   percentiles[2][0], percentiles[2][1], percentiles[2][2],
+                   percentiles[3][0], percentiles[3][1], percentiles[3][2],
+                   metrics_limited_code((uint8_t)limited), limited_share);
+        }
+
+        printf("\n");
+    }
+
+    // Percentis de todas as conexões pelo histograma (erro relativo de até 1%)
+    printf("Todas as conexões:\n");
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        double p50 = hist_percentile(&fleet[m], 50);
+        double p90 = hist_percentile(&fleet[m], 90);
+        double p99 = hist_percentile(&fleet[m], 99);
+
+        if (metric_integral[m]) {
+            p50 = round(p50);
+            p90 = round(p90);
+            p99 = round(p99);
+        }
+
+        printf("  %-18s p50 %12.3f | p90 %12.3f | p99 %12.3f\n", metric_names[m], p50, p90, p99);
+    }
+
+    uint64_t limited_total = 0;
+    for (int l = 0; l < LIMITED_COUNT; l++) limited_total += fleet_limited[l];
+
+    printf("  %-18s", "Limitado por");
+    for (int l = 1; l < LIMITED_COUNT; l++) {
+        printf(" %s %.1f%%", metrics_limited_code((uint8_t)l), limited_total ? 100.0 * fleet_limited[l] / limited_total : 0.0);
+    }
+    if (fleet_limited[0] > 0) printf(" (sem classificação: %llu)", (unsigned long long)fleet_limited[0]);
+    printf("\n");
+
+    if (csv_path) printf("\nCSV exportado em: %s\n", csv_path);
+
+    for (size_t i = 0; i < table.capacity; i++) {
+        for (int m = 0; m < METRIC_COUNT; m++) free(table.slots[i].values[m]);
+    }
+    free(table.slots);
+
+    return 0;
+}
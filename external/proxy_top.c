@@ -0,0 +1,244 @@
+// Visualizador das estatísticas ao vivo do proxy (segmento /dev/shm/tcp_proxy_<porta>.stats)
+// Lê as vagas das conexões sem travar o proxy (seqlock) e mostra uma tabela ordenável, como o top:
+// t = throughput, r = RTT, x = retransmissões, q = sair
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+#include "../proxy/include/stats_segment.h"
+
+typedef enum {
+    SORT_THROUGHPUT = 0,
+    SORT_RTT,
+    SORT_RETRANS
+} SortKey;
+
+static const char *sort_names[] = { "throughput", "RTT", "retransmissões" };
+static const char *limited_names[] = { "-", "aplicação", "receptor", "sndbuf", "rede" };
+
+static struct termios saved_termios;
+static int terminal_raw = 0;
+
+static void terminal_restore(void) {
+    if (terminal_raw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+        printf("\033[?25h\n");
+        terminal_raw = 0;
+    }
+}
+
+static void handle_signal(int signal_number) {
+    (void)signal_number;
+    terminal_restore();
+    _exit(0);
+}
+
+// Teclas sem Enter e sem eco enquanto o proxy_top roda
+static void terminal_enter_raw(void) {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios) < 0) return;
+
+    struct termios raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    terminal_raw = 1;
+
+    atexit(terminal_restore);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    printf("\033[?25l");
+}
+
+static uint64_t now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static double slot_throughput(const StatsSlot *slot) {
+    return slot->client_proxy.throughput_kbps + slot->proxy_server.throughput_kbps;
+}
+
+static double slot_rtt(const StatsSlot *slot) {
+    return slot->client_proxy.rtt_ms > slot->proxy_server.rtt_ms ? slot->client_proxy.rtt_ms : slot->proxy_server.rtt_ms;
+}
+
+static double slot_retrans(const StatsSlot *slot) {
+    return (double)slot->client_proxy.total_retrans + slot->proxy_server.total_retrans;
+}
+
+static SortKey sort_key = SORT_THROUGHPUT;
+
+// Maior primeiro; empate pelo id (mais antiga primeiro) para a tabela não "pular"
+static int compare_slots(const void *a, const void *b) {
+    const StatsSlot *left = a, *right = b;
+    double left_value, right_value;
+
+    switch (sort_key) {
+        case SORT_RTT:     left_value = slot_rtt(left); right_value = slot_rtt(right); break;
+        case SORT_RETRANS: left_value = slot_retrans(left); right_value = slot_retrans(right); break;
+        default:           left_value = slot_throughput(left); right_value = slot_throughput(right); break;
+    }
+
+    if (left_value != right_value) return left_value < right_value ? 1 : -1;
+    return left->connection_id < right->connection_id ? -1 : left->connection_id > right->connection_id;
+}
+
+static const char* limited_name(uint8_t limited_by) {
+    return limited_by < sizeof(limited_names) / sizeof(limited_names[0]) ? limited_names[limited_by] : "?";
+}
+
+static void format_bytes(char *out, size_t out_len, double bytes) {
+    if (bytes >= 1073741824.0) snprintf(out, out_len, "%.1fG", bytes / 1073741824.0);
+    else if (bytes >= 1048576.0) snprintf(out, out_len, "%.1fM", bytes / 1048576.0);
+    else if (bytes >= 1024.0) snprintf(out, out_len, "%.1fK", bytes / 1024.0);
+    else snprintf(out, out_len, "%.0f", bytes);
+}
+
+// Uma tela: cabeçalho com os agregados e as conexões ordenadas (até caber no terminal)
+static void render(const StatsSegment *segment, StatsSlot *rows, int once) {
+    const StatsHeader *header = &segment->header;
+    size_t count = 0;
+    double total_throughput = 0;
+
+    for (uint32_t i = 0; i < header->slot_count; i++) {
+        if (!__atomic_load_n(&segment->slots[i].in_use, __ATOMIC_RELAXED)) continue;
+        if (stats_slot_read(&segment->slots[i], &rows[count]) == 0) {
+            total_throughput += slot_throughput(&rows[count]);
+            count++;
+        }
+    }
+
+    qsort(rows, count, sizeof(StatsSlot), compare_slots);
+
+    int max_rows = 1000000;
+    if (!once) {
+        struct winsize window;
+        max_rows = (ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == 0 && window.ws_row > 11) ? window.ws_row - 10 : 20;
+        printf("\033[H\033[2J");
+    }
+
+    uint64_t now = now_ms();
+    uint64_t opened = __atomic_load_n(&header->connections_opened, __ATOMIC_RELAXED);
+    uint64_t closed = __atomic_load_n(&header->connections_closed, __ATOMIC_RELAXED);
+    char to_server[16], to_client[16], pools[16], rss[16];
+
+    format_bytes(to_server, sizeof(to_server), (double)__atomic_load_n(&header->bytes_client_to_server, __ATOMIC_RELAXED));
+    format_bytes(to_client, sizeof(to_client), (double)__atomic_load_n(&header->bytes_server_to_client, __ATOMIC_RELAXED));
+    format_bytes(pools, sizeof(pools), (double)__atomic_load_n(&header->pool_in_use_bytes, __ATOMIC_RELAXED));
+    format_bytes(rss, sizeof(rss), (double)__atomic_load_n(&header->rss_bytes, __ATOMIC_RELAXED));
+
+    int alive = kill(header->pid, 0) == 0 || errno == EPERM;
+
+    printf("proxy_top - porta %d, pid %d (%s), engine %s, ativo há %lus%s\n", header->listen_port, header->pid,
+           alive ? "rodando" : "ENCERRADO", header->engine, (unsigned long)((now - header->start_ms) / 1000),
+           once ? "" : "   [t] throughput [r] RTT [x] retrans [q] sair");
+    printf("Conexões: %lu ativas | %lu abertas | %lu encerradas | %lu sem vaga | Throughput: %.1f Mbit/s\n",
+           (unsigned long)(opened - closed), (unsigned long)opened, (unsigned long)closed,
+           (unsigned long)__atomic_load_n(&header->slots_exhausted, __ATOMIC_RELAXED), total_throughput / 1000.0);
+    printf("Tráfego: %s Cliente -> Servidor | %s Servidor -> Cliente | Pools: %s | RSS: %s | Logs descartados: %lu\n",
+           to_server, to_client, pools, rss, (unsigned long)__atomic_load_n(&header->log_dropped, __ATOMIC_RELAXED));
+    printf("Admissão: %lu recusadas | %lu na fila de connect | %lu conectando | %lu pausas do accept\n",
+           (unsigned long)__atomic_load_n(&header->admission_rejected, __ATOMIC_RELAXED),
+           (unsigned long)__atomic_load_n(&header->admission_queued, __ATOMIC_RELAXED),
+           (unsigned long)__atomic_load_n(&header->admission_connecting, __ATOMIC_RELAXED),
+           (unsigned long)__atomic_load_n(&header->admission_pauses, __ATOMIC_RELAXED));
+    printf("Ordenado por %s\n\n", sort_names[sort_key]);
+
+    printf("%8s %-22s %-22s %6s %8s %8s %10s %10s %8s %8s %6s %6s %-10s %-10s\n",
+           "ID", "CLIENTE", "BACKEND", "IDADE", "C->S", "S->C", "THR C kb", "THR S kb", "RTT C", "RTT S", "RET C", "RET S", "LIM C", "LIM S");
+
+    for (size_t i = 0; i < count && (int)i < max_rows; i++) {
+        const StatsSlot *slot = &rows[i];
+        char up[16], down[16];
+
+        format_bytes(up, sizeof(up), (double)slot->bytes_client_to_server);
+        format_bytes(down, sizeof(down), (double)slot->bytes_server_to_client);
+
+        printf("%8lu %-22.22s %-22.22s %5lus %8s %8s %10.1f %10.1f %8.2f %8.2f %6u %6u %-10s %-10s\n",
+               (unsigned long)slot->connection_id, slot->client, slot->backend,
+               (unsigned long)(now > slot->opened_ms ? (now - slot->opened_ms) / 1000 : 0), up, down,
+               slot->client_proxy.throughput_kbps, slot->proxy_server.throughput_kbps,
+               slot->client_proxy.rtt_ms, slot->proxy_server.rtt_ms,
+               slot->client_proxy.total_retrans, slot->proxy_server.total_retrans,
+               limited_name(slot->client_proxy.limited_by), limited_name(slot->proxy_server.limited_by));
+    }
+
+    if ((int)count > max_rows) printf("... e mais %zu conexões\n", count - (size_t)max_rows);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Parametros: <porta_do_proxy | arquivo> [--sort thr|rtt|retrans] [--interval ms] [--once]\n");
+        exit(1);
+    }
+
+    char path[256];
+    int interval_ms = 1000;
+    int once = 0;
+
+    // Porta (segmento padrão do proxy) ou caminho do arquivo
+    if (strchr(argv[1], '/')) snprintf(path, sizeof(path), "%s", argv[1]);
+    else snprintf(path, sizeof(path), STATS_SEGMENT_PATH_FORMAT, atoi(argv[1]));
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            const char *key = argv[++i];
+            if (strcmp(key, "rtt") == 0) sort_key = SORT_RTT;
+            else if (strcmp(key, "retrans") == 0) sort_key = SORT_RETRANS;
+            else sort_key = SORT_THROUGHPUT;
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+            if (interval_ms < 100) interval_ms = 100;
+        } else if (strcmp(argv[i], "--once") == 0) {
+            once = 1;
+        }
+    }
+
+    const StatsSegment *segment = stats_segment_attach(path);
+    if (!segment) {
+        fprintf(stderr, "Segmento de estatísticas %s não encontrado ou inválido (o proxy está rodando?)\n", path);
+        exit(1);
+    }
+
+    StatsSlot *rows = malloc((size_t)segment->header.slot_count * sizeof(StatsSlot));
+    if (!rows) {
+        perror("Erro ao alocar tabela");
+        exit(1);
+    }
+
+    if (once) {
+        render(segment, rows, 1);
+        return 0;
+    }
+
+    terminal_enter_raw();
+
+    while (1) {
+        render(segment, rows, 0);
+
+        // Sem terminal (ex.: saída redirecionada) só espera o intervalo
+        struct pollfd input = { .fd = terminal_raw ? STDIN_FILENO : -1, .events = POLLIN };
+        if (poll(&input, 1, interval_ms) > 0) {
+            char key;
+            if (read(STDIN_FILENO, &key, 1) == 1) {
+                if (key == 'q') break;
+                if (key == 't') sort_key = SORT_THROUGHPUT;
+                if (key == 'r') sort_key = SORT_RTT;
+                if (key == 'x') sort_key = SORT_RETRANS;
+            }
+        }
+    }
+
+    return 0;
+}
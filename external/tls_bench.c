@@ -0,0 +1,311 @@
+// Benchmark de TLS através do proxy (--tls-cert / --tls-backend)
+//   handshake: várias threads abrem conexões TLS, trocam um byte com o eco e fecham (handshakes/s)
+//   bulk:      conexões enviam dados sem parar para um sink (throughput cifrado; --plain envia sem TLS)
+//   server:    backend TLS de eco ou sink, para medir a origem TLS do proxy (--tls-backend)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#define BULK_CHUNK 65536
+
+typedef struct {
+    struct sockaddr_in address;
+    SSL_CTX *context;           // NULL = texto puro (--plain)
+    double deadline;
+    double measure_from;        // Bytes antes disso (handshake e início da janela) não contam
+    unsigned long operations;   // Handshakes completos (handshake) ou bytes enviados (bulk)
+    unsigned long errors;
+    double latency_total_ms;
+    double latency_max_ms;
+} BenchThread;
+
+static double now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+static int bench_connect(const struct sockaddr_in *address) {
+    int sock_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock_fd < 0) return -1;
+
+    // Fecha com RST: evita esgotar portas em TIME_WAIT
+    struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(sock_fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+
+    int opt = 1;
+    setsockopt(sock_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    if (connect(sock_fd, (const struct sockaddr*)address, sizeof(*address)) < 0) {
+        close(sock_fd);
+        return -1;
+    }
+
+    return sock_fd;
+}
+
+// Handshake completo (sem retomada de sessão), um byte de ida e volta e fechamento
+static int bench_handshake_one(BenchThread *thread) {
+    int sock_fd = bench_connect(&thread->address);
+    if (sock_fd < 0) return -1;
+
+    SSL *ssl = SSL_new(thread->context);
+    char byte = 'x';
+    int result = -1;
+
+    SSL_set_fd(ssl, sock_fd);
+    if (SSL_connect(ssl) == 1 && SSL_write(ssl, &byte, 1) == 1 && SSL_read(ssl, &byte, 1) == 1) result = 0;
+
+    ERR_clear_error();
+    SSL_free(ssl);
+    close(sock_fd);
+    return result;
+}
+
+static void* bench_handshake_thread(void *args) {
+    BenchThread *thread = (BenchThread*)args;
+
+    while (1) {
+        double start = now_ms();
+        if (start >= thread->deadline) break;
+
+        if (bench_handshake_one(thread) < 0) {
+            thread->errors++;
+            continue;
+        }
+
+        double elapsed = now_ms() - start;
+        thread->operations++;
+        thread->latency_total_ms += elapsed;
+        if (elapsed > thread->latency_max_ms) thread->latency_max_ms = elapsed;
+    }
+
+    return NULL;
+}
+
+static void* bench_bulk_thread(void *args) {
+    BenchThread *thread = (BenchThread*)args;
+    static char chunk[BULK_CHUNK];
+    int sock_fd = bench_connect(&thread->address);
+    SSL *ssl = NULL;
+
+    if (sock_fd < 0) {
+        thread->errors++;
+        return NULL;
+    }
+
+    if (thread->context) {
+        ssl = SSL_new(thread->context);
+        SSL_set_fd(ssl, sock_fd);
+
+        if (SSL_connect(ssl) != 1) {
+            thread->errors++;
+            SSL_free(ssl);
+            close(sock_fd);
+            return NULL;
+        }
+    }
+
+    while (1) {
+        double now = now_ms();
+        if (now >= thread->deadline) break;
+
+        int sent = ssl ? SSL_write(ssl, chunk, sizeof(chunk)) : (int)send(sock_fd, chunk, sizeof(chunk), MSG_NOSIGNAL);
+        if (sent <= 0) {
+            thread->errors++;
+            break;
+        }
+
+        if (now >= thread->measure_from) thread->operations += (unsigned long)sent;
+    }
+
+    if (ssl) SSL_free(ssl);
+    close(sock_fd);
+    return NULL;
+}
+
+// Backend TLS: uma thread por conexão, eco ou descarte do que chega
+typedef struct {
+    SSL_CTX *context;
+    int client_fd;
+    int echo;
+} ServerConnection;
+
+static void* bench_server_connection(void *args) {
+    ServerConnection *connection = (ServerConnection*)args;
+    SSL *ssl = SSL_new(connection->context);
+    static __thread char buffer[BULK_CHUNK];
+
+    SSL_set_fd(ssl, connection->client_fd);
+
+    if (SSL_accept(ssl) == 1) {
+        int received;
+
+        while ((received = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+            if (connection->echo && SSL_write(ssl, buffer, received) <= 0) break;
+        }
+    }
+
+    ERR_clear_error();
+    SSL_free(ssl);
+    close(connection->client_fd);
+    free(connection);
+    return NULL;
+}
+
+static int bench_server(int port, const char *cert_file, const char *key_file, int echo) {
+    SSL_CTX *context = SSL_CTX_new(TLS_server_method());
+
+    if (!context || SSL_CTX_use_certificate_chain_file(context, cert_file) != 1 ||
+        SSL_CTX_use_PrivateKey_file(context, key_file, SSL_FILETYPE_PEM) != 1) {
+        fprintf(stderr, "Erro ao carregar certificado '%s' e chave '%s'\n", cert_file, key_file);
+        ERR_print_errors_fp(stderr);
+        return 1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 1024) < 0) {
+        perror("Erro ao escutar");
+        return 1;
+    }
+
+    printf("Backend TLS (%s) escutando na porta %d\n", echo ? "eco" : "sink", port);
+
+    while (1) {
+        int client_fd = accept(listen_fd, NULL, NULL);
+        if (client_fd < 0) continue;
+
+        ServerConnection *connection = malloc(sizeof(ServerConnection));
+        pthread_t thread;
+
+        connection->context = context;
+        connection->client_fd = client_fd;
+        connection->echo = echo;
+
+        if (pthread_create(&thread, NULL, bench_server_connection, connection) != 0) {
+            close(client_fd);
+            free(connection);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        printf("Parametros: handshake <host> <porta> [threads=4] [segundos=10]\n");
+        printf("            bulk <host> <porta> [conexões=1] [segundos=10] [--plain]\n");
+        printf("            server <porta> <cert.pem> [chave.pem] [eco|sink]\n");
+        exit(1);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (strcmp(argv[1], "server") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Uso: server <porta> <cert.pem> [chave.pem] [eco|sink]\n");
+            exit(1);
+        }
+        const char *key_file = argc > 4 && strcmp(argv[4], "eco") != 0 && strcmp(argv[4], "sink") != 0 ? argv[4] : argv[3];
+        int echo = strcmp(argv[argc - 1], "eco") == 0;
+        return bench_server(atoi(argv[2]), argv[3], key_file, echo);
+    }
+
+    int handshake = strcmp(argv[1], "handshake") == 0;
+    if (!handshake && strcmp(argv[1], "bulk") != 0) {
+        fprintf(stderr, "Modo '%s' desconhecido. Use handshake, bulk ou server.\n", argv[1]);
+        exit(1);
+    }
+    if (argc < 4) {
+        fprintf(stderr, "Informe host e porta\n");
+        exit(1);
+    }
+
+    int thread_count = argc > 4 ? atoi(argv[4]) : (handshake ? 4 : 1);
+    int seconds = argc > 5 ? atoi(argv[5]) : 10;
+    int plain = argc > 6 && strcmp(argv[6], "--plain") == 0;
+    if (thread_count < 1) thread_count = 1;
+    if (seconds < 1) seconds = 1;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(atoi(argv[3]));
+
+    if (inet_pton(AF_INET, argv[2], &address.sin_addr) <= 0) {
+        fprintf(stderr, "Endereço inválido: %s\n", argv[2]);
+        exit(1);
+    }
+
+    // Certificados autoassinados: o benchmark não verifica o servidor
+    SSL_CTX *context = NULL;
+    if (!plain) {
+        context = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+    }
+
+    BenchThread *threads = calloc(thread_count, sizeof(BenchThread));
+    pthread_t *thread_ids = calloc(thread_count, sizeof(pthread_t));
+    double start = now_ms();
+
+    // No bulk, o primeiro segundo (handshake e crescimento das janelas) fica fora da medida
+    double measure_from = handshake ? start : start + 1000.0;
+    if (!handshake && seconds < 2) seconds = 2;
+
+    for (int i = 0; i < thread_count; i++) {
+        threads[i].address = address;
+        threads[i].context = context;
+        threads[i].deadline = start + seconds * 1000.0;
+        threads[i].measure_from = measure_from;
+        pthread_create(&thread_ids[i], NULL, handshake ? bench_handshake_thread : bench_bulk_thread, &threads[i]);
+    }
+
+    unsigned long operations = 0, errors = 0;
+    double latency_total_ms = 0, latency_max_ms = 0;
+
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(thread_ids[i], NULL);
+        operations += threads[i].operations;
+        errors += threads[i].errors;
+        latency_total_ms += threads[i].latency_total_ms;
+        if (threads[i].latency_max_ms > latency_max_ms) latency_max_ms = threads[i].latency_max_ms;
+    }
+
+    double elapsed_s = (now_ms() - measure_from) / 1000.0;
+
+    if (handshake) {
+        printf("Handshakes: %lu em %.2f s (%d threads)\n", operations, elapsed_s, thread_count);
+        printf("Taxa:       %.0f handshakes/s\n", operations / elapsed_s);
+        printf("Latência:   média %.3f ms | máx %.3f ms\n", operations ? latency_total_ms / operations : 0.0, latency_max_ms);
+    } else {
+        printf("Enviados:   %.1f MB em %.2f s (%d conexões, %s)\n", operations / 1048576.0, elapsed_s, thread_count, plain ? "texto puro" : "TLS");
+        printf("Throughput: %.1f Mbit/s\n", operations * 8.0 / elapsed_s / 1e6);
+    }
+    printf("Erros:      %lu\n", errors);
+
+    free(threads);
+    free(thread_ids);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+// Controle de admissão no accept: limites de conexões simultâneas, de taxa de accept e de connect()
+// em andamento com os backends. Acima deles o proxy recusa cedo (RST) ou para de aceitar e deixa
+// os SYNs no backlog do kernel, em vez de aceitar tudo e degradar todas as conexões
+#define ADMISSION_CONNECT_QUEUE_DEFAULT 256     // Conexões aceitas esperando uma vaga de connect()
+#define ADMISSION_QUEUE_TIMEOUT_DEFAULT_MS 1000 // Tempo máximo nessa fila antes do RST
+#define ADMISSION_RETRY_MS 5                    // Reavaliação da fila e da pausa sem evento que as acorde
+
+// O que fazer com uma conexão acima dos limites
+typedef enum {
+    ADMISSION_SHED_RESET = 0,   // Aceita e fecha com RST: o cliente sabe na hora que precisa tentar depois
+    ADMISSION_SHED_PAUSE        // Para de chamar accept(): o backlog enche e o kernel segura os SYNs
+} AdmissionShedMode;
+
+// Limites (zero = sem limite)
+typedef struct {
+    int max_connections;        // Conexões simultâneas (aceitas e ainda abertas)
+    int accept_rate;            // Novas conexões por segundo (token bucket)
+    int accept_burst;           // Rajada acima da taxa (padrão: um décimo da taxa, no mínimo 1)
+    int max_connecting;         // connect() com os backends em andamento ao mesmo tempo
+    int connect_queue;          // Conexões aceitas à espera de uma vaga de connect() (padrão: ADMISSION_CONNECT_QUEUE_DEFAULT)
+    int queue_timeout_ms;       // Tempo máximo na fila (padrão: ADMISSION_QUEUE_TIMEOUT_DEFAULT_MS)
+    AdmissionShedMode shed_mode;
+} AdmissionConfig;
+
+// Resultado da admissão de uma conexão recém-aceita
+typedef enum {
+    ADMISSION_ADMIT = 0,
+    ADMISSION_REJECT_LIMIT,     // max_connections atingido
+    ADMISSION_REJECT_RATE,      // Sem tokens de accept
+    ADMISSION_REJECT_QUEUE,     // Fila de connect() cheia
+    ADMISSION_REJECT_TIMEOUT    // Esperou mais que queue_timeout_ms por uma vaga de connect()
+} AdmissionVerdict;
+
+// Contadores (todas as engines)
+typedef struct {
+    unsigned long active;       // Conexões admitidas e ainda abertas
+    unsigned long connecting;   // connect() em andamento
+    unsigned long queued;       // Na fila de connect() agora
+    unsigned long queue_peak;   // Maior fila observada
+    unsigned long admitted;
+    unsigned long rejected_limit;
+    unsigned long rejected_rate;
+    unsigned long rejected_queue;
+    unsigned long rejected_timeout;
+    unsigned long pauses;       // Vezes que o accept parou por estar no limite (--overload pause)
+} AdmissionStats;
+
+// Guarda os limites (antes de aceitar a primeira conexão)
+void admission_init(const AdmissionConfig *config);
+
+// 1 se algum limite está configurado
+int admission_enabled(void);
+
+// 1 se excessos seguram o accept em vez de receber RST
+int admission_pauses_accept(void);
+
+/**
+ * Com --overload pause, diz se o accept deve esperar (limite de conexões, taxa ou fila cheia)
+ * @return ms até a próxima reavaliação, ou 0 se pode aceitar agora
+ */
+int admission_pause_ms(void);
+
+/**
+ * Decide sobre uma conexão recém-aceita. Admitida, ela conta em max_connections até admission_release
+ * @return ADMISSION_ADMIT ou o motivo da recusa (para admission_reject)
+ */
+AdmissionVerdict admission_accept(void);
+
+// Fecha a conexão recusada com RST (SO_LINGER 0) e conta o motivo; ADMISSION_REJECT_QUEUE
+// e ADMISSION_REJECT_TIMEOUT são de conexões já admitidas, que também liberam a vaga
+void admission_reject(int client_fd, AdmissionVerdict verdict);
+
+// Conexão admitida encerrada (connection_pair_close ou falha antes de formar o par)
+void admission_release(void);
+
+/**
+ * Reserva uma vaga de connect() sem esperar (engines epoll e io_uring)
+ * @return 1 se reservou (ou não há limite), 0 se todas estão em uso
+ */
+int admission_connect_try(void);
+
+/**
+ * Engine threads: espera uma vaga de connect() na fila limitada por até queue_timeout_ms
+ * @return ADMISSION_ADMIT com a vaga reservada, ADMISSION_REJECT_QUEUE ou ADMISSION_REJECT_TIMEOUT
+ */
+AdmissionVerdict admission_connect_wait(void);
+
+// connect() terminou (sucesso ou erro): libera a vaga
+void admission_connect_done(void);
+
+// Conexão aceita à espera de uma vaga de connect() na fila de um worker
+typedef struct AdmissionWaiting {
+    int client_fd;
+    struct sockaddr_in client_address;
+    uint64_t accepted_ns;               // Momento do accept() (latency_now_ns)
+    unsigned long deadline_ms;          // Prazo antes do RST (get_monotonic_ms)
+    struct AdmissionWaiting *next;
+} AdmissionWaiting;
+
+// Fila de connect() de um worker das engines orientadas a eventos, em ordem de chegada (zerada = vazia).
+// Só o worker dono mexe nela; o total de todas as filas é limitado por --connect-queue
+typedef struct {
+    AdmissionWaiting *head;
+    AdmissionWaiting *tail;
+} AdmissionQueue;
+
+// Inicia uma conexão com a vaga de connect() já reservada (cada engine tem a sua)
+typedef void (*AdmissionStartCallback)(void *context, int client_fd, const struct sockaddr_in *client_address, uint64_t accepted_ns);
+
+/**
+ * Conexão admitida (admission_accept) chega ao worker: inicia na hora se há vaga de connect() e
+ * ninguém esperando na fila dele; senão entra na fila e, com ela cheia, recebe RST
+ */
+void admission_queue_admit(AdmissionQueue *queue, int client_fd, const struct sockaddr_in *client_address, uint64_t accepted_ns,
+                           AdmissionStartCallback start, void *context);
+
+/**
+ * Inicia as conexões da fila que já têm vaga de connect() e recusa as que passaram do prazo
+ * @return ms até a próxima tentativa, ou -1 se a fila ficou vazia
+ */
+int admission_queue_drain(AdmissionQueue *queue, AdmissionStartCallback start, void *context);
+
+void admission_get_stats(AdmissionStats *stats);
+
+// Nome do modo para o banner
+const char* admission_shed_name(AdmissionShedMode mode);
+
+#endif
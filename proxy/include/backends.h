@@ -0,0 +1,77 @@
+#ifndef BACKENDS_H
+#define BACKENDS_H
+
+#include <sys/socket.h>
+#include "proxy.h"
+
+#define BACKEND_HOST_MAX 256
+#define BACKEND_RTT_ALPHA 0.125          // Peso de cada amostra no RTT suavizado (igual ao SRTT do TCP)
+#define BACKEND_RTT_TIE_RATIO 1.1        // RTTs a menos de 10% um do outro empatam e a taxa entregue decide
+#define BACKEND_EJECT_FAILURES 2         // Falhas seguidas para ejetar um backend
+#define BACKEND_RESTORE_SUCCESSES 2      // Sucessos seguidos para readmitir um backend ejetado
+
+// Um servidor de destino, com endereço resolvido uma única vez na inicialização
+typedef struct Backend {
+    char host[BACKEND_HOST_MAX];
+    int port;
+    struct sockaddr_storage address;
+    socklen_t address_len;
+    char address_str[BACKEND_HOST_MAX];  // "ip:porta" para logs
+
+    int healthy;                         // 0 = ejetado pela verificação de saúde
+    int consecutive_failures;
+    int consecutive_successes;
+
+    int active_connections;              // Conexões de clientes atendidas agora
+    double srtt_ms;                      // RTT suavizado do trecho Proxy <-> Servidor (0 = sem amostra)
+    double delivery_kbps;                // Taxa entregue suavizada nas amostras não limitadas pela aplicação (0 = sem amostra)
+    double last_probe_ms;                // Tempo do último connect de verificação
+
+    unsigned long total_connections;
+    unsigned long connect_failures;
+} Backend;
+
+/**
+ * Resolve o destino principal (config->target_host/target_port) e os extras de --backend
+ * Aceita IPv4, IPv6 e nomes (resolvidos uma vez e guardados)
+ * @return 0 em sucesso, -1 se algum backend não puder ser resolvido
+ */
+int backends_init(ProxyConfig *config);
+
+// Inicia a thread de verificação ativa de saúde (connect periódico em cada backend)
+int backends_start_health_checks(ProxyConfig *config);
+
+/**
+ * Escolhe o backend para uma nova conexão pela política configurada e conta a conexão nele
+ * Se todos estiverem ejetados, escolhe entre todos (melhor tentar do que recusar o cliente)
+ */
+Backend* backends_acquire(void);
+
+// Número de backends configurados
+int backends_count(void);
+
+// Backend pelo índice (0 = destino principal), ou NULL fora do intervalo
+Backend* backends_get(int index);
+
+// Indica se o backend está saudável (leitura com o lock)
+int backends_is_healthy(Backend *backend);
+
+// Devolve a conexão contada em backends_acquire
+void backends_release(Backend *backend);
+
+/**
+ * Atualiza o RTT e a taxa entregue suavizados com uma amostra do TCP_INFO do trecho Proxy <-> Servidor
+ * @param delivery_kbps tcpi_delivery_rate da amostra, ou 0 se o trecho estava limitado pela aplicação
+ */
+void backends_report_sample(Backend *backend, double rtt_ms, double delivery_kbps);
+
+// Registra uma falha de connect de cliente (conta para a ejeção)
+void backends_report_failure(Backend *backend);
+
+// Exibe o estado dos backends no console
+void backends_print_status(void);
+
+// Nome da política para logs
+const char* backends_policy_name(LoadBalancePolicy policy);
+
+#endif
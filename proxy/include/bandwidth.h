@@ -0,0 +1,104 @@
+#ifndef BANDWIDTH_H
+#define BANDWIDTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+// Escalonador global de banda (--bw-limit): um orçamento total do proxy dividido entre os IPs de
+// cliente pelos pesos de --bw-weight. A cada rodada as parcelas são recalculadas por partilha justa
+// max-min ponderada (quem usa menos que a sua parte fica com o que usa e o resto vai para os demais)
+// e repostas em um balde de tokens por cliente, que limita as leituras do relay. Dentro do cliente, cada
+// conexão lê no máximo um quantum por rodada (o balde dividido pelas conexões que leram na rodada
+// anterior, como no deficit round-robin). O SO_MAX_PACING_RATE dos sockets de destino acompanha a
+// parcela, para o kernel espaçar o que a leitura libera em blocos
+#define BANDWIDTH_ROUND_MS 10               // Intervalo da redistribuição e da reposição dos tokens
+#define BANDWIDTH_BURST_MS 50               // Tokens acumulados no máximo, em tempo da parcela do cliente
+#define BANDWIDTH_MIN_BURST 16384           // Menor balde: uma leitura útil mesmo com parcela pequena
+#define BANDWIDTH_DEMAND_GAIN 1.5           // Cliente sem fila pede até 1,5x o que usou (espaço para crescer)
+#define BANDWIDTH_PACING_GAIN 1.25          // Pacing um pouco acima da parcela: quem limita é o balde
+#define BANDWIDTH_PACING_CHANGE 0.1         // Variação mínima da parcela para refazer o pacing
+#define BANDWIDTH_MAX_CLIENTS 4096          // IPs distintos com balde próprio (os demais dividem um)
+#define BANDWIDTH_MAX_WEIGHTS 32
+#define BANDWIDTH_REPORT_CLIENTS 8          // Clientes listados na linha [Banda]
+
+// Direções sujeitas ao orçamento
+typedef enum {
+    BANDWIDTH_DOWN = 0,     // Servidor -> Cliente (padrão)
+    BANDWIDTH_UP,           // Cliente -> Servidor
+    BANDWIDTH_BOTH          // As duas, somadas no mesmo balde do cliente
+} BandwidthDirection;
+
+// Peso de um IP ou rede (--bw-weight 10.0.0.0/24=4); a primeira regra que casa vale
+typedef struct {
+    uint32_t network;       // Ordem de rede, já com a máscara aplicada
+    uint32_t mask;
+    int weight;
+} BandwidthWeight;
+
+typedef struct {
+    double rate_bytes_sec;  // Orçamento total (0 = desativado)
+    BandwidthDirection direction;
+    BandwidthWeight weights[BANDWIDTH_MAX_WEIGHTS];
+    int weight_count;
+} BandwidthConfig;
+
+// Balde e parcela de um IP de cliente (compartilhado por todas as conexões dele)
+typedef struct BandwidthClient BandwidthClient;
+
+// Quantum de uma direção de uma conexão na rodada atual
+typedef struct {
+    unsigned long round;    // Rodada do cliente em que used foi contado
+    long used;              // Bytes lidos nesta rodada
+} BandwidthQuota;
+
+/**
+ * Lê uma regra "ip[/prefixo]=peso" para a configuração
+ * @return 0 em sucesso, -1 se o formato é inválido ou há regras demais
+ */
+int bandwidth_parse_weight(BandwidthConfig *config, const char *spec);
+
+/**
+ * Guarda o orçamento e inicia a thread que redistribui as parcelas a cada BANDWIDTH_ROUND_MS
+ * @return 0 em sucesso, -1 se a thread não pôde ser criada
+ */
+int bandwidth_start(const BandwidthConfig *config);
+
+// 1 se o escalonador está rodando
+int bandwidth_enabled(void);
+
+// Balde do IP da conexão (criado na primeira conexão dele); conta a conexão até bandwidth_release
+BandwidthClient* bandwidth_acquire(const struct sockaddr_in *address);
+
+void bandwidth_release(BandwidthClient *client);
+
+/**
+ * Reserva tokens para uma leitura de até wanted bytes, dentro do quantum da conexão
+ * @return Bytes que podem ser lidos agora (0 = sem tokens ou quantum até a próxima rodada)
+ */
+size_t bandwidth_take(BandwidthClient *client, BandwidthQuota *quota, size_t wanted);
+
+// Acerta a reserva depois da leitura: devolve o que não foi lido e registra o uso
+void bandwidth_settle(BandwidthClient *client, BandwidthQuota *quota, size_t wanted, size_t granted, size_t used);
+
+// 1 se a conexão está sem tokens ou sem quantum (a leitura espera a próxima rodada)
+int bandwidth_blocked(const BandwidthClient *client, const BandwidthQuota *quota);
+
+// ms até a próxima reposição de tokens
+int bandwidth_wait_ms(void);
+
+/**
+ * Pacing de cada conexão do cliente: a parcela inteira dele, nunca abaixo da parte garantida pelo peso
+ * (não é dividida pelas conexões: o pacing só espaça os envios; quem limita o total do cliente é o balde)
+ * @param generation Última versão aplicada pela conexão (atualizada quando há valor novo)
+ * @return 1 se o valor mudou desde generation, 0 caso contrário
+ */
+int bandwidth_pacing_rate(BandwidthClient *client, unsigned long *generation, unsigned long *rate_bytes_sec);
+
+// Linha [Banda]: orçamento, uso e, por cliente ativo, peso, parcela e taxa obtida
+void bandwidth_print_status(void);
+
+// Nome da direção para o banner
+const char* bandwidth_direction_name(BandwidthDirection direction);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+#define CC_NAME_MAX 16
+#define CC_CLASSIFY_SAMPLES 3            // Amostras de TCP_INFO antes de classificar o caminho
+
+// Limiares da classificação
+#define CC_LOSSY_RATE 0.01               // Retransmissões / segmentos enviados acima de 1%
+#define CC_JITTER_RATIO 0.5              // rttvar / rtt médio acima disso
+#define CC_QUEUE_RATIO 1.5               // RTT acima de 1,5x o min RTT indica fila no gargalo
+#define CC_QUEUE_MIN_MS 2.0              // ... desde que a fila some pelo menos 2 ms (ignora ruído em loopback/LAN)
+#define CC_JITTER_MIN_MS 1.0             // rttvar abaixo disso nunca conta como jitter
+#define CC_HIGH_BDP_BYTES (1024 * 1024)  // BDP acima de 1 MB
+#define CC_HIGH_RTT_MS 50.0              // Ou RTT de propagação acima de 50 ms
+
+// Seleção do controle de congestionamento (--cc)
+typedef enum {
+    CC_MODE_OFF = 0,       // Mantém o padrão do sistema
+    CC_MODE_AUTO,          // Classifica cada trecho e escolhe o algoritmo
+    CC_MODE_FIXED          // Usa o algoritmo de config->cc_algorithm nos dois trechos
+} CongestionControlMode;
+
+// Classe do caminho de um trecho
+typedef enum {
+    PATH_UNKNOWN = 0,
+    PATH_NORMAL,           // Sem sinais de problema
+    PATH_LOSSY,            // Perdas frequentes
+    PATH_BANDWIDTH_LIMITED, // Fila crescendo no gargalo (bufferbloat)
+    PATH_HIGH_BDP,         // Banda alta e/ou RTT longo
+    PATH_JITTERY           // RTT muito variável
+} PathClass;
+
+struct ConnectionMetrics;
+
+// Amostras acumuladas de um trecho até a classificação
+typedef struct {
+    int samples;
+    int decided;                         // 1 = algoritmo já escolhido (classificação é feita uma vez)
+    double rtt_sum_ms;
+    double rtt_var_sum_ms;
+    double min_rtt_ms;
+    double max_delivery_bytes_sec;
+    int queued_samples;                  // Amostras com RTT acima de CC_QUEUE_RATIO * min RTT
+    unsigned int total_retrans;
+    unsigned int segs_out;
+    PathClass path_class;
+    char algorithm[CC_NAME_MAX];         // Algoritmo em uso no socket
+} PathClassifier;
+
+// Inicializa o classificador e, no modo fixo, aplica o algoritmo configurado ao socket
+void cc_classifier_init(PathClassifier *classifier, int sock_fd, CongestionControlMode mode, const char *algorithm, const char *leg_name);
+
+// Acumula uma amostra; ao completar CC_CLASSIFY_SAMPLES classifica o caminho e troca o algoritmo (modo auto)
+void cc_classifier_sample(PathClassifier *classifier, int sock_fd, const struct ConnectionMetrics *metrics, const char *leg_name);
+
+/**
+ * Troca o controle de congestionamento de um socket (TCP_CONGESTION)
+ * @return 0 em sucesso, -1 se o algoritmo não está disponível ou não é permitido
+ */
+int cc_set_algorithm(int sock_fd, const char *algorithm);
+
+// Nome da classe do caminho para logs
+const char* cc_path_class_name(PathClass path_class);
+
+#endif
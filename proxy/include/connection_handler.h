@@ -2,13 +2,128 @@
 #define CONNECTION_HANDLER_H
 
 #include "proxy.h"
+#include "backends.h"
+
+// Intervalo de monitoramento (logs em texto): base da coleta de TCP_INFO (--sample-ms)
+#define MONITOR_INTERVAL_MS 3000
+
+// Amostragem adaptativa: no slow start (e na primeira amostra) o intervalo cai para a base / 4, com
+// piso de SAMPLE_MIN_INTERVAL_MS; sem bytes no intervalo, dobra a cada amostra até a base * 8
+#define SAMPLE_MIN_INTERVAL_MS 250
+#define SAMPLE_SLOW_START_DIVISOR 4
+#define SAMPLE_IDLE_MAX_FACTOR 8
+#define SAMPLE_MAX_INTERVAL_MS 3600000       // Maior --sample-ms (1 h)
+
+#define CONNECTION_IDLE_TIMEOUT_DEFAULT_S 300    // Conexão sem tráfego é encerrada após esse tempo
+#define CONNECTION_KEEPALIVE_DEFAULT_S 60        // Ociosidade até o primeiro probe de keepalive
+#define CONNECTION_KEEPALIVE_PROBES 3            // Probes sem resposta até o kernel derrubar a conexão
+#define CONNECTION_THREAD_STACK_SIZE (256 * 1024) // Pilha de cada thread da engine threads (o padrão é 8 MB)
 
 typedef struct {
     int client_socket;                  // Socket do cliente que acabou de conectar
     ProxyConfig *config;                // Ponteiro para a configuração do proxy
     struct sockaddr_in client_address;  // Endereço do cliente (para logs)
+    uint64_t accepted_ns;               // Momento do accept() (latency_now_ns), base da latência de conexão
 } ConnectionThreadArgs;
 
+/**
+ * Escolhe o backend, obtém um socket conectado do pool ou cria o socket para ele e inicia a conexão
+ * @param nonblocking Se 1, o socket é não-bloqueante e o connect pode ficar em andamento (EINPROGRESS)
+ * @param connection_id Id de connection_accepted (grava CONNECT_START antes do connect)
+ * @param backend_out Backend escolhido (contado em backends_acquire; liberado em connection_pair_close)
+ * @return O socket do servidor, ou -1 em erro com errno (o backend já é liberado)
+ */
+int connection_connect_upstream(ProxyConfig *config, int nonblocking, unsigned long connection_id, Backend **backend_out);
+
+/**
+ * Dá o id à conexão aceita e grava o ACCEPT no gravador de voo, antes do connect com o backend
+ * @param accepted_ns Momento do accept() do cliente (latency_now_ns)
+ * @return O id da conexão (coluna ConnectionId do log)
+ */
+unsigned long connection_accepted(int client_socket, uint64_t accepted_ns);
+
+/**
+ * Inicializa o par de conexões: endereços, backend, canais de encaminhamento e métricas
+ * @param connection_id Id de connection_accepted
+ * @param accepted_ns Momento do accept() do cliente (latency_now_ns), base das latências de conexão e TTFB
+ */
+void connection_pair_init(ConnectionPair *pair, ProxyConfig *config, unsigned long connection_id, int client_socket, int server_socket, const struct sockaddr_in *client_address, Backend *backend, uint64_t accepted_ns);
+
+// Backend conectado: grava a latência accept -> connect (com --stats-port) e o evento do gravador de voo
+void connection_pair_connected(ConnectionPair *pair);
+
+// connect() com o backend falhou (error = errno): grava o evento e a causa do encerramento que vem a seguir
+void connection_pair_connect_failed(ConnectionPair *pair, int error);
+
+// connect síncrono ou handshake TLS com o backend falhou antes do par existir: grava CONNECT_DONE e CLOSE
+void connection_connect_aborted(unsigned long connection_id, uint64_t accepted_ns, int error);
+
+// Conexão encerrada antes do par existir (TLS com o cliente, fila de admissão, memória): grava só o CLOSE
+void connection_aborted(unsigned long connection_id, int reason, int error);
+
+// Causa do encerramento do par (FlightCloseReason), gravada no connection_pair_close; a primeira vale
+void connection_pair_set_close_reason(ConnectionPair *pair, int reason, int error);
+
+/**
+ * Acompanha o tempo até o primeiro byte da resposta (com --stats-port): marca o primeiro byte lido do
+ * cliente e grava a amostra quando algo já foi entregue a ele. As engines com relay próprio chamam direto
+ * @param delivered_to_client Bytes já enviados ao cliente
+ */
+void connection_ttfb_update(ConnectionPair *pair, unsigned long delivered_to_client);
+
+// Entrega ao par as sessões TLS dos handshakes (NULL = trecho em texto puro); liberadas em connection_pair_close
+void connection_pair_set_tls(ConnectionPair *pair, TlsSession *client_session, TlsSession *server_session);
+
+/**
+ * Encaminha dados nas duas direções sem bloquear (sockets não-bloqueantes)
+ * Com --fastpath, passa o par para o kernel na primeira rodada em que os dois canais ficam vazios
+ * @return 0 se a conexão continua, 1 se os dois lados encerraram (FIN propagado), -1 em erro
+ */
+int connection_relay(ConnectionPair *pair);
+
+/**
+ * Tempo até o par precisar de connection_relay sem evento de socket: dados retidos pela emulação de WAN,
+ * leitura parada pelo escalonador de banda ou dados decifrados guardados pelo OpenSSL
+ * @return ms (0 = já pode encaminhar), ou -1 se nada está retido
+ */
+int connection_pending_wait_ms(ConnectionPair *pair);
+
+/**
+ * Tempo até a próxima verificação de um FIN retido à espera da entrega do fast path (connection_relay
+ * verifica); o intervalo dobra de SOCKMAP_FIN_CHECK_MS até SOCKMAP_FIN_CHECK_MAX_MS enquanto o destino
+ * não aceita mais nada
+ * @return ms (0 = já pode verificar), ou -1 sem FIN retido
+ */
+int connection_fin_wait_ms(const ConnectionPair *pair);
+
+/**
+ * Tempo até a conexão completar config->idle_timeout_ms sem tráfego (peer morto ou esquecido)
+ * @return ms restantes, 0 se já expirou, ou -1 sem --idle-timeout
+ */
+int connection_idle_remaining_ms(const ConnectionPair *pair, const ProxyConfig *config);
+
+// Conexões abertas em todas as engines
+unsigned long connection_active_count(void);
+
+/**
+ * Cria o segmento de memória compartilhada onde cada conexão publica suas métricas (lido pelo proxy_top)
+ * Sem o segmento o proxy funciona normalmente, só não publica
+ * @param path_out Recebe o caminho do segmento
+ * @return 0 em sucesso, -1 em erro
+ */
+int connection_stats_start(ProxyConfig *config, char *path_out, size_t path_len);
+
+// Atualiza os agregados do cabeçalho do segmento (no máximo a cada STATS_HEADER_REFRESH_MS). Chamada
+// também fora das conexões estabelecidas, para que recusas em sobrecarga apareçam no proxy_top
+void connection_stats_publish_header(void);
+
+// Coleta métricas, exibe/loga e aplica as políticas de otimização; depois escolhe o intervalo até a
+// próxima coleta (pair->sample_interval_ms), que cada engine agenda
+void connection_monitor_tick(ConnectionPair *pair, ProxyConfig *config);
+
+// Fecha os sockets, as sessões TLS e os canais do par e devolve o backend (com --stats-port, exibe o resumo de latências)
+void connection_pair_close(ConnectionPair *pair);
+
 // Função principal da thread.
 // Gerencia o ciclo de vida de um par de conexões (cliente e servidor) e encaminha os dados
 void* handle_connection(void* args);
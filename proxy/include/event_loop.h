@@ -0,0 +1,20 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "proxy.h"
+
+/**
+ * Inicia o pool de workers do modo epoll (config->num_workers threads)
+ * Cada worker roda seu próprio loop epoll edge-triggered sobre vários ConnectionPair
+ * Com config->reuseport, cada worker abre seu socket de escuta e aceita as próprias conexões
+ * @return 0 em sucesso, -1 em erro
+ */
+int event_loop_start(ProxyConfig *config);
+
+/**
+ * Entrega um socket recém aceito para um dos workers (round-robin)
+ * @return 0 em sucesso, -1 em erro (o socket não é fechado)
+ */
+int event_loop_dispatch(int client_fd, const struct sockaddr_in *client_address);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef EXPERIMENT_H
+#define EXPERIMENT_H
+
+#include <stddef.h>
+
+#include "tcp_optimizer.h"
+
+// Experimento A/B entre as políticas do otimizador (--ab off=1,legacy=1,model=2): cada conexão nova cai
+// em um braço sorteado pelos pesos (hash do id da conexão com a semente da execução) e usa a política dele
+// do início ao fim. No encerramento, o resultado da conexão entra nas estatísticas do braço: média e
+// intervalo de 95% do throughput, do RTT e da taxa de retransmissão, e p50/p90 do throughput. Os braços
+// dividem o mesmo tráfego ao mesmo tempo: a comparação não depende de execuções separadas sob redes
+// diferentes. Com --ab-promote N, o braço que supera todos os outros passa a receber todas as conexões
+#define EXPERIMENT_MAX_ARMS 4
+#define EXPERIMENT_RESERVOIR 512        // Throughputs guardados por braço para os percentis (amostragem de reservatório)
+#define EXPERIMENT_REPORT_EVERY 100     // Conexões encerradas entre os relatórios no console
+#define EXPERIMENT_CI_Z 1.96            // Intervalo de confiança de 95% exibido no relatório
+#define EXPERIMENT_PROMOTE_Z 2.58       // Promoção a 99%: o teste é repetido a cada relatório e cada olhada é uma chance de falso positivo
+
+// Braço do experimento: sem otimização ou uma política
+typedef struct {
+    int optimize;               // 0 = braço sem otimização (política ignorada)
+    OptimizerPolicyType policy;
+    int weight;                 // Parte das conexões novas (relativa à soma dos pesos)
+} ExperimentArmSpec;
+
+typedef struct {
+    int arm_count;              // 0 = sem experimento (vale --optimize/--policy para todas as conexões)
+    ExperimentArmSpec arms[EXPERIMENT_MAX_ARMS];
+    int promote_min;            // Conexões encerradas em cada braço antes de tentar promover (0 = nunca promove)
+} ExperimentConfig;
+
+// Acompanhamento de uma conexão pelo braço dela
+typedef struct {
+    int arm;                    // Índice do braço (-1 = fora do experimento)
+    unsigned long busy_acked_bytes; // Bytes confirmados nos dois trechos nos intervalos em que algum trecho estava ocupado
+    unsigned long busy_ms;      // Duração somada desses intervalos (o intervalo das coletas varia: --sample-ms adaptativo)
+    unsigned long last_acked;   // tcpi_bytes_acked dos dois trechos na coleta anterior
+    unsigned long last_sample_ms;
+    unsigned long started_ms;   // Criação do par (get_monotonic_ms), base do throughput de conexões sem intervalos ocupados
+} ExperimentTrack;
+
+// Resultado de uma conexão encerrada
+typedef struct {
+    double throughput_kbps;     // Bytes confirmados / tempo nos intervalos ocupados, ou bytes encaminhados / duração
+    double rtt_client_ms;       // RTT suavizado do trecho Cliente <-> Proxy no encerramento
+    double rtt_server_ms;       // RTT suavizado do trecho Proxy <-> Servidor (onde a política legacy atua)
+    double retrans_pct;         // Segmentos retransmitidos / enviados nos dois trechos (%)
+} ExperimentOutcome;
+
+/**
+ * Lê a lista "braço=peso,..." (braços: off, model, legacy; peso padrão 1) para a configuração
+ * @return 0 em sucesso, -1 se o formato é inválido, um braço se repete ou há braços demais
+ */
+int experiment_parse_arms(ExperimentConfig *config, const char *spec);
+
+// Guarda os braços e sorteia a semente da execução (sem braços, o experimento fica desativado)
+void experiment_start(const ExperimentConfig *config);
+
+// 1 se há um experimento rodando
+int experiment_enabled(void);
+
+// Braço de uma conexão nova: o promovido, se já houver, ou o sorteado pelos pesos
+int experiment_assign(unsigned long connection_id);
+
+/**
+ * Política de um braço
+ * @return A política, ou NULL no braço sem otimização
+ */
+const OptimizerPolicy* experiment_arm_policy(int arm);
+
+// Nome do braço ("off" ou o nome da política)
+const char* experiment_arm_name(int arm);
+
+// Código do braço gravado no log de métricas (METRICS_ARM_*, metrics_format.h); -1 vira METRICS_ARM_NONE
+int experiment_arm_code(int arm);
+
+// Soma o resultado de uma conexão encerrada ao braço; a cada EXPERIMENT_REPORT_EVERY, exibe o relatório e tenta promover
+void experiment_record(int arm, const ExperimentOutcome *outcome);
+
+// Relatório por braço (peso, conexões, médias com IC de 95%, percentis do throughput e o promovido)
+size_t experiment_format(char *out, size_t out_len);
+
+#endif
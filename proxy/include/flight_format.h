@@ -0,0 +1,82 @@
+#ifndef FLIGHT_FORMAT_H
+#define FLIGHT_FORMAT_H
+
+#include <stdint.h>
+
+// Formato dos despejos do gravador de voo (logs/flight-<ms>.bin): cabeçalho + eventos de tamanho fixo,
+// copiados da memória como estão (ordem de bytes da máquina que gravou; o decodificador recusa outra)
+#define FLIGHT_MAGIC 0x54484c46             // "FLHT" no início do arquivo (lido como uint32)
+#define FLIGHT_VERSION 1
+
+// Tipos de evento. Gravados no arquivo: só acrescente no fim
+typedef enum {
+    FLIGHT_EVENT_ACCEPT = 1,        // value = fd do cliente (instante do accept)
+    FLIGHT_EVENT_CONNECT_START,     // value = fd do servidor
+    FLIGHT_EVENT_CONNECT_DONE,      // error = errno do connect (EPROTO = handshake TLS; 0 = conectado); value = ns desde o accept
+    FLIGHT_EVENT_READ,              // value = bytes (0 = FIN); -1 com error (EAGAIN = origem vazia)
+    FLIGHT_EVENT_WRITE,             // value = bytes aceitos pelo destino; -1 com error (EAGAIN = destino cheio)
+    FLIGHT_EVENT_BLOCKED,           // Destino cheio com dados pendentes; value = bytes pendentes
+    FLIGHT_EVENT_UNBLOCKED,         // Destino voltou a aceitar; value = ns bloqueado
+    FLIGHT_EVENT_PAUSED,            // Canal cheio: a origem deixa de ser lida; value = bytes pendentes
+    FLIGHT_EVENT_RESUMED,           // Canal com espaço de novo; value = ns pausado
+    FLIGHT_EVENT_SHUTDOWN,          // FIN propagado ao destino (shutdown SHUT_WR)
+    FLIGHT_EVENT_BUFFER,            // Otimizador ajustou os buffers; value = SO_SNDBUF em bytes; error = errno do setsockopt
+    FLIGHT_EVENT_PACING,            // Otimizador ajustou SO_MAX_PACING_RATE; value = bytes/s (-1 = sem limite)
+    FLIGHT_EVENT_STALL,             // Destino cheio há mais de --flight-stall-ms; value = ns bloqueado
+    FLIGHT_EVENT_CLOSE,             // value = causa (FlightCloseReason); error = errno da causa
+    FLIGHT_EVENT_TYPES
+} FlightEventType;
+
+// Socket de um evento: leituras são da origem, envios e bloqueios são do destino
+typedef enum {
+    FLIGHT_SIDE_NONE = 0,
+    FLIGHT_SIDE_CLIENT,
+    FLIGHT_SIDE_SERVER
+} FlightSide;
+
+// Causa do encerramento de uma conexão. Gravada no arquivo: só acrescente no fim
+typedef enum {
+    FLIGHT_CLOSE_UNKNOWN = 0,
+    FLIGHT_CLOSE_DONE,              // FIN dos dois lados e tudo entregue
+    FLIGHT_CLOSE_ERROR,             // Erro de leitura ou envio em um dos sockets
+    FLIGHT_CLOSE_CONNECT_FAILED,    // connect() com o backend falhou
+    FLIGHT_CLOSE_IDLE,              // --idle-timeout
+    FLIGHT_CLOSE_INTERNAL,          // Falha do proxy (epoll_ctl, poll, fila do io_uring)
+    FLIGHT_CLOSE_REJECTED,          // Recusada pela fila de connect (--connect-queue, --queue-timeout)
+    FLIGHT_CLOSE_REASONS
+} FlightCloseReason;
+
+// Evento de tamanho fixo (32 bytes, também o formato do arquivo)
+typedef struct {
+    uint64_t timestamp_ns;          // latency_now_ns (CLOCK_MONOTONIC)
+    uint64_t connection_id;
+    uint16_t type;                  // FlightEventType
+    uint8_t side;                   // FlightSide
+    uint8_t reserved;
+    int32_t error;                  // errno (0 = sucesso)
+    int64_t value;
+} FlightEvent;
+
+// Cabeçalho do arquivo, seguido de event_count eventos (de cada anel em ordem; o decodificador ordena)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t event_size;
+    uint32_t reason;                // FlightDumpReason
+    uint32_t ring_count;
+    uint64_t dumped_ns;             // Momento do despejo no relógio dos eventos
+    uint64_t dumped_wall_ms;        // O mesmo momento no relógio de parede (converte os timestamps)
+    uint64_t event_count;
+} FlightDumpHeader;
+
+typedef enum {
+    FLIGHT_DUMP_SIGNAL = 1,         // SIGUSR2
+    FLIGHT_DUMP_STALL               // Destino parado por mais de --flight-stall-ms
+} FlightDumpReason;
+
+// Nomes dos eventos, lados e causas de encerramento ("?" fora da faixa)
+const char* flight_event_name(int type);
+const char* flight_side_name(int side);
+const char* flight_close_reason_name(int reason);
+
+#endif
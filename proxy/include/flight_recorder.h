@@ -0,0 +1,58 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+
+#include "flight_format.h"
+
+// Gravador de voo (sempre ligado; --no-flight desliga): cada thread que encaminha grava o ciclo de vida das
+// conexões em um anel binário próprio de tamanho fixo, que sobrescreve os eventos mais antigos. Gravar é um
+// clock_gettime (vDSO) e um store de 32 bytes, sem trava e sem syscall. Os anéis vão para o disco
+// (logs/flight-<ms>.bin) com SIGUSR2 ou quando um destino fica cheio por mais de --flight-stall-ms; o
+// flight_decoder transforma o arquivo em uma linha do tempo por conexão
+#define FLIGHT_RING_EVENTS 16384            // Eventos por anel (potência de 2): 512 KB por thread
+#define FLIGHT_MAX_RINGS 64                 // Threads com anel próprio; as demais dividem um anel (atômico)
+#define FLIGHT_STALL_DEFAULT_MS 2000
+#define FLIGHT_DUMP_MIN_INTERVAL_MS 10000   // Entre despejos por parada: uma rede travada para muitas conexões de uma vez
+#define FLIGHT_FILE_PREFIX "logs/flight-"
+
+typedef struct {
+    int enabled;                    // 0 = --no-flight (gravar vira um teste de flag)
+    int stall_ms;                   // Destino cheio por mais que isso despeja os anéis (0 = só com SIGUSR2)
+} FlightConfig;
+
+/**
+ * Guarda a configuração, cria a thread que escreve os despejos e instala o SIGUSR2
+ * @return 0 em sucesso (ou desativado), -1 em erro
+ */
+int flight_recorder_start(const FlightConfig *config);
+
+int flight_recorder_enabled(void);
+
+// Grava um evento no anel da thread atual
+void flight_record(unsigned long connection_id, FlightEventType type, FlightSide side, int error, int64_t value);
+
+// Grava um evento com instante já medido (ex: o accept, antes da conexão ter id)
+void flight_record_at(uint64_t timestamp_ns, unsigned long connection_id, FlightEventType type, FlightSide side, int error, int64_t value);
+
+/**
+ * Conexão cujos ajustes de socket esta thread está fazendo: apply_buffer_tuning e apply_tcp_pacing gravam
+ * os eventos do otimizador nela, com o lado pelo fd (connection_id 0 = nenhuma, os ajustes não são gravados)
+ */
+void flight_recorder_enter(unsigned long connection_id, int client_fd, int server_fd);
+void flight_recorder_leave(void);
+
+// Ajuste de socket do otimizador na conexão marcada por flight_recorder_enter
+void flight_record_socket(FlightEventType type, int sock_fd, int error, int64_t value);
+
+/**
+ * Destino parado há blocked_ns: passando de --flight-stall-ms, grava FLIGHT_EVENT_STALL e pede um
+ * despejo (no máximo um a cada FLIGHT_DUMP_MIN_INTERVAL_MS)
+ * @return 1 se a parada passou do limite (quem chama não avisa de novo a mesma parada), 0 se não
+ */
+int flight_recorder_stall(unsigned long connection_id, FlightSide side, uint64_t blocked_ns);
+
+// Devolve o anel da thread atual (threads que terminam, como no modo legado); os eventos continuam no anel
+void flight_release_thread_ring(void);
+
+#endif
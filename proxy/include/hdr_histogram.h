@@ -0,0 +1,21 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Buckets do histograma log-linear usado pelo proxy (latency_stats.c) e pelo loadgen: o mesmo valor cai
+// na mesma faixa dos dois lados. Valores abaixo de HDR_SUB_BUCKETS são exatos; acima, cada potência de 2
+// tem HDR_SUB_BUCKETS/2 faixas (erro relativo < 0,8%)
+#define HDR_SUB_BITS 8
+#define HDR_SUB_BUCKETS (1 << HDR_SUB_BITS)
+#define HDR_HALF_BUCKETS (HDR_SUB_BUCKETS / 2)
+#define HDR_MAX_SHIFT 33                    // Cobre até ~2^41 ns (mais de 30 min)
+#define HDR_BUCKETS (HDR_SUB_BUCKETS + HDR_MAX_SHIFT * HDR_HALF_BUCKETS)
+
+// Bucket de um valor (valores além do alcance caem no último)
+int hdr_index(uint64_t value);
+
+// Meio da faixa do bucket
+uint64_t hdr_value(int index);
+
+#endif
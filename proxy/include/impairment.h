@@ -0,0 +1,101 @@
+#ifndef IMPAIRMENT_H
+#define IMPAIRMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IMPAIR_MAX_SEGMENTS 4096             // Blocos lidos e ainda retidos por direção
+#define IMPAIR_BUFFER_SIZE (4 * 1024 * 1024) // Buffer do canal com emulação (comporta o BDP de links longos)
+#define IMPAIR_MIN_BUFFER_SIZE (64 * 1024)   // Menor buffer do canal com taxa limitada
+#define IMPAIR_DEFAULT_STALL_MS 200.0        // Parada por "perda" (RTO mínimo do Linux)
+#define IMPAIR_DEFAULT_BURST 16384           // Rajada do token bucket em bytes
+#define IMPAIR_QUEUE_LATENCY_MS 400.0        // Com taxa limitada, a fila comporta esse tempo de dados
+
+// Distribuição do jitter somado ao atraso de cada bloco
+typedef enum {
+    JITTER_UNIFORM = 0,    // Uniforme em [-jitter, +jitter]
+    JITTER_NORMAL          // Normal com desvio padrão = jitter (como o netem com distribution normal)
+} JitterDistribution;
+
+// Parâmetros de uma direção (zero = sem efeito)
+typedef struct {
+    double delay_ms;
+    double jitter_ms;
+    JitterDistribution distribution;
+    double loss_rate;      // Probabilidade de um bloco ser "perdido" (0 a 1)
+    double stall_ms;       // Atraso extra de um bloco perdido (retransmissão emulada)
+    double rate_bytes_sec; // Token bucket (0 = sem limite)
+    size_t burst_bytes;
+} ImpairmentParams;
+
+// Configuração global: direção Servidor -> Cliente (down) e Cliente -> Servidor (up)
+typedef struct {
+    int enabled;
+    const char *preset;
+    ImpairmentParams down;
+    ImpairmentParams up;
+    unsigned long seed;
+} ImpairmentConfig;
+
+typedef struct {
+    uint64_t release_us;   // Quando o bloco pode ser entregue ao destino
+    size_t length;
+} ImpairSegment;
+
+// Estado de uma direção de uma conexão
+typedef struct {
+    ImpairmentParams params;
+    uint64_t rng;                          // Gerador determinístico (semente + conexão + direção)
+    ImpairSegment segments[IMPAIR_MAX_SEGMENTS];
+    size_t segment_head;
+    size_t segment_count;
+    uint64_t last_release_us;              // Entrega em ordem: um bloco nunca passa o anterior
+    double tokens;
+    uint64_t last_refill_us;
+    unsigned long losses;                  // Blocos "perdidos" (paradas emuladas)
+} ImpairmentState;
+
+/**
+ * Aplica um preset dos cenários do README (ideal, leve, moderado, gargalo, long, caotica)
+ * @return 0 em sucesso, -1 se o nome não existe
+ */
+int impairment_apply_preset(ImpairmentConfig *config, const char *name);
+
+/**
+ * Lê uma lista "delay=100,jitter=50,dist=normal,loss=2,stall=200,rate=5000,burst=4096" para uma direção
+ * (delay/jitter/stall em ms, loss em %, rate em kbit/s, burst em bytes)
+ * @return 0 em sucesso, -1 se alguma chave ou valor é inválido
+ */
+int impairment_parse_spec(ImpairmentParams *params, const char *spec);
+
+// A direção tem algum efeito configurado
+int impairment_params_active(const ImpairmentParams *params);
+
+// Descreve a direção em texto para o banner
+void impairment_describe(const ImpairmentParams *params, char *out, size_t out_len);
+
+// Inicializa o estado de uma direção com semente própria
+void impairment_state_init(ImpairmentState *state, const ImpairmentParams *params, uint64_t seed);
+
+// Relógio monotônico em microssegundos
+uint64_t impairment_now_us(void);
+
+// Há espaço para registrar mais um bloco
+int impairment_can_enqueue(const ImpairmentState *state);
+
+// Registra um bloco recém lido, sorteando atraso, jitter e perda
+void impairment_enqueue(ImpairmentState *state, size_t length, uint64_t now_us);
+
+// Bytes que já podem ser entregues agora (blocos liberados, limitados pelos tokens)
+size_t impairment_sendable(ImpairmentState *state, uint64_t now_us);
+
+// Desconta bytes entregues dos blocos e dos tokens
+void impairment_consume(ImpairmentState *state, size_t length);
+
+/**
+ * Tempo até o próximo byte poder ser entregue
+ * @return ms (0 = já pode), ou -1 se não há nada retido
+ */
+int impairment_wait_ms(ImpairmentState *state, uint64_t now_us);
+
+#endif
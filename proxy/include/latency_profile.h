@@ -0,0 +1,36 @@
+#ifndef LATENCY_PROFILE_H
+#define LATENCY_PROFILE_H
+
+#include "proxy.h"
+
+// Perfil de baixa latência (--latency) para cargas de requisição/resposta com mensagens pequenas
+#define LATENCY_NOTSENT_LOWAT_DEFAULT 16384 // Bytes não enviados acima dos quais o socket deixa de ser gravável
+#define LATENCY_FASTOPEN_QUEUE 256          // Fila de TFO do socket de escuta (SYNs com dados pendentes)
+#define LATENCY_DEFER_ACCEPT_S 1            // O accept só acontece quando chegam dados (ou após esse tempo)
+
+/**
+ * Socket de escuta: TCP Fast Open (dados já no SYN) com --latency e, com --client-first, TCP_DEFER_ACCEPT
+ * (a conexão só chega ao proxy junto com a primeira requisição)
+ */
+void latency_apply_listener(int listen_fd, const ProxyConfig *config);
+
+/**
+ * Socket do servidor antes do connect, com --client-first: TCP_FASTOPEN_CONNECT (a primeira escrita vai
+ * no SYN quando há cookie). O SYN espera a primeira escrita do cliente, por isso não serve para servidores
+ * que falam primeiro (SMTP, SSH, banners): os dois lados ficariam esperando
+ */
+void latency_apply_upstream(int server_socket, const ProxyConfig *config);
+
+// Os dois trechos: TCP_NODELAY (sem Nagle) e TCP_NOTSENT_LOWAT (pouco dado parado no buffer de envio)
+void latency_apply_socket(int sock_fd, const ProxyConfig *config);
+
+// ACK imediato dos dados recebidos (TCP_QUICKACK não é permanente: é reaplicado após cada leitura)
+void latency_quickack(int sock_fd);
+
+/**
+ * Lê net.ipv4.tcp_fastopen (bit 1 = cliente, bit 2 = servidor)
+ * @return O valor do sysctl, ou -1 se não disponível
+ */
+int latency_fastopen_sysctl(void);
+
+#endif
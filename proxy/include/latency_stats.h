@@ -0,0 +1,59 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Latências adicionadas pelo proxy (--stats-port): accept -> backend conectado, tempo até o primeiro
+// byte da resposta e, por bloco encaminhado, o tempo entre a leitura na origem e o envio completo ao
+// destino. Cada thread grava em histogramas próprios (sem trava: um só escritor por vaga); o endpoint
+// local soma as vagas quando é consultado e responde os percentis em texto (HTTP ou TCP puro), seguidos
+// do relatório do experimento A/B quando há um (--ab)
+
+#define LATENCY_MAX_SLOTS 64                // Threads com histogramas próprios; as demais dividem uma vaga (atômica)
+#define LATENCY_STATS_BACKLOG 16
+#define LATENCY_REQUEST_TIMEOUT_MS 200      // Espera pela requisição HTTP; sem ela (ex: nc), responde só o texto
+
+// Medidas com histograma global
+typedef enum {
+    LATENCY_CONNECT = 0,    // accept() -> backend conectado (engine threads: inclui os handshakes TLS)
+    LATENCY_TTFB,           // Primeiro byte do cliente (ou accept, se o servidor fala primeiro) -> primeiro byte entregue ao cliente
+    LATENCY_RELAY,          // Bloco lido da origem -> envio completo ao destino (as duas direções)
+    LATENCY_METRICS
+} LatencyMetric;
+
+// Resumo de uma direção de uma conexão (exibido no encerramento)
+typedef struct {
+    unsigned long count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} LatencySummary;
+
+/**
+ * Ativa a medição e sobe a thread do endpoint em 127.0.0.1:port
+ * @return 0 em sucesso (ou port == 0: medição desativada), -1 se a porta não pôde ser aberta
+ */
+int latency_stats_start(int port);
+
+// 1 se as latências estão sendo medidas
+int latency_stats_enabled(void);
+
+// Relógio das medidas (CLOCK_MONOTONIC, ns)
+uint64_t latency_now_ns(void);
+
+// Grava uma amostra no histograma da thread atual (a vaga é obtida na primeira amostra)
+void latency_record(LatencyMetric metric, uint64_t value_ns);
+
+// Soma uma amostra ao resumo de uma conexão
+void latency_summary_add(LatencySummary *summary, uint64_t value_ns);
+
+// Devolve a vaga da thread atual (fim de uma thread da engine threads); as contagens continuam somando
+void latency_release_thread_slot(void);
+
+/**
+ * Relatório com contagem, percentis (p50, p90, p99, p99.9), máximo e média de cada medida, somando todas as vagas
+ * @return Tamanho do texto escrito em out
+ */
+size_t latency_stats_format(char *out, size_t out_len);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include "proxy.h"
+
+#define LISTEN_BACKLOG_DEFAULT 1024   // Fila de conexões pendentes (SYNs completos aguardando accept)
+
+/**
+ * Cria o socket de escuta do proxy na porta configurada, com o backlog de config->listen_backlog
+ * @param reuseport Se 1, ativa SO_REUSEPORT para que vários sockets dividam a mesma porta
+ * @return O socket, ou -1 em erro
+ */
+int listener_open(ProxyConfig *config, int reuseport);
+
+/**
+ * Pede ao kernel que entregue a este socket (do grupo SO_REUSEPORT) as conexões
+ * cujos pacotes foram processados na CPU indicada (SO_INCOMING_CPU)
+ * @return 0 em sucesso, -1 em erro
+ */
+int listener_set_incoming_cpu(int listen_fd, int cpu);
+
+// CPU associada a um worker: worker_id módulo o número de núcleos
+int listener_worker_cpu(int worker_id);
+
+/**
+ * Fixa a thread atual na CPU do worker (listener_worker_cpu)
+ * @return A CPU escolhida, ou -1 em erro
+ */
+int listener_pin_worker(int worker_id);
+
+#endif
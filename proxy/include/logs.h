@@ -3,14 +3,42 @@
 
 #include "proxy.h"
 
+#define LOG_DIR "logs"
+#define LOG_FILE_NAME "logs/metrics.csv"
+#define LOG_BIN_FILE_NAME "logs/metrics.bin"      // --log-format bin (formato em metrics_format.h)
+#define LOG_RING_CAPACITY 4096          // Registros por anel (potência de 2)
+#define LOG_MAX_RINGS 256               // Anéis disponíveis (um por thread produtora ativa)
+#define LOG_FLUSH_INTERVAL_MS 200       // Intervalo em que a thread de escrita esvazia os anéis
+#define LOG_ROTATE_BYTES (64L * 1024 * 1024) // Tamanho em que o log é rotacionado
+#define LOG_ROTATE_KEEP 5               // Arquivos antigos mantidos (metrics.csv.1 ... .5)
+
+// Registro de tamanho fixo com uma amostra de métricas de uma conexão
+typedef struct {
+    unsigned long connection_id;
+    char client_ip[INET_ADDRSTRLEN];
+    int arm;                            // Braço do experimento A/B (METRICS_ARM_*, metrics_format.h)
+    ConnectionMetrics client_proxy;
+    ConnectionMetrics proxy_server;
+} MetricsRecord;
+
+/**
+ * Inicia a thread que esvazia os anéis em lotes e escreve em um único log rotacionado
+ * no formato de config->log_format (CSV ou binário)
+ * @return 0 em sucesso, -1 em erro
+ */
+int logs_start(ProxyConfig *config);
+
 /**
- * Abre um arquivo de log CSV e escreve o cabeçalho
- * @return O file descriptor do arquivo, ou -1 em erro
+ * Enfileira um registro no anel da thread atual (SPSC, sem lock e sem I/O)
+ * Com o anel cheio o registro é descartado e contado, o encaminhamento nunca espera o disco
  */
-FILE* open_log_file(const char* client_ip);
+void logs_submit(const MetricsRecord *record);
+
+// Devolve o anel da thread atual ao conjunto livre (threads que terminam, como no modo legado)
+void logs_release_thread_ring(void);
 
-// Escreve uma linha de métricas nos arquivos de log CSV
-void log_metrics_csv(FILE *log_file, ConnectionMetrics *metrics_client_proxy, ConnectionMetrics *metrics_proxy_server);
+// Registros descartados por anel cheio ou falta de anéis
+unsigned long logs_dropped_count(void);
 
 // Exibe as métricas atuais no console (interface de texto)
 void display_metrics_text(ConnectionMetrics *metrics_client_proxy, ConnectionMetrics *metrics_proxy_server);
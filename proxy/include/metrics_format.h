@@ -0,0 +1,77 @@
+#ifndef METRICS_FORMAT_H
+#define METRICS_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Formato binário do log de métricas (logs/metrics.bin)
+// Arquivo = cabeçalho + registros de tamanho fixo, todos os campos em little-endian
+#define METRICS_BIN_MAGIC "TPXM"
+#define METRICS_BIN_VERSION 3          // Versão 3: braço do experimento A/B no byte 20 (antes reservado, sempre zero)
+#define METRICS_BIN_HEADER_SIZE 24
+#define METRICS_BIN_RECORD_SIZE 128        // Versão 2: campos estendidos de cada trecho no fim
+#define METRICS_BIN_RECORD_SIZE_V1 80      // Versão 1: sem os campos estendidos (lidos como zero)
+
+// Braço do experimento A/B de uma amostra (--ab); as políticas seguem a ordem de OptimizerPolicyType
+#define METRICS_ARM_NONE 0             // Sem experimento (arquivos anteriores à versão 3 também)
+#define METRICS_ARM_OFF 1              // Braço sem otimização
+#define METRICS_ARM_POLICY 2           // Braço com política: METRICS_ARM_POLICY + OptimizerPolicyType
+
+// Métricas de um trecho (Cliente <-> Proxy ou Proxy <-> Servidor) em um registro binário
+typedef struct {
+    float rtt_ms;
+    float rtt_var_ms;
+    uint32_t retransmits;
+    uint32_t cwnd_segments;
+    uint32_t ssthresh;
+    float throughput_kbps;
+    float goodput_kbps;
+
+    // Campos estendidos (versão 2)
+    float delivery_rate_kbps;
+    float min_rtt_ms;
+    float retrans_kbps;
+    uint32_t notsent_bytes;
+    uint32_t total_retrans;
+    uint8_t limited_by;            // Valores de LimitedBy (proxy.h); 0 = desconhecido
+} MetricsBinLeg;
+
+// Amostra decodificada
+typedef struct {
+    uint64_t connection_id;
+    uint64_t timestamp_ms;
+    uint8_t client_ip[4];          // IPv4 em ordem de rede
+    uint8_t arm;                   // Braço do experimento (METRICS_ARM_*)
+    MetricsBinLeg client_proxy;
+    MetricsBinLeg proxy_server;
+} MetricsBinRecord;
+
+// Cabeçalho: magic(4) | versão(2) | tamanho do registro(2) | reservado(8) | início da execução em ms(8)
+typedef struct {
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t run_start_ms;         // Identifica a execução: os ids de conexão recomeçam a cada uma
+} MetricsBinHeader;
+
+// Serializa o cabeçalho em buffer (METRICS_BIN_HEADER_SIZE bytes)
+void metrics_bin_encode_header(uint8_t *buffer, uint64_t run_start_ms);
+
+/**
+ * Lê e valida o cabeçalho
+ * @return 0 se for um arquivo de métricas com versão suportada, -1 caso contrário
+ */
+int metrics_bin_decode_header(const uint8_t *buffer, size_t length, MetricsBinHeader *header);
+
+// Serializa um registro em buffer (METRICS_BIN_RECORD_SIZE bytes)
+void metrics_bin_encode_record(uint8_t *buffer, const MetricsBinRecord *record);
+
+// Lê um registro de buffer com record_size bytes (do cabeçalho); registros da versão 1 ficam sem os campos estendidos
+void metrics_bin_decode_record(const uint8_t *buffer, uint16_t record_size, MetricsBinRecord *record);
+
+// Nome do limitante (LimitedBy) usado nas colunas *_LimitedBy do CSV
+const char* metrics_limited_code(uint8_t limited_by);
+
+// Nome do braço (METRICS_ARM_*) usado na coluna Arm do CSV
+const char* metrics_arm_code(uint8_t arm);
+
+#endif
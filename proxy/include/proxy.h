@@ -4,16 +4,93 @@
 #include <netinet/in.h>
 #include <stdio.h>
 
+#include "relay.h"
+#include "tcp_optimizer.h"
+#include "congestion_control.h"
+#include "admission.h"
+#include "bandwidth.h"
+#include "tls_session.h"
+#include "experiment.h"
+#include "flight_recorder.h"
+
+// Engine de I/O usada para atender as conexões
+typedef enum {
+    ENGINE_THREADS = 0,    // Legado: uma thread (com poll()) por conexão
+    ENGINE_EPOLL,          // Pool fixo de workers, cada um com seu loop epoll edge-triggered
+    ENGINE_URING           // Workers com io_uring: accept multishot, connect assíncrono e buffers fornecidos
+} ProxyEngine;
+
+// Formato do log de métricas
+typedef enum {
+    LOG_FORMAT_CSV = 0,    // Texto, uma linha por amostra (logs/metrics.csv)
+    LOG_FORMAT_BINARY      // Registros binários de tamanho fixo (logs/metrics.bin)
+} LogFormat;
+
+#define MAX_BACKENDS 32
+
+// Política de escolha do servidor de destino para cada nova conexão
+typedef enum {
+    LB_ROUND_ROBIN = 0,    // Alterna entre os backends saudáveis
+    LB_LEAST_CONNECTIONS,  // Backend com menos conexões ativas
+    LB_LOWEST_RTT          // Backend com menor RTT suavizado no trecho Proxy <-> Servidor
+} LoadBalancePolicy;
+
+struct Backend;
+
 // Configuração do proxy
 typedef struct {
     int listen_port;       // Porta onde o proxy escuta
     char *target_host;     // IP do servidor
     int target_port;       // Porta do servidor
     int enable_optimization; // 0 = Desativado, 1 = Ativado
+    ProxyEngine engine;    // Engine de I/O (padrão: epoll)
+    int num_workers;       // Número de workers no modo epoll (padrão: um por núcleo)
+    RelayMode relay_mode;  // Encaminhamento por cópia (padrão) ou zero-copy com splice()
+    int pool_min;          // Mínimo de conexões ociosas pré-abertas com o servidor (0 = pool desativado)
+    int pool_max;          // Máximo de conexões ociosas no pool
+    char *backend_specs[MAX_BACKENDS]; // Backends extras (--backend host:porta), além de target_host
+    int backend_spec_count;
+    LoadBalancePolicy lb_policy; // Política de balanceamento entre os backends
+    int health_interval_ms;  // Intervalo da verificação ativa de saúde (0 = desativada)
+    int health_max_ms;       // Connect de verificação mais lento que isso conta como falha
+    int listen_backlog;      // Backlog do listen() (padrão: LISTEN_BACKLOG_DEFAULT)
+    int reuseport;           // 1 = um socket de escuta SO_REUSEPORT por worker (sem thread de accept)
+    int pin_cpus;            // 1 = fixa cada worker em uma CPU
+    int incoming_cpu;        // 1 = SO_INCOMING_CPU: conexão atendida no núcleo que tratou seus pacotes
+    LogFormat log_format;    // Formato do log de métricas (padrão: CSV)
+    OptimizerPolicyType optimizer_policy; // Política usada com --optimize (padrão: model)
+    CongestionControlMode cc_mode; // Seleção do controle de congestionamento por socket (padrão: desativada)
+    char *cc_algorithm;      // Algoritmo usado com --cc <algoritmo> (modo fixo)
+    ImpairmentConfig impairment; // Emulação de WAN no encaminhamento (--impair), desativada por padrão
+    int idle_timeout_ms;     // Conexão sem tráfego por mais que isso é encerrada (0 = nunca)
+    int keepalive_s;         // Ociosidade até o primeiro probe de TCP keepalive nos dois trechos (0 = desativado)
+    int console_metrics;     // 1 = tabela de métricas e linhas de estado no console a cada intervalo (--console)
+    int latency_profile;     // 1 = NODELAY, NOTSENT_LOWAT, QUICKACK e TFO na escuta (--latency)
+    int client_first;        // 1 = o cliente sempre fala primeiro: DEFER_ACCEPT e TFO no connect (--client-first)
+    int notsent_lowat;       // TCP_NOTSENT_LOWAT do perfil de latência, em bytes (0 = não altera)
+    int fastpath;            // 1 = pares estabelecidos encaminhados no kernel por um BPF sockmap (--fastpath)
+    AdmissionConfig admission; // Limites de conexões, taxa de accept e connect() em andamento (desativados por padrão)
+    BandwidthConfig bandwidth; // Orçamento de banda do proxy dividido entre os clientes (--bw-limit), desativado por padrão
+    TlsConfig tls;           // Terminação TLS com os clientes e origem TLS com os backends (desativadas por padrão)
+    int stats_port;          // Porta local do endpoint de latências (0 = sem medição, --stats-port)
+    int sample_interval_ms;  // Intervalo base da coleta de TCP_INFO por conexão (--sample-ms)
+    int sample_adaptive;     // 1 = intervalo por conexão: menor no slow start, maior ociosa (0 = --sample-fixed)
+    ExperimentConfig experiment; // Braços do experimento A/B entre políticas (--ab), no lugar de --optimize
+    FlightConfig flight;     // Gravador de voo: sempre ligado, despejo com SIGUSR2 ou parada longa (--no-flight desliga)
 } ProxyConfig;
 
+// O que limitou o envio de um trecho no último intervalo (pelos cronômetros do tcp_info)
+// Os valores são gravados no log binário: só acrescente no fim
+typedef enum {
+    LIMITED_UNKNOWN = 0,   // Sem amostra anterior para comparar
+    LIMITED_APP,           // Socket ocioso a maior parte do tempo: o outro lado do proxy não entregou dados
+    LIMITED_RWND,          // Janela anunciada pelo receptor (o par deste socket lê devagar)
+    LIMITED_SNDBUF,        // Buffer de envio do proxy cheio
+    LIMITED_NETWORK        // Rede: CWND/pacing, perdas ou banda do caminho
+} LimitedBy;
+
 // Estrutura para registrar as métricas de uma conexão
-typedef struct {
+typedef struct ConnectionMetrics {
     unsigned long timestamp_ms; // Momento da medição
 
     // Métricas diretas do TCP_INFO
@@ -22,15 +99,37 @@ typedef struct {
     int retransmits;           // Contagem de retransmissões
     int cwnd_segments;         // Janela de congestionamento (se disponível)
     int ssthresh;              // Limiar de ssthresh
+    double delivery_rate_bytes_sec; // Taxa de entrega estimada pelo kernel (tcpi_delivery_rate)
+    int delivery_app_limited;  // 1 = a amostra de taxa foi limitada pela aplicação (não pela rede)
+    double min_rtt_ms;         // Menor RTT observado (tcpi_min_rtt), estimativa do RTprop
+    unsigned int total_retrans; // Retransmissões acumuladas na conexão (tcpi_total_retrans)
+    unsigned int segs_out;     // Segmentos enviados, incluindo retransmissões (tcpi_segs_out)
+    unsigned long bytes_acked; // Bytes enviados e confirmados pelo par, acumulado (tcpi_bytes_acked)
+    unsigned long bytes_retrans; // Bytes retransmitidos, acumulado (tcpi_bytes_retrans)
+    unsigned int notsent_bytes; // Bytes no buffer de envio ainda não enviados (tcpi_notsent_bytes)
+    unsigned long busy_time_us; // Tempo com dados em voo, acumulado (tcpi_busy_time)
+    unsigned long rwnd_limited_us; // Parte do busy_time limitada pela janela do receptor
+    unsigned long sndbuf_limited_us; // Parte do busy_time limitada pelo buffer de envio
 
     // Métricas calculadas
-    double throughput_kbps;    // Throughput (bytes/tempo)
-    double goodput_kbps;       // Goodput (dados úteis/tempo)
+    double throughput_kbps;    // Throughput (bytes que o proxy escreveu neste socket/tempo; mesma direção do goodput)
+    double received_kbps;      // Bytes lidos deste socket/tempo (a outra direção do trecho)
+    double goodput_kbps;       // Goodput (bytes enviados neste socket e confirmados pelo par/tempo)
+    double retrans_kbps;       // Taxa de bytes retransmitidos neste socket
+    LimitedBy limited_by;      // Classificação do intervalo (aplicação, receptor, buffer de envio ou rede)
+    int slow_start;            // 1 = CWND abaixo do ssthresh e crescendo no intervalo (amostragem adaptativa)
 
     // Campos auxiliares de cálculo
     unsigned long bytes_transferred_total;
     unsigned long last_bytes_total;
-    unsigned long last_timestamp_ms;
+    unsigned long last_bytes_received;
+    unsigned long last_sample_ms;   // Amostra anterior (get_monotonic_ms)
+    int last_cwnd_segments;
+    unsigned long last_bytes_acked;
+    unsigned long last_bytes_retrans;
+    unsigned long last_busy_time_us;
+    unsigned long last_rwnd_limited_us;
+    unsigned long last_sndbuf_limited_us;
 } ConnectionMetrics;
 
 // Estrutura para gerenciar um par de conexões (Cliente e Servidor)
@@ -38,11 +137,57 @@ typedef struct {
     int client_socket;                          // Socket do cliente
     int server_socket;                          // Socket do servidor
     struct sockaddr_in client_address;          // Endereço do cliente
+    struct Backend *backend;                    // Backend escolhido para o lado do servidor
+    char client_ip_str[INET_ADDRSTRLEN];        // IP do cliente em texto (para logs)
+
+    unsigned long bytes_client_to_server;       // Bytes Cliente -> Servidor
+    unsigned long bytes_server_to_client;       // Bytes Servidor -> Cliente
+    unsigned long last_monitor_time;            // Última coleta de métricas (get_monotonic_ms)
+    unsigned long sample_interval_ms;           // Intervalo até a próxima coleta (adaptativo, ver connection_monitor_tick)
+    unsigned long last_activity_time;           // Último byte encaminhado (get_coarse_ms, base do --idle-timeout)
+
+    RelayChannel to_server;                     // Canal Cliente -> Servidor
+    RelayChannel to_client;                     // Canal Servidor -> Cliente
 
     ConnectionMetrics metrics_client_proxy;     // Métricas da conexão Cliente <-> Proxy
     ConnectionMetrics metrics_proxy_server;     // Métricas da conexão Proxy <-> Servidor
 
-    FILE *log_file;                             // Arquivo de log CSV para a conexão
+    OptimizerLeg optimizer_client;              // Estado da política de otimização no socket do cliente
+    OptimizerLeg optimizer_server;              // Estado da política de otimização no socket do servidor
+    PathClassifier path_client;                 // Classificação do caminho e algoritmo de CC no socket do cliente
+    PathClassifier path_server;                 // Classificação do caminho e algoritmo de CC no socket do servidor
+    ExperimentTrack experiment;                 // Braço do experimento A/B e medidas para o resultado dele
+
+    unsigned long connection_id;                // Identificador da conexão (coluna ConnectionId do log)
+    int close_reason;                           // Primeira causa de encerramento registrada (FlightCloseReason)
+    int close_errno;                            // errno dessa causa (0 = sem erro)
+
+    int stats_slot;                             // Vaga no segmento de estatísticas ao vivo (-1 = sem vaga)
+    unsigned long stats_client_to_server;       // Bytes já somados aos agregados do segmento
+    unsigned long stats_server_to_client;
+
+    int sockmap_wanted;                         // 1 = entra no fast path assim que os canais esvaziarem (--fastpath)
+    int sockmap_slot;                           // Vaga no fast path do kernel (-1 = encaminhado pelo relay)
+    unsigned long sockmap_client_to_server;     // Contadores do sockmap já somados aos bytes do par
+    unsigned long sockmap_server_to_client;
+    unsigned long sockmap_fin_checked;          // Última verificação da entrega com um FIN retido (ms)
+    unsigned long sockmap_fin_progress;         // Última vez que o destino aceitou mais bytes com um FIN retido (ms)
+    long sockmap_fin_written;                   // Bytes aceitos pelos destinos na última verificação
+    int sockmap_fin_interval_ms;                // Intervalo até a próxima verificação (dobra sem progresso)
+
+    BandwidthClient *bandwidth;                 // Balde do IP do cliente no escalonador de banda (NULL = sem limite)
+    unsigned long bandwidth_generation;         // Versão da parcela já aplicada no pacing dos sockets
+
+    TlsSession *tls_client;                     // Sessão TLS com o cliente (NULL = texto puro)
+    TlsSession *tls_server;                     // Sessão TLS com o backend (NULL = texto puro)
+
+    int latency_timed;                          // 1 = latências medidas nesta conexão (--stats-port)
+    uint64_t accepted_ns;                       // accept() do cliente (relógio de latency_now_ns)
+    uint64_t connect_ns;                        // accept -> backend conectado (0 = ainda conectando)
+    uint64_t request_ns;                        // Primeiro byte lido do cliente (0 = ainda nenhum)
+    uint64_t ttfb_ns;                           // Tempo até o primeiro byte entregue ao cliente (0 = ainda nenhum)
+    LatencySummary delay_to_server;             // Atraso de encaminhamento Cliente -> Servidor
+    LatencySummary delay_to_client;             // Atraso de encaminhamento Servidor -> Cliente
 } ConnectionPair;
 
 #endif
@@ -0,0 +1,137 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "impairment.h"
+#include "bandwidth.h"
+#include "tls_session.h"
+#include "latency_stats.h"
+#include "flight_recorder.h"
+
+#define RELAY_BUFFER_INITIAL 16384 // Buffer do modo cópia de uma direção que acabou de começar a transferir
+#define RELAY_BUFFER_MAX 262144    // Maior buffer do modo cópia (conexões de alto throughput)
+#define RELAY_SPLICE_CHUNK 65536   // Máximo movido por splice() (capacidade padrão do pipe)
+
+// Modo de encaminhamento dos dados entre os sockets
+typedef enum {
+    RELAY_MODE_COPY = 0,   // recv()/send() passando por um buffer circular em user space
+    RELAY_MODE_SPLICE      // splice() socket -> pipe -> socket, sem cópia para user space
+} RelayMode;
+
+// Canal de encaminhamento de uma direção (ex: Cliente -> Servidor)
+// Sockets não-bloqueantes: o canal guarda o que a origem enviou e o destino ainda não aceitou.
+// No modo cópia o buffer vem do slab_pool só enquanto há dados em trânsito: uma direção ociosa não tem buffer
+typedef struct {
+    RelayMode mode;
+    int pipe_fds[2];                // Pipe intermediário do modo splice (-1 se não usado)
+    size_t capacity;                // Máximo de bytes pendentes (buffer circular, o próximo a alocar, ou pipe)
+    size_t pending;                 // Bytes lidos da origem e ainda não entregues ao destino
+    size_t start;                   // Modo cópia: início dos dados pendentes no buffer circular
+    size_t peak;                    // Modo cópia: maior ocupação desde que o buffer foi alocado
+    int read_closed;                // A origem enviou FIN (recv() == 0)
+    int write_closed;               // O FIN já foi propagado ao destino com shutdown(SHUT_WR)
+    int quickack;                   // 1 = TCP_QUICKACK na origem depois de cada rodada com leitura (--latency)
+    int hold_fin;                   // 1 = o FIN da origem espera o fast path do kernel entregar o que redirecionou (--fastpath)
+    char *data;                     // Modo cópia: dados em trânsito (NULL se a direção está vazia)
+    ImpairmentState *impairment;    // Emulação de WAN nesta direção (NULL = desativada)
+    BandwidthClient *bandwidth;     // Balde do cliente no escalonador de banda (NULL = sem limite)
+    BandwidthQuota quota;           // Quantum desta direção na rodada atual do escalonador
+    int throttled;                  // 1 = a leitura parou por falta de tokens e a origem pode ter mais dados
+    TlsSession *tls_source;         // Origem fala TLS: leituras decifradas por SSL_read (NULL = texto puro)
+    TlsSession *tls_dest;           // Destino fala TLS: cifrado pelo kernel (kTLS) ou por SSL_write
+    LatencySummary *delay;          // Atraso leitura -> envio completo desta direção (NULL = sem medição)
+    uint64_t pending_since_ns;      // Leitura que encontrou o canal vazio: o byte mais antigo ainda pendente
+    unsigned long trace_id;         // Conexão nos eventos do gravador de voo (0 = canal não grava)
+    int trace_to_server;            // 1 = canal Cliente -> Servidor (origem no socket do cliente)
+    uint64_t blocked_since_ns;      // Destino recusando com dados pendentes desde (0 = aceitando)
+    uint64_t paused_since_ns;       // Canal cheio, origem sem leitura desde (0 = lendo)
+    int stall_reported;             // A parada atual do destino já passou de --flight-stall-ms
+} RelayChannel;
+
+/**
+ * Inicializa o canal no modo pedido
+ * Se o pipe do modo splice não puder ser criado, o canal cai para o modo cópia
+ */
+void relay_channel_init(RelayChannel *channel, RelayMode mode);
+
+/**
+ * Ativa a emulação de WAN no canal: os dados lidos ficam retidos até o atraso sorteado e a taxa permitirem
+ * O canal passa para o modo cópia com um buffer maior (até IMPAIR_BUFFER_SIZE)
+ * @return 0 em sucesso, -1 se não foi possível alocar (o canal segue sem emulação)
+ */
+int relay_channel_set_impairment(RelayChannel *channel, const ImpairmentParams *params, uint64_t seed);
+
+/**
+ * Liga o canal às sessões TLS da origem e do destino (NULL = trecho em texto puro)
+ * O splice só continua com a origem em texto puro e o destino em texto puro ou kTLS; nos outros casos
+ * os registros passam pelo OpenSSL e o canal usa o modo cópia
+ */
+void relay_channel_set_tls(RelayChannel *channel, TlsSession *source, TlsSession *dest);
+
+/**
+ * Liga o canal ao gravador de voo: leituras, envios, bloqueios do destino, pausas da origem e o FIN
+ * propagado viram eventos da conexão
+ * @param to_server 1 = canal Cliente -> Servidor, 0 = Servidor -> Cliente
+ */
+void relay_channel_set_trace(RelayChannel *channel, unsigned long connection_id, int to_server);
+
+/**
+ * Destino parado há mais de --flight-stall-ms ainda sem aceitar nada: avisa o gravador de voo (uma vez
+ * por parada; as que terminam sozinhas são avisadas pelo próprio relay_flush)
+ */
+void relay_check_stall(RelayChannel *channel);
+
+// Fecha o pipe do canal (se houver) e libera o buffer e a emulação
+void relay_channel_close(RelayChannel *channel);
+
+/**
+ * Lê da origem para o espaço livre do canal (limitado aos tokens do cliente, com escalonador de banda)
+ * Se splice() não for suportado pelo socket, o canal troca para o modo cópia e tenta de novo
+ * @return Bytes lidos, 0 caso desconexão, -1 caso erro (errno EAGAIN se não há dados ou espaço)
+ */
+ssize_t relay_read(RelayChannel *channel, int src_fd);
+
+/**
+ * Entrega ao destino os dados pendentes do canal
+ * Com medição de latência, o canal que esvazia grava o tempo desde a leitura que o encontrou vazio
+ * (com o destino lento, a espera pelo destino entra na amostra)
+ * @return 0 se esvaziou ou o destino está cheio (EAGAIN, dados continuam pendentes), -1 em erro
+ */
+int relay_flush(RelayChannel *channel, int dest_fd);
+
+/**
+ * Encaminha o máximo possível de src para dest sem bloquear
+ * Para de ler quando o canal enche (backpressure) e, após o FIN da origem e o canal
+ * esvaziar, propaga o FIN ao destino com shutdown(SHUT_WR).
+ * Com o canal vazio ao final, o buffer volta ao pool (maior na próxima vez, se a leitura o encheu)
+ * @param byte_counter Acumula os bytes lidos da origem (alimenta o cálculo de throughput)
+ * @return 0 em sucesso, -1 em erro (a conexão deve ser encerrada)
+ */
+int relay_pump(RelayChannel *channel, int src_fd, int dest_fd, unsigned long *byte_counter);
+
+// A origem deve ser monitorada para leitura (canal com espaço, sem FIN e com tokens de banda)
+int relay_wants_read(const RelayChannel *channel);
+
+// O destino deve ser monitorado para escrita (há dados pendentes já liberados pela emulação)
+int relay_wants_write(RelayChannel *channel);
+
+/**
+ * Tempo até a emulação liberar mais dados do canal ou o escalonador repor os tokens da leitura
+ * (0 também quando o OpenSSL guarda dados decifrados da origem, que o poll() não sinaliza)
+ * @return ms (0 = já pode entregar), ou -1 se nada espera
+ */
+int relay_wait_ms(RelayChannel *channel);
+
+// Direção encerrada: FIN recebido e propagado
+int relay_is_done(const RelayChannel *channel);
+
+// Bytes de buffer em user space que o canal ocupa agora
+size_t relay_buffer_bytes(const RelayChannel *channel);
+
+// Nome do modo para logs
+const char* relay_mode_name(RelayMode mode);
+
+#endif
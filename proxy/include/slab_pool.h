@@ -0,0 +1,38 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stddef.h>
+
+#define SLAB_CHUNK_SIZE (1024 * 1024)          // Memória pedida ao kernel de uma vez para cada classe
+#define SLAB_MAX_OBJECT (256 * 1024)           // Maior objeto servido pelas classes (acima disso usa malloc)
+#define SLAB_THREAD_CACHE_BYTES (512 * 1024)   // Limite do cache local de cada thread, por classe
+#define SLAB_IDLE_BYTES (8 * 1024 * 1024)      // Acima disso, buffers livres de uma classe devolvem as páginas ao kernel
+
+// Uso de memória dos pools (todas as classes)
+typedef struct {
+    size_t in_use_bytes;     // Entregue a conexões e buffers ativos (tamanho da classe)
+    size_t reserved_bytes;   // Pedido ao kernel pelas classes (inclui objetos livres)
+    size_t released_bytes;   // Páginas de buffers livres já devolvidas ao kernel (madvise)
+    unsigned long objects;   // Objetos em uso
+} SlabStats;
+
+/**
+ * Aloca um objeto da menor classe que comporta o tamanho pedido
+ * Cada thread guarda um cache de objetos livres por classe; o lock só é usado ao encher ou esvaziar o cache
+ * @return Ponteiro para a memória (não zerada), ou NULL se não houver memória
+ */
+void* slab_alloc(size_t size);
+
+// Devolve um objeto de slab_alloc; size é o mesmo tamanho pedido na alocação
+void slab_free(void *ptr, size_t size);
+
+// Tamanho realmente reservado para um pedido de size bytes (o da classe)
+size_t slab_class_size(size_t size);
+
+// Fotografia dos contadores de uso
+void slab_get_stats(SlabStats *stats);
+
+// Memória residente do processo (VmRSS), em bytes; 0 se não disponível
+size_t slab_process_rss(void);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SOCKMAP_H
+#define SOCKMAP_H
+
+#include <stddef.h>
+
+// Fast path no kernel (--fastpath): os dois sockets de um par entram em um BPF sockmap e um programa
+// sk_skb redireciona cada segmento recebido direto para a saída do outro socket, sem acordar o proxy.
+// O proxy fica só com o controle: accept, connect, TCP_INFO, otimizador e o FIN de cada direção
+#define SOCKMAP_MAX_PAIRS 32768         // Pares no fast path ao mesmo tempo (os demais usam o relay)
+#define SOCKMAP_FIN_CHECK_MS 10         // Primeira nova verificação de entrega com um FIN retido (um tick da roda)
+#define SOCKMAP_FIN_CHECK_MAX_MS 160    // O intervalo dobra enquanto o destino não aceita nada, até este limite
+#define SOCKMAP_FIN_WAIT_MAX_MS 2000    // Tempo máximo retendo um FIN sem que o destino aceite mais nada
+
+#define SOCKMAP_REFUSED -1              // O par não pode usar o fast path (IPv6, tabela cheia, erro do kernel)
+#define SOCKMAP_BUSY -2                 // Dados na fila de recepção: tente de novo depois que o relay os entregar
+
+// Contadores do fast path (todas as engines)
+typedef struct {
+    unsigned long active;               // Pares no sockmap agora
+    unsigned long attached;             // Pares que entraram no fast path desde o início
+    unsigned long refused;              // Pares que ficaram no relay (IPv6, tabela cheia, erro do kernel)
+} SockmapStats;
+
+/**
+ * Cria os mapas, carrega o programa sk_skb (bytecode montado aqui, pela syscall bpf() sem libbpf)
+ * e o anexa ao sockmap
+ * @param reason Recebe o motivo da falha (sem privilégio, kernel sem suporte, verificador...)
+ * @return 0 se o fast path está disponível, -1 caso contrário (o proxy segue com o relay)
+ */
+int sockmap_init(char *reason, size_t reason_len);
+
+// 1 se sockmap_init teve sucesso
+int sockmap_available(void);
+
+/**
+ * Coloca o par no fast path. Os dois sockets precisam estar conectados (IPv4) e sem dados em fila
+ * @return Vaga do par (usada nas outras funções), SOCKMAP_REFUSED ou SOCKMAP_BUSY
+ */
+int sockmap_attach(int client_socket, int server_socket);
+
+// Tira o par do fast path e libera a vaga (antes de fechar os sockets)
+void sockmap_detach(int slot);
+
+/**
+ * Bytes que o kernel já redirecionou em cada direção desde sockmap_attach
+ * @return 0 em sucesso, -1 em erro
+ */
+int sockmap_read_bytes(int slot, unsigned long *client_to_server, unsigned long *server_to_client);
+
+/**
+ * Bytes que o socket já aceitou para envio desde o connect (confirmados + na fila de envio)
+ * Com o que o kernel redirecionou, diz se a entrega ao destino terminou antes de propagar o FIN
+ * @return Total em bytes, ou -1 em erro
+ */
+long sockmap_socket_written(int sock_fd);
+
+void sockmap_get_stats(SockmapStats *stats);
+
+#endif
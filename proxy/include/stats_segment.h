@@ -0,0 +1,109 @@
+#ifndef STATS_SEGMENT_H
+#define STATS_SEGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Segmento de memória compartilhada com as estatísticas ao vivo do proxy (lido pelo proxy_top)
+// Cabeçalho com os agregados + uma vaga por conexão; cada vaga é protegida por um seqlock:
+// só a thread dona da conexão escreve, e quem lê repete a cópia se pegou uma escrita no meio
+#define STATS_SEGMENT_MAGIC 0x53585054u           // "TPXS"
+#define STATS_SEGMENT_VERSION 2
+#define STATS_SEGMENT_SLOTS 8192                  // Conexões visíveis ao mesmo tempo (as demais só entram nos agregados)
+#define STATS_SEGMENT_PATH_FORMAT "/dev/shm/tcp_proxy_%d.stats" // Um segmento por porta de escuta
+#define STATS_ADDRESS_LEN 48                      // "ip:porta" com IPv6 entre colchetes
+
+// Métricas de um trecho no último intervalo de monitoramento
+typedef struct {
+    float rtt_ms;
+    float rtt_var_ms;
+    float min_rtt_ms;
+    float throughput_kbps;
+    float goodput_kbps;
+    float retrans_kbps;
+    uint32_t cwnd_segments;
+    uint32_t total_retrans;
+    uint8_t limited_by;                           // Valores de LimitedBy (proxy.h)
+    uint8_t reserved[3];
+} StatsLeg;
+
+// Vaga de uma conexão (256 bytes, alinhada à linha de cache)
+typedef struct {
+    uint32_t sequence;                            // Seqlock: ímpar = escrita em andamento
+    uint32_t in_use;
+    uint64_t connection_id;
+    uint64_t opened_ms;
+    uint64_t updated_ms;
+    uint64_t bytes_client_to_server;
+    uint64_t bytes_server_to_client;
+    char client[STATS_ADDRESS_LEN];
+    char backend[STATS_ADDRESS_LEN];
+    StatsLeg client_proxy;
+    StatsLeg proxy_server;
+} __attribute__((aligned(64))) StatsSlot;
+
+// Cabeçalho: identificação e agregados (contadores atualizados com operações atômicas)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    int32_t pid;                                  // Processo do proxy (o proxy_top detecta se ele terminou)
+    int32_t listen_port;
+    uint64_t start_ms;
+    char engine[16];
+
+    uint64_t connections_opened;
+    uint64_t connections_closed;
+    uint64_t slots_exhausted;                     // Conexões abertas sem vaga livre
+    uint64_t bytes_client_to_server;              // Acumulado até a última publicação de cada conexão
+    uint64_t bytes_server_to_client;
+    uint64_t pool_in_use_bytes;                   // Memória dos pools (slab_pool) e do processo
+    uint64_t rss_bytes;
+    uint64_t log_dropped;
+    uint64_t admission_rejected;                  // Conexões recusadas pelo controle de admissão (RST)
+    uint64_t admission_queued;                    // Na fila de connect() agora
+    uint64_t admission_connecting;                // connect() com os backends em andamento
+    uint64_t admission_pauses;                    // Vezes que o accept parou no limite (--overload pause)
+    uint64_t updated_ms;
+} __attribute__((aligned(64))) StatsHeader;
+
+typedef struct {
+    StatsHeader header;
+    StatsSlot slots[];
+} StatsSegment;
+
+/**
+ * Cria (ou recria) o segmento da porta em /dev/shm e o mapeia
+ * @param path_out Recebe o caminho do arquivo (pode ser NULL)
+ * @return O segmento, ou NULL em erro
+ */
+StatsSegment* stats_segment_create(int listen_port, const char *engine, char *path_out, size_t path_len);
+
+/**
+ * Mapeia um segmento existente só para leitura e valida magic, versão e tamanhos
+ * @return O segmento, ou NULL se o arquivo não existe ou não é um segmento válido
+ */
+const StatsSegment* stats_segment_attach(const char *path);
+
+/**
+ * Reserva uma vaga livre para uma conexão
+ * @return Índice da vaga, ou -1 se todas estão ocupadas (contado em slots_exhausted)
+ */
+int stats_segment_acquire_slot(StatsSegment *segment);
+
+// Libera a vaga (quem lê deixa de vê-la na próxima cópia)
+void stats_segment_release_slot(StatsSegment *segment, int slot);
+
+// Seqlock do lado de quem escreve: os campos da vaga são alterados entre begin e end
+void stats_slot_write_begin(StatsSlot *slot);
+void stats_slot_write_end(StatsSlot *slot);
+
+/**
+ * Copia uma vaga de forma consistente (repete se uma escrita estava em andamento)
+ * @return 0 se a cópia é de uma vaga em uso, -1 se a vaga está livre ou não estabilizou
+ */
+int stats_slot_read(const StatsSlot *slot, StatsSlot *copy);
+
+#endif
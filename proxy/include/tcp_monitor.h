@@ -3,16 +3,39 @@
 
 #include "proxy.h"
 
+// Fração mínima do intervalo com dados em voo; abaixo disso o trecho é limitado pela aplicação
+#define MONITOR_BUSY_MIN_FRACTION 0.1
+
 // Coleta métricas TCP de um socket
 int monitor_get_tcp_info(int sock_fd, ConnectionMetrics *metrics);
 
 // Inicializa os valores da estrutura de métricas
 void monitor_init_metrics(ConnectionMetrics *metrics);
 
-// Calcula o throughput e goodput com base nos bytes transferidos
-void monitor_calculate_throughput(ConnectionMetrics *metrics, unsigned long total_bytes_forwarded);
+/**
+ * Calcula o throughput, o goodput (tcpi_bytes_acked) e classifica o limitante do intervalo
+ * @param total_bytes_sent Bytes que o proxy escreveu no socket do trecho (direção do goodput e das retransmissões)
+ * @param total_bytes_received Bytes lidos do mesmo socket (received_kbps)
+ */
+void monitor_calculate_throughput(ConnectionMetrics *metrics, unsigned long total_bytes_sent, unsigned long total_bytes_received);
+
+/**
+ * Classifica o que limitou o envio desde a amostra anterior, pelos deltas de busy/rwnd_limited/sndbuf_limited
+ * @return LIMITED_APP, LIMITED_RWND, LIMITED_SNDBUF ou LIMITED_NETWORK (LIMITED_UNKNOWN sem intervalo)
+ */
+LimitedBy monitor_classify_limit(const ConnectionMetrics *metrics, unsigned long interval_ms);
+
+// Nome curto do limitante para o console
+const char* monitor_limited_by_name(LimitedBy limited_by);
 
-// Retorna o timestamp atual em milissegundos
+// Retorna o timestamp atual em milissegundos (relógio de parede: logs e segmento do proxy_top)
 unsigned long get_timestamp_ms();
 
+// Relógio monotônico em ms (CLOCK_MONOTONIC): prazos e intervalos, imunes a ajustes do relógio de parede
+unsigned long get_monotonic_ms(void);
+
+// CLOCK_MONOTONIC_COARSE em ms: o último tick do kernel (1 a 4 ms de resolução), sem ler o contador
+// de ciclos. Para o caminho quente (atividade a cada rodada do relay); só compare com ele mesmo
+unsigned long get_coarse_ms(void);
+
 #endif
@@ -1,12 +1,80 @@
 #ifndef TCP_OPTIMIZER_H
 #define TCP_OPTIMIZER_H
 
+// Menor buffer aplicado pelo Buffer Tuning (64 KB)
+#define OPTIMIZER_MIN_BUFFER 65535
+// Maior buffer aplicado pela política de modelo (32 MB)
+#define OPTIMIZER_MAX_BUFFER (32 * 1024 * 1024)
+// Amostras de delivery rate na janela do máximo (BtlBw); o intervalo entre elas segue a amostragem
+// adaptativa (no padrão, 0,75 s no slow start e 3 s depois)
+#define OPTIMIZER_BW_WINDOW 5
+// Pacing sem limite (SO_MAX_PACING_RATE = ~0)
+#define OPTIMIZER_PACING_UNLIMITED (~0UL)
+
+// Políticas de otimização disponíveis (--policy)
+typedef enum {
+    OPTIMIZER_POLICY_MODEL = 0,  // Modelo estilo BBR: BtlBw (delivery rate) e RTprop (min RTT) nos dois trechos
+    OPTIMIZER_POLICY_LEGACY      // Heurística original: 2x BDP pelo throughput medido e pacing fixo com RTT > 100 ms
+} OptimizerPolicyType;
+
+struct ConnectionMetrics;
+struct OptimizerPolicy;
+
+// Estado da política em um socket (um por trecho da conexão)
+typedef struct {
+    const struct OptimizerPolicy *policy;
+    int is_server_leg;                          // 1 = Proxy <-> Servidor, 0 = Cliente <-> Proxy
+    int samples;                                // Amostras recebidas
+
+    double bw_samples[OPTIMIZER_BW_WINDOW];     // Últimas taxas de entrega (bytes/s), sem amostras app-limited
+    int bw_next;
+    double btl_bw_bytes_sec;                    // Máximo da janela: estimativa da banda do gargalo
+    double rt_prop_ms;                          // Estimativa do RTT de propagação
+
+    int applied_buffer;                         // Último buffer aplicado (0 = autotuning do kernel)
+    unsigned long policy_pacing;                // Pacing pedido pela política (0 = nenhum)
+    double applied_gain;                        // Ganho do último pacing pedido (fase de sondagem ou de drenagem)
+    unsigned long share_pacing;                 // Teto da parcela de banda do cliente (--bw-limit; 0 = nenhum)
+    unsigned long effective_pacing;             // O que está no socket: o menor dos dois (0 = sem limite)
+    int pacing_set;                             // 1 depois do primeiro SO_MAX_PACING_RATE no socket
+} OptimizerLeg;
+
+// Interface de uma política: chamada na criação do par, a cada amostra de métricas e no fechamento
+typedef struct OptimizerPolicy {
+    const char *name;
+    void (*init)(OptimizerLeg *leg, int sock_fd);
+    void (*on_sample)(OptimizerLeg *leg, int sock_fd, const struct ConnectionMetrics *metrics);
+    void (*on_close)(OptimizerLeg *leg, int sock_fd);
+} OptimizerPolicy;
+
+// Retorna a implementação da política
+const OptimizerPolicy* optimizer_policy_get(OptimizerPolicyType type);
+
+/**
+ * Prepara o estado de um trecho e chama init da política
+ * @param policy Política a usar, ou NULL para desativar a otimização nesse trecho
+ */
+void optimizer_leg_init(OptimizerLeg *leg, const OptimizerPolicy *policy, int is_server_leg, int sock_fd);
+
+// Entrega uma amostra de métricas à política do trecho
+void optimizer_leg_sample(OptimizerLeg *leg, int sock_fd, const struct ConnectionMetrics *metrics);
+
+// Avisa a política que o trecho vai ser fechado
+void optimizer_leg_close(OptimizerLeg *leg, int sock_fd);
+
+/**
+ * Teto de pacing da parcela de banda do cliente (--bw-limit) no socket do trecho, com ou sem política.
+ * O socket recebe o menor entre ele e o pacing da política, e só quando esse valor muda
+ * @param rate_bytes_sec Teto em bytes/s (0 = sem teto)
+ */
+void optimizer_leg_set_share(OptimizerLeg *leg, int sock_fd, unsigned long rate_bytes_sec);
+
 /**
  * Aplica TCP Pacing (controle de taxa) a um socket
  * @param socket O socket para aplicar o pacing
  * @param rate_bytes_per_sec Taxa máxima em bytes por segundo
  */
-void apply_tcp_pacing(int socket, long rate_bytes_per_sec);
+void apply_tcp_pacing(int socket, unsigned long rate_bytes_per_sec);
 
 /**
  * Ajusta dinamicamente os buffers de envio e recebimento
@@ -0,0 +1,42 @@
+#ifndef THREAD_SLOTS_H
+#define THREAD_SLOTS_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define THREAD_SLOTS_MAX 256                // Maior capacidade entre os registros (LOG_MAX_RINGS)
+
+// Registro de vagas por thread (anéis de log, histogramas de latência, anéis do gravador de voo): cada
+// thread produtora pega uma vaga na primeira escrita e a devolve ao terminar, para a próxima thread reusar.
+// As vagas alocadas nunca são liberadas e items[i] não muda depois de publicado: quem leu count sob a
+// trava (thread_slots_snapshot) percorre items[0..count) sem ela, enquanto os donos continuam escrevendo
+typedef struct {
+    void *items[THREAD_SLOTS_MAX];
+    unsigned char in_use[THREAD_SLOTS_MAX];
+    int count;                  // Vagas já alocadas
+    int capacity;
+    size_t item_size;           // Tamanho de cada vaga (alocada zerada)
+    void *overflow;             // Vaga dividida quando todas estão em uso; NULL = a thread fica sem vaga
+    pthread_mutex_t lock;
+} ThreadSlots;
+
+#define THREAD_SLOTS_INITIALIZER(type, max, overflow_item) \
+    { .capacity = (max), .item_size = sizeof(type), .overflow = (overflow_item), .lock = PTHREAD_MUTEX_INITIALIZER }
+
+/**
+ * Obtém uma vaga livre para a thread atual, reusando a de uma thread que já terminou
+ * @return A vaga, a de excesso se todas estiverem em uso (ou sem memória), ou NULL se não houver uma
+ */
+void* thread_slots_acquire(ThreadSlots *slots);
+
+// Devolve a vaga de uma thread que terminou (o conteúdo fica; a vaga de excesso é ignorada)
+void thread_slots_release(ThreadSlots *slots, void *item);
+
+/**
+ * Fotografia do registro para os leitores
+ * @param in_use_out Se não for NULL, recebe quantas vagas estão em uso
+ * @return Vagas alocadas: items[0..count) pode ser lido sem a trava
+ */
+int thread_slots_snapshot(ThreadSlots *slots, int *in_use_out);
+
+#endif
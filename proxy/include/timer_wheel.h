@@ -0,0 +1,69 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// Roda de timers hierárquica de um worker (amostragem de TCP_INFO, ticks do otimizador e ociosidade de
+// milhares de conexões): agendar e cancelar são O(1) e um worker ocioso não varre as conexões. Cada nível
+// tem TIMER_WHEEL_SLOTS posições; o nível 0 anda um tick por vez e, a cada volta, a posição atual do nível
+// seguinte desce para os de baixo (cascata). O timerfd (CLOCK_MONOTONIC) é armado só para o próximo tick
+// com timers, ou para a próxima cascata: sem timers próximos, o worker não acorda
+#define TIMER_WHEEL_TICK_MS 10
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)   // Nível 0: 640 ms; 1: 41 s; 2: 44 min; 3: 47 h
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLACK_SHIFT 4   // Folga: o vencimento pode atrasar até 1/16 do prazo pedido
+
+// Timer embutido no objeto dono (ex: a conexão); fora da roda, next == NULL
+typedef struct TimerEntry {
+    struct TimerEntry *next;
+    struct TimerEntry *prev;
+    unsigned long expires;      // Tick em que vence
+    int level;                  // Posição atual na roda (para manter o mapa do nível 0)
+    int slot;
+    int kind;                   // Uso de quem agenda (ex: amostragem ou ociosidade)
+    void *owner;                // Objeto dono, entregue de volta no vencimento
+} TimerEntry;
+
+typedef struct {
+    TimerEntry slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];  // Cabeças das listas circulares
+    uint64_t occupied;          // Posições do nível 0 com timers (bit i = posição i)
+    unsigned long current;      // Próximo tick a processar
+    unsigned long count;        // Timers na roda
+    unsigned long level0_count; // Deles, no nível 0
+    int timer_fd;               // timerfd que acorda o worker (-1 = quem usa a roda consulta timer_wheel_wait_ms)
+    unsigned long armed;        // Tick para o qual o timerfd está armado (0 = desarmado)
+} TimerWheel;
+
+// Chamada para cada timer vencido, já fora da roda (pode agendar de novo, inclusive o próprio)
+typedef void (*TimerCallback)(TimerEntry *entry, void *context);
+
+/**
+ * Inicializa a roda no tempo atual
+ * @param use_timerfd 1 = cria o timerfd (registrado pelo worker no epoll ou no io_uring)
+ * @return 0 em sucesso, -1 se o timerfd não pôde ser criado
+ */
+int timer_wheel_init(TimerWheel *wheel, int use_timerfd);
+
+void timer_wheel_entry_init(TimerEntry *entry, int kind, void *owner);
+
+// Agenda (ou reagenda) o timer para daqui a delay_ms, arredondado para cima até um múltiplo de uma
+// potência de 2 de ticks que não passa de delay_ms >> TIMER_WHEEL_SLACK_SHIFT (como o timer_slack do
+// Linux): timers com prazos próximos vencem no mesmo tick e o worker acorda uma vez para todos
+void timer_wheel_schedule(TimerWheel *wheel, TimerEntry *entry, unsigned long delay_ms);
+
+// Tira o timer da roda (sem efeito se ele não está agendado)
+void timer_wheel_cancel(TimerWheel *wheel, TimerEntry *entry);
+
+int timer_wheel_pending(const TimerEntry *entry);
+
+/**
+ * Processa os ticks até agora: cascatas e timers vencidos; depois rearma o timerfd
+ * @return Timers vencidos
+ */
+int timer_wheel_advance(TimerWheel *wheel, TimerCallback callback, void *context);
+
+// ms até o próximo tick com timers ou cascata (-1 = roda vazia)
+int timer_wheel_wait_ms(const TimerWheel *wheel);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Terminação TLS no trecho do cliente (--tls-cert) e origem TLS no trecho do servidor (--tls-backend).
+// O handshake roda em user space com OpenSSL; depois dele, com kTLS disponível (módulo tls do kernel),
+// as chaves da sessão vão para o socket (TCP_ULP "tls") e o kernel cifra os registros: o relay escreve
+// texto puro no socket e o splice continua valendo. Sem kTLS, os registros passam por SSL_read/SSL_write
+#define TLS_HANDSHAKE_TIMEOUT_MS 5000   // Cliente ou backend que não completa o handshake nesse tempo é descartado
+
+typedef struct {
+    const char *cert_file;      // Certificado (PEM) apresentado aos clientes (NULL = sem terminação)
+    const char *key_file;       // Chave privada (PEM; padrão: o próprio cert_file)
+    int backend;                // 1 = TLS também no trecho até os backends
+    const char *backend_ca;     // CAs que verificam o certificado dos backends (NULL = não verifica; exige backend_name)
+    const char *backend_name;   // Nome enviado no SNI e exigido no certificado do backend
+    int ktls;                   // 1 = entrega as chaves ao kernel depois do handshake (padrão)
+} TlsConfig;
+
+// Sessão TLS de um socket (um trecho da conexão)
+typedef struct TlsSession TlsSession;
+
+// Contadores (todas as conexões)
+typedef struct {
+    unsigned long handshakes;       // Handshakes completos (clientes e backends)
+    unsigned long failures;         // Handshakes recusados ou que esgotaram o tempo
+    unsigned long ktls_send;        // Sessões com cifragem no kernel
+    unsigned long ktls_recv;        // Sessões com decifragem no kernel
+} TlsStats;
+
+/**
+ * Cria os contextos OpenSSL dos dois trechos (certificado, chave e CAs carregados uma vez)
+ * @return 0 em sucesso (ou TLS desativado), -1 se certificado, chave ou CAs não puderam ser carregados
+ */
+int tls_init(const TlsConfig *config);
+
+// 1 se os clientes falam TLS com o proxy
+int tls_terminates(void);
+
+// 1 se o proxy fala TLS com os backends
+int tls_originates(void);
+
+/**
+ * 1 se o kernel aceita TCP_ULP "tls": um socket sem conexão responde ENOTCONN quando o módulo
+ * existe e ENOENT quando não
+ */
+int tls_ktls_available(void);
+
+/**
+ * Handshake de servidor no socket do cliente (bloqueante, até TLS_HANDSHAKE_TIMEOUT_MS)
+ * @return Sessão estabelecida ou NULL (o socket continua aberto)
+ */
+TlsSession* tls_session_accept(int fd);
+
+// Handshake de cliente no socket do backend (bloqueante, até TLS_HANDSHAKE_TIMEOUT_MS)
+TlsSession* tls_session_connect(int fd);
+
+/**
+ * Lê dados já decifrados (socket não-bloqueante)
+ * @return Bytes lidos, 0 no close_notify ou FIN da origem, -1 em erro (errno EAGAIN se falta um registro inteiro)
+ */
+ssize_t tls_session_read(TlsSession *session, void *buffer, size_t length);
+
+/**
+ * Cifra e envia (socket não-bloqueante). Depois de EAGAIN, a próxima chamada deve começar pelos mesmos bytes
+ * @return Bytes aceitos ou -1 em erro (errno EAGAIN se o socket está cheio)
+ */
+ssize_t tls_session_write(TlsSession *session, const void *buffer, size_t length);
+
+// Bytes decifrados que o OpenSSL guarda e o poll() do socket não enxerga
+size_t tls_session_pending(const TlsSession *session);
+
+// 1 se o kernel cifra os envios: o socket aceita texto puro com send()/splice()
+int tls_session_ktls_send(const TlsSession *session);
+
+// Envia o close_notify antes do FIN (half-close)
+void tls_session_shutdown(TlsSession *session);
+
+void tls_session_free(TlsSession *session);
+
+// Versão, cifra e onde ela roda (ex.: "TLSv1.3 TLS_AES_256_GCM_SHA384, kTLS tx"), para logs
+void tls_session_describe(const TlsSession *session, char *out, size_t out_len);
+
+void tls_get_stats(TlsStats *stats);
+
+#endif
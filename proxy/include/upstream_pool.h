@@ -0,0 +1,38 @@
+#ifndef UPSTREAM_POOL_H
+#define UPSTREAM_POOL_H
+
+#include "proxy.h"
+#include "backends.h"
+
+#define POOL_REFILL_INTERVAL_MS 1000   // Intervalo da verificação de saúde e reposição
+#define POOL_MAX_IDLE_MS 60000         // Socket ocioso há mais tempo que isso é descartado
+#define POOL_CONNECT_TIMEOUT_MS 3000   // Connect de reposição mais lento que isso é abandonado (backend tenta de novo no próximo intervalo)
+
+// Contadores do pool de conexões com o servidor
+typedef struct {
+    int idle;                    // Sockets conectados aguardando um cliente
+    unsigned long hits;          // Clientes atendidos com um socket do pool
+    unsigned long misses;        // Clientes que precisaram de um connect() novo
+    unsigned long created;       // Conexões abertas pela thread de reposição
+    unsigned long discarded;     // Sockets ociosos descartados (fechados pelo servidor ou expirados)
+} UpstreamPoolStats;
+
+/**
+ * Inicia o pool (se config->pool_min > 0) e a thread que o mantém entre pool_min e pool_max
+ * @return 0 em sucesso, -1 em erro
+ */
+int upstream_pool_start(ProxyConfig *config);
+
+/**
+ * Retira do pool um socket já conectado e saudável para o backend escolhido
+ * @return O socket (bloqueante), ou -1 se não há socket desse backend ou o pool está desativado (miss)
+ */
+int upstream_pool_acquire(Backend *backend);
+
+// Indica se o pool está ativo
+int upstream_pool_enabled(void);
+
+// Copia os contadores atuais do pool
+void upstream_pool_get_stats(UpstreamPoolStats *stats);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef URING_ENGINE_H
+#define URING_ENGINE_H
+
+#include "proxy.h"
+
+/**
+ * Verifica se o kernel permite criar um io_uring com os recursos usados pela engine
+ * (accept multishot e anel de buffers fornecidos)
+ * @return 1 se disponível, 0 caso contrário
+ */
+int uring_engine_available(void);
+
+/**
+ * Executa a engine io_uring: config->num_workers threads, cada uma com seu próprio anel,
+ * accept multishot em listen_fd, connect assíncrono ao servidor e recv/send com buffers fornecidos
+ * Com config->reuseport, listen_fd é ignorado e cada worker abre seu próprio socket de escuta
+ * Não retorna em operação normal
+ * @return -1 em erro de inicialização
+ */
+int uring_engine_run(ProxyConfig *config, int listen_fd);
+
+#endif
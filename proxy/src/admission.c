@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "../include/admission.h"
+#include "../include/tcp_monitor.h"
+
+static AdmissionConfig limits;
+static int enabled = 0;
+
+static unsigned long active = 0;             // Atômicos: lidos por todos os workers sem a trava
+static unsigned long connecting = 0;
+static unsigned long queued = 0;
+static unsigned long queue_peak = 0;
+static unsigned long admitted = 0;
+static unsigned long rejected[ADMISSION_REJECT_TIMEOUT + 1];
+static unsigned long pauses = 0;
+static int paused = 0;
+
+// Token bucket da taxa de accept e espera da engine threads por uma vaga de connect()
+static pthread_mutex_t admission_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t connect_slot_cond = PTHREAD_COND_INITIALIZER;
+static double tokens = 0;
+static unsigned long last_refill_ms = 0;
+
+void admission_init(const AdmissionConfig *config) {
+    limits = *config;
+
+    if (limits.accept_rate > 0 && limits.accept_burst <= 0) {
+        limits.accept_burst = limits.accept_rate / 10 > 1 ? limits.accept_rate / 10 : 1;
+    }
+    if (limits.connect_queue < 0) limits.connect_queue = 0;
+    if (limits.queue_timeout_ms <= 0) limits.queue_timeout_ms = ADMISSION_QUEUE_TIMEOUT_DEFAULT_MS;
+
+    tokens = limits.accept_burst;
+    last_refill_ms = get_monotonic_ms();
+
+    // Espera da engine threads no relógio monotônico: um ajuste do relógio de parede não muda o prazo na fila
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&connect_slot_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    enabled = limits.max_connections > 0 || limits.accept_rate > 0 || limits.max_connecting > 0;
+}
+
+int admission_enabled(void) {
+    return enabled;
+}
+
+int admission_pauses_accept(void) {
+    return enabled && limits.shed_mode == ADMISSION_SHED_PAUSE;
+}
+
+// Repõe os tokens pelo tempo decorrido (chamada com admission_lock)
+static void admission_refill(unsigned long now) {
+    if (now <= last_refill_ms) return;
+
+    tokens += (double)(now - last_refill_ms) * limits.accept_rate / 1000.0;
+    if (tokens > limits.accept_burst) tokens = limits.accept_burst;
+    last_refill_ms = now;
+}
+
+int admission_pause_ms(void) {
+    if (!admission_pauses_accept()) return 0;
+
+    int wait = 0;
+
+    // Conexões no limite ou fila de connect() cheia: só uma saída libera, então reavalia em pouco tempo
+    if (limits.max_connections > 0 && __atomic_load_n(&active, __ATOMIC_RELAXED) >= (unsigned long)limits.max_connections) {
+        wait = ADMISSION_RETRY_MS;
+    } else if (limits.max_connecting > 0 && __atomic_load_n(&queued, __ATOMIC_RELAXED) >= (unsigned long)limits.connect_queue) {
+        wait = ADMISSION_RETRY_MS;
+    } else if (limits.accept_rate > 0) {
+        pthread_mutex_lock(&admission_lock);
+        admission_refill(get_monotonic_ms());
+        if (tokens < 1.0) wait = (int)((1.0 - tokens) * 1000.0 / limits.accept_rate) + 1;
+        pthread_mutex_unlock(&admission_lock);
+    }
+
+    // Conta cada entrada em pausa, não cada reavaliação
+    int was_paused = __atomic_exchange_n(&paused, wait > 0, __ATOMIC_RELAXED);
+    if (wait > 0 && !was_paused) __atomic_add_fetch(&pauses, 1, __ATOMIC_RELAXED);
+
+    return wait;
+}
+
+AdmissionVerdict admission_accept(void) {
+    if (!enabled) {
+        __atomic_add_fetch(&active, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&admitted, 1, __ATOMIC_RELAXED);
+        return ADMISSION_ADMIT;
+    }
+
+    unsigned long now_active = __atomic_add_fetch(&active, 1, __ATOMIC_RELAXED);
+
+    if (limits.max_connections > 0 && now_active > (unsigned long)limits.max_connections) {
+        __atomic_sub_fetch(&active, 1, __ATOMIC_RELAXED);
+        return ADMISSION_REJECT_LIMIT;
+    }
+
+    if (limits.accept_rate > 0) {
+        pthread_mutex_lock(&admission_lock);
+        admission_refill(get_monotonic_ms());
+
+        int has_token = tokens >= 1.0;
+        if (has_token) tokens -= 1.0;
+
+        pthread_mutex_unlock(&admission_lock);
+
+        if (!has_token) {
+            __atomic_sub_fetch(&active, 1, __ATOMIC_RELAXED);
+            return ADMISSION_REJECT_RATE;
+        }
+    }
+
+    __atomic_add_fetch(&admitted, 1, __ATOMIC_RELAXED);
+    return ADMISSION_ADMIT;
+}
+
+void admission_reject(int client_fd, AdmissionVerdict verdict) {
+    // SO_LINGER com tempo zero: o close() envia RST e o socket não passa por TIME_WAIT
+    struct linger reset = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(client_fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    close(client_fd);
+
+    if (verdict == ADMISSION_ADMIT) return;
+    __atomic_add_fetch(&rejected[verdict], 1, __ATOMIC_RELAXED);
+
+    // Recusas da fila acontecem depois da admissão
+    if (verdict == ADMISSION_REJECT_QUEUE || verdict == ADMISSION_REJECT_TIMEOUT) admission_release();
+}
+
+void admission_release(void) {
+    __atomic_sub_fetch(&active, 1, __ATOMIC_RELAXED);
+}
+
+// Reserva um lugar no total das filas de connect()
+// @return 0 se entrou, -1 se as filas estão cheias
+static int admission_queue_enter(void) {
+    unsigned long current = __atomic_load_n(&queued, __ATOMIC_RELAXED);
+
+    do {
+        if (current >= (unsigned long)limits.connect_queue) return -1;
+    } while (!__atomic_compare_exchange_n(&queued, &current, current + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    unsigned long peak = __atomic_load_n(&queue_peak, __ATOMIC_RELAXED);
+    while (current + 1 > peak && !__atomic_compare_exchange_n(&queue_peak, &peak, current + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return 0;
+}
+
+static void admission_queue_leave(void) {
+    __atomic_sub_fetch(&queued, 1, __ATOMIC_RELAXED);
+}
+
+int admission_connect_try(void) {
+    if (limits.max_connecting <= 0) {
+        __atomic_add_fetch(&connecting, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    unsigned long current = __atomic_load_n(&connecting, __ATOMIC_RELAXED);
+
+    do {
+        if (current >= (unsigned long)limits.max_connecting) return 0;
+    } while (!__atomic_compare_exchange_n(&connecting, &current, current + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return 1;
+}
+
+AdmissionVerdict admission_connect_wait(void) {
+    if (admission_connect_try()) return ADMISSION_ADMIT;
+    if (admission_queue_enter() < 0) return ADMISSION_REJECT_QUEUE;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += limits.queue_timeout_ms / 1000;
+    deadline.tv_nsec += (long)(limits.queue_timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    AdmissionVerdict verdict = ADMISSION_ADMIT;
+
+    pthread_mutex_lock(&admission_lock);
+    while (!admission_connect_try()) {
+        if (pthread_cond_timedwait(&connect_slot_cond, &admission_lock, &deadline) == ETIMEDOUT && !admission_connect_try()) {
+            verdict = ADMISSION_REJECT_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&admission_lock);
+
+    admission_queue_leave();
+    return verdict;
+}
+
+void admission_connect_done(void) {
+    __atomic_sub_fetch(&connecting, 1, __ATOMIC_RELAXED);
+
+    // Acorda uma thread da engine threads que espera na fila (as outras engines reavaliam no loop)
+    if (limits.max_connecting > 0 && __atomic_load_n(&queued, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&admission_lock);
+        pthread_cond_signal(&connect_slot_cond);
+        pthread_mutex_unlock(&admission_lock);
+    }
+}
+
+void admission_queue_admit(AdmissionQueue *queue, int client_fd, const struct sockaddr_in *client_address, uint64_t accepted_ns,
+                           AdmissionStartCallback start, void *context) {
+    // Quem já espera tem prioridade: a vaga só é tomada direto com a fila do worker vazia
+    if (!queue->head && admission_connect_try()) {
+        start(context, client_fd, client_address, accepted_ns);
+        return;
+    }
+
+    if (admission_queue_enter() < 0) {
+        admission_reject(client_fd, ADMISSION_REJECT_QUEUE);
+        return;
+    }
+
+    AdmissionWaiting *waiting = malloc(sizeof(AdmissionWaiting));
+
+    if (!waiting) {
+        perror("Erro ao alocar conexão na fila de connect");
+        admission_queue_leave();
+        admission_reject(client_fd, ADMISSION_REJECT_QUEUE);
+        return;
+    }
+
+    waiting->client_fd = client_fd;
+    waiting->client_address = *client_address;
+    waiting->accepted_ns = accepted_ns;
+    waiting->deadline_ms = get_monotonic_ms() + (unsigned long)limits.queue_timeout_ms;
+    waiting->next = NULL;
+
+    if (queue->tail) queue->tail->next = waiting;
+    else queue->head = waiting;
+    queue->tail = waiting;
+}
+
+int admission_queue_drain(AdmissionQueue *queue, AdmissionStartCallback start, void *context) {
+    unsigned long now = get_monotonic_ms();
+
+    while (queue->head) {
+        AdmissionWaiting *waiting = queue->head;
+        int expired = now >= waiting->deadline_ms;
+
+        if (!expired && !admission_connect_try()) break;
+
+        queue->head = waiting->next;
+        if (!queue->head) queue->tail = NULL;
+        admission_queue_leave();
+
+        if (expired) admission_reject(waiting->client_fd, ADMISSION_REJECT_TIMEOUT);
+        else start(context, waiting->client_fd, &waiting->client_address, waiting->accepted_ns);
+
+        free(waiting);
+    }
+
+    return queue->head ? ADMISSION_RETRY_MS : -1;
+}
+
+void admission_get_stats(AdmissionStats *stats) {
+    stats->active = __atomic_load_n(&active, __ATOMIC_RELAXED);
+    stats->connecting = __atomic_load_n(&connecting, __ATOMIC_RELAXED);
+    stats->queued = __atomic_load_n(&queued, __ATOMIC_RELAXED);
+    stats->queue_peak = __atomic_load_n(&queue_peak, __ATOMIC_RELAXED);
+    stats->admitted = __atomic_load_n(&admitted, __ATOMIC_RELAXED);
+    stats->rejected_limit = __atomic_load_n(&rejected[ADMISSION_REJECT_LIMIT], __ATOMIC_RELAXED);
+    stats->rejected_rate = __atomic_load_n(&rejected[ADMISSION_REJECT_RATE], __ATOMIC_RELAXED);
+    stats->rejected_queue = __atomic_load_n(&rejected[ADMISSION_REJECT_QUEUE], __ATOMIC_RELAXED);
+    stats->rejected_timeout = __atomic_load_n(&rejected[ADMISSION_REJECT_TIMEOUT], __ATOMIC_RELAXED);
+    stats->pauses = __atomic_load_n(&pauses, __ATOMIC_RELAXED);
+}
+
+const char* admission_shed_name(AdmissionShedMode mode) {
+    return mode == ADMISSION_SHED_PAUSE ? "pausa o accept" : "RST";
+}
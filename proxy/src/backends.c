@@ -0,0 +1,337 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../include/backends.h"
+
+static Backend backends[MAX_BACKENDS];
+static int backend_count = 0;
+static unsigned int round_robin_next = 0;
+static ProxyConfig *backends_config = NULL;
+
+static pthread_mutex_t backends_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t health_thread;
+
+// Relógio com resolução de microssegundos: o connect em rede local leva menos de 1 ms
+static double backends_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+// Resolve host:porta (uma única vez) e preenche o backend
+static int backend_resolve(Backend *backend, const char *host, int port) {
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    char port_str[16];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;     // IPv4 ou IPv6
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port_str, sizeof(port_str), "%d", port);
+
+    int status = getaddrinfo(host, port_str, &hints, &result);
+
+    if (status != 0 || result == NULL) {
+        fprintf(stderr, "Erro ao resolver backend '%s': %s\n", host, gai_strerror(status));
+        return -1;
+    }
+
+    memset(backend, 0, sizeof(Backend));
+    snprintf(backend->host, sizeof(backend->host), "%s", host);
+    backend->port = port;
+    memcpy(&backend->address, result->ai_addr, result->ai_addrlen);
+    backend->address_len = result->ai_addrlen;
+    backend->healthy = 1;
+
+    char ip_str[INET6_ADDRSTRLEN];
+    getnameinfo(result->ai_addr, result->ai_addrlen, ip_str, sizeof(ip_str), NULL, 0, NI_NUMERICHOST);
+    snprintf(backend->address_str, sizeof(backend->address_str),
+             result->ai_family == AF_INET6 ? "[%s]:%d" : "%s:%d", ip_str, port);
+
+    freeaddrinfo(result);
+    return 0;
+}
+
+// Separa "host:porta" ou "[ipv6]:porta"
+static int backend_parse_spec(const char *spec, char *host, size_t host_size, int *port) {
+    const char *separator;
+
+    if (spec[0] == '[') {
+        const char *closing = strchr(spec, ']');
+        if (!closing || closing[1] != ':') return -1;
+
+        snprintf(host, host_size, "%.*s", (int)(closing - spec - 1), spec + 1);
+        separator = closing + 1;
+    } else {
+        separator = strrchr(spec, ':');
+        if (!separator) return -1;
+
+        snprintf(host, host_size, "%.*s", (int)(separator - spec), spec);
+    }
+
+    *port = atoi(separator + 1);
+    return *port > 0 ? 0 : -1;
+}
+
+int backends_init(ProxyConfig *config) {
+    backends_config = config;
+    backend_count = 0;
+
+    if (backend_resolve(&backends[backend_count], config->target_host, config->target_port) < 0) return -1;
+    backend_count++;
+
+    for (int i = 0; i < config->backend_spec_count && backend_count < MAX_BACKENDS; i++) {
+        char host[BACKEND_HOST_MAX];
+        int port;
+
+        if (backend_parse_spec(config->backend_specs[i], host, sizeof(host), &port) < 0) {
+            fprintf(stderr, "Backend inválido '%s'. Use host:porta ou [ipv6]:porta.\n", config->backend_specs[i]);
+            return -1;
+        }
+
+        if (backend_resolve(&backends[backend_count], host, port) < 0) return -1;
+        backend_count++;
+    }
+
+    return 0;
+}
+
+/**
+ * Ordem da lowest-rtt entre backends já medidos: RTT menor vence; RTTs próximos (BACKEND_RTT_TIE_RATIO)
+ * vão para a maior taxa entregue e, sem diferença nela, para quem tem menos conexões
+ * @return 1 se candidate é melhor que best
+ */
+static int backend_rtt_better(const Backend *candidate, const Backend *best) {
+    if (candidate->srtt_ms * BACKEND_RTT_TIE_RATIO < best->srtt_ms) return 1;
+    if (best->srtt_ms * BACKEND_RTT_TIE_RATIO < candidate->srtt_ms) return 0;
+
+    if (candidate->delivery_kbps * BACKEND_RTT_TIE_RATIO < best->delivery_kbps) return 0;
+    if (best->delivery_kbps * BACKEND_RTT_TIE_RATIO < candidate->delivery_kbps) return 1;
+
+    return candidate->active_connections < best->active_connections;
+}
+
+// Escolhe o backend pela política (chamada com o lock)
+static Backend* backends_choose(void) {
+    int any_healthy = 0;
+    for (int i = 0; i < backend_count; i++) any_healthy |= backends[i].healthy;
+
+    Backend *best = NULL;
+    LoadBalancePolicy policy = backends_config->lb_policy;
+
+    if (policy == LB_ROUND_ROBIN) {
+        for (int attempt = 0; attempt < backend_count; attempt++) {
+            Backend *candidate = &backends[round_robin_next++ % backend_count];
+            if (!any_healthy || candidate->healthy) return candidate;
+        }
+        return &backends[0];
+    }
+
+    int any_measured = 0;
+    for (int i = 0; i < backend_count; i++) {
+        Backend *candidate = &backends[i];
+        if (any_healthy && !candidate->healthy) continue;
+
+        // Backend sem amostra recebe uma conexão por vez, só para ser medido; as demais ficam com os medidos
+        if (policy == LB_LOWEST_RTT && candidate->srtt_ms <= 0 && candidate->active_connections == 0) return candidate;
+        any_measured |= candidate->srtt_ms > 0;
+    }
+
+    for (int i = 0; i < backend_count; i++) {
+        Backend *candidate = &backends[i];
+        if (any_healthy && !candidate->healthy) continue;
+        if (policy == LB_LOWEST_RTT && any_measured && candidate->srtt_ms <= 0) continue;
+
+        if (best == NULL) {
+            best = candidate;
+            continue;
+        }
+
+        if (policy == LB_LOWEST_RTT && any_measured) {
+            if (backend_rtt_better(candidate, best)) best = candidate;
+        } else if (candidate->active_connections < best->active_connections) {
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+Backend* backends_acquire(void) {
+    pthread_mutex_lock(&backends_lock);
+
+    Backend *backend = backends_choose();
+    backend->active_connections++;
+    backend->total_connections++;
+
+    pthread_mutex_unlock(&backends_lock);
+    return backend;
+}
+
+int backends_count(void) {
+    return backend_count;
+}
+
+Backend* backends_get(int index) {
+    if (index < 0 || index >= backend_count) return NULL;
+    return &backends[index];
+}
+
+int backends_is_healthy(Backend *backend) {
+    pthread_mutex_lock(&backends_lock);
+    int healthy = backend->healthy;
+    pthread_mutex_unlock(&backends_lock);
+    return healthy;
+}
+
+void backends_release(Backend *backend) {
+    if (!backend) return;
+
+    pthread_mutex_lock(&backends_lock);
+    if (backend->active_connections > 0) backend->active_connections--;
+    pthread_mutex_unlock(&backends_lock);
+}
+
+void backends_report_sample(Backend *backend, double rtt_ms, double delivery_kbps) {
+    if (!backend || rtt_ms <= 0) return;
+
+    pthread_mutex_lock(&backends_lock);
+    if (backend->srtt_ms <= 0) backend->srtt_ms = rtt_ms;
+    else backend->srtt_ms = (1.0 - BACKEND_RTT_ALPHA) * backend->srtt_ms + BACKEND_RTT_ALPHA * rtt_ms;
+
+    if (delivery_kbps > 0) {
+        if (backend->delivery_kbps <= 0) backend->delivery_kbps = delivery_kbps;
+        else backend->delivery_kbps = (1.0 - BACKEND_RTT_ALPHA) * backend->delivery_kbps + BACKEND_RTT_ALPHA * delivery_kbps;
+    }
+    pthread_mutex_unlock(&backends_lock);
+}
+
+// Atualiza o estado de saúde com o resultado de uma verificação (chamada com o lock)
+static void backend_record_result(Backend *backend, int success) {
+    if (success) {
+        backend->consecutive_failures = 0;
+        backend->consecutive_successes++;
+
+        if (!backend->healthy && backend->consecutive_successes >= BACKEND_RESTORE_SUCCESSES) {
+            backend->healthy = 1;
+            printf("[Backends] %s readmitido\n", backend->address_str);
+        }
+    } else {
+        backend->consecutive_successes = 0;
+        backend->consecutive_failures++;
+
+        if (backend->healthy && backend->consecutive_failures >= BACKEND_EJECT_FAILURES) {
+            backend->healthy = 0;
+            printf("[Backends] %s ejetado (lento ou fora do ar)\n", backend->address_str);
+        }
+    }
+}
+
+void backends_report_failure(Backend *backend) {
+    if (!backend) return;
+
+    pthread_mutex_lock(&backends_lock);
+    backend->connect_failures++;
+
+    // Sem verificação ativa nada readmitiria o backend, então a falha só é contada
+    if (backends_config->health_interval_ms > 0) backend_record_result(backend, 0);
+    pthread_mutex_unlock(&backends_lock);
+}
+
+/**
+ * Verificação ativa: connect não-bloqueante com timeout
+ * @return Tempo do handshake em ms, ou -1 se falhou ou passou do limite
+ */
+static double backend_probe(const Backend *backend, int timeout_ms) {
+    int probe_socket = socket(backend->address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe_socket < 0) return -1;
+
+    double start = backends_now_ms();
+    double elapsed = -1;
+
+    if (connect(probe_socket, (const struct sockaddr*)&backend->address, backend->address_len) == 0) {
+        elapsed = backends_now_ms() - start;
+    } else if (errno == EINPROGRESS) {
+        struct pollfd poll_fd = { .fd = probe_socket, .events = POLLOUT };
+
+        if (poll(&poll_fd, 1, timeout_ms) == 1) {
+            int socket_error = 0;
+            socklen_t error_len = sizeof(socket_error);
+            getsockopt(probe_socket, SOL_SOCKET, SO_ERROR, &socket_error, &error_len);
+
+            if (socket_error == 0) elapsed = backends_now_ms() - start;
+        }
+    }
+
+    close(probe_socket);
+    return elapsed;
+}
+
+static void* health_check_main(void *args) {
+    (void)args;
+
+    while (1) {
+        for (int i = 0; i < backend_count; i++) {
+            // O probe roda fora do lock; só o resultado é registrado com ele
+            double connect_ms = backend_probe(&backends[i], backends_config->health_max_ms);
+
+            pthread_mutex_lock(&backends_lock);
+            backends[i].last_probe_ms = connect_ms;
+            backend_record_result(&backends[i], connect_ms >= 0);
+
+            // Sem tráfego ainda, o handshake é a melhor estimativa de RTT do caminho
+            if (connect_ms > 0 && backends[i].srtt_ms <= 0) {
+                backends[i].srtt_ms = connect_ms;
+            }
+            pthread_mutex_unlock(&backends_lock);
+        }
+
+        usleep(backends_config->health_interval_ms * 1000);
+    }
+
+    return NULL;
+}
+
+int backends_start_health_checks(ProxyConfig *config) {
+    if (config->health_interval_ms <= 0) return 0;
+
+    if (pthread_create(&health_thread, NULL, health_check_main, NULL) != 0) {
+        perror("Erro ao criar thread de verificação de saúde");
+        return -1;
+    }
+
+    pthread_detach(health_thread);
+    return 0;
+}
+
+void backends_print_status(void) {
+    pthread_mutex_lock(&backends_lock);
+
+    for (int i = 0; i < backend_count; i++) {
+        Backend *backend = &backends[i];
+        printf("[Backend] %-24s | %-8s | Ativas: %-4d | SRTT: %8.3f ms | Entrega: %10.1f kbps | Total: %lu | Falhas: %lu\n",
+               backend->address_str, backend->healthy ? "OK" : "EJETADO", backend->active_connections,
+               backend->srtt_ms, backend->delivery_kbps, backend->total_connections, backend->connect_failures);
+    }
+
+    pthread_mutex_unlock(&backends_lock);
+}
+
+const char* backends_policy_name(LoadBalancePolicy policy) {
+    switch (policy) {
+        case LB_LEAST_CONNECTIONS: return "least-connections";
+        case LB_LOWEST_RTT: return "lowest-rtt";
+        default: return "round-robin";
+    }
+}
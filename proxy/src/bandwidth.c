@@ -0,0 +1,392 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+
+#include "../include/bandwidth.h"
+#include "../include/tcp_monitor.h"
+
+#define BANDWIDTH_MIN_DEMAND 16384.0        // Demanda mínima de um cliente ativo: o balde ocioso volta a encher em 1 s
+#define BANDWIDTH_ACHIEVED_ALPHA 0.05       // Peso de cada rodada na taxa obtida (média de ~200 ms)
+
+struct BandwidthClient {
+    uint32_t ip;                    // Ordem de rede (0 = vaga livre)
+    int weight;
+    int connections;                // Atômico
+    long credit;                    // Tokens em bytes (atômico)
+    unsigned long used_bytes;       // Bytes lidos com tokens (atômico)
+    int backlogged;                 // Atômico: faltou token nesta rodada
+    unsigned long allotted;         // Parcela em bytes/s (atômico, escrita pelo escalonador)
+    unsigned long guaranteed;       // Parte do orçamento garantida pelo peso, em bytes/s (atômico)
+    unsigned long generation;       // Muda quando o pacing das conexões precisa ser refeito (atômico)
+    unsigned long round;            // Rodada atual do cliente: zera o quantum das conexões (atômico)
+    long quantum;                   // Bytes por conexão nesta rodada (atômico)
+    int readers;                    // Conexões que leram nesta rodada (atômico)
+
+    // Estado do escalonador (com table_lock)
+    unsigned long used_mark;
+    double achieved_bytes_sec;
+    double demand;
+    int satisfied;
+    unsigned long paced;            // Base do pacing no último incremento de generation
+};
+
+static BandwidthConfig limits;
+static int enabled = 0;
+
+// Tabela por IP (endereçamento aberto). Vagas nunca voltam a ficar livres: um IP sem conexões
+// cede a vaga a outro, e a busca só para em uma vaga livre, então as cadeias continuam válidas
+static BandwidthClient clients[BANDWIDTH_MAX_CLIENTS];
+static BandwidthClient overflow_client;    // IPs além da tabela dividem este balde
+static BandwidthClient *active[BANDWIDTH_MAX_CLIENTS + 1];
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t scheduler_thread;
+static unsigned long next_round_ms = 0;
+
+int bandwidth_parse_weight(BandwidthConfig *config, const char *spec) {
+    char address[64];
+    const char *equals = strchr(spec, '=');
+
+    if (!equals || config->weight_count >= BANDWIDTH_MAX_WEIGHTS || (size_t)(equals - spec) >= sizeof(address)) return -1;
+
+    memcpy(address, spec, equals - spec);
+    address[equals - spec] = '\0';
+
+    int prefix = 32;
+    char *slash = strchr(address, '/');
+
+    if (slash) {
+        *slash = '\0';
+        prefix = atoi(slash + 1);
+        if (prefix < 0 || prefix > 32) return -1;
+    }
+
+    struct in_addr network;
+    int weight = atoi(equals + 1);
+    if (inet_pton(AF_INET, address, &network) != 1 || weight <= 0) return -1;
+
+    BandwidthWeight *rule = &config->weights[config->weight_count++];
+    rule->mask = prefix == 0 ? 0 : htonl(0xFFFFFFFFu << (32 - prefix));
+    rule->network = network.s_addr & rule->mask;
+    rule->weight = weight;
+    return 0;
+}
+
+static int bandwidth_weight_for(uint32_t ip) {
+    for (int i = 0; i < limits.weight_count; i++) {
+        if ((ip & limits.weights[i].mask) == limits.weights[i].network) return limits.weights[i].weight;
+    }
+    return 1;
+}
+
+// Volta a vaga ao estado de um cliente novo (com table_lock)
+static void bandwidth_client_reset(BandwidthClient *client, uint32_t ip) {
+    client->ip = ip;
+    client->weight = bandwidth_weight_for(ip);
+    client->credit = BANDWIDTH_MIN_BURST;
+    client->used_mark = __atomic_load_n(&client->used_bytes, __ATOMIC_RELAXED);
+    client->backlogged = 0;
+    client->allotted = 0;
+    client->achieved_bytes_sec = 0;
+    client->paced = 0;
+    client->quantum = BANDWIDTH_MIN_BURST;
+    client->readers = 0;
+}
+
+// Parcela de cada cliente ativo: partilha max-min ponderada do orçamento (com table_lock)
+static void bandwidth_share(int count, double total_weight) {
+    double remaining = limits.rate_bytes_sec;
+    double weight_left = total_weight;
+    int changed = 1;
+
+    for (int i = 0; i < count; i++) active[i]->satisfied = 0;
+
+    // Quem pede menos que a sua parte recebe o que pede; a sobra é dividida de novo entre os demais
+    while (changed && weight_left > 0) {
+        double unit = remaining / weight_left;
+        changed = 0;
+
+        for (int i = 0; i < count; i++) {
+            BandwidthClient *client = active[i];
+            if (client->satisfied || client->demand > unit * client->weight) continue;
+
+            client->satisfied = 1;
+            __atomic_store_n(&client->allotted, (unsigned long)client->demand, __ATOMIC_RELAXED);
+            remaining -= client->demand;
+            weight_left -= client->weight;
+            changed = 1;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        BandwidthClient *client = active[i];
+        if (!client->satisfied) __atomic_store_n(&client->allotted, (unsigned long)(remaining * client->weight / weight_left), __ATOMIC_RELAXED);
+    }
+}
+
+// Repõe os tokens da rodada, limitados ao balde, e abre uma rodada nova para as conexões: o balde
+// é dividido entre as que leram na rodada anterior (as ociosas não seguram quantum)
+static void bandwidth_refill(BandwidthClient *client, double elapsed_s) {
+    unsigned long allotted = __atomic_load_n(&client->allotted, __ATOMIC_RELAXED);
+    long burst = (long)(allotted * BANDWIDTH_BURST_MS / 1000);
+    long add = (long)(allotted * elapsed_s);
+    long credit = __atomic_load_n(&client->credit, __ATOMIC_RELAXED);
+    long updated;
+
+    if (burst < BANDWIDTH_MIN_BURST) burst = BANDWIDTH_MIN_BURST;
+
+    do {
+        updated = credit + add > burst ? burst : credit + add;
+    } while (!__atomic_compare_exchange_n(&client->credit, &credit, updated, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    int readers = __atomic_exchange_n(&client->readers, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&client->quantum, burst / (readers > 1 ? readers : 1), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&client->round, 1, __ATOMIC_RELEASE);
+}
+
+static void bandwidth_round(double elapsed_s) {
+    int count = 0;
+    double total_weight = 0;
+
+    pthread_mutex_lock(&table_lock);
+
+    // Uso e demanda da rodada: quem ficou sem tokens quer mais que qualquer parcela
+    for (int i = 0; i <= BANDWIDTH_MAX_CLIENTS; i++) {
+        BandwidthClient *client = i < BANDWIDTH_MAX_CLIENTS ? &clients[i] : &overflow_client;
+        if (__atomic_load_n(&client->connections, __ATOMIC_RELAXED) <= 0) continue;
+
+        unsigned long used = __atomic_load_n(&client->used_bytes, __ATOMIC_RELAXED);
+        double rate = (double)(used - client->used_mark) / elapsed_s;
+        client->used_mark = used;
+        client->achieved_bytes_sec += (rate - client->achieved_bytes_sec) * BANDWIDTH_ACHIEVED_ALPHA;
+
+        if (__atomic_exchange_n(&client->backlogged, 0, __ATOMIC_RELAXED)) {
+            client->demand = limits.rate_bytes_sec;
+        } else {
+            double recent = rate > client->achieved_bytes_sec ? rate : client->achieved_bytes_sec;
+            client->demand = recent * BANDWIDTH_DEMAND_GAIN;
+            if (client->demand < BANDWIDTH_MIN_DEMAND) client->demand = BANDWIDTH_MIN_DEMAND;
+        }
+
+        active[count++] = client;
+        total_weight += client->weight;
+    }
+
+    bandwidth_share(count, total_weight);
+
+    for (int i = 0; i < count; i++) {
+        BandwidthClient *client = active[i];
+        unsigned long guaranteed = (unsigned long)(limits.rate_bytes_sec * client->weight / total_weight);
+        unsigned long allotted = __atomic_load_n(&client->allotted, __ATOMIC_RELAXED);
+        unsigned long base = allotted > guaranteed ? allotted : guaranteed;
+
+        __atomic_store_n(&client->guaranteed, guaranteed, __ATOMIC_RELAXED);
+        bandwidth_refill(client, elapsed_s);
+
+        // Pacing refeito só com variação relevante (é um setsockopt por conexão)
+        double change = client->paced ? (double)base / client->paced - 1.0 : 1.0;
+        if (change > BANDWIDTH_PACING_CHANGE || change < -BANDWIDTH_PACING_CHANGE) {
+            client->paced = base;
+            __atomic_add_fetch(&client->generation, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    pthread_mutex_unlock(&table_lock);
+}
+
+static void* bandwidth_scheduler_main(void *args) {
+    (void)args;
+    unsigned long last = get_monotonic_ms();
+
+    while (1) {
+        __atomic_store_n(&next_round_ms, last + BANDWIDTH_ROUND_MS, __ATOMIC_RELAXED);
+        usleep(BANDWIDTH_ROUND_MS * 1000);
+
+        unsigned long now = get_monotonic_ms();
+        if (now <= last) continue;
+
+        bandwidth_round((now - last) / 1000.0);
+        last = now;
+    }
+
+    return NULL;
+}
+
+int bandwidth_start(const BandwidthConfig *config) {
+    limits = *config;
+    if (limits.rate_bytes_sec <= 0) return 0;
+
+    overflow_client.weight = 1;
+    overflow_client.credit = BANDWIDTH_MIN_BURST;
+    overflow_client.quantum = BANDWIDTH_MIN_BURST;
+
+    if (pthread_create(&scheduler_thread, NULL, bandwidth_scheduler_main, NULL) != 0) {
+        perror("Erro ao criar thread do escalonador de banda");
+        return -1;
+    }
+
+    pthread_detach(scheduler_thread);
+    enabled = 1;
+    return 0;
+}
+
+int bandwidth_enabled(void) {
+    return enabled;
+}
+
+BandwidthClient* bandwidth_acquire(const struct sockaddr_in *address) {
+    uint32_t ip = address->sin_addr.s_addr;
+    uint32_t start = (ntohl(ip) * 2654435761u) % BANDWIDTH_MAX_CLIENTS;
+    BandwidthClient *found = NULL;
+    BandwidthClient *reusable = NULL;
+
+    pthread_mutex_lock(&table_lock);
+
+    for (uint32_t probe = 0; probe < BANDWIDTH_MAX_CLIENTS; probe++) {
+        BandwidthClient *client = &clients[(start + probe) % BANDWIDTH_MAX_CLIENTS];
+
+        if (client->ip == ip && ip != 0) {
+            found = client;
+            break;
+        }
+        if (client->ip == 0) {
+            if (!reusable) reusable = client;
+            break;
+        }
+        if (!reusable && __atomic_load_n(&client->connections, __ATOMIC_RELAXED) == 0) reusable = client;
+    }
+
+    if (!found && reusable && ip != 0) {
+        bandwidth_client_reset(reusable, ip);
+        found = reusable;
+    }
+    if (!found) found = &overflow_client;
+
+    __atomic_add_fetch(&found->connections, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&table_lock);
+
+    return found;
+}
+
+void bandwidth_release(BandwidthClient *client) {
+    if (client) __atomic_sub_fetch(&client->connections, 1, __ATOMIC_RELAXED);
+}
+
+// Quantum que a conexão ainda tem na rodada atual (a primeira leitura da rodada a conta como leitora)
+static long bandwidth_quota_left(BandwidthClient *client, BandwidthQuota *quota) {
+    unsigned long round = __atomic_load_n(&client->round, __ATOMIC_ACQUIRE);
+
+    if (quota->round != round) {
+        quota->round = round;
+        quota->used = 0;
+        __atomic_add_fetch(&client->readers, 1, __ATOMIC_RELAXED);
+    }
+
+    return __atomic_load_n(&client->quantum, __ATOMIC_RELAXED) - quota->used;
+}
+
+size_t bandwidth_take(BandwidthClient *client, BandwidthQuota *quota, size_t wanted) {
+    long allowed = bandwidth_quota_left(client, quota);
+    long credit = __atomic_load_n(&client->credit, __ATOMIC_RELAXED);
+    long granted;
+
+    if (allowed < (long)wanted) wanted = allowed > 0 ? (size_t)allowed : 0;
+
+    do {
+        if (credit <= 0 || wanted == 0) {
+            __atomic_store_n(&client->backlogged, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        granted = credit < (long)wanted ? credit : (long)wanted;
+    } while (!__atomic_compare_exchange_n(&client->credit, &credit, credit - granted, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    quota->used += granted;
+    return (size_t)granted;
+}
+
+void bandwidth_settle(BandwidthClient *client, BandwidthQuota *quota, size_t wanted, size_t granted, size_t used) {
+    if (used < granted) {
+        __atomic_add_fetch(&client->credit, (long)(granted - used), __ATOMIC_RELAXED);
+        quota->used -= (long)(granted - used);
+    }
+    if (used > 0) __atomic_add_fetch(&client->used_bytes, used, __ATOMIC_RELAXED);
+
+    // A leitura usou tudo que os tokens permitiam e havia espaço para mais: o cliente tem fila
+    if (used == granted && granted < wanted) __atomic_store_n(&client->backlogged, 1, __ATOMIC_RELAXED);
+}
+
+int bandwidth_blocked(const BandwidthClient *client, const BandwidthQuota *quota) {
+    if (__atomic_load_n(&client->credit, __ATOMIC_RELAXED) <= 0) return 1;
+
+    // Quantum esgotado só vale na mesma rodada (uma rodada nova o renova)
+    return quota->round == __atomic_load_n(&client->round, __ATOMIC_ACQUIRE) &&
+           quota->used >= __atomic_load_n(&client->quantum, __ATOMIC_RELAXED);
+}
+
+int bandwidth_wait_ms(void) {
+    unsigned long next = __atomic_load_n(&next_round_ms, __ATOMIC_RELAXED);
+    unsigned long now = get_monotonic_ms();
+
+    // Nunca 0: sem tokens, bombear antes da rodada só repetiria a leitura recusada
+    return next > now ? (int)(next - now) : 1;
+}
+
+int bandwidth_pacing_rate(BandwidthClient *client, unsigned long *generation, unsigned long *rate_bytes_sec) {
+    unsigned long current = __atomic_load_n(&client->generation, __ATOMIC_ACQUIRE);
+    if (current == *generation) return 0;
+
+    unsigned long allotted = __atomic_load_n(&client->allotted, __ATOMIC_RELAXED);
+    unsigned long guaranteed = __atomic_load_n(&client->guaranteed, __ATOMIC_RELAXED);
+    unsigned long base = allotted > guaranteed ? allotted : guaranteed;
+
+    *generation = current;
+    *rate_bytes_sec = (unsigned long)(base * BANDWIDTH_PACING_GAIN);
+    if (*rate_bytes_sec < BANDWIDTH_MIN_BURST) *rate_bytes_sec = BANDWIDTH_MIN_BURST;
+    return 1;
+}
+
+void bandwidth_print_status(void) {
+    int count = 0, shown = 0;
+    double used = 0;
+
+    pthread_mutex_lock(&table_lock);
+
+    for (int i = 0; i <= BANDWIDTH_MAX_CLIENTS; i++) {
+        BandwidthClient *client = i < BANDWIDTH_MAX_CLIENTS ? &clients[i] : &overflow_client;
+        if (__atomic_load_n(&client->connections, __ATOMIC_RELAXED) <= 0) continue;
+        used += client->achieved_bytes_sec;
+        count++;
+    }
+
+    printf("[Banda] Orçamento: %.2f Mbit/s | Em uso: %.2f Mbit/s | Clientes: %d\n",
+           limits.rate_bytes_sec * 8 / 1e6, used * 8 / 1e6, count);
+
+    for (int i = 0; i <= BANDWIDTH_MAX_CLIENTS && shown < BANDWIDTH_REPORT_CLIENTS; i++) {
+        BandwidthClient *client = i < BANDWIDTH_MAX_CLIENTS ? &clients[i] : &overflow_client;
+        int connections = __atomic_load_n(&client->connections, __ATOMIC_RELAXED);
+        if (connections <= 0) continue;
+
+        char ip_str[INET_ADDRSTRLEN] = "outros";
+        if (client != &overflow_client) inet_ntop(AF_INET, &client->ip, ip_str, sizeof(ip_str));
+
+        printf("[Banda] %-15s | Peso: %-3d | Conexões: %-4d | Parcela: %8.2f Mbit/s | Obtido: %8.2f Mbit/s\n",
+               ip_str, client->weight, connections, __atomic_load_n(&client->allotted, __ATOMIC_RELAXED) * 8 / 1e6,
+               client->achieved_bytes_sec * 8 / 1e6);
+        shown++;
+    }
+
+    if (count > shown) printf("[Banda] ... e mais %d clientes\n", count - shown);
+
+    pthread_mutex_unlock(&table_lock);
+}
+
+const char* bandwidth_direction_name(BandwidthDirection direction) {
+    switch (direction) {
+        case BANDWIDTH_UP: return "Cliente -> Servidor";
+        case BANDWIDTH_BOTH: return "as duas direções";
+        default: return "Servidor -> Cliente";
+    }
+}
@@ -0,0 +1,164 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../include/congestion_control.h"
+#include "../include/proxy.h"
+
+int cc_set_algorithm(int sock_fd, const char *algorithm) {
+    #ifdef TCP_CONGESTION
+        if (setsockopt(sock_fd, IPPROTO_TCP, TCP_CONGESTION, algorithm, strlen(algorithm)) < 0) return -1;
+        return 0;
+    #else
+        (void)sock_fd;
+        (void)algorithm;
+        errno = ENOPROTOOPT;
+        return -1;
+    #endif
+}
+
+// Lê o algoritmo atual do socket (padrão do sistema até a primeira troca)
+static void cc_read_algorithm(int sock_fd, char *out) {
+    snprintf(out, CC_NAME_MAX, "padrão");
+    #ifdef TCP_CONGESTION
+        char name[CC_NAME_MAX] = {0};
+        socklen_t len = sizeof(name) - 1;
+        if (getsockopt(sock_fd, IPPROTO_TCP, TCP_CONGESTION, name, &len) == 0 && name[0]) {
+            snprintf(out, CC_NAME_MAX, "%s", name);
+        }
+    #endif
+}
+
+const char* cc_path_class_name(PathClass path_class) {
+    switch (path_class) {
+        case PATH_NORMAL: return "normal";
+        case PATH_LOSSY: return "com perdas";
+        case PATH_BANDWIDTH_LIMITED: return "limitado por banda";
+        case PATH_HIGH_BDP: return "alto BDP";
+        case PATH_JITTERY: return "com jitter";
+        default: return "desconhecido";
+    }
+}
+
+// Algoritmo preferido para cada classe:
+// - perdas: BBR não interpreta perda aleatória como congestionamento (CUBIC/Reno colapsam)
+// - limitado por banda: BBR mantém a fila do gargalo curta em vez de enchê-la
+// - alto BDP: BBR chega à banda do caminho sem depender do crescimento por perdas
+// - jitter: CUBIC, baseado em perdas, não reage à variação de RTT que engana o modelo do BBR
+// - normal: CUBIC, o padrão do Linux
+static const char* cc_algorithm_for(PathClass path_class) {
+    switch (path_class) {
+        case PATH_LOSSY:
+        case PATH_BANDWIDTH_LIMITED:
+        case PATH_HIGH_BDP:
+            return "bbr";
+        default:
+            return "cubic";
+    }
+}
+
+void cc_classifier_init(PathClassifier *classifier, int sock_fd, CongestionControlMode mode, const char *algorithm, const char *leg_name) {
+    memset(classifier, 0, sizeof(*classifier));
+    classifier->path_class = PATH_UNKNOWN;
+
+    if (mode == CC_MODE_OFF) {
+        // Nada a decidir: o socket fica com o algoritmo padrão do sistema
+        classifier->decided = 1;
+        return;
+    }
+
+    cc_read_algorithm(sock_fd, classifier->algorithm);
+
+    if (mode == CC_MODE_FIXED) {
+        classifier->decided = 1;
+        if (cc_set_algorithm(sock_fd, algorithm) == 0) {
+            snprintf(classifier->algorithm, CC_NAME_MAX, "%s", algorithm);
+        } else {
+            printf("[CC] %s: não foi possível usar %s (%s), mantendo %s\n",
+                   leg_name, algorithm, strerror(errno), classifier->algorithm);
+        }
+    }
+}
+
+// Classifica o caminho com as amostras acumuladas, do sinal mais grave para o mais leve
+static PathClass cc_classify(const PathClassifier *classifier, char *reason, size_t reason_len) {
+    double avg_rtt_ms = classifier->rtt_sum_ms / classifier->samples;
+    double avg_rtt_var_ms = classifier->rtt_var_sum_ms / classifier->samples;
+    double loss_rate = classifier->segs_out > 0 ? (double)classifier->total_retrans / classifier->segs_out : 0.0;
+    double bdp_bytes = classifier->max_delivery_bytes_sec * (classifier->min_rtt_ms / 1000.0);
+
+    if (loss_rate > CC_LOSSY_RATE) {
+        snprintf(reason, reason_len, "retransmissões %.2f%% dos segmentos", loss_rate * 100.0);
+        return PATH_LOSSY;
+    }
+
+    if (classifier->min_rtt_ms > 0 && classifier->queued_samples * 2 > classifier->samples) {
+        snprintf(reason, reason_len, "RTT médio %.2f ms contra mínimo %.2f ms, fila no gargalo",
+                 avg_rtt_ms, classifier->min_rtt_ms);
+        return PATH_BANDWIDTH_LIMITED;
+    }
+
+    if (bdp_bytes > CC_HIGH_BDP_BYTES || classifier->min_rtt_ms > CC_HIGH_RTT_MS) {
+        snprintf(reason, reason_len, "BDP %.0f KB, RTT mínimo %.2f ms", bdp_bytes / 1024.0, classifier->min_rtt_ms);
+        return PATH_HIGH_BDP;
+    }
+
+    if (avg_rtt_ms > 0 && avg_rtt_var_ms > CC_JITTER_MIN_MS && avg_rtt_var_ms / avg_rtt_ms > CC_JITTER_RATIO) {
+        snprintf(reason, reason_len, "rttvar %.2f ms sobre RTT %.2f ms", avg_rtt_var_ms, avg_rtt_ms);
+        return PATH_JITTERY;
+    }
+
+    snprintf(reason, reason_len, "sem perdas, fila ou jitter relevantes");
+    return PATH_NORMAL;
+}
+
+void cc_classifier_sample(PathClassifier *classifier, int sock_fd, const ConnectionMetrics *metrics, const char *leg_name) {
+    if (classifier->decided) return;
+
+    classifier->samples++;
+    classifier->rtt_sum_ms += metrics->rtt_ms;
+    classifier->rtt_var_sum_ms += metrics->rtt_var_ms;
+
+    if (metrics->min_rtt_ms > 0 && (classifier->min_rtt_ms == 0 || metrics->min_rtt_ms < classifier->min_rtt_ms)) {
+        classifier->min_rtt_ms = metrics->min_rtt_ms;
+    }
+    if (classifier->min_rtt_ms > 0 && metrics->rtt_ms > classifier->min_rtt_ms * CC_QUEUE_RATIO &&
+        metrics->rtt_ms - classifier->min_rtt_ms > CC_QUEUE_MIN_MS) {
+        classifier->queued_samples++;
+    }
+    if (!metrics->delivery_app_limited && metrics->delivery_rate_bytes_sec > classifier->max_delivery_bytes_sec) {
+        classifier->max_delivery_bytes_sec = metrics->delivery_rate_bytes_sec;
+    }
+
+    // Contadores acumulados do kernel: basta a última leitura
+    classifier->total_retrans = metrics->total_retrans;
+    classifier->segs_out = metrics->segs_out;
+
+    if (classifier->samples < CC_CLASSIFY_SAMPLES) return;
+
+    classifier->decided = 1;
+
+    char reason[128];
+    classifier->path_class = cc_classify(classifier, reason, sizeof(reason));
+    const char *algorithm = cc_algorithm_for(classifier->path_class);
+
+    if (strcmp(algorithm, classifier->algorithm) == 0) {
+        printf("[CC] %s: caminho %s (%s), mantendo %s\n",
+               leg_name, cc_path_class_name(classifier->path_class), reason, algorithm);
+        return;
+    }
+
+    if (cc_set_algorithm(sock_fd, algorithm) < 0) {
+        printf("[CC] %s: caminho %s (%s), %s indisponível (%s), mantendo %s\n",
+               leg_name, cc_path_class_name(classifier->path_class), reason,
+               algorithm, strerror(errno), classifier->algorithm);
+        return;
+    }
+
+    printf("[CC] %s: caminho %s (%s), %s -> %s\n",
+           leg_name, cc_path_class_name(classifier->path_class), reason, classifier->algorithm, algorithm);
+    snprintf(classifier->algorithm, CC_NAME_MAX, "%s", algorithm);
+}
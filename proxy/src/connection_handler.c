@@ -2,213 +2,929 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <poll.h>
+#include <limits.h>
 #include <sys/stat.h> // Para mkdir
 
 #include "../include/connection_handler.h"
 #include "../include/tcp_monitor.h"
 #include "../include/logs.h"
 #include "../include/tcp_optimizer.h"
+#include "../include/upstream_pool.h"
+#include "../include/backends.h"
+#include "../include/slab_pool.h"
+#include "../include/stats_segment.h"
+#include "../include/latency_profile.h"
+#include "../include/sockmap.h"
+#include "../include/admission.h"
+#include "../include/bandwidth.h"
+#include "../include/tls_session.h"
+#include "../include/latency_stats.h"
+#include "../include/flight_recorder.h"
+
+#define STATS_HEADER_REFRESH_MS 1000   // Intervalo mínimo entre atualizações da memória no cabeçalho do segmento
+
+static unsigned long next_connection_id = 0;
+static unsigned long active_connections = 0;
+static StatsSegment *stats_segment = NULL;
+
+// Soma aos bytes do par o que o kernel redirecionou desde a última leitura dos contadores
+static void connection_fastpath_sync(ConnectionPair *pair) {
+    unsigned long client_to_server, server_to_client;
+
+    if (pair->sockmap_slot < 0 || sockmap_read_bytes(pair->sockmap_slot, &client_to_server, &server_to_client) < 0) return;
+    if (client_to_server == pair->sockmap_client_to_server && server_to_client == pair->sockmap_server_to_client) return;
+
+    pair->bytes_client_to_server += client_to_server - pair->sockmap_client_to_server;
+    pair->bytes_server_to_client += server_to_client - pair->sockmap_server_to_client;
+    pair->sockmap_client_to_server = client_to_server;
+    pair->sockmap_server_to_client = server_to_client;
+    pair->last_activity_time = get_coarse_ms();
+}
+
+static int connection_fin_held(const RelayChannel *channel) {
+    return channel->hold_fin && channel->read_closed && channel->pending == 0 && !channel->write_closed;
+}
+
+// O kernel entrega os segmentos redirecionados por uma fila própria do destino; um shutdown antes
+// disso descartaria o fim dos dados. O FIN só sai quando o destino aceitou tudo que a origem enviou
+static void connection_fastpath_release_fin(ConnectionPair *pair) {
+    if (!connection_fin_held(&pair->to_server) && !connection_fin_held(&pair->to_client)) return;
+
+    connection_fastpath_sync(pair);
+
+    long server_written = sockmap_socket_written(pair->server_socket);
+    long client_written = sockmap_socket_written(pair->client_socket);
+    unsigned long now = get_monotonic_ms();
+
+    // Desiste de esperar só se o destino parou de aceitar dados (o FIN sai e o resto se perde).
+    // Com o destino parado as verificações vão se espaçando; com progresso voltam ao intervalo mínimo
+    if (pair->sockmap_fin_checked == 0 || server_written + client_written != pair->sockmap_fin_written) {
+        pair->sockmap_fin_progress = now;
+        pair->sockmap_fin_written = server_written + client_written;
+        pair->sockmap_fin_interval_ms = SOCKMAP_FIN_CHECK_MS;
+    } else if (pair->sockmap_fin_interval_ms < SOCKMAP_FIN_CHECK_MAX_MS) {
+        pair->sockmap_fin_interval_ms *= 2;
+    }
+
+    pair->sockmap_fin_checked = now;
+    int expired = now - pair->sockmap_fin_progress >= SOCKMAP_FIN_WAIT_MAX_MS;
+
+    if (connection_fin_held(&pair->to_server) && (expired || server_written >= (long)pair->bytes_client_to_server)) {
+        pair->to_server.hold_fin = 0;
+        relay_pump(&pair->to_server, pair->client_socket, pair->server_socket, &pair->bytes_client_to_server);
+    }
+
+    if (connection_fin_held(&pair->to_client) && (expired || client_written >= (long)pair->bytes_server_to_client)) {
+        pair->to_client.hold_fin = 0;
+        relay_pump(&pair->to_client, pair->server_socket, pair->client_socket, &pair->bytes_server_to_client);
+    }
+}
+
+// Passa o par para o sockmap. Só com os canais vazios: o que o relay ainda retém sairia depois
+// do que o kernel redireciona; e uma direção que já recebeu FIN não tem mais o que acelerar
+static void connection_fastpath_enter(ConnectionPair *pair) {
+    if (pair->to_server.pending || pair->to_client.pending || pair->to_server.read_closed || pair->to_client.read_closed) return;
+
+    int slot = sockmap_attach(pair->client_socket, pair->server_socket);
+
+    if (slot == SOCKMAP_BUSY) return; // Dados chegaram na fila: o relay entrega e a próxima rodada tenta de novo
+
+    pair->sockmap_wanted = 0;
+    if (slot < 0) return;
+
+    pair->sockmap_slot = slot;
+    pair->to_server.hold_fin = 1;
+    pair->to_client.hold_fin = 1;
+}
+
+// Parcela do cliente mudou: o teto de pacing de cada destino limitado vai para a parcela inteira do cliente
+// (x1,25), sem dividir pelas conexões dele: uma conexão ativa entre várias ociosas ficaria presa a uma fração.
+// O total do cliente continua limitado pelo balde de tokens nas leituras do relay; o socket fica com o
+// menor entre esse teto e o pacing da política do otimizador
+static void connection_bandwidth_pace(ConnectionPair *pair) {
+    unsigned long rate;
+
+    if (!bandwidth_pacing_rate(pair->bandwidth, &pair->bandwidth_generation, &rate)) return;
+
+    flight_recorder_enter(pair->connection_id, pair->client_socket, pair->server_socket);
+    if (pair->to_client.bandwidth) optimizer_leg_set_share(&pair->optimizer_client, pair->client_socket, rate);
+    if (pair->to_server.bandwidth) optimizer_leg_set_share(&pair->optimizer_server, pair->server_socket, rate);
+    flight_recorder_leave();
+}
+
+int connection_relay(ConnectionPair *pair) {
+    unsigned long bytes_before = pair->bytes_client_to_server + pair->bytes_server_to_client;
+
+    // Cliente -> Servidor
+    if (relay_pump(&pair->to_server, pair->client_socket, pair->server_socket, &pair->bytes_client_to_server) < 0) {
+        connection_pair_set_close_reason(pair, FLIGHT_CLOSE_ERROR, errno);
+        return -1;
+    }
+
+    // O pedido é marcado antes da outra direção: a resposta pode chegar e sair ainda nesta rodada
+    if (pair->latency_timed && !pair->request_ns) connection_ttfb_update(pair, 0);
+
+    // Servidor -> Cliente
+    if (relay_pump(&pair->to_client, pair->server_socket, pair->client_socket, &pair->bytes_server_to_client) < 0) {
+        connection_pair_set_close_reason(pair, FLIGHT_CLOSE_ERROR, errno);
+        return -1;
+    }
+
+    if (pair->bytes_client_to_server + pair->bytes_server_to_client != bytes_before) {
+        pair->last_activity_time = get_coarse_ms();
+    }
+
+    if (pair->sockmap_slot >= 0) connection_fastpath_release_fin(pair);
+    else if (pair->sockmap_wanted) connection_fastpath_enter(pair);
+
+    if (pair->bandwidth) connection_bandwidth_pace(pair);
+
+    if (pair->latency_timed && !pair->ttfb_ns) connection_ttfb_update(pair, pair->bytes_server_to_client - pair->to_client.pending);
+
+    // O par só termina quando os dois lados enviaram FIN e tudo foi entregue
+    if (!relay_is_done(&pair->to_server) || !relay_is_done(&pair->to_client)) return 0;
+
+    connection_pair_set_close_reason(pair, FLIGHT_CLOSE_DONE, 0);
+    return 1;
+}
+
+int connection_pending_wait_ms(ConnectionPair *pair) {
+    int to_server = relay_wait_ms(&pair->to_server);
+    int to_client = relay_wait_ms(&pair->to_client);
+    return to_server < 0 ? to_client : (to_client < 0 || to_server < to_client ? to_server : to_client);
+}
+
+int connection_fin_wait_ms(const ConnectionPair *pair) {
+    if (!connection_fin_held(&pair->to_server) && !connection_fin_held(&pair->to_client)) return -1;
+
+    unsigned long elapsed = get_monotonic_ms() - pair->sockmap_fin_checked;
+    return elapsed >= (unsigned long)pair->sockmap_fin_interval_ms ? 0 : pair->sockmap_fin_interval_ms - (int)elapsed;
+}
+
+int connection_idle_remaining_ms(const ConnectionPair *pair, const ProxyConfig *config) {
+    if (config->idle_timeout_ms <= 0) return -1;
+
+    unsigned long idle = get_coarse_ms() - pair->last_activity_time;
+    return idle >= (unsigned long)config->idle_timeout_ms ? 0 : config->idle_timeout_ms - (int)idle;
+}
+
+unsigned long connection_active_count(void) {
+    return __atomic_load_n(&active_connections, __ATOMIC_RELAXED);
+}
+
+// TCP keepalive: o kernel detecta o par que sumiu sem FIN/RST (cabo, NAT, máquina desligada)
+static void connection_set_keepalive(int fd, int idle_s) {
+    if (idle_s <= 0) return;
+
+    int enable = 1;
+    int interval = idle_s / CONNECTION_KEEPALIVE_PROBES > 0 ? idle_s / CONNECTION_KEEPALIVE_PROBES : 1;
+    int probes = CONNECTION_KEEPALIVE_PROBES;
+
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle_s, sizeof(idle_s));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+}
+
+int connection_stats_start(ProxyConfig *config, char *path_out, size_t path_len) {
+    const char *engine = config->engine == ENGINE_URING ? "io_uring" : config->engine == ENGINE_EPOLL ? "epoll" : "threads";
+
+    stats_segment = stats_segment_create(config->listen_port, engine, path_out, path_len);
+    return stats_segment ? 0 : -1;
+}
+
+static void connection_stats_fill_leg(StatsLeg *leg, const ConnectionMetrics *metrics) {
+    leg->rtt_ms = (float)metrics->rtt_ms;
+    leg->rtt_var_ms = (float)metrics->rtt_var_ms;
+    leg->min_rtt_ms = (float)metrics->min_rtt_ms;
+    leg->throughput_kbps = (float)metrics->throughput_kbps;
+    leg->goodput_kbps = (float)metrics->goodput_kbps;
+    leg->retrans_kbps = (float)metrics->retrans_kbps;
+    leg->cwnd_segments = (uint32_t)metrics->cwnd_segments;
+    leg->total_retrans = metrics->total_retrans;
+    leg->limited_by = (uint8_t)metrics->limited_by;
+}
+
+// Publica contadores e métricas da conexão na vaga dela (seqlock: o proxy_top nunca bloqueia a thread)
+static void connection_stats_publish(ConnectionPair *pair) {
+    if (!stats_segment) return;
+
+    StatsHeader *header = &stats_segment->header;
+    __atomic_add_fetch(&header->bytes_client_to_server, pair->bytes_client_to_server - pair->stats_client_to_server, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&header->bytes_server_to_client, pair->bytes_server_to_client - pair->stats_server_to_client, __ATOMIC_RELAXED);
+    pair->stats_client_to_server = pair->bytes_client_to_server;
+    pair->stats_server_to_client = pair->bytes_server_to_client;
+
+    if (pair->stats_slot < 0) return;
+
+    StatsSlot *slot = &stats_segment->slots[pair->stats_slot];
+
+    stats_slot_write_begin(slot);
+    slot->updated_ms = get_timestamp_ms();
+    slot->bytes_client_to_server = pair->bytes_client_to_server;
+    slot->bytes_server_to_client = pair->bytes_server_to_client;
+    connection_stats_fill_leg(&slot->client_proxy, &pair->metrics_client_proxy);
+    connection_stats_fill_leg(&slot->proxy_server, &pair->metrics_proxy_server);
+    stats_slot_write_end(slot);
+}
+
+// Memória e descartes no cabeçalho: uma thread por intervalo, não uma leitura de /proc por conexão
+void connection_stats_publish_header(void) {
+    if (!stats_segment) return;
+
+    StatsHeader *header = &stats_segment->header;
+    uint64_t now = get_timestamp_ms();
+    uint64_t last = __atomic_load_n(&header->updated_ms, __ATOMIC_RELAXED);
+
+    if (now - last < STATS_HEADER_REFRESH_MS) return;
+    if (!__atomic_compare_exchange_n(&header->updated_ms, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return;
+
+    SlabStats slab_stats;
+    slab_get_stats(&slab_stats);
+
+    __atomic_store_n(&header->pool_in_use_bytes, slab_stats.in_use_bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->rss_bytes, slab_process_rss(), __ATOMIC_RELAXED);
+    __atomic_store_n(&header->log_dropped, logs_dropped_count(), __ATOMIC_RELAXED);
+
+    AdmissionStats admission_stats;
+    admission_get_stats(&admission_stats);
+
+    __atomic_store_n(&header->admission_rejected, admission_stats.rejected_limit + admission_stats.rejected_rate +
+                     admission_stats.rejected_queue + admission_stats.rejected_timeout, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->admission_queued, admission_stats.queued, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->admission_connecting, admission_stats.connecting, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->admission_pauses, admission_stats.pauses, __ATOMIC_RELAXED);
+}
+
+static void connection_stats_open(ConnectionPair *pair) {
+    pair->stats_slot = -1;
+    if (!stats_segment) return;
+
+    __atomic_add_fetch(&stats_segment->header.connections_opened, 1, __ATOMIC_RELAXED);
+
+    pair->stats_slot = stats_segment_acquire_slot(stats_segment);
+    if (pair->stats_slot < 0) return;
+
+    StatsSlot *slot = &stats_segment->slots[pair->stats_slot];
+
+    stats_slot_write_begin(slot);
+    slot->connection_id = pair->connection_id;
+    slot->opened_ms = get_timestamp_ms();
+    slot->updated_ms = slot->opened_ms;
+    slot->bytes_client_to_server = 0;
+    slot->bytes_server_to_client = 0;
+    snprintf(slot->client, sizeof(slot->client), "%s:%d", pair->client_ip_str, ntohs(pair->client_address.sin_port));
+    snprintf(slot->backend, sizeof(slot->backend), "%.*s", STATS_ADDRESS_LEN - 1, pair->backend->address_str);
+    memset(&slot->client_proxy, 0, sizeof(StatsLeg));
+    memset(&slot->proxy_server, 0, sizeof(StatsLeg));
+    stats_slot_write_end(slot);
+}
+
+static void connection_stats_close(ConnectionPair *pair) {
+    if (!stats_segment) return;
+
+    connection_stats_publish(pair);
+    stats_segment_release_slot(stats_segment, pair->stats_slot);
+    pair->stats_slot = -1;
+    __atomic_add_fetch(&stats_segment->header.connections_closed, 1, __ATOMIC_RELAXED);
+}
+
+unsigned long connection_accepted(int client_socket, uint64_t accepted_ns) {
+    unsigned long connection_id = __atomic_add_fetch(&next_connection_id, 1, __ATOMIC_RELAXED);
+
+    // O accept entra com o instante medido antes da conexão ter id
+    if (flight_recorder_enabled()) {
+        flight_record_at(accepted_ns, connection_id, FLIGHT_EVENT_ACCEPT, FLIGHT_SIDE_CLIENT, 0, client_socket);
+    }
+    return connection_id;
+}
+
+int connection_connect_upstream(ProxyConfig *config, int nonblocking, unsigned long connection_id, Backend **backend_out) {
+    // Escolhe o backend pela política de balanceamento (a conexão fica contada nele até o fechamento)
+    Backend *backend = backends_acquire();
+    *backend_out = backend;
+
+    // Socket já conectado do pool evita um RTT até o servidor no início da conexão
+    int pooled_socket = upstream_pool_acquire(backend);
+
+    if (pooled_socket >= 0) {
+        if (nonblocking) {
+            fcntl(pooled_socket, F_SETFL, fcntl(pooled_socket, F_GETFL, 0) | O_NONBLOCK);
+        }
+        flight_record(connection_id, FLIGHT_EVENT_CONNECT_START, FLIGHT_SIDE_SERVER, 0, pooled_socket);
+        return pooled_socket;
+    }
+
+    // Conectar ao servidor real usando novo socket depois de conectar com o cliente
+    int server_socket = socket(backend->address.ss_family, SOCK_STREAM, 0);
+
+    if (server_socket < 0) {
+        int error = errno;
+        perror("Erro ao criar socket para o servidor");
+        backends_release(backend);
+        errno = error;
+        return -1;
+    }
+
+    latency_apply_upstream(server_socket, config);
+
+    // No modo não-bloqueante o connect retorna EINPROGRESS e é concluído pelo loop de eventos
+    if (nonblocking) {
+        fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    // Se conecta ao servidor usando seu socket (no modo bloqueante, uma parada no connect fica entre os dois eventos)
+    flight_record(connection_id, FLIGHT_EVENT_CONNECT_START, FLIGHT_SIDE_SERVER, 0, server_socket);
+
+    if (connect(server_socket, (struct sockaddr*)&backend->address, backend->address_len) < 0) {
+        if (!(nonblocking && errno == EINPROGRESS)) {
+            int error = errno;
+            fprintf(stderr, "Erro ao conectar ao servidor real %s: %s\n", backend->address_str, strerror(error));
+            backends_report_failure(backend);
+            backends_release(backend);
+            close(server_socket);
+            errno = error;
+            return -1;
+        }
+    }
+
+    return server_socket;
+}
+
+// Primeira coleta: a conexão começa em slow start
+static unsigned long connection_sample_first_ms(const ProxyConfig *config) {
+    unsigned long base = (unsigned long)config->sample_interval_ms;
+    unsigned long fast = base / SAMPLE_SLOW_START_DIVISOR;
+
+    if (!config->sample_adaptive) return base;
+    if (fast < SAMPLE_MIN_INTERVAL_MS) fast = base < SAMPLE_MIN_INTERVAL_MS ? base : SAMPLE_MIN_INTERVAL_MS;
+    return fast;
+}
+
+// Intervalo até a próxima coleta pelo que a última mostrou: sem bytes nos dois trechos a conexão
+// é amostrada cada vez menos; com a janela de um trecho ainda crescendo, mais vezes
+static unsigned long connection_sample_next_ms(const ConnectionPair *pair, const ProxyConfig *config) {
+    unsigned long base = (unsigned long)config->sample_interval_ms;
+
+    if (!config->sample_adaptive) return base;
+
+    const ConnectionMetrics *client = &pair->metrics_client_proxy;
+    const ConnectionMetrics *server = &pair->metrics_proxy_server;
+
+    if (client->throughput_kbps == 0 && server->throughput_kbps == 0) {
+        unsigned long idle = pair->sample_interval_ms < base ? base : pair->sample_interval_ms * 2;
+        return idle < base * SAMPLE_IDLE_MAX_FACTOR ? idle : base * SAMPLE_IDLE_MAX_FACTOR;
+    }
+
+    if (client->slow_start || server->slow_start) return connection_sample_first_ms(config);
+    return base;
+}
+
+void connection_pair_init(ConnectionPair *pair, ProxyConfig *config, unsigned long connection_id, int client_socket, int server_socket, const struct sockaddr_in *client_address, Backend *backend, uint64_t accepted_ns) {
+    memset(pair, 0, sizeof(ConnectionPair));
+    pair->backend = backend;
+
+    pair->client_socket = client_socket;
+    pair->server_socket = server_socket;
+    pair->sockmap_wanted = config->fastpath;
+    pair->sockmap_slot = -1;
+    pair->client_address = *client_address;
+    inet_ntop(AF_INET, &(client_address->sin_addr), pair->client_ip_str, INET_ADDRSTRLEN);
+
+    // Canais de encaminhamento (cada direção cai para cópia sozinha se o splice falhar)
+    relay_channel_init(&pair->to_server, config->relay_mode);
+    relay_channel_init(&pair->to_client, config->relay_mode);
+
+    // Inicializa as estruturas de métricas
+    monitor_init_metrics(&pair->metrics_client_proxy);
+    monitor_init_metrics(&pair->metrics_proxy_server);
+    pair->last_monitor_time = get_monotonic_ms();
+    pair->last_activity_time = get_coarse_ms();
+    pair->sample_interval_ms = connection_sample_first_ms(config);
+
+    connection_set_keepalive(client_socket, config->keepalive_s);
+    connection_set_keepalive(server_socket, config->keepalive_s);
+
+    // Perfil de latência: sem Nagle nos dois trechos e ACK imediato do que o proxy lê
+    latency_apply_socket(client_socket, config);
+    latency_apply_socket(server_socket, config);
+    pair->to_server.quickack = config->latency_profile;
+    pair->to_client.quickack = config->latency_profile;
+
+    // Controle de congestionamento por socket (fixo já aplica aqui; auto decide após as primeiras amostras)
+    cc_classifier_init(&pair->path_client, client_socket, config->cc_mode, config->cc_algorithm, "Cliente -> Proxy");
+    cc_classifier_init(&pair->path_server, server_socket, config->cc_mode, config->cc_algorithm, "Proxy -> Servidor");
+
+    // Identifica as amostras desta conexão no log único (ACCEPT e CONNECT_START já gravados com esse id)
+    pair->connection_id = connection_id;
+    __atomic_add_fetch(&active_connections, 1, __ATOMIC_RELAXED);
+    connection_stats_open(pair);
+
+    if (flight_recorder_enabled()) {
+        relay_channel_set_trace(&pair->to_server, pair->connection_id, 1);
+        relay_channel_set_trace(&pair->to_client, pair->connection_id, 0);
+    }
+
+    // Política de otimização nos dois trechos: a do braço sorteado (--ab) ou a de --optimize
+    const OptimizerPolicy *policy = config->enable_optimization ? optimizer_policy_get(config->optimizer_policy) : NULL;
+    pair->experiment.arm = experiment_assign(pair->connection_id);
+    pair->experiment.started_ms = pair->last_monitor_time;
+    pair->experiment.last_sample_ms = pair->last_monitor_time;
+    if (pair->experiment.arm >= 0) policy = experiment_arm_policy(pair->experiment.arm);
 
-// Intervalo de monitoramento (logs em texto)
-#define MONITOR_INTERVAL_MS 3000
+    flight_recorder_enter(pair->connection_id, client_socket, server_socket);
+    optimizer_leg_init(&pair->optimizer_client, policy, 0, client_socket);
+    optimizer_leg_init(&pair->optimizer_server, policy, 1, server_socket);
+    flight_recorder_leave();
 
-// Função auxiliar para encaminhar dados de um socket para outro (cliente <-> servidor)
-// Retorna o número de bytes lidos, 0 caso desconexão, -1 caso erro
-ssize_t forward_data(int src_fd, int dest_fd, char* buffer, size_t buffer_size) {
-    ssize_t bytes_read = recv(src_fd, buffer, buffer_size, 0); // Recupera dados do buffer
+    // Emulação de WAN: semente própria por conexão e direção, a mesma a cada execução com a mesma --impair-seed
+    if (config->impairment.enabled) {
+        uint64_t seed = (uint64_t)config->impairment.seed * 0x9E3779B97F4A7C15ULL + pair->connection_id * 2;
 
-    if (bytes_read > 0) {
-        // Encaminha os dados lidos
-        send(dest_fd, buffer, bytes_read, 0);
+        if (impairment_params_active(&config->impairment.up)) {
+            relay_channel_set_impairment(&pair->to_server, &config->impairment.up, seed);
+        }
+        if (impairment_params_active(&config->impairment.down)) {
+            relay_channel_set_impairment(&pair->to_client, &config->impairment.down, seed + 1);
+        }
+    }
+
+    // Escalonador de banda: as conexões do mesmo IP dividem um balde
+    if (bandwidth_enabled()) {
+        pair->bandwidth = bandwidth_acquire(client_address);
+        if (config->bandwidth.direction != BANDWIDTH_UP) pair->to_client.bandwidth = pair->bandwidth;
+        if (config->bandwidth.direction != BANDWIDTH_DOWN) pair->to_server.bandwidth = pair->bandwidth;
+    }
+
+    // Latências: a direção com emulação de WAN não entra (o atraso ali é o emulado, não o do proxy)
+    pair->accepted_ns = accepted_ns;
+    pair->latency_timed = latency_stats_enabled();
+
+    if (pair->latency_timed) {
+        if (!pair->to_server.impairment) pair->to_server.delay = &pair->delay_to_server;
+        if (!pair->to_client.impairment) pair->to_client.delay = &pair->delay_to_client;
+    }
+}
+
+// Fim do connect com o backend (error = errno, 0 = conectado), com o tempo desde o accept
+static void connection_record_connect_done(unsigned long connection_id, uint64_t accepted_ns, int error) {
+    if (!flight_recorder_enabled()) return;
+
+    uint64_t now = latency_now_ns();
+    flight_record_at(now, connection_id, FLIGHT_EVENT_CONNECT_DONE, FLIGHT_SIDE_SERVER, error, (int64_t)(now - accepted_ns));
+}
+
+void connection_pair_connected(ConnectionPair *pair) {
+    connection_record_connect_done(pair->connection_id, pair->accepted_ns, 0);
+
+    if (!pair->latency_timed || pair->connect_ns) return;
+
+    uint64_t elapsed = latency_now_ns() - pair->accepted_ns;
+    pair->connect_ns = elapsed > 0 ? elapsed : 1;
+    latency_record(LATENCY_CONNECT, pair->connect_ns);
+}
+
+void connection_pair_connect_failed(ConnectionPair *pair, int error) {
+    connection_record_connect_done(pair->connection_id, pair->accepted_ns, error);
+    connection_pair_set_close_reason(pair, FLIGHT_CLOSE_CONNECT_FAILED, error);
+}
+
+void connection_connect_aborted(unsigned long connection_id, uint64_t accepted_ns, int error) {
+    connection_record_connect_done(connection_id, accepted_ns, error);
+    connection_aborted(connection_id, FLIGHT_CLOSE_CONNECT_FAILED, error);
+}
+
+void connection_aborted(unsigned long connection_id, int reason, int error) {
+    flight_record(connection_id, FLIGHT_EVENT_CLOSE, FLIGHT_SIDE_NONE, error, reason);
+}
+
+void connection_pair_set_close_reason(ConnectionPair *pair, int reason, int error) {
+    if (pair->close_reason != FLIGHT_CLOSE_UNKNOWN) return;
+
+    pair->close_reason = reason;
+    pair->close_errno = error;
+}
+
+void connection_ttfb_update(ConnectionPair *pair, unsigned long delivered_to_client) {
+    if (!pair->latency_timed || pair->ttfb_ns) return;
+    if (delivered_to_client == 0 && (pair->request_ns || pair->bytes_client_to_server == 0)) return;
+
+    uint64_t now = latency_now_ns();
+
+    if (!pair->request_ns && pair->bytes_client_to_server > 0) pair->request_ns = now;
+    if (delivered_to_client == 0) return;
+
+    // Servidor que fala primeiro (banner): conta desde o accept
+    uint64_t start = pair->request_ns ? pair->request_ns : pair->accepted_ns;
+    pair->ttfb_ns = now > start ? now - start : 1;
+    latency_record(LATENCY_TTFB, pair->ttfb_ns);
+}
+
+// Resumo das latências da conexão, junto da linha de encerramento
+static void connection_print_latency(const ConnectionPair *pair) {
+    const LatencySummary *directions[2] = { &pair->delay_to_server, &pair->delay_to_client };
+    const RelayChannel *channels[2] = { &pair->to_server, &pair->to_client };
+    char ttfb[32];
+    char relay[2][96];
+
+    if (pair->ttfb_ns) snprintf(ttfb, sizeof(ttfb), "%.3f ms", pair->ttfb_ns / 1e6);
+    else snprintf(ttfb, sizeof(ttfb), "-");
+
+    for (int i = 0; i < 2; i++) {
+        const LatencySummary *summary = directions[i];
+
+        if (!channels[i]->delay && channels[i]->impairment) snprintf(relay[i], sizeof(relay[i]), "não medida (emulação de WAN)");
+        else if (summary->count == 0) snprintf(relay[i], sizeof(relay[i]), "sem blocos");
+        else snprintf(relay[i], sizeof(relay[i]), "%lu blocos, média %.1f µs, máx %.1f µs",
+                      summary->count, summary->total_ns / 1000.0 / summary->count, summary->max_ns / 1000.0);
+    }
+
+    printf("[Latência] Conexão %lu: connect %.3f ms | TTFB %s | Cliente -> Servidor: %s | Servidor -> Cliente: %s\n",
+           pair->connection_id, pair->connect_ns / 1e6, ttfb, relay[0], relay[1]);
+}
+
+void connection_pair_set_tls(ConnectionPair *pair, TlsSession *client_session, TlsSession *server_session) {
+    pair->tls_client = client_session;
+    pair->tls_server = server_session;
+
+    // Cliente -> Servidor decifra do cliente e cifra para o backend; Servidor -> Cliente, o inverso
+    relay_channel_set_tls(&pair->to_server, client_session, server_session);
+    relay_channel_set_tls(&pair->to_client, server_session, client_session);
+}
+
+// Trecho que enviou limitado pelo receptor, pelo buffer ou pela rede (não esperando dados do outro lado)
+static int connection_leg_busy(const ConnectionMetrics *metrics) {
+    return metrics->limited_by == LIMITED_RWND || metrics->limited_by == LIMITED_SNDBUF || metrics->limited_by == LIMITED_NETWORK;
+}
+
+// Resultado da conexão para o braço do experimento, com um último TCP_INFO dos dois trechos
+static void connection_experiment_record(ConnectionPair *pair) {
+    ExperimentOutcome outcome;
+    ConnectionMetrics client = pair->metrics_client_proxy;
+    ConnectionMetrics server = pair->metrics_proxy_server;
+
+    monitor_get_tcp_info(pair->client_socket, &client);
+    monitor_get_tcp_info(pair->server_socket, &server);
+
+    // Bytes por tempo ocupado, não média por amostra: as coletas curtas do slow start pesariam como as longas.
+    // Conexão curta ou sempre esperando a aplicação: bytes encaminhados pela duração inteira
+    if (pair->experiment.busy_ms > 0) {
+        outcome.throughput_kbps = pair->experiment.busy_acked_bytes * 8.0 / pair->experiment.busy_ms;
+    } else {
+        unsigned long elapsed = get_monotonic_ms() - pair->experiment.started_ms;
+        outcome.throughput_kbps = (pair->bytes_client_to_server + pair->bytes_server_to_client) * 8.0 / (elapsed ? elapsed : 1);
+    }
+
+    unsigned long segments = (unsigned long)client.segs_out + server.segs_out;
+    outcome.rtt_client_ms = client.rtt_ms;
+    outcome.rtt_server_ms = server.rtt_ms;
+    outcome.retrans_pct = segments ? 100.0 * ((unsigned long)client.total_retrans + server.total_retrans) / segments : 0.0;
+
+    experiment_record(pair->experiment.arm, &outcome);
+}
+
+void connection_monitor_tick(ConnectionPair *pair, ProxyConfig *config) {
+    // 1. COLETA DE MÉTRICAS
+
+    // Bytes que o fast path encaminhou no kernel entram no throughput como os do relay
+    connection_fastpath_sync(pair);
+
+    // Coleta métricas Cliente -> Proxy: o proxy envia neste socket o que veio do servidor
+    monitor_get_tcp_info(pair->client_socket, &pair->metrics_client_proxy);
+    monitor_calculate_throughput(&pair->metrics_client_proxy, pair->bytes_server_to_client, pair->bytes_client_to_server);
+
+    // Coleta métricas Proxy -> Servidor: o proxy envia neste socket o que veio do cliente
+    monitor_get_tcp_info(pair->server_socket, &pair->metrics_proxy_server);
+    monitor_calculate_throughput(&pair->metrics_proxy_server, pair->bytes_client_to_server, pair->bytes_server_to_client);
+
+    // O RTT e a taxa entregue medidos pelo kernel alimentam a escolha do backend na política lowest-rtt;
+    // amostras limitadas pela aplicação não dizem quanto o caminho entrega
+    backends_report_sample(pair->backend, pair->metrics_proxy_server.rtt_ms,
+                           connection_leg_busy(&pair->metrics_proxy_server) ? pair->metrics_proxy_server.delivery_rate_bytes_sec * 8.0 / 1000.0 : 0);
+
+    // 2. EXIBIÇÃO E LOG
+
+    // Segmento compartilhado (proxy_top) sempre; console só com --console
+    connection_stats_publish(pair);
+    connection_stats_publish_header();
+
+    if (config->console_metrics) display_metrics_text(&pair->metrics_client_proxy, &pair->metrics_proxy_server);
+
+    // O registro vai para o anel da thread; a escrita em disco fica com a thread de logs
+    MetricsRecord record;
+    record.connection_id = pair->connection_id;
+    record.arm = experiment_arm_code(pair->experiment.arm);
+    memcpy(record.client_ip, pair->client_ip_str, sizeof(record.client_ip));
+    record.client_proxy = pair->metrics_client_proxy;
+    record.proxy_server = pair->metrics_proxy_server;
+    logs_submit(&record);
+
+    // 3. APLICAÇÃO DE POLÍTICAS DE OTIMIZAÇÃO CONDICIONAL
+    // Ativada de acordo com flag (sem --optimize os trechos não têm política); os ajustes vão para o gravador de voo
+    flight_recorder_enter(pair->connection_id, pair->client_socket, pair->server_socket);
+    optimizer_leg_sample(&pair->optimizer_client, pair->client_socket, &pair->metrics_client_proxy);
+    optimizer_leg_sample(&pair->optimizer_server, pair->server_socket, &pair->metrics_proxy_server);
+
+    // Classificação do caminho de cada trecho e troca do TCP_CONGESTION (--cc auto)
+    cc_classifier_sample(&pair->path_client, pair->client_socket, &pair->metrics_client_proxy, "Cliente -> Proxy");
+    cc_classifier_sample(&pair->path_server, pair->server_socket, &pair->metrics_proxy_server, "Proxy -> Servidor");
+    flight_recorder_leave();
+
+    // Destino que não aceita nada há muito tempo: o despejo sai durante a parada, não só quando ela acaba
+    relay_check_stall(&pair->to_server);
+    relay_check_stall(&pair->to_client);
+
+    // Experimento A/B: o throughput do braço só conta os intervalos em que a conexão tinha o que enviar
+    if (pair->experiment.arm >= 0) {
+        ExperimentTrack *track = &pair->experiment;
+        unsigned long acked = pair->metrics_client_proxy.bytes_acked + pair->metrics_proxy_server.bytes_acked;
+        unsigned long now = get_monotonic_ms();
+
+        if (connection_leg_busy(&pair->metrics_client_proxy) || connection_leg_busy(&pair->metrics_proxy_server)) {
+            track->busy_acked_bytes += acked - track->last_acked;
+            track->busy_ms += now - track->last_sample_ms;
+        }
+
+        track->last_acked = acked;
+        track->last_sample_ms = now;
+    }
+
+    // 4. PRÓXIMA COLETA (a engine agenda com o intervalo escolhido aqui)
+    pair->sample_interval_ms = connection_sample_next_ms(pair, config);
+
+    if (!config->console_metrics) return;
+
+    if (upstream_pool_enabled()) {
+        UpstreamPoolStats pool_stats;
+        upstream_pool_get_stats(&pool_stats);
+
+        printf("[Pool] Ociosos: %d | Hits: %lu | Misses: %lu | Criados: %lu | Descartados: %lu\n",
+               pool_stats.idle, pool_stats.hits, pool_stats.misses, pool_stats.created, pool_stats.discarded);
+    }
+
+    if (config->backend_spec_count > 0) backends_print_status();
+    if (pair->bandwidth) bandwidth_print_status();
+
+    if (pair->to_client.impairment || pair->to_server.impairment) {
+        printf("[WAN] Perdas emuladas: Servidor -> Cliente %lu | Cliente -> Servidor %lu | Retidos: %zu / %zu bytes\n",
+               pair->to_client.impairment ? pair->to_client.impairment->losses : 0,
+               pair->to_server.impairment ? pair->to_server.impairment->losses : 0,
+               pair->to_client.pending, pair->to_server.pending);
+    }
+
+    // Memória por conexão: buffers e estados nos pools, e o processo inteiro (RSS)
+    unsigned long connections = connection_active_count();
+    SlabStats slab_stats;
+    slab_get_stats(&slab_stats);
+    size_t rss = slab_process_rss();
+
+    printf("[Memória] Conexões: %lu | Pools: %.1f MB em uso / %.1f MB reservados | RSS: %.1f MB | Por conexão: %lu B (pools) / %lu B (RSS)\n",
+           connections, slab_stats.in_use_bytes / 1048576.0, (slab_stats.reserved_bytes - slab_stats.released_bytes) / 1048576.0,
+           rss / 1048576.0, connections ? (unsigned long)(slab_stats.in_use_bytes / connections) : 0,
+           connections ? (unsigned long)(rss / connections) : 0);
+
+    if (config->fastpath) {
+        SockmapStats sockmap_stats;
+        sockmap_get_stats(&sockmap_stats);
+
+        printf("[Fastpath] Pares no kernel: %lu | Entraram: %lu | Recusados: %lu | Esta conexão: %s\n",
+               sockmap_stats.active, sockmap_stats.attached, sockmap_stats.refused, pair->sockmap_slot >= 0 ? "kernel" : "relay");
+    }
+
+    if (admission_enabled()) {
+        AdmissionStats admission_stats;
+        admission_get_stats(&admission_stats);
+
+        printf("[Admissão] Ativas: %lu | Conectando: %lu | Na fila: %lu (pico %lu) | Recusadas: %lu limite, %lu taxa, %lu fila cheia, %lu tempo na fila | Pausas: %lu\n",
+               admission_stats.active, admission_stats.connecting, admission_stats.queued, admission_stats.queue_peak,
+               admission_stats.rejected_limit, admission_stats.rejected_rate, admission_stats.rejected_queue,
+               admission_stats.rejected_timeout, admission_stats.pauses);
+    }
+
+    if (pair->tls_client || pair->tls_server) {
+        TlsStats tls_stats;
+        tls_get_stats(&tls_stats);
+
+        printf("[TLS] Handshakes: %lu | Falhas: %lu | Sessões com kTLS: %lu tx, %lu rx\n",
+               tls_stats.handshakes, tls_stats.failures, tls_stats.ktls_send, tls_stats.ktls_recv);
+    }
+
+    unsigned long dropped = logs_dropped_count();
+    if (dropped > 0) printf("[Logs] Registros descartados (anel cheio): %lu\n", dropped);
+}
+
+void connection_pair_close(ConnectionPair *pair) {
+    printf("[-] Conexão (Cliente %d <-> Servidor %d) encerrada.\n", pair->client_socket, pair->server_socket);
+    if (pair->latency_timed && pair->connect_ns) connection_print_latency(pair);
+
+    flight_recorder_enter(pair->connection_id, pair->client_socket, pair->server_socket);
+    optimizer_leg_close(&pair->optimizer_client, pair->client_socket);
+    optimizer_leg_close(&pair->optimizer_server, pair->server_socket);
+    flight_recorder_leave();
+
+    if (pair->sockmap_slot >= 0) {
+        connection_fastpath_sync(pair);
+        sockmap_detach(pair->sockmap_slot);
+        pair->sockmap_slot = -1;
     }
 
-    return bytes_read;
+    // Depois da última sincronização do fast path: os bytes do par estão completos
+    if (pair->experiment.arm >= 0) connection_experiment_record(pair);
+
+    flight_record(pair->connection_id, FLIGHT_EVENT_CLOSE, FLIGHT_SIDE_NONE, pair->close_errno, pair->close_reason);
+
+    // As sessões só depois dos canais pararem de usá-las, e antes dos sockets que elas referenciam
+    tls_session_free(pair->tls_client);
+    tls_session_free(pair->tls_server);
+    pair->tls_client = NULL;
+    pair->tls_server = NULL;
+
+    close(pair->client_socket);
+    close(pair->server_socket);
+    backends_release(pair->backend);
+    admission_release();
+    bandwidth_release(pair->bandwidth);
+    pair->backend = NULL;
+    pair->bandwidth = NULL;
+
+    relay_channel_close(&pair->to_server);
+    relay_channel_close(&pair->to_client);
+
+    connection_stats_close(pair);
+    __atomic_sub_fetch(&active_connections, 1, __ATOMIC_RELAXED);
+}
+
+// Espera do poll da engine threads: uma thread por conexão, os dois prazos dela dispensam a roda de timers
+static int connection_thread_wait_ms(const ConnectionPair *pair, const ProxyConfig *config) {
+    unsigned long elapsed = get_monotonic_ms() - pair->last_monitor_time;
+    unsigned long wait = elapsed < pair->sample_interval_ms ? pair->sample_interval_ms - elapsed : 0;
+    int idle_wait = connection_idle_remaining_ms(pair, config);
+
+    if (idle_wait >= 0 && (unsigned long)idle_wait < wait) wait = (unsigned long)idle_wait;
+    return wait > INT_MAX ? INT_MAX : (int)wait;
 }
 
 // Essa é a função que será executada pela thread
 void* handle_connection(void* args) {
     ConnectionThreadArgs *thread_args = (ConnectionThreadArgs*)args;
-    
+
     int client_socket = thread_args->client_socket;
     ProxyConfig *config = thread_args->config;
-    
+
     char client_ip_str[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &(thread_args->client_address.sin_addr), client_ip_str, INET_ADDRSTRLEN); // Checagem do endereço
-    
+
     printf("[+] Nova conexão de %s:%d\n", client_ip_str, ntohs(thread_args->client_address.sin_port));
 
-    // 1. Conectar ao servidor real usando novo socket depois de conectar com o cliente
-    int server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    // Id já no accept: as falhas antes do par existir também vão para o gravador de voo
+    uint64_t accepted_ns = thread_args->accepted_ns;
+    unsigned long connection_id = connection_accepted(client_socket, accepted_ns);
 
-    if (server_socket < 0) {
-        perror("Erro ao criar socket para o servidor");
-        close(client_socket);
+    // 1. Terminação TLS: o handshake com o cliente vem antes de ocupar um connect() com o backend
+    TlsSession *client_tls = NULL;
+
+    if (tls_terminates()) {
+        client_tls = tls_session_accept(client_socket);
+
+        if (!client_tls) {
+            connection_aborted(connection_id, FLIGHT_CLOSE_ERROR, EPROTO);
+            close(client_socket);
+            admission_release();
+            connection_stats_publish_header();
+            free(thread_args);
+            return NULL;
+        }
+    }
+
+    // 2. Conectar ao servidor real usando novo socket depois de conectar com o cliente
+    // Com --max-connecting, a thread espera uma vaga na fila limitada (cheia ou demorada demais: RST)
+    AdmissionVerdict verdict = admission_connect_wait();
+
+    if (verdict != ADMISSION_ADMIT) {
+        connection_aborted(connection_id, FLIGHT_CLOSE_REJECTED, 0);
+        tls_session_free(client_tls);
+        admission_reject(client_socket, verdict);
+        connection_stats_publish_header();
         free(thread_args);
         return NULL;
     }
 
-    struct sockaddr_in server_address;
+    Backend *backend;
+    int server_socket = connection_connect_upstream(config, 0, connection_id, &backend);
+    int connect_error = errno;
+    admission_connect_done();
 
-    memset(&server_address, 0, sizeof(server_address));
-    server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(config->target_port); // Porta do servidor
+    // Origem TLS: handshake com o backend no socket recém-conectado (ou vindo do pool)
+    TlsSession *server_tls = NULL;
 
-    // Checagem do endereço
-    if (inet_pton(AF_INET, config->target_host, &server_address.sin_addr) <= 0) {
-        perror("Endereço do servidor real inválido");
-        close(client_socket);
-        close(server_socket);
-        free(thread_args);
-        return NULL;
+    if (server_socket >= 0 && tls_originates()) {
+        server_tls = tls_session_connect(server_socket);
+
+        if (!server_tls) {
+            backends_report_failure(backend);
+            backends_release(backend);
+            close(server_socket);
+            server_socket = -1;
+            connect_error = EPROTO;
+        }
     }
 
-    // Se conecta ao servidor usando seu socket
-    if (connect(server_socket, (struct sockaddr*)&server_address, sizeof(server_address)) < 0) {
-        perror("Erro ao conectar ao servidor real");
+    if (server_socket < 0) {
+        connection_connect_aborted(connection_id, accepted_ns, connect_error);
+        tls_session_free(client_tls);
         close(client_socket);
-        close(server_socket);
+        admission_release();
         free(thread_args);
         return NULL;
     }
 
-    printf("[+] Conexão (Cliente %d <-> Servidor %d) estabelecida.\n", client_socket, server_socket);
-
-    // 2. Inicializa as estruturas de métricas
+    printf("[+] Conexão (Cliente %d <-> Servidor %d, %s) estabelecida.\n", client_socket, server_socket, backend->address_str);
 
+    // 3. Inicializa as estruturas de métricas e o identificador usado no log
     ConnectionPair connection_pair;
-    connection_pair.client_socket = client_socket;
-    connection_pair.server_socket = server_socket;
-    connection_pair.client_address = thread_args->client_address;
-    
-    monitor_init_metrics(&connection_pair.metrics_client_proxy);
-    monitor_init_metrics(&connection_pair.metrics_proxy_server);
+    connection_pair_init(&connection_pair, config, connection_id, client_socket, server_socket, &thread_args->client_address, backend, accepted_ns);
+    connection_pair_connected(&connection_pair);
 
-    // 3. Abre o arquivo de log CSV
+    if (client_tls || server_tls) {
+        char description[128];
 
-    connection_pair.log_file = open_log_file(client_ip_str);
-
-    if (connection_pair.log_file == NULL) {
-        fprintf(stderr, "Falha ao iniciar o logger, a conexão continuará sem logs.\n");
+        connection_pair_set_tls(&connection_pair, client_tls, server_tls);
+        if (client_tls) {
+            tls_session_describe(client_tls, description, sizeof(description));
+            printf("[+] TLS com o cliente %d: %s\n", client_socket, description);
+        }
+        if (server_tls) {
+            tls_session_describe(server_tls, description, sizeof(description));
+            printf("[+] TLS com o servidor %d: %s\n", server_socket, description);
+        }
     }
 
     // Libera os argumentos da thread, já temos os dados que precisamos
     free(thread_args);
 
-    // 4. Configurar o poll() para monitorar os dois sockets agora que temos a conexão no meio do cliente e servidor
+    // 4. Sockets não-bloqueantes: um destino lento não trava a thread nem a outra direção
+    fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL, 0) | O_NONBLOCK);
+
     struct pollfd poll_fd[2]; // 0 = cliente, 1 = servidor
     poll_fd[0].fd = client_socket;
-    poll_fd[0].events = POLLIN; // Monitorar por dados de entrada (leitura)
     poll_fd[1].fd = server_socket;
-    poll_fd[1].events = POLLIN; // Monitorar por dados de entrada (leitura)
-
-    char buffer[4096]; // Buffer de 4KB para o tráfego
-    unsigned long bytes_client_to_server = 0; // Bytes Cliente -> Servidor
-    unsigned long bytes_server_to_client = 0; // Bytes Servidor -> Cliente
-    
-    unsigned long last_monitor_time = get_timestamp_ms();
 
     // 5. Loop de encaminhamento de dados e monitoramento
     while (1) {
-        // Espera pelo intervalo de monitoramento até que um dos sockets tenha dados
-        int poll_count = poll(poll_fd, 2, MONITOR_INTERVAL_MS);
+        // Lê de um lado só enquanto o canal para o outro tem espaço (backpressure),
+        // e espera POLLOUT do lado que tem dados pendentes
+        poll_fd[0].events = (relay_wants_read(&connection_pair.to_server) ? POLLIN : 0) |
+                            (relay_wants_write(&connection_pair.to_client) ? POLLOUT : 0);
+        poll_fd[1].events = (relay_wants_read(&connection_pair.to_client) ? POLLIN : 0) |
+                            (relay_wants_write(&connection_pair.to_server) ? POLLOUT : 0);
+
+        // Espera até a próxima coleta ou o prazo de ociosidade, o que vier antes, até que um dos sockets
+        // esteja pronto (ou menos, se a emulação de WAN ou um FIN retido pelo fast path precisam do relay antes)
+        int pending_wait = connection_pending_wait_ms(&connection_pair);
+        int fin_wait = connection_fin_wait_ms(&connection_pair);
+        if (fin_wait >= 0 && (pending_wait < 0 || fin_wait < pending_wait)) pending_wait = fin_wait;
+        int timeout = connection_thread_wait_ms(&connection_pair, config);
+        if (pending_wait >= 0 && pending_wait < timeout) timeout = pending_wait;
+        int poll_count = poll(poll_fd, 2, timeout);
 
         if (poll_count < 0) {
             perror("Erro no poll");
+            connection_pair_set_close_reason(&connection_pair, FLIGHT_CLOSE_INTERNAL, errno);
             break; // Encerra o loop e a conexão
         }
 
-        // Verifica se o cliente enviou dados e encaminha para o servidor caso sim
-        if (poll_fd[0].revents & POLLIN) {
-            ssize_t bytes_read = forward_data(client_socket, server_socket, buffer, sizeof(buffer));
-            if (bytes_read <= 0) break; // Cliente desconectou ou erro
-
-            bytes_client_to_server += bytes_read;
-        }
+        // Encaminha nas duas direções; erro ou FIN dos dois lados encerra o par
+        if ((poll_count > 0 || pending_wait >= 0) && connection_relay(&connection_pair) != 0) break;
 
-        // Verifica se o servidor enviou dados e encaminha para o cliente caso sim
-        if (poll_fd[1].revents & POLLIN) {
-            ssize_t bytes_read = forward_data(server_socket, client_socket, buffer, sizeof(buffer));
-            if (bytes_read <= 0) break; // Servidor desconectou ou erro
+        // Verifica se é hora de coletar métricas (intervalo adaptativo da conexão)
+        unsigned long current_time = get_monotonic_ms();
 
-            bytes_server_to_client += bytes_read;
+        if (current_time - connection_pair.last_monitor_time >= connection_pair.sample_interval_ms) {
+            connection_monitor_tick(&connection_pair, config);
+            connection_pair.last_monitor_time = current_time;
         }
 
-        // Verifica se é hora de coletar métricas caso tenha dado o tempo de intervalo do timestamp
-        unsigned long current_time = get_timestamp_ms();
-
-        if (current_time - last_monitor_time >= MONITOR_INTERVAL_MS) {
-            // 1. COLETA DE MÉTRICAS
-
-            // Coleta métricas Cliente -> Proxy
-            monitor_get_tcp_info(client_socket, &connection_pair.metrics_client_proxy);
-            monitor_calculate_throughput(&connection_pair.metrics_client_proxy, bytes_client_to_server);
-
-            // Coleta métricas Proxy -> Servidor
-            monitor_get_tcp_info(server_socket, &connection_pair.metrics_proxy_server);
-            monitor_calculate_throughput(&connection_pair.metrics_proxy_server, bytes_server_to_client);
-
-            // 2. EXIBIÇÃO E LOG
-
-            // Exibe no terminal e loga no CSV
-            display_metrics_text(&connection_pair.metrics_client_proxy, &connection_pair.metrics_proxy_server);
-            log_metrics_csv(connection_pair.log_file, &connection_pair.metrics_client_proxy, &connection_pair.metrics_proxy_server);
-
-            // 3. APLICAÇÃO DE POLÍTICAS DE OTIMIZAÇÃO CONDICIONAL
-            // Ativada de acordo com flag
-            if (config->enable_optimization) {
-                // Cálculo do BDP (Bandwidth-Delay Product) para a conexão Proxy <-> Servidor
-                // BDP = Banda (bytes/s) * RTT (s)
-                
-                double throughput_bytes_sec = (connection_pair.metrics_proxy_server.throughput_kbps * 1000.0) / 8.0;
-                double rtt_sec = connection_pair.metrics_proxy_server.rtt_ms / 1000.0;
-                
-                if (throughput_bytes_sec > 0 && rtt_sec > 0) {
-                    int bdp = (int)(throughput_bytes_sec * rtt_sec);
-                    
-                    // Buffer Tuning: Define o buffer como 2x o BDP para garantir fluxo contínuo, limitado para evitar bufferbloat
-                    // Limitado a um mínimo de 64 KB
-                    int optimal_buffer = bdp * 2;
-                    if (optimal_buffer < 65535) optimal_buffer = 65535; 
-
-                    // Aplica no socket que vai para o servidor
-                    apply_buffer_tuning(server_socket, optimal_buffer, optimal_buffer);
-                    
-                    // Log
-                    printf("[Otimização] BDP Calculado: %d bytes | Novo Buffer: %d bytes\n", bdp, optimal_buffer);
-                }
-
-                // TCP Pacing:
-                // Se detectar que o RTT está muito alto (ex: > 100ms), limita a taxa para tentar descongestionar a rede
-                if (connection_pair.metrics_proxy_server.rtt_ms > 100.0) {
-                    // Limita a 1 MB/s (valor arbitrário para teste)
-                    long pacing_rate = 1024 * 1024; 
-                    apply_tcp_pacing(server_socket, pacing_rate);
-
-                    printf("[Otimização] RTT Alto (%.2fms). Pacing ativado: 1MB/s\n", connection_pair.metrics_proxy_server.rtt_ms);
-                } else {
-                    // Remove o pacing (define como 0 ou valor máximo)
-                    apply_tcp_pacing(server_socket, ~0UL); 
-                }
-            }
-
-            last_monitor_time = current_time;
+        if (connection_idle_remaining_ms(&connection_pair, config) == 0) {
+            printf("[-] Conexão (Cliente %d <-> Servidor %d) ociosa há %d s, encerrando.\n",
+                   client_socket, server_socket, config->idle_timeout_ms / 1000);
+            connection_pair_set_close_reason(&connection_pair, FLIGHT_CLOSE_IDLE, 0);
+            break;
         }
     }
 
     // 6. Limpeza
-    printf("[-] Conexão (Cliente %d <-> Servidor %d) encerrada.\n", client_socket, server_socket);
-
-    close(client_socket);
-    close(server_socket);
-
-    if (connection_pair.log_file) {
-        fclose(connection_pair.log_file); // Fecha arquivo de logs
-        printf("[+] Log da conexão salvo.\n");
-    }
+    connection_pair_close(&connection_pair);
+    logs_release_thread_ring();
+    latency_release_thread_slot();
+    flight_release_thread_ring();
 
     return NULL;
 }
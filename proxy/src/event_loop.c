@@ -0,0 +1,614 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "../include/event_loop.h"
+#include "../include/connection_handler.h"
+#include "../include/tcp_monitor.h"
+#include "../include/listener.h"
+#include "../include/slab_pool.h"
+#include "../include/admission.h"
+#include "../include/latency_stats.h"
+#include "../include/timer_wheel.h"
+
+#define EPOLL_MAX_EVENTS 256      // Eventos processados por chamada de epoll_wait
+#define HEADER_INTERVAL_MS 500    // Publicação dos agregados do segmento enquanto o worker tem conexões
+
+// Timers da roda do worker (TimerEntry.kind)
+typedef enum {
+    WORKER_TIMER_SAMPLE = 0,      // Coleta de métricas de uma conexão (intervalo adaptativo)
+    WORKER_TIMER_IDLE,            // Prazo do --idle-timeout de uma conexão
+    WORKER_TIMER_FIN,             // Nova verificação de um FIN retido pelo fast path
+    WORKER_TIMER_HEADER           // Cabeçalho do segmento de estatísticas (owner == NULL)
+} WorkerTimerKind;
+
+typedef enum {
+    CONN_CONNECTING = 0,  // connect() ao servidor em andamento
+    CONN_ESTABLISHED      // Encaminhando dados
+} EpollConnectionState;
+
+struct EpollConnection;
+
+// Identifica qual lado da conexão gerou o evento (vai em epoll_event.data.ptr)
+typedef struct {
+    struct EpollConnection *connection;
+    int is_server;
+} EpollHandle;
+
+typedef struct EpollConnection {
+    ConnectionPair pair;
+    EpollConnectionState state;
+    int closing;                        // Marcada para liberação ao fim do lote de eventos
+    int deferred;                       // Na lista de trabalho adiado do worker
+    uint32_t interest;                  // Eventos registrados no epoll para os dois sockets
+    int connect_slot;                   // 1 enquanto ocupa uma vaga de connect() (--max-connecting)
+
+    TimerEntry sample_timer;            // Próxima coleta de métricas (só estabelecida)
+    TimerEntry idle_timer;              // Prazo de ociosidade (reavaliado pela atividade real no vencimento)
+    TimerEntry fin_timer;               // FIN retido pelo fast path: verifica de novo a entrega ao destino
+
+    EpollHandle client_handle;
+    EpollHandle server_handle;
+
+    struct EpollConnection *prev;       // Lista de conexões do worker
+    struct EpollConnection *next;
+    struct EpollConnection *deferred_prev;  // Lista das que têm dados retidos sem borda de epoll
+    struct EpollConnection *deferred_next;
+    struct EpollConnection *reap_next;      // Lista das marcadas para encerramento
+} EpollConnection;
+
+// Socket aceito pela thread principal aguardando o worker
+typedef struct PendingAccept {
+    int client_fd;
+    struct sockaddr_in client_address;
+    uint64_t accepted_ns;               // Momento do accept() (latency_now_ns)
+    struct PendingAccept *next;
+} PendingAccept;
+
+typedef struct {
+    int id;
+    pthread_t thread;
+    int epoll_fd;
+    int notify_fd;                      // eventfd para acordar o worker quando há novos sockets
+    int listen_fd;                      // Socket de escuta próprio (SO_REUSEPORT), ou -1
+    EpollHandle listen_handle;          // Marca os eventos do socket de escuta (connection == NULL)
+    int listen_paused;                  // Accept suspenso pelo controle de admissão (--overload pause)
+
+    pthread_mutex_t queue_lock;
+    PendingAccept *queue_head;
+    PendingAccept *queue_tail;
+
+    AdmissionQueue waiting;             // Aceitas à espera de uma vaga de connect()
+
+    EpollConnection *connections;       // Conexões ativas deste worker
+    int connection_count;
+    EpollConnection *deferred;          // Só as conexões com trabalho adiado (emulação, banda, TLS)
+    EpollConnection *reap;              // Marcadas para encerramento, liberadas no fim do lote
+
+    TimerWheel timers;                  // Coletas, ociosidade e cabeçalho: o worker só acorda no vencimento
+    TimerEntry header_timer;
+    EpollHandle timer_handle;           // Marca os eventos do timerfd da roda (connection == NULL)
+
+    ProxyConfig *config;
+} EpollWorker;
+
+static EpollWorker *workers = NULL;
+static int worker_count = 0;
+static unsigned int next_worker = 0;
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// connect() concluído (ou abandonado): devolve a vaga ao controle de admissão
+static void connection_release_connect_slot(EpollConnection *connection) {
+    if (!connection->connect_slot) return;
+
+    connection->connect_slot = 0;
+    admission_connect_done();
+}
+
+// Marca a conexão para liberação no fim do lote (outros eventos do lote ainda podem apontar para ela)
+static void connection_mark_closing(EpollWorker *worker, EpollConnection *connection) {
+    if (connection->closing) return;
+
+    connection->closing = 1;
+    connection->reap_next = worker->reap;
+    worker->reap = connection;
+}
+
+static void connection_set_deferred(EpollWorker *worker, EpollConnection *connection, int deferred) {
+    if (connection->deferred == deferred) return;
+
+    if (deferred) {
+        connection->deferred_prev = NULL;
+        connection->deferred_next = worker->deferred;
+        if (worker->deferred) worker->deferred->deferred_prev = connection;
+        worker->deferred = connection;
+    } else {
+        if (connection->deferred_prev) connection->deferred_prev->deferred_next = connection->deferred_next;
+        else worker->deferred = connection->deferred_next;
+        if (connection->deferred_next) connection->deferred_next->deferred_prev = connection->deferred_prev;
+    }
+
+    connection->deferred = deferred;
+}
+
+// Remove a conexão do worker e libera seus recursos
+static void worker_release_connection(EpollWorker *worker, EpollConnection *connection) {
+    connection_set_deferred(worker, connection, 0);
+    connection_release_connect_slot(connection);
+    timer_wheel_cancel(&worker->timers, &connection->sample_timer);
+    timer_wheel_cancel(&worker->timers, &connection->idle_timer);
+    timer_wheel_cancel(&worker->timers, &connection->fin_timer);
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, connection->pair.client_socket, NULL);
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, connection->pair.server_socket, NULL);
+
+    if (connection->prev) connection->prev->next = connection->next;
+    else worker->connections = connection->next;
+    if (connection->next) connection->next->prev = connection->prev;
+    worker->connection_count--;
+
+    connection_pair_close(&connection->pair);
+    slab_free(connection, sizeof(EpollConnection));
+}
+
+// Encaminha nas duas direções até esgotar as origens ou encher os canais.
+// Com edge-triggered é preciso drenar tudo, senão não chega nova notificação;
+// um canal cheio é retomado na borda de EPOLLOUT do destino.
+static void connection_pump(EpollWorker *worker, EpollConnection *connection) {
+
+    // Erro em qualquer lado ou FIN propagado nas duas direções encerra o par
+    if (connection_relay(&connection->pair) != 0) {
+        connection_mark_closing(worker, connection);
+        return;
+    }
+
+    // Só as conexões com algo retido são revisitadas a cada volta do loop, sem varrer as demais
+    connection_set_deferred(worker, connection, connection_pending_wait_ms(&connection->pair) >= 0);
+
+    // FIN retido: cada conexão tem o próprio timer, sem encurtar o epoll_wait do worker
+    int fin_wait = connection_fin_wait_ms(&connection->pair);
+    if (fin_wait < 0) timer_wheel_cancel(&worker->timers, &connection->fin_timer);
+    else if (!timer_wheel_pending(&connection->fin_timer)) timer_wheel_schedule(&worker->timers, &connection->fin_timer, (unsigned long)fin_wait);
+
+    // No fast path o kernel escreve no destino e cada ACK geraria uma borda de EPOLLOUT:
+    // sem nada pendente no relay, o worker só precisa saber de dados que sobraram, FIN e erros
+    ConnectionPair *pair = &connection->pair;
+    uint32_t interest = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+
+    if (pair->sockmap_slot >= 0 && !relay_wants_write(&pair->to_server) && !relay_wants_write(&pair->to_client)) {
+        interest = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    }
+
+    if (interest != connection->interest) {
+        struct epoll_event event = { .events = interest, .data.ptr = &connection->client_handle };
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, pair->client_socket, &event);
+        event.data.ptr = &connection->server_handle;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, pair->server_socket, &event);
+        connection->interest = interest;
+    }
+}
+
+// Verifica o resultado do connect() não-bloqueante
+static void connection_finish_connect(EpollWorker *worker, EpollConnection *connection) {
+    int socket_error = 0;
+    socklen_t error_len = sizeof(socket_error);
+
+    getsockopt(connection->pair.server_socket, SOL_SOCKET, SO_ERROR, &socket_error, &error_len);
+
+    if (socket_error == EINPROGRESS || socket_error == EALREADY) return; // Ainda conectando
+
+    connection_release_connect_slot(connection);
+
+    if (socket_error != 0) {
+        fprintf(stderr, "Erro ao conectar ao servidor real %s: %s\n", connection->pair.backend->address_str, strerror(socket_error));
+        backends_report_failure(connection->pair.backend);
+        connection_pair_connect_failed(&connection->pair, socket_error);
+        connection_mark_closing(worker, connection);
+        return;
+    }
+
+    connection->state = CONN_ESTABLISHED;
+    connection_pair_connected(&connection->pair);
+    timer_wheel_schedule(&worker->timers, &connection->sample_timer, connection->pair.sample_interval_ms);
+    printf("[+] Conexão (Cliente %d <-> Servidor %d, %s) estabelecida.\n", connection->pair.client_socket, connection->pair.server_socket,
+           connection->pair.backend->address_str);
+
+    // Dados que o cliente já enviou não geram nova borda, então encaminha imediatamente
+    connection_pump(worker, connection);
+}
+
+// Conecta ao backend uma conexão admitida (a vaga de connect() já está reservada; AdmissionStartCallback)
+static void worker_add_connection(void *context, int client_fd, const struct sockaddr_in *client_address, uint64_t accepted_ns) {
+    EpollWorker *worker = context;
+    char client_ip_str[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(client_address->sin_addr), client_ip_str, INET_ADDRSTRLEN);
+
+    printf("[+] Nova conexão de %s:%d (worker %d)\n", client_ip_str, ntohs(client_address->sin_port), worker->id);
+
+    unsigned long connection_id = connection_accepted(client_fd, accepted_ns);
+    Backend *backend;
+    int server_socket = connection_connect_upstream(worker->config, 1, connection_id, &backend);
+
+    if (server_socket < 0) {
+        connection_connect_aborted(connection_id, accepted_ns, errno);
+        close(client_fd);
+        admission_connect_done();
+        admission_release();
+        return;
+    }
+
+    EpollConnection *connection = slab_alloc(sizeof(EpollConnection));
+
+    if (!connection) {
+        perror("Erro ao alocar conexão");
+        connection_aborted(connection_id, FLIGHT_CLOSE_INTERNAL, ENOMEM);
+        close(client_fd);
+        close(server_socket);
+        backends_release(backend);
+        admission_connect_done();
+        admission_release();
+        return;
+    }
+
+    memset(connection, 0, sizeof(EpollConnection));
+    connection->connect_slot = 1;
+    set_nonblocking(client_fd);
+    connection_pair_init(&connection->pair, worker->config, connection_id, client_fd, server_socket, client_address, backend, accepted_ns);
+    connection->state = CONN_CONNECTING;
+
+    connection->client_handle.connection = connection;
+    connection->client_handle.is_server = 0;
+    connection->server_handle.connection = connection;
+    connection->server_handle.is_server = 1;
+
+    timer_wheel_entry_init(&connection->sample_timer, WORKER_TIMER_SAMPLE, connection);
+    timer_wheel_entry_init(&connection->idle_timer, WORKER_TIMER_IDLE, connection);
+    timer_wheel_entry_init(&connection->fin_timer, WORKER_TIMER_FIN, connection);
+    if (worker->config->idle_timeout_ms > 0) timer_wheel_schedule(&worker->timers, &connection->idle_timer, worker->config->idle_timeout_ms);
+    if (!timer_wheel_pending(&worker->header_timer)) timer_wheel_schedule(&worker->timers, &worker->header_timer, HEADER_INTERVAL_MS);
+
+    // Insere na lista do worker
+    connection->next = worker->connections;
+    if (worker->connections) worker->connections->prev = connection;
+    worker->connections = connection;
+    worker->connection_count++;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    connection->interest = event.events;
+
+    event.data.ptr = &connection->client_handle;
+    int client_ok = epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, connection->pair.client_socket, &event);
+
+    event.data.ptr = &connection->server_handle;
+    int server_ok = epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, connection->pair.server_socket, &event);
+
+    if (client_ok < 0 || server_ok < 0) {
+        perror("Erro no epoll_ctl");
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_INTERNAL, errno);
+        worker_release_connection(worker, connection);
+    }
+}
+
+// Consome os sockets entregues pela thread principal
+static void worker_drain_queue(EpollWorker *worker) {
+    uint64_t counter;
+    while (read(worker->notify_fd, &counter, sizeof(counter)) > 0);
+
+    pthread_mutex_lock(&worker->queue_lock);
+    PendingAccept *accepted = worker->queue_head;
+    worker->queue_head = worker->queue_tail = NULL;
+    pthread_mutex_unlock(&worker->queue_lock);
+
+    while (accepted) {
+        PendingAccept *next = accepted->next;
+        admission_queue_admit(&worker->waiting, accepted->client_fd, &accepted->client_address, accepted->accepted_ns, worker_add_connection, worker);
+        free(accepted);
+        accepted = next;
+    }
+}
+
+// Liga ou desliga os eventos do socket de escuta (o registro é level-triggered: pausado, ele
+// dispararia a cada epoll_wait enquanto o backlog tiver conexões)
+static void worker_set_listen_paused(EpollWorker *worker, int paused) {
+    struct epoll_event event = { .events = paused ? 0 : EPOLLIN, .data.ptr = &worker->listen_handle };
+
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, worker->listen_fd, &event);
+    worker->listen_paused = paused;
+}
+
+// Aceita todas as conexões pendentes no socket de escuta próprio do worker
+static void worker_accept_all(EpollWorker *worker) {
+    while (1) {
+        // No limite com --overload pause, as próximas conexões esperam no backlog do kernel
+        if (admission_pause_ms() > 0) {
+            worker_set_listen_paused(worker, 1);
+            return;
+        }
+
+        PendingAccept accepted;
+        socklen_t client_len = sizeof(accepted.client_address);
+
+        accepted.client_fd = accept4(worker->listen_fd, (struct sockaddr*)&accepted.client_address, &client_len, SOCK_CLOEXEC);
+        accepted.accepted_ns = latency_now_ns();
+
+        if (accepted.client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("Erro no accept");
+            return;
+        }
+
+        AdmissionVerdict verdict = admission_accept();
+        if (verdict != ADMISSION_ADMIT) {
+            admission_reject(accepted.client_fd, verdict);
+            continue;
+        }
+
+        admission_queue_admit(&worker->waiting, accepted.client_fd, &accepted.client_address, accepted.accepted_ns, worker_add_connection, worker);
+    }
+}
+
+// Vencimento de um timer da roda. A ociosidade é reavaliada pela atividade real: cada byte encaminhado
+// só atualiza last_activity_time, e o timer volta para a roda com o que falta do prazo
+static void worker_timer_fired(TimerEntry *entry, void *context) {
+    EpollWorker *worker = (EpollWorker*)context;
+
+    if (entry->kind == WORKER_TIMER_HEADER) {
+        connection_stats_publish_header();
+        if (worker->connection_count > 0) timer_wheel_schedule(&worker->timers, entry, HEADER_INTERVAL_MS);
+        return;
+    }
+
+    EpollConnection *connection = (EpollConnection*)entry->owner;
+    if (connection->closing) return;
+
+    if (entry->kind == WORKER_TIMER_FIN) {
+        connection_pump(worker, connection); // Verifica a entrega e reagenda com o intervalo seguinte
+        return;
+    }
+
+    if (entry->kind == WORKER_TIMER_IDLE) {
+        int remaining = connection_idle_remaining_ms(&connection->pair, worker->config);
+
+        if (remaining != 0) {
+            if (remaining > 0) timer_wheel_schedule(&worker->timers, entry, (unsigned long)remaining);
+            return;
+        }
+
+        printf("[-] Conexão (Cliente %d <-> Servidor %d) ociosa há %d s, encerrando.\n",
+               connection->pair.client_socket, connection->pair.server_socket, worker->config->idle_timeout_ms / 1000);
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_IDLE, 0);
+        connection_mark_closing(worker, connection);
+        return;
+    }
+
+    connection_monitor_tick(&connection->pair, worker->config);
+    connection->pair.last_monitor_time = get_monotonic_ms();
+    timer_wheel_schedule(&worker->timers, entry, connection->pair.sample_interval_ms);
+}
+
+// Encaminha o que não tem borda de epoll: dados da emulação de WAN com o atraso vencido,
+// leituras paradas à espera de tokens de banda e registros já decifrados pelo OpenSSL.
+// Percorre só a lista de adiadas (connection_pump tira da lista a conexão que não tem mais nada retido)
+// @return ms até a próxima liberação em alguma conexão, ou -1 se nada está retido
+static int worker_pump_deferred(EpollWorker *worker) {
+    int next_wait = -1;
+    EpollConnection *connection = worker->deferred;
+
+    while (connection) {
+        EpollConnection *next = connection->deferred_next;
+
+        if (!connection->closing) {
+            int wait = connection_pending_wait_ms(&connection->pair);
+            if (wait == 0) {
+                connection_pump(worker, connection);
+                wait = connection->closing ? -1 : connection_pending_wait_ms(&connection->pair);
+            }
+
+            if (wait < 0) connection_set_deferred(worker, connection, 0);
+            else if (next_wait < 0 || wait < next_wait) next_wait = wait;
+        }
+
+        connection = next;
+    }
+
+    return next_wait;
+}
+
+// Libera as conexões marcadas durante o lote de eventos (evita ponteiros inválidos no mesmo lote)
+static void worker_reap_closed(EpollWorker *worker) {
+    while (worker->reap) {
+        EpollConnection *connection = worker->reap;
+        worker->reap = connection->reap_next;
+        worker_release_connection(worker, connection);
+    }
+}
+
+static void* worker_main(void *args) {
+    EpollWorker *worker = (EpollWorker*)args;
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int timeout = -1;
+
+    if (worker->config->pin_cpus) listener_pin_worker(worker->id);
+
+    while (1) {
+        int event_count = epoll_wait(worker->epoll_fd, events, EPOLL_MAX_EVENTS, timeout);
+
+        if (event_count < 0) {
+            if (errno == EINTR) continue;
+            perror("Erro no epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < event_count; i++) {
+            EpollHandle *handle = (EpollHandle*)events[i].data.ptr;
+
+            // data.ptr == NULL identifica o eventfd de novos sockets
+            if (handle == NULL) {
+                worker_drain_queue(worker);
+                continue;
+            }
+
+            if (handle == &worker->listen_handle) {
+                worker_accept_all(worker);
+                continue;
+            }
+
+            if (handle == &worker->timer_handle) {
+                timer_wheel_advance(&worker->timers, worker_timer_fired, worker);
+                continue;
+            }
+
+            EpollConnection *connection = handle->connection;
+            if (connection->closing) continue;
+
+            if (connection->state == CONN_CONNECTING) {
+                if (handle->is_server) connection_finish_connect(worker, connection);
+            } else {
+                connection_pump(worker, connection);
+            }
+        }
+
+        // Sem nada retido o worker dorme até um socket ou o timerfd da roda
+        timeout = -1;
+
+        if (worker->deferred) timeout = worker_pump_deferred(worker);
+
+        // Fila de connect() e accept pausado não têm borda de epoll: são reavaliados a cada volta
+        if (worker->waiting.head) {
+            int waiting_retry = admission_queue_drain(&worker->waiting, worker_add_connection, worker);
+            if (waiting_retry >= 0 && (timeout < 0 || waiting_retry < timeout)) timeout = waiting_retry;
+        }
+
+        if (worker->listen_paused) {
+            int pause_ms = admission_pause_ms();
+
+            if (pause_ms == 0) {
+                worker_set_listen_paused(worker, 0);
+                worker_accept_all(worker);
+            } else if (timeout < 0 || pause_ms < timeout) {
+                timeout = pause_ms;
+            }
+        }
+
+        if (worker->reap) worker_reap_closed(worker);
+    }
+
+    return NULL;
+}
+
+int event_loop_start(ProxyConfig *config) {
+    worker_count = config->num_workers > 0 ? config->num_workers : 1;
+    workers = calloc(worker_count, sizeof(EpollWorker));
+
+    if (!workers) {
+        perror("Erro ao alocar workers");
+        return -1;
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        EpollWorker *worker = &workers[i];
+        worker->id = i;
+        worker->config = config;
+        pthread_mutex_init(&worker->queue_lock, NULL);
+
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        worker->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (worker->epoll_fd < 0 || worker->notify_fd < 0) {
+            perror("Erro ao criar epoll/eventfd do worker");
+            return -1;
+        }
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->notify_fd, &event) < 0) {
+            perror("Erro ao registrar eventfd do worker");
+            return -1;
+        }
+
+        // Roda de timers: o timerfd fica armado só para o próximo vencimento
+        if (timer_wheel_init(&worker->timers, 1) < 0) return -1;
+        timer_wheel_entry_init(&worker->header_timer, WORKER_TIMER_HEADER, NULL);
+
+        event.events = EPOLLIN;
+        event.data.ptr = &worker->timer_handle;
+
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->timers.timer_fd, &event) < 0) {
+            perror("Erro ao registrar timerfd do worker");
+            return -1;
+        }
+
+        // Com SO_REUSEPORT o próprio worker aceita: o kernel faz o balanceamento e não há thread de accept
+        worker->listen_fd = -1;
+
+        if (config->reuseport) {
+            worker->listen_fd = listener_open(config, 1);
+            if (worker->listen_fd < 0) return -1;
+
+            set_nonblocking(worker->listen_fd);
+            if (config->incoming_cpu) listener_set_incoming_cpu(worker->listen_fd, listener_worker_cpu(i));
+
+            event.events = EPOLLIN;
+            event.data.ptr = &worker->listen_handle;
+
+            if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->listen_fd, &event) < 0) {
+                perror("Erro ao registrar socket de escuta do worker");
+                return -1;
+            }
+        }
+
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            perror("Erro ao criar thread do worker");
+            return -1;
+        }
+
+        pthread_detach(worker->thread);
+    }
+
+    return 0;
+}
+
+int event_loop_dispatch(int client_fd, const struct sockaddr_in *client_address) {
+    PendingAccept *accepted = malloc(sizeof(PendingAccept));
+
+    if (!accepted) {
+        perror("Erro ao alocar socket pendente");
+        return -1;
+    }
+
+    accepted->client_fd = client_fd;
+    accepted->client_address = *client_address;
+    accepted->accepted_ns = latency_now_ns();
+    accepted->next = NULL;
+
+    // Round-robin entre os workers
+    EpollWorker *worker = &workers[next_worker++ % worker_count];
+
+    pthread_mutex_lock(&worker->queue_lock);
+    if (worker->queue_tail) worker->queue_tail->next = accepted;
+    else worker->queue_head = accepted;
+    worker->queue_tail = accepted;
+    pthread_mutex_unlock(&worker->queue_lock);
+
+    uint64_t wake = 1;
+    if (write(worker->notify_fd, &wake, sizeof(wake)) < 0) {
+        perror("Erro ao notificar worker");
+    }
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../include/experiment.h"
+#include "../include/metrics_format.h"
+#include "../include/tcp_monitor.h"
+
+// Média e variância acumuladas sem guardar as amostras (Welford)
+typedef struct {
+    unsigned long count;
+    double mean;
+    double m2;
+} RunningStat;
+
+typedef struct {
+    RunningStat throughput;
+    RunningStat rtt_client;
+    RunningStat rtt_server;
+    RunningStat retrans;
+    float reservoir[EXPERIMENT_RESERVOIR];
+    unsigned long assigned;             // Conexões atribuídas (atômico; as encerradas são throughput.count)
+} ArmStats;
+
+static ExperimentConfig settings;
+static ArmStats arm_stats[EXPERIMENT_MAX_ARMS];
+static int total_weight = 0;
+static uint64_t salt = 0;
+static uint64_t reservoir_state = 0;
+static int promoted = -1;                       // Atômico: braço promovido (-1 = ainda em teste)
+static unsigned long recorded = 0;              // Conexões encerradas em todos os braços (com stats_lock)
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Espalha ids sequenciais de forma uniforme (splitmix64)
+static uint64_t experiment_mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+int experiment_parse_arms(ExperimentConfig *config, const char *spec) {
+    char buffer[256];
+    char *save = NULL;
+
+    if (strlen(spec) >= sizeof(buffer)) return -1;
+    strcpy(buffer, spec);
+    config->arm_count = 0;
+
+    for (char *item = strtok_r(buffer, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (config->arm_count >= EXPERIMENT_MAX_ARMS) return -1;
+
+        ExperimentArmSpec arm = { .optimize = 1, .policy = OPTIMIZER_POLICY_MODEL, .weight = 1 };
+        char *equals = strchr(item, '=');
+
+        if (equals) {
+            *equals = '\0';
+            arm.weight = atoi(equals + 1);
+            if (arm.weight <= 0) return -1;
+        }
+
+        if (strcmp(item, "off") == 0) arm.optimize = 0;
+        else if (strcmp(item, "model") == 0) arm.policy = OPTIMIZER_POLICY_MODEL;
+        else if (strcmp(item, "legacy") == 0) arm.policy = OPTIMIZER_POLICY_LEGACY;
+        else return -1;
+
+        // Braços repetidos teriam o mesmo nome no relatório e o mesmo código no log
+        for (int i = 0; i < config->arm_count; i++) {
+            const ExperimentArmSpec *other = &config->arms[i];
+            if (other->optimize == arm.optimize && (!arm.optimize || other->policy == arm.policy)) return -1;
+        }
+
+        config->arms[config->arm_count++] = arm;
+    }
+
+    // Um braço só não é experimento
+    return config->arm_count >= 2 ? 0 : -1;
+}
+
+void experiment_start(const ExperimentConfig *config) {
+    settings = *config;
+    total_weight = 0;
+    for (int i = 0; i < settings.arm_count; i++) total_weight += settings.arms[i].weight;
+
+    // A semente muda a cada execução: a mesma conexão de um teste repetido não cai sempre no mesmo braço
+    salt = experiment_mix(get_timestamp_ms());
+    reservoir_state = salt | 1;
+}
+
+int experiment_enabled(void) {
+    return settings.arm_count > 0;
+}
+
+int experiment_assign(unsigned long connection_id) {
+    if (!experiment_enabled()) return -1;
+
+    int arm = __atomic_load_n(&promoted, __ATOMIC_RELAXED);
+
+    if (arm < 0) {
+        int ticket = (int)(experiment_mix(connection_id ^ salt) % (uint64_t)total_weight);
+
+        for (arm = 0; arm < settings.arm_count - 1 && ticket >= settings.arms[arm].weight; arm++) {
+            ticket -= settings.arms[arm].weight;
+        }
+    }
+
+    __atomic_add_fetch(&arm_stats[arm].assigned, 1, __ATOMIC_RELAXED);
+    return arm;
+}
+
+const OptimizerPolicy* experiment_arm_policy(int arm) {
+    return settings.arms[arm].optimize ? optimizer_policy_get(settings.arms[arm].policy) : NULL;
+}
+
+const char* experiment_arm_name(int arm) {
+    return settings.arms[arm].optimize ? optimizer_policy_get(settings.arms[arm].policy)->name : "off";
+}
+
+int experiment_arm_code(int arm) {
+    if (arm < 0) return METRICS_ARM_NONE;
+    return settings.arms[arm].optimize ? METRICS_ARM_POLICY + (int)settings.arms[arm].policy : METRICS_ARM_OFF;
+}
+
+static void running_add(RunningStat *stat, double value) {
+    stat->count++;
+
+    double delta = value - stat->mean;
+    stat->mean += delta / stat->count;
+    stat->m2 += delta * (value - stat->mean);
+}
+
+static double running_variance(const RunningStat *stat) {
+    return stat->count > 1 ? stat->m2 / (stat->count - 1) : 0.0;
+}
+
+// Meia largura do intervalo de confiança da média (aproximação normal)
+static double running_ci(const RunningStat *stat) {
+    return stat->count > 1 ? EXPERIMENT_CI_Z * sqrt(running_variance(stat) / stat->count) : 0.0;
+}
+
+// Estatística z de Welch da diferença entre as médias (a - b); variâncias diferentes nos dois braços
+static double running_z(const RunningStat *a, const RunningStat *b) {
+    double error = sqrt(running_variance(a) / a->count + running_variance(b) / b->count);
+
+    if (error == 0) return a->mean > b->mean ? INFINITY : a->mean < b->mean ? -INFINITY : 0.0;
+    return (a->mean - b->mean) / error;
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Promove o braço de maior throughput se ele supera cada um dos outros a 99% sem retransmitir
+// significativamente mais (com stats_lock)
+static void experiment_try_promote(void) {
+    if (settings.promote_min <= 0 || __atomic_load_n(&promoted, __ATOMIC_RELAXED) >= 0) return;
+
+    int best = 0;
+
+    for (int i = 0; i < settings.arm_count; i++) {
+        if (arm_stats[i].throughput.count < (unsigned long)settings.promote_min) return;
+        if (arm_stats[i].throughput.mean > arm_stats[best].throughput.mean) best = i;
+    }
+
+    int runner_up = best == 0 ? 1 : 0;
+
+    for (int i = 0; i < settings.arm_count; i++) {
+        if (i == best) continue;
+        if (arm_stats[i].throughput.mean > arm_stats[runner_up].throughput.mean) runner_up = i;
+        if (running_z(&arm_stats[best].throughput, &arm_stats[i].throughput) < EXPERIMENT_PROMOTE_Z) return;
+        if (running_z(&arm_stats[best].retrans, &arm_stats[i].retrans) > EXPERIMENT_PROMOTE_Z) return;
+    }
+
+    __atomic_store_n(&promoted, best, __ATOMIC_RELAXED);
+    printf("[A/B] Braço '%s' promovido: %.1f kbps contra %.1f kbps do segundo ('%s'), z = %.2f em %lu conexões encerradas\n",
+           experiment_arm_name(best), arm_stats[best].throughput.mean, arm_stats[runner_up].throughput.mean,
+           experiment_arm_name(runner_up), running_z(&arm_stats[best].throughput, &arm_stats[runner_up].throughput), recorded);
+}
+
+void experiment_record(int arm, const ExperimentOutcome *outcome) {
+    if (arm < 0 || !experiment_enabled()) return;
+
+    ArmStats *stats = &arm_stats[arm];
+    int report = 0;
+
+    pthread_mutex_lock(&stats_lock);
+
+    running_add(&stats->throughput, outcome->throughput_kbps);
+    running_add(&stats->rtt_client, outcome->rtt_client_ms);
+    running_add(&stats->rtt_server, outcome->rtt_server_ms);
+    running_add(&stats->retrans, outcome->retrans_pct);
+
+    // Reservatório: cada conexão do braço tem a mesma chance de estar entre as guardadas
+    unsigned long seen = stats->throughput.count;
+    if (seen <= EXPERIMENT_RESERVOIR) {
+        stats->reservoir[seen - 1] = (float)outcome->throughput_kbps;
+    } else {
+        reservoir_state = experiment_mix(reservoir_state);
+        unsigned long slot = reservoir_state % seen;
+        if (slot < EXPERIMENT_RESERVOIR) stats->reservoir[slot] = (float)outcome->throughput_kbps;
+    }
+
+    if (++recorded % EXPERIMENT_REPORT_EVERY == 0) {
+        experiment_try_promote();
+        report = 1;
+    }
+
+    pthread_mutex_unlock(&stats_lock);
+
+    if (report) {
+        char text[2048];
+        experiment_format(text, sizeof(text));
+        printf("%s", text);
+    }
+}
+
+size_t experiment_format(char *out, size_t out_len) {
+    float sorted[EXPERIMENT_RESERVOIR];
+    size_t length = 0;
+    int winner = __atomic_load_n(&promoted, __ATOMIC_RELAXED);
+
+    if (!experiment_enabled()) {
+        length = snprintf(out, out_len, "sem experimento A/B\n");
+        return length < out_len ? length : out_len - 1;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+
+    length += snprintf(out + length, out_len - length, "# Experimento A/B: %lu conexões encerradas, %s (IC de 95%%)\n",
+                       recorded, winner >= 0 ? "braço promovido recebe todas as novas" : "em teste");
+    if (length >= out_len) length = out_len - 1;
+    length += snprintf(out + length, out_len - length,
+                       "braço     peso atribuídas encerradas |   thr kbps ±IC95           p50      p90 | RTT cli ms ±IC95  | RTT srv ms ±IC95  | retr %% ±IC95\n");
+    if (length >= out_len) length = out_len - 1;
+
+    for (int i = 0; i < settings.arm_count && length < out_len - 1; i++) {
+        const ArmStats *stats = &arm_stats[i];
+        size_t kept = stats->throughput.count < EXPERIMENT_RESERVOIR ? stats->throughput.count : EXPERIMENT_RESERVOIR;
+        double p50 = 0, p90 = 0;
+
+        if (kept > 0) {
+            memcpy(sorted, stats->reservoir, kept * sizeof(float));
+            qsort(sorted, kept, sizeof(float), compare_float);
+            p50 = sorted[(kept - 1) * 50 / 100];
+            p90 = sorted[(kept - 1) * 90 / 100];
+        }
+
+        length += snprintf(out + length, out_len - length,
+                           "%-8s %5d %10lu %10lu | %10.1f ±%-9.1f %8.0f %8.0f | %8.2f ±%-7.2f | %8.2f ±%-7.2f | %6.3f ±%.3f%s\n",
+                           experiment_arm_name(i), settings.arms[i].weight,
+                           __atomic_load_n(&stats->assigned, __ATOMIC_RELAXED), stats->throughput.count,
+                           stats->throughput.mean, running_ci(&stats->throughput), p50, p90,
+                           stats->rtt_client.mean, running_ci(&stats->rtt_client),
+                           stats->rtt_server.mean, running_ci(&stats->rtt_server), stats->retrans.mean, running_ci(&stats->retrans),
+                           i == winner ? "  <- promovido" : "");
+        if (length >= out_len) length = out_len - 1;
+    }
+
+    pthread_mutex_unlock(&stats_lock);
+    return length;
+}
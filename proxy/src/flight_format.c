@@ -0,0 +1,24 @@
+#include "../include/flight_format.h"
+
+static const char *event_names[FLIGHT_EVENT_TYPES] = {
+    "?", "accept", "connect", "conectado", "leitura", "envio", "bloqueado", "liberado",
+    "pausado", "retomado", "fin", "buffer", "pacing", "parada", "encerrada"
+};
+
+static const char *side_names[] = { "-", "cliente", "servidor" };
+
+static const char *close_reason_names[FLIGHT_CLOSE_REASONS] = {
+    "desconhecida", "fim normal", "erro de socket", "connect falhou", "ociosa", "falha interna", "recusada"
+};
+
+const char* flight_event_name(int type) {
+    return type > 0 && type < FLIGHT_EVENT_TYPES ? event_names[type] : "?";
+}
+
+const char* flight_side_name(int side) {
+    return side >= FLIGHT_SIDE_NONE && side <= FLIGHT_SIDE_SERVER ? side_names[side] : "?";
+}
+
+const char* flight_close_reason_name(int reason) {
+    return reason >= 0 && reason < FLIGHT_CLOSE_REASONS ? close_reason_names[reason] : "?";
+}
@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "../include/flight_recorder.h"
+#include "../include/latency_stats.h"
+#include "../include/tcp_monitor.h"
+#include "../include/thread_slots.h"
+
+#define FLIGHT_RING_MASK (FLIGHT_RING_EVENTS - 1)
+
+// Anel de uma thread: só ela escreve; head é publicado depois do evento (o leitor nunca vê um evento pela metade)
+typedef struct {
+    FlightEvent events[FLIGHT_RING_EVENTS];
+    uint64_t head;          // Eventos já gravados; o próximo vai em head & FLIGHT_RING_MASK
+    int shared;             // 1 = anel de excesso, escrito por várias threads (posição reservada com soma atômica)
+} FlightRing;
+
+static FlightRing overflow_ring = { .shared = 1 };
+// O anel de uma thread que terminou guarda a história dela até ser reusado
+static ThreadSlots flight_rings = THREAD_SLOTS_INITIALIZER(FlightRing, FLIGHT_MAX_RINGS, &overflow_ring);
+
+static FlightConfig settings;
+static int enabled = 0;
+static int dump_pipe[2] = { -1, -1 };       // O sinal e as paradas só escrevem um byte; a thread de despejo faz o resto
+static uint64_t last_stall_dump_ms = 0;     // Atômico: limita os despejos automáticos
+static pthread_t dump_thread;
+
+static __thread FlightRing *thread_ring = NULL;
+static __thread unsigned long current_connection = 0;
+static __thread int current_client_fd = -1;
+static __thread int current_server_fd = -1;
+
+void flight_record_at(uint64_t timestamp_ns, unsigned long connection_id, FlightEventType type, FlightSide side, int error, int64_t value) {
+    if (!enabled) return;
+    if (!thread_ring) thread_ring = thread_slots_acquire(&flight_rings);
+
+    FlightRing *ring = thread_ring;
+    uint64_t index = ring->shared ? __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED) : ring->head;
+    FlightEvent *event = &ring->events[index & FLIGHT_RING_MASK];
+
+    event->timestamp_ns = timestamp_ns;
+    event->connection_id = connection_id;
+    event->type = (uint16_t)type;
+    event->side = (uint8_t)side;
+    event->reserved = 0;
+    event->error = error;
+    event->value = value;
+
+    // O novo head só aparece para o despejo depois do evento completo
+    if (!ring->shared) __atomic_store_n(&ring->head, index + 1, __ATOMIC_RELEASE);
+}
+
+void flight_record(unsigned long connection_id, FlightEventType type, FlightSide side, int error, int64_t value) {
+    if (!enabled) return;
+    flight_record_at(latency_now_ns(), connection_id, type, side, error, value);
+}
+
+void flight_recorder_enter(unsigned long connection_id, int client_fd, int server_fd) {
+    current_connection = connection_id;
+    current_client_fd = client_fd;
+    current_server_fd = server_fd;
+}
+
+void flight_recorder_leave(void) {
+    current_connection = 0;
+}
+
+void flight_record_socket(FlightEventType type, int sock_fd, int error, int64_t value) {
+    if (!enabled || !current_connection) return;
+
+    FlightSide side = sock_fd == current_client_fd ? FLIGHT_SIDE_CLIENT : sock_fd == current_server_fd ? FLIGHT_SIDE_SERVER : FLIGHT_SIDE_NONE;
+    flight_record(current_connection, type, side, error, value);
+}
+
+// Pede um despejo à thread de escrita (async-signal-safe; pipe cheio = já há um pedido pendente)
+static void flight_request_dump(FlightDumpReason reason) {
+    unsigned char byte = (unsigned char)reason;
+    int saved_errno = errno;
+
+    if (dump_pipe[1] >= 0 && write(dump_pipe[1], &byte, 1) < 0) {
+        // Nada a fazer: o pedido anterior ainda não foi atendido
+    }
+    errno = saved_errno;
+}
+
+int flight_recorder_stall(unsigned long connection_id, FlightSide side, uint64_t blocked_ns) {
+    if (!enabled || settings.stall_ms <= 0 || blocked_ns < (uint64_t)settings.stall_ms * 1000000ULL) return 0;
+
+    flight_record(connection_id, FLIGHT_EVENT_STALL, side, 0, (int64_t)blocked_ns);
+
+    // Uma parada da rede atinge muitas conexões ao mesmo tempo: um despejo cobre todas
+    uint64_t now = get_monotonic_ms();
+    uint64_t last = __atomic_load_n(&last_stall_dump_ms, __ATOMIC_RELAXED);
+
+    if ((last == 0 || now - last >= FLIGHT_DUMP_MIN_INTERVAL_MS) &&
+        __atomic_compare_exchange_n(&last_stall_dump_ms, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        flight_request_dump(FLIGHT_DUMP_STALL);
+    }
+
+    return 1;
+}
+
+void flight_release_thread_ring(void) {
+    if (!thread_ring) return;
+
+    thread_slots_release(&flight_rings, thread_ring);
+    thread_ring = NULL;
+}
+
+/**
+ * Copia os eventos do anel sem parar o escritor: o que ele sobrescreveu durante a cópia (e o evento que
+ * está escrevendo) é descartado pelo head relido no fim. No anel de excesso, um evento reservado e ainda
+ * não escrito pode sair com o conteúdo antigo (só com mais de FLIGHT_MAX_RINGS threads gravando)
+ * @return Eventos válidos, a partir de *first_out em copy
+ */
+static size_t flight_snapshot(FlightRing *ring, FlightEvent *copy, size_t *first_out) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > FLIGHT_RING_EVENTS ? head - FLIGHT_RING_EVENTS : 0;
+
+    for (uint64_t i = first; i < head; i++) copy[i - first] = ring->events[i & FLIGHT_RING_MASK];
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t after = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint64_t valid = after + 1 > FLIGHT_RING_EVENTS ? after + 1 - FLIGHT_RING_EVENTS : 0;
+
+    if (valid >= head) return 0;
+    if (valid < first) valid = first;
+
+    *first_out = (size_t)(valid - first);
+    return (size_t)(head - valid);
+}
+
+static void flight_dump(FlightDumpReason reason, FlightEvent *copy) {
+    FlightDumpHeader header;
+    char path[128];
+    int ring_count;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = FLIGHT_MAGIC;
+    header.version = FLIGHT_VERSION;
+    header.event_size = sizeof(FlightEvent);
+    header.reason = reason;
+    header.dumped_ns = latency_now_ns();
+    header.dumped_wall_ms = get_timestamp_ms();
+
+    mkdir("logs", 0755); // Mesmo diretório dos logs de métricas, ignora erro se já existir
+    snprintf(path, sizeof(path), FLIGHT_FILE_PREFIX "%llu.bin", (unsigned long long)header.dumped_wall_ms);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror("[Voo] Erro ao criar o arquivo do despejo");
+        return;
+    }
+
+    // O total só é conhecido no fim: o cabeçalho é reescrito depois dos eventos
+    fwrite(&header, sizeof(header), 1, file);
+
+    ring_count = thread_slots_snapshot(&flight_rings, NULL);
+
+    for (int i = 0; i <= ring_count; i++) {
+        FlightRing *ring = i < ring_count ? flight_rings.items[i] : &overflow_ring;
+        size_t first = 0;
+        size_t count = flight_snapshot(ring, copy, &first);
+
+        // Posições reservadas do anel de excesso que nunca chegaram a ser escritas
+        size_t written = 0;
+        for (size_t j = first; j < first + count; j++) {
+            if (copy[j].timestamp_ns) copy[first + written++] = copy[j];
+        }
+
+        if (written == 0) continue;
+        fwrite(copy + first, sizeof(FlightEvent), written, file);
+        header.event_count += written;
+        header.ring_count++;
+    }
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+
+    if (fclose(file) != 0) {
+        perror("[Voo] Erro ao gravar o despejo");
+        return;
+    }
+
+    printf("[Voo] %llu eventos de %u anéis despejados em %s (%s)\n", (unsigned long long)header.event_count, header.ring_count,
+           path, reason == FLIGHT_DUMP_SIGNAL ? "SIGUSR2" : "parada de destino");
+}
+
+static void* flight_dump_main(void *args) {
+    (void)args;
+
+    FlightEvent *copy = malloc(sizeof(FlightEvent) * FLIGHT_RING_EVENTS);
+    unsigned char requests[16];
+
+    if (!copy) {
+        perror("[Voo] Erro ao alocar a cópia dos anéis");
+        return NULL;
+    }
+
+    while (1) {
+        ssize_t count = read(dump_pipe[0], requests, sizeof(requests));
+
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) continue;
+            break;
+        }
+
+        // Pedidos acumulados viram um despejo só (o sinal tem prioridade no nome do motivo)
+        FlightDumpReason reason = FLIGHT_DUMP_STALL;
+        for (ssize_t i = 0; i < count; i++) {
+            if (requests[i] == FLIGHT_DUMP_SIGNAL) reason = FLIGHT_DUMP_SIGNAL;
+        }
+
+        flight_dump(reason, copy);
+    }
+
+    free(copy);
+    return NULL;
+}
+
+static void flight_signal_handler(int signal_number) {
+    (void)signal_number;
+    flight_request_dump(FLIGHT_DUMP_SIGNAL);
+}
+
+int flight_recorder_start(const FlightConfig *config) {
+    settings = *config;
+    if (!settings.enabled) return 0;
+
+    if (pipe2(dump_pipe, O_CLOEXEC) < 0) {
+        perror("[Voo] Erro ao criar o pipe de despejo");
+        return -1;
+    }
+
+    // Só a escrita é não-bloqueante: quem pede nunca espera; a thread dorme no read
+    fcntl(dump_pipe[1], F_SETFL, fcntl(dump_pipe[1], F_GETFL, 0) | O_NONBLOCK);
+
+    if (pthread_create(&dump_thread, NULL, flight_dump_main, NULL) != 0) {
+        perror("Erro ao criar thread do gravador de voo");
+        close(dump_pipe[0]);
+        close(dump_pipe[1]);
+        dump_pipe[0] = dump_pipe[1] = -1;
+        return -1;
+    }
+
+    pthread_detach(dump_thread);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = flight_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, NULL);
+
+    enabled = 1;
+    return 0;
+}
+
+int flight_recorder_enabled(void) {
+    return enabled;
+}
@@ -0,0 +1,19 @@
+#include "../include/hdr_histogram.h"
+
+int hdr_index(uint64_t value) {
+    if (value < HDR_SUB_BUCKETS) return (int)value;
+
+    // Desloca até o valor caber em [HDR_HALF_BUCKETS, HDR_SUB_BUCKETS)
+    int shift = (63 - __builtin_clzll(value)) - (HDR_SUB_BITS - 1);
+    if (shift > HDR_MAX_SHIFT) return HDR_BUCKETS - 1;
+
+    return HDR_SUB_BUCKETS + (shift - 1) * HDR_HALF_BUCKETS + (int)((value >> shift) - HDR_HALF_BUCKETS);
+}
+
+uint64_t hdr_value(int index) {
+    if (index < HDR_SUB_BUCKETS) return (uint64_t)index;
+
+    int shift = (index - HDR_SUB_BUCKETS) / HDR_HALF_BUCKETS + 1;
+    uint64_t mantissa = (uint64_t)((index - HDR_SUB_BUCKETS) % HDR_HALF_BUCKETS + HDR_HALF_BUCKETS);
+    return (mantissa << shift) + (1ULL << (shift - 1));
+}
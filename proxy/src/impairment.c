@@ -0,0 +1,249 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "../include/impairment.h"
+
+// Presets equivalentes aos comandos tc/netem dos cenários do README (aplicados na saída do servidor)
+typedef struct {
+    const char *name;
+    double delay_ms;
+    double jitter_ms;
+    JitterDistribution distribution;
+    double loss_percent;
+    double rate_kbit;
+    size_t burst_bytes;
+} ImpairmentPreset;
+
+static const ImpairmentPreset presets[] = {
+    { "ideal",    0,   0,  JITTER_UNIFORM, 0, 0,    0 },
+    { "leve",     50,  0,  JITTER_UNIFORM, 1, 0,    0 },    // netem delay 50ms loss 1%
+    { "moderado", 100, 0,  JITTER_UNIFORM, 2, 0,    0 },    // netem delay 100ms loss 2%
+    { "gargalo",  0,   0,  JITTER_UNIFORM, 0, 5000, 4096 }, // tbf rate 5mbit burst 32kbit
+    { "long",     200, 0,  JITTER_UNIFORM, 0, 0,    0 },    // netem delay 200ms
+    { "caotica",  100, 50, JITTER_NORMAL,  5, 0,    0 },    // netem delay 100ms 50ms distribution normal loss 5%
+};
+
+static void impairment_params_clear(ImpairmentParams *params) {
+    memset(params, 0, sizeof(*params));
+    params->stall_ms = IMPAIR_DEFAULT_STALL_MS;
+    params->burst_bytes = IMPAIR_DEFAULT_BURST;
+}
+
+int impairment_apply_preset(ImpairmentConfig *config, const char *name) {
+    // Aceita "caótica" com acento, como no README
+    const char *lookup = strcmp(name, "caótica") == 0 ? "caotica" : name;
+
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        const ImpairmentPreset *preset = &presets[i];
+        if (strcmp(preset->name, lookup) != 0) continue;
+
+        impairment_params_clear(&config->up);
+        impairment_params_clear(&config->down);
+
+        config->down.delay_ms = preset->delay_ms;
+        config->down.jitter_ms = preset->jitter_ms;
+        config->down.distribution = preset->distribution;
+        config->down.loss_rate = preset->loss_percent / 100.0;
+        config->down.rate_bytes_sec = preset->rate_kbit * 1000.0 / 8.0;
+        if (preset->burst_bytes > 0) config->down.burst_bytes = preset->burst_bytes;
+
+        config->preset = preset->name;
+        config->enabled = 1;
+        return 0;
+    }
+
+    return -1;
+}
+
+int impairment_parse_spec(ImpairmentParams *params, const char *spec) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", spec);
+
+    impairment_params_clear(params);
+
+    char *saveptr = NULL;
+    for (char *item = strtok_r(buffer, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(item, '=');
+        if (!value) return -1;
+        *value++ = '\0';
+
+        char *end;
+        double number = strtod(value, &end);
+
+        if (strcmp(item, "dist") == 0) {
+            if (strcmp(value, "uniform") == 0) params->distribution = JITTER_UNIFORM;
+            else if (strcmp(value, "normal") == 0) params->distribution = JITTER_NORMAL;
+            else return -1;
+            continue;
+        }
+
+        if (end == value || *end != '\0' || number < 0) return -1;
+
+        if (strcmp(item, "delay") == 0) params->delay_ms = number;
+        else if (strcmp(item, "jitter") == 0) params->jitter_ms = number;
+        else if (strcmp(item, "loss") == 0 && number <= 100) params->loss_rate = number / 100.0;
+        else if (strcmp(item, "stall") == 0) params->stall_ms = number;
+        else if (strcmp(item, "rate") == 0) params->rate_bytes_sec = number * 1000.0 / 8.0;
+        else if (strcmp(item, "burst") == 0 && number >= 1) params->burst_bytes = (size_t)number;
+        else return -1;
+    }
+
+    return 0;
+}
+
+int impairment_params_active(const ImpairmentParams *params) {
+    return params->delay_ms > 0 || params->jitter_ms > 0 || params->loss_rate > 0 || params->rate_bytes_sec > 0;
+}
+
+void impairment_describe(const ImpairmentParams *params, char *out, size_t out_len) {
+    if (!impairment_params_active(params)) {
+        snprintf(out, out_len, "sem efeito");
+        return;
+    }
+
+    int used = snprintf(out, out_len, "atraso %.0f ms", params->delay_ms);
+
+    if (params->jitter_ms > 0 && used < (int)out_len) {
+        used += snprintf(out + used, out_len - used, " ± %.0f ms (%s)", params->jitter_ms,
+                         params->distribution == JITTER_NORMAL ? "normal" : "uniforme");
+    }
+    if (params->loss_rate > 0 && used < (int)out_len) {
+        used += snprintf(out + used, out_len - used, ", perda %.1f%% (parada de %.0f ms)", params->loss_rate * 100.0, params->stall_ms);
+    }
+    if (params->rate_bytes_sec > 0 && used < (int)out_len) {
+        snprintf(out + used, out_len - used, ", taxa %.0f kbit/s (rajada %zu B)", params->rate_bytes_sec * 8.0 / 1000.0, params->burst_bytes);
+    }
+}
+
+uint64_t impairment_now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000;
+}
+
+// splitmix64: rápido e com a mesma sequência em qualquer máquina para a mesma semente
+static uint64_t impairment_next(ImpairmentState *state) {
+    uint64_t value = (state->rng += 0x9E3779B97F4A7C15ULL);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Uniforme em [0, 1)
+static double impairment_uniform(ImpairmentState *state) {
+    return (impairment_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double impairment_jitter_ms(ImpairmentState *state) {
+    const ImpairmentParams *params = &state->params;
+    if (params->jitter_ms <= 0) return 0.0;
+
+    if (params->distribution == JITTER_NORMAL) {
+        // Box-Muller
+        double u1 = impairment_uniform(state);
+        double u2 = impairment_uniform(state);
+        if (u1 < 1e-12) u1 = 1e-12;
+        return params->jitter_ms * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+
+    return params->jitter_ms * (2.0 * impairment_uniform(state) - 1.0);
+}
+
+void impairment_state_init(ImpairmentState *state, const ImpairmentParams *params, uint64_t seed) {
+    memset(state, 0, sizeof(*state));
+    state->params = *params;
+    state->rng = seed;
+    state->tokens = (double)params->burst_bytes;
+    state->last_refill_us = impairment_now_us();
+}
+
+int impairment_can_enqueue(const ImpairmentState *state) {
+    return state->segment_count < IMPAIR_MAX_SEGMENTS;
+}
+
+void impairment_enqueue(ImpairmentState *state, size_t length, uint64_t now_us) {
+    double delay_ms = state->params.delay_ms + impairment_jitter_ms(state);
+
+    // Bloco "perdido": chega só depois da retransmissão emulada (descartar bytes corromperia o fluxo TCP)
+    if (state->params.loss_rate > 0 && impairment_uniform(state) < state->params.loss_rate) {
+        delay_ms += state->params.stall_ms;
+        state->losses++;
+    }
+
+    if (delay_ms < 0) delay_ms = 0;
+
+    // Como no TCP, a entrega é em ordem: o jitter atrasa os blocos seguintes (head-of-line)
+    uint64_t release_us = now_us + (uint64_t)(delay_ms * 1000.0);
+    if (release_us < state->last_release_us) release_us = state->last_release_us;
+    state->last_release_us = release_us;
+
+    size_t index = (state->segment_head + state->segment_count) % IMPAIR_MAX_SEGMENTS;
+    state->segments[index].release_us = release_us;
+    state->segments[index].length = length;
+    state->segment_count++;
+}
+
+static void impairment_refill(ImpairmentState *state, uint64_t now_us) {
+    if (state->params.rate_bytes_sec <= 0) return;
+
+    state->tokens += (now_us - state->last_refill_us) * state->params.rate_bytes_sec / 1e6;
+    if (state->tokens > state->params.burst_bytes) state->tokens = (double)state->params.burst_bytes;
+    state->last_refill_us = now_us;
+}
+
+size_t impairment_sendable(ImpairmentState *state, uint64_t now_us) {
+    size_t released = 0;
+
+    for (size_t i = 0; i < state->segment_count; i++) {
+        const ImpairSegment *segment = &state->segments[(state->segment_head + i) % IMPAIR_MAX_SEGMENTS];
+        if (segment->release_us > now_us) break;
+        released += segment->length;
+    }
+
+    if (state->params.rate_bytes_sec > 0) {
+        impairment_refill(state, now_us);
+        size_t allowed = state->tokens > 0 ? (size_t)state->tokens : 0;
+        if (released > allowed) released = allowed;
+    }
+
+    return released;
+}
+
+void impairment_consume(ImpairmentState *state, size_t length) {
+    if (state->params.rate_bytes_sec > 0) state->tokens -= (double)length;
+
+    while (length > 0 && state->segment_count > 0) {
+        ImpairSegment *segment = &state->segments[state->segment_head];
+        size_t used = length < segment->length ? length : segment->length;
+
+        segment->length -= used;
+        length -= used;
+
+        if (segment->length == 0) {
+            state->segment_head = (state->segment_head + 1) % IMPAIR_MAX_SEGMENTS;
+            state->segment_count--;
+        }
+    }
+}
+
+int impairment_wait_ms(ImpairmentState *state, uint64_t now_us) {
+    if (state->segment_count == 0) return -1;
+
+    uint64_t ready_us = state->segments[state->segment_head].release_us;
+
+    // Sem tokens para um byte: espera a reposição do balde
+    if (state->params.rate_bytes_sec > 0) {
+        impairment_refill(state, now_us);
+
+        if (state->tokens < 1.0) {
+            uint64_t refill_us = now_us + (uint64_t)((1.0 - state->tokens) * 1e6 / state->params.rate_bytes_sec);
+            if (refill_us > ready_us) ready_us = refill_us;
+        }
+    }
+
+    if (ready_us <= now_us) return 0;
+    return (int)((ready_us - now_us + 999) / 1000);
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../include/latency_profile.h"
+
+void latency_apply_listener(int listen_fd, const ProxyConfig *config) {
+    // O Fast Open da escuta só aceita dados que vierem no SYN: quem não os envia não espera nada
+    if (config->latency_profile) {
+        int queue = LATENCY_FASTOPEN_QUEUE;
+        if (setsockopt(listen_fd, IPPROTO_TCP, TCP_FASTOPEN, &queue, sizeof(queue)) < 0) {
+            perror("[Latência] Erro ao ativar TCP_FASTOPEN no socket de escuta");
+        }
+    }
+
+    if (config->client_first) {
+        int defer_s = LATENCY_DEFER_ACCEPT_S;
+        if (setsockopt(listen_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer_s, sizeof(defer_s)) < 0) {
+            perror("[Latência] Erro ao ativar TCP_DEFER_ACCEPT");
+        }
+    }
+}
+
+void latency_apply_upstream(int server_socket, const ProxyConfig *config) {
+    if (!config->client_first) return;
+
+    #ifdef TCP_FASTOPEN_CONNECT
+        int enable = 1;
+        setsockopt(server_socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &enable, sizeof(enable));
+    #endif
+}
+
+void latency_apply_socket(int sock_fd, const ProxyConfig *config) {
+    if (!config->latency_profile) return;
+
+    int enable = 1;
+    setsockopt(sock_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    #ifdef TCP_NOTSENT_LOWAT
+        int lowat = config->notsent_lowat;
+        if (lowat > 0) setsockopt(sock_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+    #endif
+}
+
+void latency_quickack(int sock_fd) {
+    int enable = 1;
+    setsockopt(sock_fd, IPPROTO_TCP, TCP_QUICKACK, &enable, sizeof(enable));
+}
+
+int latency_fastopen_sysctl(void) {
+    FILE *sysctl = fopen("/proc/sys/net/ipv4/tcp_fastopen", "r");
+    if (!sysctl) return -1;
+
+    int value = -1;
+    if (fscanf(sysctl, "%d", &value) != 1) value = -1;
+    fclose(sysctl);
+    return value;
+}
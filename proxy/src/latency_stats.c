@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../include/latency_stats.h"
+#include "../include/hdr_histogram.h"
+#include "../include/thread_slots.h"
+#include "../include/experiment.h"
+
+typedef struct {
+    unsigned long counts[HDR_BUCKETS];
+    unsigned long total;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} LatencyHistogram;
+
+// Histogramas de uma thread. Contagens só crescem: o leitor soma sem parar os escritores
+typedef struct {
+    LatencyHistogram histograms[LATENCY_METRICS];
+    int shared;             // 1 = vaga de excesso, escrita por várias threads (somas atômicas)
+} LatencySlot;
+
+static LatencySlot overflow_slot = { .shared = 1 };
+static ThreadSlots latency_slots = THREAD_SLOTS_INITIALIZER(LatencySlot, LATENCY_MAX_SLOTS, &overflow_slot);
+static int enabled = 0;
+static int listen_fd = -1;
+static pthread_t endpoint_thread;
+
+static __thread LatencySlot *thread_slot = NULL;
+
+static const char *metric_names[LATENCY_METRICS] = { "connect", "ttfb", "relay" };
+
+uint64_t latency_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void latency_record(LatencyMetric metric, uint64_t value_ns) {
+    if (!thread_slot) thread_slot = thread_slots_acquire(&latency_slots);
+
+    LatencyHistogram *histogram = &thread_slot->histograms[metric];
+    int index = hdr_index(value_ns);
+
+    if (thread_slot->shared) {
+        __atomic_add_fetch(&histogram->counts[index], 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&histogram->total, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&histogram->sum_ns, value_ns, __ATOMIC_RELAXED);
+
+        uint64_t max = __atomic_load_n(&histogram->max_ns, __ATOMIC_RELAXED);
+        while (value_ns > max && !__atomic_compare_exchange_n(&histogram->max_ns, &max, value_ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        return;
+    }
+
+    // Escritor único: store simples (sem lock no barramento), só para o leitor nunca ver um valor rasgado
+    __atomic_store_n(&histogram->counts[index], histogram->counts[index] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->total, histogram->total + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->sum_ns, histogram->sum_ns + value_ns, __ATOMIC_RELAXED);
+    if (value_ns > histogram->max_ns) __atomic_store_n(&histogram->max_ns, value_ns, __ATOMIC_RELAXED);
+}
+
+void latency_summary_add(LatencySummary *summary, uint64_t value_ns) {
+    summary->count++;
+    summary->total_ns += value_ns;
+    if (value_ns > summary->max_ns) summary->max_ns = value_ns;
+}
+
+void latency_release_thread_slot(void) {
+    if (!thread_slot) return;
+
+    thread_slots_release(&latency_slots, thread_slot);
+    thread_slot = NULL;
+}
+
+static void latency_merge(LatencyHistogram *into, const LatencyHistogram *from) {
+    for (int i = 0; i < HDR_BUCKETS; i++) into->counts[i] += __atomic_load_n(&from->counts[i], __ATOMIC_RELAXED);
+    into->sum_ns += __atomic_load_n(&from->sum_ns, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&from->max_ns, __ATOMIC_RELAXED);
+    if (max > into->max_ns) into->max_ns = max;
+}
+
+static uint64_t latency_percentile(const LatencyHistogram *histogram, double percentile) {
+    if (histogram->total == 0) return 0;
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * histogram->total + 0.5);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= target) {
+            uint64_t value = hdr_value(i);
+            return value < histogram->max_ns ? value : histogram->max_ns;
+        }
+    }
+
+    return histogram->max_ns;
+}
+
+size_t latency_stats_format(char *out, size_t out_len) {
+    LatencyHistogram *merged = calloc(1, sizeof(LatencyHistogram));
+    size_t length = 0;
+    int slots_in_use = 0;
+
+    if (!merged) {
+        length = snprintf(out, out_len, "sem memória para somar os histogramas\n");
+        return length < out_len ? length : out_len - 1;
+    }
+
+    int slot_count = thread_slots_snapshot(&latency_slots, &slots_in_use);
+
+    length += snprintf(out + length, out_len - length, "# Latências adicionadas pelo proxy em µs (%d vagas de threads, %d em uso)\n",
+                       slot_count, slots_in_use);
+    if (length >= out_len) length = out_len - 1;
+    length += snprintf(out + length, out_len - length, "%-8s %10s %10s %10s %10s %10s %10s %10s\n",
+                       "medida", "amostras", "p50", "p90", "p99", "p99.9", "max", "media");
+    if (length >= out_len) length = out_len - 1;
+
+    for (int metric = 0; metric < LATENCY_METRICS && length < out_len - 1; metric++) {
+        memset(merged, 0, sizeof(LatencyHistogram));
+
+        for (int i = 0; i < slot_count; i++) latency_merge(merged, &((LatencySlot*)latency_slots.items[i])->histograms[metric]);
+        latency_merge(merged, &overflow_slot.histograms[metric]);
+
+        // O total sai da soma dos buckets: coerente com os percentis mesmo com escritas no meio da leitura
+        for (int i = 0; i < HDR_BUCKETS; i++) merged->total += merged->counts[i];
+
+        length += snprintf(out + length, out_len - length, "%-8s %10lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                           metric_names[metric], merged->total,
+                           latency_percentile(merged, 50) / 1000.0, latency_percentile(merged, 90) / 1000.0,
+                           latency_percentile(merged, 99) / 1000.0, latency_percentile(merged, 99.9) / 1000.0,
+                           merged->max_ns / 1000.0, merged->total ? merged->sum_ns / 1000.0 / merged->total : 0.0);
+        if (length >= out_len) length = out_len - 1;
+    }
+
+    free(merged);
+    return length;
+}
+
+// Uma consulta por vez: lê a requisição (se vier) e responde o relatório
+static void latency_serve(int client_fd) {
+    char request[1024];
+    char body[8192];
+    char header[256];
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = LATENCY_REQUEST_TIMEOUT_MS * 1000 };
+
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    ssize_t received = recv(client_fd, request, sizeof(request) - 1, 0);
+    size_t body_len = latency_stats_format(body, sizeof(body));
+
+    // Com --ab, a tabela dos braços vem logo depois das latências
+    if (experiment_enabled()) body_len += experiment_format(body + body_len, sizeof(body) - body_len);
+
+    // Requisição HTTP recebe cabeçalho (curl, navegador); conexão muda (nc) recebe só o texto
+    if (received > 0 && strncmp(request, "GET ", 4) == 0) {
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                                  body_len);
+        if (send(client_fd, header, header_len, MSG_NOSIGNAL) < 0) return;
+    }
+
+    send(client_fd, body, body_len, MSG_NOSIGNAL);
+}
+
+static void* latency_endpoint_main(void *args) {
+    (void)args;
+
+    while (1) {
+        int client_fd = accept(listen_fd, NULL, NULL);
+
+        if (client_fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) perror("[Latência] Erro no accept do endpoint");
+            continue;
+        }
+
+        latency_serve(client_fd);
+        close(client_fd);
+    }
+
+    return NULL;
+}
+
+int latency_stats_start(int port) {
+    if (port <= 0) return 0;
+
+    struct sockaddr_in address;
+    int opt = 1;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Só local: o relatório não sai da máquina
+
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("[Latência] Erro ao criar o socket do endpoint");
+        return -1;
+    }
+
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, LATENCY_STATS_BACKLOG) < 0) {
+        perror("[Latência] Erro ao abrir a porta do endpoint");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    if (pthread_create(&endpoint_thread, NULL, latency_endpoint_main, NULL) != 0) {
+        perror("Erro ao criar thread do endpoint de latências");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    pthread_detach(endpoint_thread);
+    enabled = 1;
+    return 0;
+}
+
+int latency_stats_enabled(void) {
+    return enabled;
+}
@@ -0,0 +1,84 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../include/listener.h"
+#include "../include/latency_profile.h"
+
+int listener_open(ProxyConfig *config, int reuseport) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0); // STREAM para conexão TCP
+
+    if (listen_fd < 0) {
+        perror("Erro ao criar socket");
+        return -1;
+    }
+
+    // Permite que o socket seja reutilizado imediatamente (bom para testes)
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // Cada worker tem seu próprio socket na mesma porta e o kernel distribui as conexões entre eles
+    if (reuseport && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("Erro ao ativar SO_REUSEPORT");
+        close(listen_fd);
+        return -1;
+    }
+
+    struct sockaddr_in proxy_address;
+    memset(&proxy_address, 0, sizeof(proxy_address));
+    proxy_address.sin_family = AF_INET;
+    proxy_address.sin_addr.s_addr = INADDR_ANY; // Escuta em todos os IPs locais
+    proxy_address.sin_port = htons(config->listen_port); // Porta
+
+    if (bind(listen_fd, (struct sockaddr *)&proxy_address, sizeof(proxy_address)) < 0) {
+        perror("Erro no bind");
+        close(listen_fd);
+        return -1;
+    }
+
+    latency_apply_listener(listen_fd, config);
+
+    // Backlog pequeno descarta SYNs em rajadas de conexões (o kernel ainda limita a net.core.somaxconn)
+    if (listen(listen_fd, config->listen_backlog) < 0) {
+        perror("Erro no listen");
+        close(listen_fd);
+        return -1;
+    }
+
+    return listen_fd;
+}
+
+int listener_set_incoming_cpu(int listen_fd, int cpu) {
+    if (setsockopt(listen_fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) < 0) {
+        perror("Erro ao definir SO_INCOMING_CPU");
+        return -1;
+    }
+
+    return 0;
+}
+
+int listener_worker_cpu(int worker_id) {
+    int cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count < 1) cpu_count = 1;
+
+    return worker_id % cpu_count;
+}
+
+int listener_pin_worker(int worker_id) {
+    int cpu = listener_worker_cpu(worker_id);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        fprintf(stderr, "Aviso: não foi possível fixar o worker %d na CPU %d\n", worker_id, cpu);
+        return -1;
+    }
+
+    return cpu;
+}
@@ -1,51 +1,233 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <arpa/inet.h>
 #include <sys/stat.h> // Para mkdir
 #include "../include/logs.h"
+#include "../include/metrics_format.h"
+#include "../include/tcp_monitor.h"
+#include "../include/thread_slots.h"
 
-FILE* open_log_file(const char* client_ip) {
-    char filename[256];
-    
-    // Garante que o diretório de logs exista
-    mkdir("logs", 0755); // Cria o diretório, ignora erro se já existir
+// Anel SPSC: só a thread dona escreve head, só a thread de escrita escreve tail
+typedef struct {
+    unsigned long head;
+    unsigned long tail;
+    MetricsRecord records[LOG_RING_CAPACITY];
+} LogRing;
+
+static ThreadSlots log_rings = THREAD_SLOTS_INITIALIZER(LogRing, LOG_MAX_RINGS, NULL);
+static unsigned long log_dropped = 0;
+static pthread_t log_writer_thread;
+static int log_started = 0;
+static LogFormat log_format = LOG_FORMAT_CSV;
+static const char *log_file_name = LOG_FILE_NAME;
+static unsigned long log_run_start_ms = 0;
+
+static __thread LogRing *thread_ring = NULL;
+
+void logs_submit(const MetricsRecord *record) {
+    if (!log_started) return;
+
+    if (!thread_ring) thread_ring = thread_slots_acquire(&log_rings);
+
+    LogRing *ring = thread_ring;
+
+    if (!ring) {
+        __atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    unsigned long head = ring->head;
+    unsigned long tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= LOG_RING_CAPACITY) {
+        __atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    ring->records[head & (LOG_RING_CAPACITY - 1)] = *record;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void logs_release_thread_ring(void) {
+    if (!thread_ring) return;
 
-    snprintf(filename, sizeof(filename), "logs/log_%s_%ld.csv", client_ip, time(NULL));
+    // Os registros pendentes continuam no anel e são escritos pela thread de escrita normalmente
+    thread_slots_release(&log_rings, thread_ring);
 
-    FILE *log_file = fopen(filename, "w"); // Abre arquivo de logs
+    thread_ring = NULL;
+}
+
+unsigned long logs_dropped_count(void) {
+    return __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+}
+
+// Abre o arquivo de log (anexando) e escreve o cabeçalho se ele estiver vazio
+static FILE* logs_open_file(void) {
+    // Garante que o diretório de logs exista
+    mkdir(LOG_DIR, 0755); // Cria o diretório, ignora erro se já existir
+
+    FILE *log_file = fopen(log_file_name, log_format == LOG_FORMAT_BINARY ? "ab" : "a");
 
     if (log_file == NULL) {
         perror("Erro ao abrir arquivo de log");
         return NULL;
     }
 
-    // Escreve o cabeçalho do CSV
-    fprintf(log_file, "TimestampMS,");
-    fprintf(log_file, "C2P_RTT_ms, C2P_RTTVAR_ms, C2P_Retrans, C2P_CWND, C2P_SSTHRESH, C2P_Throughput_kbps, C2P_Goodput_kbps,");
-    fprintf(log_file, "P2S_RTT_ms, P2S_RTTVAR_ms, P2S_Retrans, P2S_CWND, P2S_SSTHRESH, P2S_Throughput_kbps, P2S_Goodput_kbps\n");
-    
-    fflush(log_file); // Garante que o cabeçalho seja escrito
+    // Buffer grande: cada lote vira poucas chamadas de write()
+    setvbuf(log_file, NULL, _IOFBF, 1 << 20);
+
+    if (ftell(log_file) == 0 && log_format == LOG_FORMAT_BINARY) {
+        uint8_t header[METRICS_BIN_HEADER_SIZE];
+        metrics_bin_encode_header(header, log_run_start_ms);
+        fwrite(header, sizeof(header), 1, log_file);
+    } else if (ftell(log_file) == 0) {
+        fprintf(log_file, "ConnectionId,ClientIP,TimestampMS,");
+        fprintf(log_file, "C2P_RTT_ms, C2P_RTTVAR_ms, C2P_Retrans, C2P_CWND, C2P_SSTHRESH, C2P_Throughput_kbps, C2P_Goodput_kbps,");
+        fprintf(log_file, "P2S_RTT_ms, P2S_RTTVAR_ms, P2S_Retrans, P2S_CWND, P2S_SSTHRESH, P2S_Throughput_kbps, P2S_Goodput_kbps,");
+        fprintf(log_file, "C2P_DeliveryRate_kbps, C2P_MinRTT_ms, C2P_Retrans_kbps, C2P_NotSent_bytes, C2P_TotalRetrans, C2P_LimitedBy,");
+        fprintf(log_file, "P2S_DeliveryRate_kbps, P2S_MinRTT_ms, P2S_Retrans_kbps, P2S_NotSent_bytes, P2S_TotalRetrans, P2S_LimitedBy, Arm\n");
+    }
 
     return log_file;
 }
 
-void log_metrics_csv(FILE *log_file, ConnectionMetrics *metrics_client_proxy, ConnectionMetrics *metrics_proxy_server) {
-    if (log_file == NULL) return; // Early return
+// metrics.csv (ou .bin) -> metrics.csv.1 -> ... -> metrics.csv.LOG_ROTATE_KEEP (o mais antigo é apagado)
+static FILE* logs_rotate(FILE *log_file) {
+    char old_name[64];
+    char new_name[64];
 
-    fprintf(log_file, "%lu,", metrics_client_proxy->timestamp_ms); // Escreve timestamp
+    if (log_file) fclose(log_file);
 
-    // Escreve métricas da conexão Cliente <-> Proxy
-    fprintf(log_file, "%.3f,%.3f,%d,%d,%d,%.3f,%.3f,",
-            metrics_client_proxy->rtt_ms, metrics_client_proxy->rtt_var_ms, metrics_client_proxy->retransmits,
-            metrics_client_proxy->cwnd_segments, metrics_client_proxy->ssthresh, metrics_client_proxy->throughput_kbps, metrics_client_proxy->goodput_kbps);
-    
-    // Escreve métricas da conexão Proxy <-> Servidor
-    fprintf(log_file, "%.3f,%.3f,%d,%d,%d,%.3f,%.3f\n",
-            metrics_proxy_server->rtt_ms, metrics_proxy_server->rtt_var_ms, metrics_proxy_server->retransmits,
-            metrics_proxy_server->cwnd_segments, metrics_proxy_server->ssthresh, metrics_proxy_server->throughput_kbps, metrics_proxy_server->goodput_kbps);
-            
-    fflush(log_file); // Garante que os dados sejam escritos
+    for (int i = LOG_ROTATE_KEEP - 1; i >= 1; i--) {
+        snprintf(old_name, sizeof(old_name), "%s.%d", log_file_name, i);
+        snprintf(new_name, sizeof(new_name), "%s.%d", log_file_name, i + 1);
+        rename(old_name, new_name);
+    }
+
+    snprintf(new_name, sizeof(new_name), "%s.1", log_file_name);
+    rename(log_file_name, new_name);
+
+    return logs_open_file();
+}
+
+static void logs_copy_leg(MetricsBinLeg *leg, const ConnectionMetrics *metrics) {
+    leg->rtt_ms = (float)metrics->rtt_ms;
+    leg->rtt_var_ms = (float)metrics->rtt_var_ms;
+    leg->retransmits = (uint32_t)metrics->retransmits;
+    leg->cwnd_segments = (uint32_t)metrics->cwnd_segments;
+    leg->ssthresh = (uint32_t)metrics->ssthresh;
+    leg->throughput_kbps = (float)metrics->throughput_kbps;
+    leg->goodput_kbps = (float)metrics->goodput_kbps;
+    leg->delivery_rate_kbps = (float)(metrics->delivery_rate_bytes_sec * 8.0 / 1000.0);
+    leg->min_rtt_ms = (float)metrics->min_rtt_ms;
+    leg->retrans_kbps = (float)metrics->retrans_kbps;
+    leg->notsent_bytes = metrics->notsent_bytes;
+    leg->total_retrans = metrics->total_retrans;
+    leg->limited_by = (uint8_t)metrics->limited_by;
+}
+
+// Registro binário de tamanho fixo (128 bytes contra ~250 da linha CSV)
+static void logs_write_binary(FILE *log_file, const MetricsRecord *record) {
+    MetricsBinRecord binary;
+    uint8_t buffer[METRICS_BIN_RECORD_SIZE];
+
+    binary.connection_id = record->connection_id;
+    binary.timestamp_ms = record->client_proxy.timestamp_ms;
+    memset(binary.client_ip, 0, sizeof(binary.client_ip));
+    inet_pton(AF_INET, record->client_ip, binary.client_ip);
+    binary.arm = (uint8_t)record->arm;
+    logs_copy_leg(&binary.client_proxy, &record->client_proxy);
+    logs_copy_leg(&binary.proxy_server, &record->proxy_server);
+
+    metrics_bin_encode_record(buffer, &binary);
+    fwrite(buffer, sizeof(buffer), 1, log_file);
+}
+
+static void logs_write_record(FILE *log_file, const MetricsRecord *record) {
+    const ConnectionMetrics *c2p = &record->client_proxy;
+    const ConnectionMetrics *p2s = &record->proxy_server;
+
+    if (log_format == LOG_FORMAT_BINARY) {
+        logs_write_binary(log_file, record);
+        return;
+    }
+
+    fprintf(log_file, "%lu,%s,%lu,"
+                      "%.3f,%.3f,%d,%d,%d,%.3f,%.3f,"
+                      "%.3f,%.3f,%d,%d,%d,%.3f,%.3f,"
+                      "%.3f,%.3f,%.3f,%u,%u,%s,"
+                      "%.3f,%.3f,%.3f,%u,%u,%s,%s\n",
+            record->connection_id, record->client_ip, c2p->timestamp_ms,
+            c2p->rtt_ms, c2p->rtt_var_ms, c2p->retransmits, c2p->cwnd_segments, c2p->ssthresh, c2p->throughput_kbps, c2p->goodput_kbps,
+            p2s->rtt_ms, p2s->rtt_var_ms, p2s->retransmits, p2s->cwnd_segments, p2s->ssthresh, p2s->throughput_kbps, p2s->goodput_kbps,
+            c2p->delivery_rate_bytes_sec * 8.0 / 1000.0, c2p->min_rtt_ms, c2p->retrans_kbps, c2p->notsent_bytes, c2p->total_retrans,
+            metrics_limited_code((uint8_t)c2p->limited_by),
+            p2s->delivery_rate_bytes_sec * 8.0 / 1000.0, p2s->min_rtt_ms, p2s->retrans_kbps, p2s->notsent_bytes, p2s->total_retrans,
+            metrics_limited_code((uint8_t)p2s->limited_by), metrics_arm_code((uint8_t)record->arm));
+}
+
+// Esvazia todos os anéis no arquivo
+// @return Número de registros escritos
+static int logs_drain(FILE *log_file) {
+    int written = 0;
+
+    int ring_count = thread_slots_snapshot(&log_rings, NULL);
+
+    for (int i = 0; i < ring_count; i++) {
+        LogRing *ring = log_rings.items[i];
+        unsigned long tail = ring->tail;
+        unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        for (; tail != head; tail++) {
+            if (log_file) logs_write_record(log_file, &ring->records[tail & (LOG_RING_CAPACITY - 1)]);
+            written++;
+        }
+
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    return written;
+}
+
+static void* logs_writer_main(void *args) {
+    (void)args;
+
+    // Cada execução começa um arquivo novo (os ids de conexão recomeçam em 1)
+    struct stat log_stat;
+    FILE *log_file = (stat(log_file_name, &log_stat) == 0 && log_stat.st_size > 0) ? logs_rotate(NULL) : logs_open_file();
+
+    while (1) {
+        usleep(LOG_FLUSH_INTERVAL_MS * 1000);
+
+        // Um flush por lote, nunca por amostra
+        if (logs_drain(log_file) > 0 && log_file) {
+            fflush(log_file);
+
+            if (ftell(log_file) >= LOG_ROTATE_BYTES) log_file = logs_rotate(log_file);
+        }
+    }
+
+    return NULL;
+}
+
+int logs_start(ProxyConfig *config) {
+    log_format = config->log_format;
+    log_file_name = log_format == LOG_FORMAT_BINARY ? LOG_BIN_FILE_NAME : LOG_FILE_NAME;
+    log_run_start_ms = get_timestamp_ms();
+
+    if (pthread_create(&log_writer_thread, NULL, logs_writer_main, NULL) != 0) {
+        perror("Erro ao criar thread de escrita dos logs");
+        return -1;
+    }
+
+    pthread_detach(log_writer_thread);
+    log_started = 1;
+    return 0;
 }
 
 void display_metrics_text(ConnectionMetrics *metrics_client_proxy, ConnectionMetrics *metrics_proxy_server) {
@@ -62,8 +244,17 @@ void display_metrics_text(ConnectionMetrics *metrics_client_proxy, ConnectionMet
     printf("| Retransmissões        | %-18d | %-17d |\n", metrics_client_proxy->retransmits, metrics_proxy_server->retransmits);
     printf("| CWND (segmentos)      | %-18d | %-17d |\n", metrics_client_proxy->cwnd_segments, metrics_proxy_server->cwnd_segments);
     printf("| ssthresh (threshold)  | %-18d | %-17d |\n", metrics_client_proxy->ssthresh, metrics_proxy_server->ssthresh);
-    printf("| Throughput (Kbps)     | %-18.3f | %-17.3f |\n", metrics_client_proxy->throughput_kbps, metrics_proxy_server->throughput_kbps);
+    printf("| Enviado (Kbps)        | %-18.3f | %-17.3f |\n", metrics_client_proxy->throughput_kbps, metrics_proxy_server->throughput_kbps);
+    printf("| Recebido (Kbps)       | %-18.3f | %-17.3f |\n", metrics_client_proxy->received_kbps, metrics_proxy_server->received_kbps);
     printf("| Goodput (Kbps)        | %-18.3f | %-17.3f |\n", metrics_client_proxy->goodput_kbps, metrics_proxy_server->goodput_kbps);
+    printf("| Retransmitido (Kbps)  | %-18.3f | %-17.3f |\n", metrics_client_proxy->retrans_kbps, metrics_proxy_server->retrans_kbps);
+    printf("| Delivery rate (Kbps)  | %-18.3f | %-17.3f |\n",
+           metrics_client_proxy->delivery_rate_bytes_sec * 8.0 / 1000.0, metrics_proxy_server->delivery_rate_bytes_sec * 8.0 / 1000.0);
+    printf("| Min RTT (ms)          | %-18.3f | %-17.3f |\n", metrics_client_proxy->min_rtt_ms, metrics_proxy_server->min_rtt_ms);
+    printf("| Não enviados (bytes)  | %-18u | %-17u |\n", metrics_client_proxy->notsent_bytes, metrics_proxy_server->notsent_bytes);
+    printf("| Retrans. total        | %-18u | %-17u |\n", metrics_client_proxy->total_retrans, metrics_proxy_server->total_retrans);
+    printf("| Limitado por          | %-18s | %-17s |\n",
+           monitor_limited_by_name(metrics_client_proxy->limited_by), monitor_limited_by_name(metrics_proxy_server->limited_by));
     printf("----------------------------------------------------------------\n");
-    printf("Log salvo em: logs/...\n\n");
+    printf("Log salvo em: %s\n\n", log_file_name);
 }
@@ -5,70 +5,477 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <signal.h>
 #include "../include/proxy.h"
 #include "../include/connection_handler.h"
+#include "../include/event_loop.h"
+#include "../include/uring_engine.h"
+#include "../include/upstream_pool.h"
+#include "../include/backends.h"
+#include "../include/listener.h"
+#include "../include/logs.h"
+#include "../include/latency_profile.h"
+#include "../include/sockmap.h"
+#include "../include/admission.h"
+#include "../include/bandwidth.h"
+#include "../include/tls_session.h"
+#include "../include/latency_stats.h"
+#include "../include/timer_wheel.h"
+#include "../include/experiment.h"
+#include "../include/flight_recorder.h"
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Uso: %s <porta_local> <host_servidor_real> <porta_servidor_real> [opções]\n", program);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --optimize, -o            Ativa Buffer Tuning e Pacing\n");
+    fprintf(stderr, "  --engine <epoll|uring|threads> Engine de I/O (padrão: epoll; threads = legado, uma thread por conexão)\n");
+    fprintf(stderr, "  --workers <n>             Número de workers dos modos epoll/uring (padrão: um por núcleo)\n");
+    fprintf(stderr, "  --relay <copy|splice>     Encaminhamento por cópia (padrão) ou zero-copy com splice()\n");
+    fprintf(stderr, "  --pool-min <n>            Conexões pré-abertas com o servidor (padrão: 0, pool desativado)\n");
+    fprintf(stderr, "  --pool-max <n>            Máximo de conexões ociosas no pool (padrão: 2x pool-min)\n");
+    fprintf(stderr, "  --backend <host:porta>    Backend extra (repetível; aceita nomes e [ipv6]:porta)\n");
+    fprintf(stderr, "  --lb <rr|leastconn|rtt>   Política de balanceamento entre backends (padrão: rr)\n");
+    fprintf(stderr, "  --health-interval <ms>    Intervalo da verificação ativa de saúde (padrão: 2000; 0 desativa)\n");
+    fprintf(stderr, "  --health-max-ms <ms>      Connect de verificação mais lento que isso ejeta o backend (padrão: 1000)\n");
+    fprintf(stderr, "  --backlog <n>             Backlog do listen() (padrão: %d)\n", LISTEN_BACKLOG_DEFAULT);
+    fprintf(stderr, "  --reuseport               Um socket de escuta SO_REUSEPORT por worker (epoll/uring)\n");
+    fprintf(stderr, "  --pin-cpus                Fixa cada worker em uma CPU\n");
+    fprintf(stderr, "  --incoming-cpu            Com --reuseport, atende a conexão no núcleo que tratou seus pacotes\n");
+    fprintf(stderr, "  --policy <model|legacy>   Política do --optimize (padrão: model, estilo BBR; legacy = heurística original)\n");
+    fprintf(stderr, "  --ab <braço=peso,...>     Experimento A/B: cada conexão usa um braço sorteado pelo peso (off, legacy, model)\n");
+    fprintf(stderr, "  --ab-promote <n>          Com n conexões por braço, o braço que vence todos passa a receber todas (padrão: 0, nunca)\n");
+    fprintf(stderr, "  --cc <auto|off|algoritmo> Controle de congestionamento por socket (auto = classifica o caminho; padrão: off)\n");
+    fprintf(stderr, "  --log-format <csv|bin>    Formato do log de métricas (padrão: csv; bin = registros binários compactos)\n");
+    fprintf(stderr, "  --impair <preset>         Emulação de WAN: ideal, leve, moderado, gargalo, long ou caotica\n");
+    fprintf(stderr, "  --impair-down <spec>      Emulação Servidor -> Cliente (ex.: delay=100,jitter=50,dist=normal,loss=5,rate=5000)\n");
+    fprintf(stderr, "  --impair-up <spec>        Emulação Cliente -> Servidor (mesmo formato)\n");
+    fprintf(stderr, "  --impair-seed <n>         Semente dos sorteios de jitter e perda (padrão: 1)\n");
+    fprintf(stderr, "  --idle-timeout <s>        Encerra conexões sem tráfego após esse tempo (padrão: %d; 0 desativa)\n", CONNECTION_IDLE_TIMEOUT_DEFAULT_S);
+    fprintf(stderr, "  --keepalive <s>           Ociosidade até o primeiro probe de TCP keepalive (padrão: %d; 0 desativa)\n", CONNECTION_KEEPALIVE_DEFAULT_S);
+    fprintf(stderr, "  --fastpath                Encaminha os pares estabelecidos no kernel (BPF sockmap); sem permissão usa o relay\n");
+    fprintf(stderr, "  --latency                 Perfil de baixa latência: NODELAY, NOTSENT_LOWAT, QUICKACK e Fast Open na escuta\n");
+    fprintf(stderr, "  --client-first            O cliente sempre fala primeiro: DEFER_ACCEPT e Fast Open no connect ao servidor\n");
+    fprintf(stderr, "                            (trava servidores que falam primeiro, como SMTP e SSH)\n");
+    fprintf(stderr, "  --notsent-lowat <bytes>   TCP_NOTSENT_LOWAT do perfil de latência (padrão: %d; 0 não altera)\n", LATENCY_NOTSENT_LOWAT_DEFAULT);
+    fprintf(stderr, "  --max-conns <n>           Conexões simultâneas admitidas (padrão: 0, sem limite)\n");
+    fprintf(stderr, "  --accept-rate <n>         Novas conexões por segundo (padrão: 0, sem limite); --accept-burst <n> define a rajada\n");
+    fprintf(stderr, "  --max-connecting <n>      connect() em andamento com os backends (padrão: 0, sem limite)\n");
+    fprintf(stderr, "  --connect-queue <n>       Conexões aceitas esperando vaga de connect() (padrão: %d)\n", ADMISSION_CONNECT_QUEUE_DEFAULT);
+    fprintf(stderr, "  --queue-timeout <ms>      Tempo máximo nessa fila antes do RST (padrão: %d)\n", ADMISSION_QUEUE_TIMEOUT_DEFAULT_MS);
+    fprintf(stderr, "  --overload <reset|pause>  Acima dos limites: RST imediato (padrão) ou pausa o accept\n");
+    fprintf(stderr, "  --bw-limit <kbit/s>       Banda total do proxy dividida entre os IPs de cliente (padrão: 0, sem limite)\n");
+    fprintf(stderr, "  --bw-weight <ip[/n]=peso> Peso de um IP ou rede na divisão da banda (repetível; padrão: 1)\n");
+    fprintf(stderr, "  --bw-dir <down|up|both>   Direção limitada por --bw-limit (padrão: down, Servidor -> Cliente)\n");
+    fprintf(stderr, "  --tls-cert <pem>          Termina TLS com os clientes usando este certificado (engine threads)\n");
+    fprintf(stderr, "  --tls-key <pem>           Chave privada do certificado (padrão: o próprio arquivo do --tls-cert)\n");
+    fprintf(stderr, "  --tls-backend             Fala TLS também com os backends\n");
+    fprintf(stderr, "  --tls-backend-ca <pem>    CAs que verificam o certificado dos backends (padrão: não verifica; requer --tls-backend-name)\n");
+    fprintf(stderr, "  --tls-backend-name <nome> Nome enviado no SNI e exigido no certificado dos backends\n");
+    fprintf(stderr, "  --ktls <on|off>           Cifragem dos registros no kernel depois do handshake (padrão: on)\n");
+    fprintf(stderr, "  --stats-port <porta>      Mede as latências do proxy e as responde em 127.0.0.1:<porta> (HTTP ou nc)\n");
+    fprintf(stderr, "  --sample-ms <ms>          Intervalo base da coleta de TCP_INFO por conexão (padrão: %d)\n", MONITOR_INTERVAL_MS);
+    fprintf(stderr, "  --sample-fixed            Coleta sempre no intervalo base (padrão: mais rápida no slow start, mais lenta ociosa)\n");
+    fprintf(stderr, "  --flight-stall-ms <ms>    Destino parado por mais que isso despeja o gravador de voo em logs/ (padrão: %d; 0 = só SIGUSR2)\n", FLIGHT_STALL_DEFAULT_MS);
+    fprintf(stderr, "  --no-flight               Desliga o gravador de voo (eventos de cada conexão em anéis por thread)\n");
+    fprintf(stderr, "  --console                 Mostra a tabela de métricas de cada conexão no console (padrão: só no proxy_top)\n");
+    fprintf(stderr, "Exemplo sem otimização: %s 8080 192.168.1.100 9090\n", program);
+    fprintf(stderr, "Exemplo com otimização: %s 8080 192.168.1.100 9090 --optimize\n", program);
+}
 
 int main(int argc, char *argv[]) {
-    if (argc < 4 || argc > 5) {
-        fprintf(stderr, "Uso: %s <porta_local> <host_servidor_real> <porta_servidor_real> [--optimize]\n", argv[0]);
-        fprintf(stderr, "Exemplo sem otimização: %s 8080 192.168.1.100 9090\n", argv[0]);
-        fprintf(stderr, "Exemplo com otimização: %s 8080 192.168.1.100 9090 --optimize\n", argv[0]);
+    if (argc < 4) {
+        print_usage(argv[0]);
         exit(EXIT_FAILURE);
     }
 
     // 1. Armazena a configuração do proxy passada por args
     ProxyConfig config;
+    memset(&config, 0, sizeof(config));
     config.listen_port = atoi(argv[1]);
     config.target_host = argv[2];
     config.target_port = atoi(argv[3]);
 
-    // Padrão: Otimização desligada
+    // Padrão: Otimização desligada, engine epoll com um worker por núcleo
     config.enable_optimization = 0;
+    config.engine = ENGINE_EPOLL;
+    config.num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (config.num_workers < 1) config.num_workers = 1;
+    config.relay_mode = RELAY_MODE_COPY;
+    config.lb_policy = LB_ROUND_ROBIN;
+    config.health_interval_ms = 2000;
+    config.health_max_ms = 1000;
+    config.listen_backlog = LISTEN_BACKLOG_DEFAULT;
+    config.impairment.seed = 1;
+    config.idle_timeout_ms = CONNECTION_IDLE_TIMEOUT_DEFAULT_S * 1000;
+    config.keepalive_s = CONNECTION_KEEPALIVE_DEFAULT_S;
+    config.notsent_lowat = LATENCY_NOTSENT_LOWAT_DEFAULT;
+    config.admission.connect_queue = ADMISSION_CONNECT_QUEUE_DEFAULT;
+    config.admission.queue_timeout_ms = ADMISSION_QUEUE_TIMEOUT_DEFAULT_MS;
+    config.tls.ktls = 1;
+    config.sample_interval_ms = MONITOR_INTERVAL_MS;
+    config.sample_adaptive = 1;
+    config.flight.enabled = 1;
+    config.flight.stall_ms = FLIGHT_STALL_DEFAULT_MS;
 
-    // Verifica se o 5º argumento existe e se é a flag de otimização
-    if (argc == 5) {
-        if (strcmp(argv[4], "--optimize") == 0 || strcmp(argv[4], "-o") == 0) {
+    // Processa as flags opcionais a partir do 4º argumento
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--optimize") == 0 || strcmp(argv[i], "-o") == 0) {
             config.enable_optimization = 1;
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            const char *engine = argv[++i];
+
+            if (strcmp(engine, "threads") == 0) {
+                config.engine = ENGINE_THREADS;
+            } else if (strcmp(engine, "epoll") == 0) {
+                config.engine = ENGINE_EPOLL;
+            } else if (strcmp(engine, "uring") == 0) {
+                config.engine = ENGINE_URING;
+            } else {
+                fprintf(stderr, "Engine '%s' desconhecida. Use 'epoll', 'uring' ou 'threads'.\n", engine);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            config.num_workers = atoi(argv[++i]);
+            if (config.num_workers < 1) config.num_workers = 1;
+        } else if (strcmp(argv[i], "--relay") == 0 && i + 1 < argc) {
+            const char *relay = argv[++i];
+
+            if (strcmp(relay, "splice") == 0) {
+                config.relay_mode = RELAY_MODE_SPLICE;
+            } else if (strcmp(relay, "copy") == 0) {
+                config.relay_mode = RELAY_MODE_COPY;
+            } else {
+                fprintf(stderr, "Modo de encaminhamento '%s' desconhecido. Use 'copy' ou 'splice'.\n", relay);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--pool-min") == 0 && i + 1 < argc) {
+            config.pool_min = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pool-max") == 0 && i + 1 < argc) {
+            config.pool_max = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            if (config.backend_spec_count < MAX_BACKENDS - 1) {
+                config.backend_specs[config.backend_spec_count++] = argv[++i];
+            } else {
+                fprintf(stderr, "Aviso: limite de %d backends atingido, ignorando '%s'.\n", MAX_BACKENDS, argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--lb") == 0 && i + 1 < argc) {
+            const char *policy = argv[++i];
+
+            if (strcmp(policy, "rr") == 0) {
+                config.lb_policy = LB_ROUND_ROBIN;
+            } else if (strcmp(policy, "leastconn") == 0) {
+                config.lb_policy = LB_LEAST_CONNECTIONS;
+            } else if (strcmp(policy, "rtt") == 0) {
+                config.lb_policy = LB_LOWEST_RTT;
+            } else {
+                fprintf(stderr, "Política '%s' desconhecida. Use 'rr', 'leastconn' ou 'rtt'.\n", policy);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--health-interval") == 0 && i + 1 < argc) {
+            config.health_interval_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--health-max-ms") == 0 && i + 1 < argc) {
+            config.health_max_ms = atoi(argv[++i]);
+            if (config.health_max_ms < 1) config.health_max_ms = 1;
+        } else if (strcmp(argv[i], "--backlog") == 0 && i + 1 < argc) {
+            config.listen_backlog = atoi(argv[++i]);
+            if (config.listen_backlog < 1) config.listen_backlog = 1;
+        } else if (strcmp(argv[i], "--reuseport") == 0) {
+            config.reuseport = 1;
+        } else if (strcmp(argv[i], "--pin-cpus") == 0) {
+            config.pin_cpus = 1;
+        } else if (strcmp(argv[i], "--incoming-cpu") == 0) {
+            config.incoming_cpu = 1;
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            const char *policy = argv[++i];
+
+            if (strcmp(policy, "model") == 0) {
+                config.optimizer_policy = OPTIMIZER_POLICY_MODEL;
+            } else if (strcmp(policy, "legacy") == 0) {
+                config.optimizer_policy = OPTIMIZER_POLICY_LEGACY;
+            } else {
+                fprintf(stderr, "Política de otimização '%s' desconhecida. Use 'model' ou 'legacy'.\n", policy);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--ab") == 0 && i + 1 < argc) {
+            if (experiment_parse_arms(&config.experiment, argv[++i]) < 0) {
+                fprintf(stderr, "Experimento '%s' inválido. Use de 2 a %d braços distintos entre off, legacy e model (ex.: off=1,legacy=1,model=2).\n",
+                        argv[i], EXPERIMENT_MAX_ARMS);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--ab-promote") == 0 && i + 1 < argc) {
+            config.experiment.promote_min = atoi(argv[++i]);
+            if (config.experiment.promote_min < 0) config.experiment.promote_min = 0;
+        } else if (strcmp(argv[i], "--cc") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+
+            if (strcmp(mode, "auto") == 0) {
+                config.cc_mode = CC_MODE_AUTO;
+            } else if (strcmp(mode, "off") == 0) {
+                config.cc_mode = CC_MODE_OFF;
+            } else if (strlen(mode) < CC_NAME_MAX) {
+                config.cc_mode = CC_MODE_FIXED;
+                config.cc_algorithm = argv[i];
+            } else {
+                fprintf(stderr, "Controle de congestionamento '%s' inválido. Use 'auto', 'off' ou um algoritmo (ex.: bbr).\n", mode);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--impair") == 0 && i + 1 < argc) {
+            if (impairment_apply_preset(&config.impairment, argv[++i]) < 0) {
+                fprintf(stderr, "Preset de emulação '%s' desconhecido. Use ideal, leve, moderado, gargalo, long ou caotica.\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((strcmp(argv[i], "--impair-down") == 0 || strcmp(argv[i], "--impair-up") == 0) && i + 1 < argc) {
+            ImpairmentParams *params = strcmp(argv[i], "--impair-down") == 0 ? &config.impairment.down : &config.impairment.up;
+
+            if (impairment_parse_spec(params, argv[++i]) < 0) {
+                fprintf(stderr, "Emulação '%s' inválida. Chaves: delay, jitter, dist, loss, stall, rate, burst.\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            config.impairment.enabled = 1;
+            config.impairment.preset = NULL;
+        } else if (strcmp(argv[i], "--impair-seed") == 0 && i + 1 < argc) {
+            config.impairment.seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--fastpath") == 0) {
+            config.fastpath = 1;
+        } else if (strcmp(argv[i], "--max-conns") == 0 && i + 1 < argc) {
+            config.admission.max_connections = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--accept-rate") == 0 && i + 1 < argc) {
+            config.admission.accept_rate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--accept-burst") == 0 && i + 1 < argc) {
+            config.admission.accept_burst = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-connecting") == 0 && i + 1 < argc) {
+            config.admission.max_connecting = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--connect-queue") == 0 && i + 1 < argc) {
+            config.admission.connect_queue = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queue-timeout") == 0 && i + 1 < argc) {
+            config.admission.queue_timeout_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--overload") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+
+            if (strcmp(mode, "reset") == 0) {
+                config.admission.shed_mode = ADMISSION_SHED_RESET;
+            } else if (strcmp(mode, "pause") == 0) {
+                config.admission.shed_mode = ADMISSION_SHED_PAUSE;
+            } else {
+                fprintf(stderr, "Modo de sobrecarga '%s' desconhecido. Use 'reset' ou 'pause'.\n", mode);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--bw-limit") == 0 && i + 1 < argc) {
+            config.bandwidth.rate_bytes_sec = atof(argv[++i]) * 1000.0 / 8.0;
+        } else if (strcmp(argv[i], "--bw-weight") == 0 && i + 1 < argc) {
+            if (bandwidth_parse_weight(&config.bandwidth, argv[++i]) < 0) {
+                fprintf(stderr, "Peso de banda '%s' inválido. Use ip=peso ou rede/prefixo=peso (até %d regras).\n", argv[i], BANDWIDTH_MAX_WEIGHTS);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--bw-dir") == 0 && i + 1 < argc) {
+            const char *direction = argv[++i];
+
+            if (strcmp(direction, "down") == 0) {
+                config.bandwidth.direction = BANDWIDTH_DOWN;
+            } else if (strcmp(direction, "up") == 0) {
+                config.bandwidth.direction = BANDWIDTH_UP;
+            } else if (strcmp(direction, "both") == 0) {
+                config.bandwidth.direction = BANDWIDTH_BOTH;
+            } else {
+                fprintf(stderr, "Direção '%s' desconhecida. Use 'down', 'up' ou 'both'.\n", direction);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--tls-cert") == 0 && i + 1 < argc) {
+            config.tls.cert_file = argv[++i];
+        } else if (strcmp(argv[i], "--tls-key") == 0 && i + 1 < argc) {
+            config.tls.key_file = argv[++i];
+        } else if (strcmp(argv[i], "--tls-backend") == 0) {
+            config.tls.backend = 1;
+        } else if (strcmp(argv[i], "--tls-backend-ca") == 0 && i + 1 < argc) {
+            config.tls.backend_ca = argv[++i];
+        } else if (strcmp(argv[i], "--tls-backend-name") == 0 && i + 1 < argc) {
+            config.tls.backend_name = argv[++i];
+        } else if (strcmp(argv[i], "--ktls") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+
+            if (strcmp(mode, "on") == 0) {
+                config.tls.ktls = 1;
+            } else if (strcmp(mode, "off") == 0) {
+                config.tls.ktls = 0;
+            } else {
+                fprintf(stderr, "Modo '%s' desconhecido para --ktls. Use 'on' ou 'off'.\n", mode);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            config.latency_profile = 1;
+        } else if (strcmp(argv[i], "--client-first") == 0) {
+            config.client_first = 1;
+        } else if (strcmp(argv[i], "--notsent-lowat") == 0 && i + 1 < argc) {
+            config.notsent_lowat = atoi(argv[++i]);
+            if (config.notsent_lowat < 0) config.notsent_lowat = 0;
+        } else if (strcmp(argv[i], "--stats-port") == 0 && i + 1 < argc) {
+            config.stats_port = atoi(argv[++i]);
+            if (config.stats_port < 0 || config.stats_port > 65535) {
+                fprintf(stderr, "Porta inválida para --stats-port: %s\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--sample-ms") == 0 && i + 1 < argc) {
+            config.sample_interval_ms = atoi(argv[++i]);
+            if (config.sample_interval_ms < TIMER_WHEEL_TICK_MS || config.sample_interval_ms > SAMPLE_MAX_INTERVAL_MS) {
+                fprintf(stderr, "Intervalo inválido para --sample-ms: %s (de %d a %d)\n", argv[i], TIMER_WHEEL_TICK_MS, SAMPLE_MAX_INTERVAL_MS);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--sample-fixed") == 0) {
+            config.sample_adaptive = 0;
+        } else if (strcmp(argv[i], "--flight-stall-ms") == 0 && i + 1 < argc) {
+            config.flight.stall_ms = atoi(argv[++i]);
+            if (config.flight.stall_ms < 0) config.flight.stall_ms = 0;
+        } else if (strcmp(argv[i], "--no-flight") == 0) {
+            config.flight.enabled = 0;
+        } else if (strcmp(argv[i], "--console") == 0) {
+            config.console_metrics = 1;
+        } else if (strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            config.idle_timeout_ms = atoi(argv[++i]) * 1000;
+            if (config.idle_timeout_ms < 0) config.idle_timeout_ms = 0;
+        } else if (strcmp(argv[i], "--keepalive") == 0 && i + 1 < argc) {
+            config.keepalive_s = atoi(argv[++i]);
+            if (config.keepalive_s < 0) config.keepalive_s = 0;
+        } else if (strcmp(argv[i], "--log-format") == 0 && i + 1 < argc) {
+            const char *format = argv[++i];
+
+            if (strcmp(format, "csv") == 0) {
+                config.log_format = LOG_FORMAT_CSV;
+            } else if (strcmp(format, "bin") == 0) {
+                config.log_format = LOG_FORMAT_BINARY;
+            } else {
+                fprintf(stderr, "Formato de log '%s' desconhecido. Use 'csv' ou 'bin'.\n", format);
+                exit(EXIT_FAILURE);
+            }
         } else {
-            fprintf(stderr, "Aviso: Argumento '%s' desconhecido. Use '--optimize' ou '-o' para ativar otimizações.\n", argv[4]);
+            fprintf(stderr, "Aviso: Argumento '%s' desconhecido.\n", argv[i]);
+            print_usage(argv[0]);
+        }
+    }
+
+    if (config.pool_min > 0 && config.pool_max == 0) config.pool_max = config.pool_min * 2;
+
+    // io_uring pode estar ausente (kernel antigo) ou bloqueado (seccomp, containers)
+    if (config.engine == ENGINE_URING) {
+        if (!uring_engine_available()) {
+            fprintf(stderr, "Aviso: io_uring indisponível neste sistema, usando a engine epoll.\n");
+            config.engine = ENGINE_EPOLL;
+        } else if (config.relay_mode == RELAY_MODE_SPLICE) {
+            fprintf(stderr, "Aviso: a engine io_uring usa recv/send com buffers fornecidos, ignorando '--relay splice'.\n");
+            config.relay_mode = RELAY_MODE_COPY;
+        }
+    }
+
+    // A emulação de WAN vive nos canais de relay (epoll e threads); io_uring usa buffers próprios
+    if (config.impairment.enabled) {
+        if (config.engine == ENGINE_URING) {
+            fprintf(stderr, "Aviso: a emulação de WAN não está disponível na engine io_uring, usando a engine epoll.\n");
+            config.engine = ENGINE_EPOLL;
+        }
+        if (config.relay_mode == RELAY_MODE_SPLICE) {
+            fprintf(stderr, "Aviso: a emulação de WAN retém os dados em user space, ignorando '--relay splice'.\n");
+            config.relay_mode = RELAY_MODE_COPY;
+        }
+    }
+
+    // O escalonador de banda limita as leituras dos canais de relay (epoll e threads)
+    if (config.bandwidth.rate_bytes_sec > 0 && config.engine == ENGINE_URING) {
+        fprintf(stderr, "Aviso: o escalonador de banda não está disponível na engine io_uring, usando a engine epoll.\n");
+        config.engine = ENGINE_EPOLL;
+    }
+
+    // Os handshakes TLS são bloqueantes e rodam na thread de cada conexão (handle_connection)
+    int tls_wanted = config.tls.cert_file || config.tls.backend;
+
+    if (tls_wanted && config.engine != ENGINE_THREADS) {
+        fprintf(stderr, "Aviso: TLS só está disponível na engine threads (handshake na thread da conexão), usando a engine threads.\n");
+        config.engine = ENGINE_THREADS;
+    }
+
+    // O fast path troca o encaminhamento dos sockets do relay (epoll e threads); sem BPF o proxy segue com o relay
+    if (config.fastpath) {
+        char reason[256];
+
+        if (tls_wanted) {
+            fprintf(stderr, "Aviso: os registros TLS precisam passar pelo relay, ignorando '--fastpath'.\n");
+            config.fastpath = 0;
+        } else if (config.impairment.enabled) {
+            fprintf(stderr, "Aviso: a emulação de WAN retém os dados em user space, ignorando '--fastpath'.\n");
+            config.fastpath = 0;
+        } else if (config.bandwidth.rate_bytes_sec > 0) {
+            fprintf(stderr, "Aviso: o escalonador de banda limita as leituras do relay, ignorando '--fastpath'.\n");
+            config.fastpath = 0;
+        } else if (sockmap_init(reason, sizeof(reason)) < 0) {
+            fprintf(stderr, "Aviso: fast path indisponível: %s. Usando o relay.\n", reason);
+            config.fastpath = 0;
+        } else if (config.engine == ENGINE_URING) {
+            fprintf(stderr, "Aviso: o fast path não está disponível na engine io_uring, usando a engine epoll.\n");
+            config.engine = ENGINE_EPOLL;
         }
     }
 
-    // 2. Cria o socket listener do proxy
-    int listen_fd;
-    struct sockaddr_in proxy_address;
+    // O modo legado aceita na thread principal; SO_REUSEPORT só faz sentido com workers
+    if (config.reuseport && config.engine == ENGINE_THREADS) {
+        fprintf(stderr, "Aviso: '--reuseport' requer a engine epoll ou uring, usando um socket de escuta único.\n");
+        config.reuseport = 0;
+    }
 
-    listen_fd = socket(AF_INET, SOCK_STREAM, 0); // STREAM para conexão TCP
+    // O accept multishot do io_uring não tem como ser pausado sem cancelar o SQE: excessos recebem RST
+    if (config.admission.shed_mode == ADMISSION_SHED_PAUSE && config.engine == ENGINE_URING) {
+        fprintf(stderr, "Aviso: '--overload pause' não está disponível na engine io_uring, usando RST.\n");
+        config.admission.shed_mode = ADMISSION_SHED_RESET;
+    }
 
-    if (listen_fd < 0) {
-        perror("Erro ao criar socket");
+    // No experimento a política vem do braço de cada conexão
+    if (config.experiment.arm_count > 0 && config.enable_optimization) {
+        fprintf(stderr, "Aviso: com '--ab' a política de cada conexão vem do braço sorteado, ignorando '--optimize'.\n");
+        config.enable_optimization = 0;
+    }
+    if (config.experiment.promote_min > 0 && config.experiment.arm_count == 0) {
+        fprintf(stderr, "Aviso: '--ab-promote' requer '--ab', ignorando.\n");
+        config.experiment.promote_min = 0;
+    }
+
+    experiment_start(&config.experiment);
+    admission_init(&config.admission);
+
+    if (bandwidth_start(&config.bandwidth) < 0) {
         exit(EXIT_FAILURE);
     }
 
-    // Permite que o socket seja reutilizado imediatamente (bom para testes)
-    int opt = 1;
-    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (tls_init(&config.tls) < 0) {
+        exit(EXIT_FAILURE);
+    }
 
-    // 3. Configura o endereço do proxy
-    memset(&proxy_address, 0, sizeof(proxy_address));
-    proxy_address.sin_family = AF_INET;
-    proxy_address.sin_addr.s_addr = INADDR_ANY; // Escuta em todos os IPs locais
-    proxy_address.sin_port = htons(config.listen_port); // Porta
+    if (latency_stats_start(config.stats_port) < 0) {
+        exit(EXIT_FAILURE);
+    }
 
-    // 4. Faz o Bind do socket para o proxy
-    if (bind(listen_fd, (struct sockaddr *)&proxy_address, sizeof(proxy_address)) < 0) {
-        perror("Erro no bind");
-        close(listen_fd);
+    if (flight_recorder_start(&config.flight) < 0) {
         exit(EXIT_FAILURE);
     }
 
-    // 5. Coloca o socket em modo Listen
-    if (listen(listen_fd, 10) < 0) { // 10 é o backlog limite de conexões pendentes
-        perror("Erro no listen");
-        close(listen_fd);
+    // SO_INCOMING_CPU escolhe entre os sockets do grupo SO_REUSEPORT e só vale com workers fixados
+    if (config.incoming_cpu && !(config.reuseport && config.pin_cpus)) {
+        fprintf(stderr, "Aviso: '--incoming-cpu' requer '--reuseport' e '--pin-cpus', ignorando.\n");
+        config.incoming_cpu = 0;
+    }
+
+    // Resolve os backends uma única vez: nomes não são consultados de novo a cada conexão
+    if (backends_init(&config) < 0) {
         exit(EXIT_FAILURE);
     }
 
+    // Escrever em um socket já fechado pelo outro lado não deve derrubar o processo
+    signal(SIGPIPE, SIG_IGN);
+
+    // 2. Cria o socket listener do proxy (com SO_REUSEPORT cada worker cria o seu)
+    int listen_fd = -1;
+
+    if (!config.reuseport) {
+        listen_fd = listener_open(&config, 0);
+        if (listen_fd < 0) exit(EXIT_FAILURE);
+    }
+
     printf("Proxy TCP escutando na porta %d, encaminhando para %s:%d\n\n",
            config.listen_port, config.target_host, config.target_port);
 
@@ -76,15 +483,185 @@ int main(int argc, char *argv[]) {
     printf("----------------------------------------------------------------\n");
     printf("Proxy TCP Iniciado\n");
     printf("Escutando em: 192.168.0.145:%d\n", config.listen_port);
-    printf("Destino:      %s:%d\n", config.target_host, config.target_port);
-    printf("Otimização:   [%s]\n", config.enable_optimization ? "\033[1;32mATIVADA\033[0m" : "\033[1;33mDESATIVADA\033[0m");
+    for (int i = 0; i < backends_count(); i++) {
+        printf("%s %s\n", i == 0 ? "Destino:     " : "             ", backends_get(i)->address_str);
+    }
+    if (backends_count() > 1) {
+        printf("Balanceamento: %s\n", backends_policy_name(config.lb_policy));
+    }
+    if (experiment_enabled()) {
+        printf("Otimização:   [\033[1;36mA/B\033[0m] braços");
+        for (int i = 0; i < config.experiment.arm_count; i++) {
+            printf("%s %s peso %d", i ? "," : "", experiment_arm_name(i), config.experiment.arms[i].weight);
+        }
+        if (config.experiment.promote_min > 0) printf("; promove o vencedor após %d conexões por braço", config.experiment.promote_min);
+        printf("\n");
+    } else {
+        printf("Otimização:   [%s]", config.enable_optimization ? "\033[1;32mATIVADA\033[0m" : "\033[1;33mDESATIVADA\033[0m");
+        if (config.enable_optimization) printf(" política %s", optimizer_policy_get(config.optimizer_policy)->name);
+        printf("\n");
+    }
+    if (config.cc_mode == CC_MODE_AUTO) {
+        printf("Congestão:    automática por caminho (após %d amostras)\n", CC_CLASSIFY_SAMPLES);
+    } else if (config.cc_mode == CC_MODE_FIXED) {
+        printf("Congestão:    %s nos dois trechos\n", config.cc_algorithm);
+    }
+    if (config.engine == ENGINE_EPOLL) {
+        printf("Engine:       epoll (%d workers)\n", config.num_workers);
+    } else if (config.engine == ENGINE_URING) {
+        printf("Engine:       io_uring (%d workers)\n", config.num_workers);
+    } else {
+        printf("Engine:       threads (legado)\n");
+    }
+    printf("Relay:        %s\n", relay_mode_name(config.relay_mode));
+    if (config.fastpath) printf("Fast path:    BPF sockmap (pares IPv4 encaminhados no kernel depois do connect)\n");
+    if (config.impairment.enabled) {
+        char description[160];
+
+        printf("Emulação WAN: %s (semente %lu)\n", config.impairment.preset ? config.impairment.preset : "personalizada", config.impairment.seed);
+        impairment_describe(&config.impairment.down, description, sizeof(description));
+        printf("              Servidor -> Cliente: %s\n", description);
+        impairment_describe(&config.impairment.up, description, sizeof(description));
+        printf("              Cliente -> Servidor: %s\n", description);
+    }
+    printf("Accept:       %s (backlog %d)%s%s\n", config.reuseport ? "SO_REUSEPORT por worker" : "socket único",
+           config.listen_backlog, config.pin_cpus ? ", workers fixados em CPUs" : "",
+           config.incoming_cpu ? ", SO_INCOMING_CPU" : "");
+    if (config.pool_min > 0) {
+        printf("Pool:         %d-%d conexões com o servidor\n", config.pool_min, config.pool_max);
+    }
+    if (config.latency_profile || config.client_first) {
+        int fastopen = latency_fastopen_sysctl();
+        int wanted = (config.latency_profile ? 2 : 0) | (config.client_first ? 1 : 0);
+
+        printf("Latência:     ");
+        if (config.latency_profile) printf("NODELAY, QUICKACK, ");
+        if (config.latency_profile && config.notsent_lowat > 0) printf("NOTSENT_LOWAT %d B, ", config.notsent_lowat);
+        if (config.client_first) printf("DEFER_ACCEPT %d s, ", LATENCY_DEFER_ACCEPT_S);
+        // Bit 2 do sysctl vale para os clientes do proxy (escuta) e o bit 1 para o trecho até o servidor
+        printf("Fast Open: clientes %s, servidor %s\n",
+               !config.latency_profile ? "desligado" : fastopen >= 0 && (fastopen & 2) ? "sim" : "não",
+               !config.client_first ? "desligado (--client-first)" : fastopen >= 0 && (fastopen & 1) ? "sim" : "não");
+        if (fastopen < 0 || (fastopen & wanted) != wanted) {
+            printf("              net.ipv4.tcp_fastopen=%d: use 3 para Fast Open nos dois trechos\n", fastopen);
+        }
+    }
+    if (admission_enabled()) {
+        printf("Admissão:     ");
+        if (config.admission.max_connections > 0) printf("até %d conexões, ", config.admission.max_connections);
+        if (config.admission.accept_rate > 0) printf("%d accepts/s, ", config.admission.accept_rate);
+        if (config.admission.max_connecting > 0) {
+            printf("%d connects (fila %d, %d ms), ", config.admission.max_connecting, config.admission.connect_queue,
+                   config.admission.queue_timeout_ms);
+        }
+        printf("excesso: %s\n", admission_shed_name(config.admission.shed_mode));
+    }
+    if (bandwidth_enabled()) {
+        printf("Banda:        %.0f kbit/s em %s, dividida por IP de cliente (%d regras de peso, rodadas de %d ms)\n",
+               config.bandwidth.rate_bytes_sec * 8.0 / 1000.0, bandwidth_direction_name(config.bandwidth.direction),
+               config.bandwidth.weight_count, BANDWIDTH_ROUND_MS);
+    }
+    if (tls_terminates() || tls_originates()) {
+        printf("TLS:          ");
+        if (tls_terminates()) printf("clientes (%s)", config.tls.cert_file);
+        if (tls_originates()) {
+            printf("%sbackends (%s)", tls_terminates() ? ", " : "",
+                   config.tls.backend_ca ? "certificado verificado" : "certificado não verificado");
+        }
+        if (!config.tls.ktls) printf(", kTLS desligado: registros cifrados em user space\n");
+        else if (tls_ktls_available()) printf(", kTLS: registros cifrados no kernel\n");
+        else printf(", kTLS indisponível (sem o módulo tls no kernel): registros cifrados em user space\n");
+    }
+    if (latency_stats_enabled()) {
+        printf("Latências:    connect, TTFB e atraso do relay por bloco em http://127.0.0.1:%d/ (resumo por conexão no encerramento)\n",
+               config.stats_port);
+    }
+    printf("Amostragem:   TCP_INFO a cada %d ms por conexão", config.sample_interval_ms);
+    if (config.sample_adaptive) {
+        printf(", adaptativa (slow start: 1/%d, mínimo %d ms; ociosa: até %d ms)\n", SAMPLE_SLOW_START_DIVISOR,
+               SAMPLE_MIN_INTERVAL_MS, config.sample_interval_ms * SAMPLE_IDLE_MAX_FACTOR);
+    } else {
+        printf(", fixa\n");
+    }
+    if (flight_recorder_enabled()) {
+        printf("Gravador:     eventos por conexão em anéis de %d por thread; kill -USR2 %d", FLIGHT_RING_EVENTS, (int)getpid());
+        if (config.flight.stall_ms > 0) printf(" ou destino parado por %d ms", config.flight.stall_ms);
+        printf(" despeja em %s<ms>.bin (./flight_decoder)\n", FLIGHT_FILE_PREFIX);
+    }
+    printf("Ociosidade:   %s", config.idle_timeout_ms > 0 ? "" : "sem limite");
+    if (config.idle_timeout_ms > 0) printf("encerra após %d s", config.idle_timeout_ms / 1000);
+    if (config.keepalive_s > 0) printf(", keepalive após %d s", config.keepalive_s);
+    printf("\n");
+
+    // Métricas ao vivo de cada conexão em memória compartilhada, para o proxy_top
+    char stats_path[128];
+    if (connection_stats_start(&config, stats_path, sizeof(stats_path)) == 0) {
+        printf("Estatísticas: %s (./proxy_top %d)%s\n", stats_path, config.listen_port, config.console_metrics ? ", também no console" : "");
+    } else {
+        fprintf(stderr, "Aviso: estatísticas ao vivo indisponíveis, use --console para ver as métricas.\n");
+    }
     printf("----------------------------------------------------------------\n");
 
+    // Métricas vão para um único log, escrito em lotes fora do caminho de encaminhamento
+    if (logs_start(&config) < 0) {
+        close(listen_fd);
+        exit(EXIT_FAILURE);
+    }
+
+    if (backends_start_health_checks(&config) < 0) {
+        fprintf(stderr, "Falha ao iniciar a verificação de saúde dos backends\n");
+        close(listen_fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // Pré-abre as conexões com o servidor antes de aceitar clientes
+    if (upstream_pool_start(&config) < 0) {
+        fprintf(stderr, "Falha ao iniciar o pool de conexões\n");
+        close(listen_fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // Na engine io_uring os próprios workers aceitam as conexões (accept multishot)
+    if (config.engine == ENGINE_URING) {
+        if (uring_engine_run(&config, listen_fd) < 0) {
+            fprintf(stderr, "Falha ao iniciar a engine io_uring\n");
+            close(listen_fd);
+            exit(EXIT_FAILURE);
+        }
+
+        close(listen_fd);
+        return 0;
+    }
+
+    // Sobe o pool de workers antes de aceitar conexões
+    if (config.engine == ENGINE_EPOLL && event_loop_start(&config) < 0) {
+        fprintf(stderr, "Falha ao iniciar os workers do modo epoll\n");
+        close(listen_fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // Com SO_REUSEPORT os workers aceitam sozinhos; a thread principal só espera
+    if (config.reuseport) {
+        while (1) pause();
+    }
+
+    // Engine threads: a pilha padrão (8 MB) é muito maior que o que handle_connection usa
+    pthread_attr_t thread_attr;
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setstacksize(&thread_attr, CONNECTION_THREAD_STACK_SIZE);
+
     // 6. Loop principal: aceita e despacha conexões
     while (1) {
         struct sockaddr_in client_address;
         socklen_t client_len = sizeof(client_address);
 
+        // No limite com --overload pause, não aceita: os SYNs esperam no backlog do kernel
+        int pause_ms = admission_pause_ms();
+        if (pause_ms > 0) {
+            usleep((useconds_t)pause_ms * 1000);
+            continue;
+        }
+
         // Aguarda um cliente conectar
         int client_fd = accept(listen_fd, (struct sockaddr *)&client_address, &client_len);
         if (client_fd < 0) {
@@ -92,26 +669,47 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
-        // Prepara os argumentos para a nova thread se accept feito com sucesso
+        // Acima dos limites a conexão é recusada antes de ocupar um worker, uma thread ou um connect()
+        AdmissionVerdict verdict = admission_accept();
+        if (verdict != ADMISSION_ADMIT) {
+            admission_reject(client_fd, verdict);
+            connection_stats_publish_header();
+            continue;
+        }
+
+        // Modo epoll: entrega o socket a um worker
+        if (config.engine == ENGINE_EPOLL) {
+            if (event_loop_dispatch(client_fd, &client_address) < 0) {
+                close(client_fd);
+                admission_release();
+            }
+            continue;
+        }
+
+        // Modo legado: prepara os argumentos para a nova thread se accept feito com sucesso
         ConnectionThreadArgs *connection_args = malloc(sizeof(ConnectionThreadArgs));
 
         if (!connection_args) {
             perror("Erro ao alocar argumentos da thread");
             close(client_fd);
+            admission_release();
             continue;
         }
 
         connection_args->client_socket = client_fd;
         connection_args->config = &config; // Passa um ponteiro para a config do proxy
         connection_args->client_address = client_address;
+        connection_args->accepted_ns = latency_now_ns();
 
         // Cria a thread para gerenciar a conexão
         pthread_t thread;
 
-        if (pthread_create(&thread, NULL, handle_connection, (void*)connection_args) != 0) {
+        if (pthread_create(&thread, &thread_attr, handle_connection, (void*)connection_args) != 0) {
             perror("Erro ao criar thread");
             free(connection_args);
             close(client_fd);
+            admission_release();
+            continue;
         }
 
         // Desvincula a thread pra que ela libere recursos quando terminar
@@ -0,0 +1,156 @@
+#include <string.h>
+
+#include "../include/metrics_format.h"
+
+// Escrita e leitura byte a byte: o formato é o mesmo em qualquer arquitetura
+static void put_u16(uint8_t *buffer, uint16_t value) {
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) buffer[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void put_u64(uint8_t *buffer, uint64_t value) {
+    for (int i = 0; i < 8; i++) buffer[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void put_f32(uint8_t *buffer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u32(buffer, bits);
+}
+
+static uint16_t get_u16(const uint8_t *buffer) {
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *buffer) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)buffer[i] << (8 * i);
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t *buffer) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)buffer[i] << (8 * i);
+    return value;
+}
+
+static float get_f32(const uint8_t *buffer) {
+    uint32_t bits = get_u32(buffer);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Cada trecho ocupa 28 bytes
+static void encode_leg(uint8_t *buffer, const MetricsBinLeg *leg) {
+    put_f32(buffer, leg->rtt_ms);
+    put_f32(buffer + 4, leg->rtt_var_ms);
+    put_u32(buffer + 8, leg->retransmits);
+    put_u32(buffer + 12, leg->cwnd_segments);
+    put_u32(buffer + 16, leg->ssthresh);
+    put_f32(buffer + 20, leg->throughput_kbps);
+    put_f32(buffer + 24, leg->goodput_kbps);
+}
+
+static void decode_leg(const uint8_t *buffer, MetricsBinLeg *leg) {
+    leg->rtt_ms = get_f32(buffer);
+    leg->rtt_var_ms = get_f32(buffer + 4);
+    leg->retransmits = get_u32(buffer + 8);
+    leg->cwnd_segments = get_u32(buffer + 12);
+    leg->ssthresh = get_u32(buffer + 16);
+    leg->throughput_kbps = get_f32(buffer + 20);
+    leg->goodput_kbps = get_f32(buffer + 24);
+}
+
+// Campos estendidos de cada trecho: 24 bytes
+static void encode_leg_ext(uint8_t *buffer, const MetricsBinLeg *leg) {
+    put_f32(buffer, leg->delivery_rate_kbps);
+    put_f32(buffer + 4, leg->min_rtt_ms);
+    put_f32(buffer + 8, leg->retrans_kbps);
+    put_u32(buffer + 12, leg->notsent_bytes);
+    put_u32(buffer + 16, leg->total_retrans);
+    buffer[20] = leg->limited_by;
+}
+
+static void decode_leg_ext(const uint8_t *buffer, MetricsBinLeg *leg) {
+    leg->delivery_rate_kbps = get_f32(buffer);
+    leg->min_rtt_ms = get_f32(buffer + 4);
+    leg->retrans_kbps = get_f32(buffer + 8);
+    leg->notsent_bytes = get_u32(buffer + 12);
+    leg->total_retrans = get_u32(buffer + 16);
+    leg->limited_by = buffer[20];
+}
+
+static void clear_leg_ext(MetricsBinLeg *leg) {
+    leg->delivery_rate_kbps = 0;
+    leg->min_rtt_ms = 0;
+    leg->retrans_kbps = 0;
+    leg->notsent_bytes = 0;
+    leg->total_retrans = 0;
+    leg->limited_by = 0;
+}
+
+void metrics_bin_encode_header(uint8_t *buffer, uint64_t run_start_ms) {
+    memset(buffer, 0, METRICS_BIN_HEADER_SIZE);
+    memcpy(buffer, METRICS_BIN_MAGIC, 4);
+    put_u16(buffer + 4, METRICS_BIN_VERSION);
+    put_u16(buffer + 6, METRICS_BIN_RECORD_SIZE);
+    put_u64(buffer + 16, run_start_ms);
+}
+
+int metrics_bin_decode_header(const uint8_t *buffer, size_t length, MetricsBinHeader *header) {
+    if (length < METRICS_BIN_HEADER_SIZE || memcmp(buffer, METRICS_BIN_MAGIC, 4) != 0) return -1;
+
+    header->version = get_u16(buffer + 4);
+    header->record_size = get_u16(buffer + 6);
+    header->run_start_ms = get_u64(buffer + 16);
+
+    // Versões futuras podem crescer o registro; campos novos ficam no fim e são ignorados aqui
+    if (header->version < 1 || header->record_size < METRICS_BIN_RECORD_SIZE_V1) return -1;
+    return 0;
+}
+
+// Registro: id(8) | timestamp(8) | IPv4(4) | braço(1) | reservado(3) | Cliente <-> Proxy(28) | Proxy <-> Servidor(28)
+//           | estendidos Cliente <-> Proxy(24) | estendidos Proxy <-> Servidor(24)   (versão 2)
+void metrics_bin_encode_record(uint8_t *buffer, const MetricsBinRecord *record) {
+    memset(buffer, 0, METRICS_BIN_RECORD_SIZE);
+    put_u64(buffer, record->connection_id);
+    put_u64(buffer + 8, record->timestamp_ms);
+    memcpy(buffer + 16, record->client_ip, 4);
+    buffer[20] = record->arm;
+    encode_leg(buffer + 24, &record->client_proxy);
+    encode_leg(buffer + 52, &record->proxy_server);
+    encode_leg_ext(buffer + 80, &record->client_proxy);
+    encode_leg_ext(buffer + 104, &record->proxy_server);
+}
+
+void metrics_bin_decode_record(const uint8_t *buffer, uint16_t record_size, MetricsBinRecord *record) {
+    record->connection_id = get_u64(buffer);
+    record->timestamp_ms = get_u64(buffer + 8);
+    memcpy(record->client_ip, buffer + 16, 4);
+    record->arm = buffer[20];   // Zero nas versões anteriores: METRICS_ARM_NONE
+    decode_leg(buffer + 24, &record->client_proxy);
+    decode_leg(buffer + 52, &record->proxy_server);
+
+    if (record_size >= METRICS_BIN_RECORD_SIZE) {
+        decode_leg_ext(buffer + 80, &record->client_proxy);
+        decode_leg_ext(buffer + 104, &record->proxy_server);
+    } else {
+        clear_leg_ext(&record->client_proxy);
+        clear_leg_ext(&record->proxy_server);
+    }
+}
+
+const char* metrics_limited_code(uint8_t limited_by) {
+    static const char *codes[] = { "unknown", "app", "rwnd", "sndbuf", "network" };
+    return limited_by < sizeof(codes) / sizeof(codes[0]) ? codes[limited_by] : "unknown";
+}
+
+const char* metrics_arm_code(uint8_t arm) {
+    static const char *codes[] = { "none", "off", "model", "legacy" };
+    return arm < sizeof(codes) / sizeof(codes[0]) ? codes[arm] : "unknown";
+}
@@ -0,0 +1,472 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../include/relay.h"
+#include "../include/slab_pool.h"
+#include "../include/latency_profile.h"
+
+void relay_channel_init(RelayChannel *channel, RelayMode mode) {
+    channel->mode = mode;
+    channel->pipe_fds[0] = channel->pipe_fds[1] = -1;
+    channel->capacity = RELAY_BUFFER_INITIAL;
+    channel->pending = 0;
+    channel->start = 0;
+    channel->peak = 0;
+    channel->read_closed = 0;
+    channel->write_closed = 0;
+    channel->quickack = 0;
+    channel->hold_fin = 0;
+    channel->data = NULL;
+    channel->impairment = NULL;
+    channel->bandwidth = NULL;
+    channel->throttled = 0;
+    memset(&channel->quota, 0, sizeof(channel->quota));
+    channel->tls_source = NULL;
+    channel->tls_dest = NULL;
+    channel->delay = NULL;
+    channel->pending_since_ns = 0;
+    channel->trace_id = 0;
+    channel->trace_to_server = 0;
+    channel->blocked_since_ns = 0;
+    channel->paused_since_ns = 0;
+    channel->stall_reported = 0;
+
+    #ifdef SPLICE_F_MOVE
+        if (mode == RELAY_MODE_SPLICE) {
+            if (pipe2(channel->pipe_fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+                perror("[Relay] Erro ao criar pipe, usando modo cópia");
+                channel->pipe_fds[0] = channel->pipe_fds[1] = -1;
+                channel->mode = RELAY_MODE_COPY;
+            } else {
+                int pipe_size = fcntl(channel->pipe_fds[1], F_GETPIPE_SZ);
+                channel->capacity = pipe_size > 0 ? (size_t)pipe_size : RELAY_SPLICE_CHUNK;
+            }
+        }
+    #else
+        // Sem splice() (ex: macOS), sempre usa o modo cópia
+        channel->mode = RELAY_MODE_COPY;
+    #endif
+}
+
+int relay_channel_set_impairment(RelayChannel *channel, const ImpairmentParams *params, uint64_t seed) {
+    // Com taxa limitada, a fila comporta IMPAIR_QUEUE_LATENCY_MS de dados (como o "latency" do tbf)
+    size_t capacity = IMPAIR_BUFFER_SIZE;
+
+    if (params->rate_bytes_sec > 0) {
+        capacity = (size_t)(params->rate_bytes_sec * IMPAIR_QUEUE_LATENCY_MS / 1000.0);
+        if (capacity < IMPAIR_MIN_BUFFER_SIZE) capacity = IMPAIR_MIN_BUFFER_SIZE;
+        if (capacity > IMPAIR_BUFFER_SIZE) capacity = IMPAIR_BUFFER_SIZE;
+    }
+
+    ImpairmentState *state = malloc(sizeof(ImpairmentState));
+    char *data = malloc(capacity);
+
+    if (!state || !data) {
+        perror("[Relay] Erro ao alocar emulação de WAN");
+        free(state);
+        free(data);
+        return -1;
+    }
+
+    // A emulação só funciona no modo cópia: os bytes retidos precisam de um buffer próprio (fixo, fora do pool)
+    relay_channel_close(channel);
+    channel->mode = RELAY_MODE_COPY;
+
+    impairment_state_init(state, params, seed);
+    channel->impairment = state;
+    channel->data = data;
+    channel->capacity = capacity;
+    channel->start = 0;
+    return 0;
+}
+
+void relay_channel_set_tls(RelayChannel *channel, TlsSession *source, TlsSession *dest) {
+    channel->tls_source = source;
+    channel->tls_dest = dest;
+
+    // O splice move bytes crus do socket: serve para o kTLS (o kernel cifra), não para registros do OpenSSL
+    if (channel->mode == RELAY_MODE_SPLICE && (source || (dest && !tls_session_ktls_send(dest)))) {
+        if (channel->pipe_fds[0] >= 0) close(channel->pipe_fds[0]);
+        if (channel->pipe_fds[1] >= 0) close(channel->pipe_fds[1]);
+        channel->pipe_fds[0] = channel->pipe_fds[1] = -1;
+        channel->mode = RELAY_MODE_COPY;
+        channel->capacity = RELAY_BUFFER_INITIAL;
+    }
+}
+
+void relay_channel_set_trace(RelayChannel *channel, unsigned long connection_id, int to_server) {
+    channel->trace_id = connection_id;
+    channel->trace_to_server = to_server;
+}
+
+static FlightSide relay_source_side(const RelayChannel *channel) {
+    return channel->trace_to_server ? FLIGHT_SIDE_CLIENT : FLIGHT_SIDE_SERVER;
+}
+
+static FlightSide relay_dest_side(const RelayChannel *channel) {
+    return channel->trace_to_server ? FLIGHT_SIDE_SERVER : FLIGHT_SIDE_CLIENT;
+}
+
+// Resultado de uma leitura ou envio (bytes, ou -1 com o errno)
+static void relay_trace_io(const RelayChannel *channel, FlightEventType type, ssize_t result) {
+    if (!channel->trace_id) return;
+
+    FlightSide side = type == FLIGHT_EVENT_READ ? relay_source_side(channel) : relay_dest_side(channel);
+    flight_record(channel->trace_id, type, side, result < 0 ? errno : 0, result);
+}
+
+// Destino recusou (EAGAIN) com dados pendentes: começo da espera por EPOLLOUT/POLLOUT
+static void relay_trace_blocked(RelayChannel *channel) {
+    if (!channel->trace_id || channel->blocked_since_ns) return;
+
+    channel->blocked_since_ns = latency_now_ns();
+    flight_record_at(channel->blocked_since_ns, channel->trace_id, FLIGHT_EVENT_BLOCKED, relay_dest_side(channel), EAGAIN, (int64_t)channel->pending);
+}
+
+// Destino voltou a aceitar: a duração da espera, e a parada que terminou sem passar pelo monitor
+static void relay_trace_unblocked(RelayChannel *channel) {
+    if (!channel->blocked_since_ns) return;
+
+    uint64_t now = latency_now_ns();
+    uint64_t blocked = now - channel->blocked_since_ns;
+
+    flight_record_at(now, channel->trace_id, FLIGHT_EVENT_UNBLOCKED, relay_dest_side(channel), 0, (int64_t)blocked);
+    if (!channel->stall_reported) flight_recorder_stall(channel->trace_id, relay_dest_side(channel), blocked);
+
+    channel->blocked_since_ns = 0;
+    channel->stall_reported = 0;
+}
+
+void relay_check_stall(RelayChannel *channel) {
+    if (!channel->blocked_since_ns || channel->stall_reported) return;
+
+    channel->stall_reported = flight_recorder_stall(channel->trace_id, relay_dest_side(channel), latency_now_ns() - channel->blocked_since_ns);
+}
+
+void relay_channel_close(RelayChannel *channel) {
+    if (channel->pipe_fds[0] >= 0) close(channel->pipe_fds[0]);
+    if (channel->pipe_fds[1] >= 0) close(channel->pipe_fds[1]);
+    channel->pipe_fds[0] = channel->pipe_fds[1] = -1;
+
+    if (channel->impairment) {
+        free(channel->impairment);
+        free(channel->data);
+        channel->impairment = NULL;
+    } else if (channel->data) {
+        slab_free(channel->data, channel->capacity);
+    }
+
+    channel->data = NULL;
+}
+
+// Modo cópia: pega o buffer do pool quando a direção volta a ter dados para ler
+static int relay_acquire_buffer(RelayChannel *channel) {
+    if (channel->data) return 0;
+
+    channel->data = slab_alloc(channel->capacity);
+    if (!channel->data) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    channel->start = 0;
+    channel->peak = 0;
+    return 0;
+}
+
+// Canal vazio devolve o buffer ao pool. O tamanho da próxima alocação acompanha o uso:
+// dobra se a leitura encheu o buffer (há mais dados por evento do que cabia) e cai pela metade se mal foi usado
+static void relay_release_buffer(RelayChannel *channel) {
+    if (!channel->data || channel->impairment || channel->pending > 0) return;
+
+    slab_free(channel->data, channel->capacity);
+    channel->data = NULL;
+
+    if (channel->peak >= channel->capacity && channel->capacity < RELAY_BUFFER_MAX) {
+        channel->capacity *= 2;
+    } else if (channel->peak <= channel->capacity / 4 && channel->capacity > RELAY_BUFFER_INITIAL) {
+        channel->capacity /= 2;
+    }
+}
+
+// Troca o canal (vazio) para o modo cópia quando o kernel recusa o splice
+static void relay_fallback_to_copy(RelayChannel *channel) {
+    fprintf(stderr, "[Relay] splice() indisponível para este socket, usando modo cópia\n");
+    relay_channel_close(channel);
+    channel->mode = RELAY_MODE_COPY;
+    channel->capacity = RELAY_BUFFER_INITIAL;
+    channel->start = 0;
+}
+
+// Primeiro bloco com o canal vazio: início da amostra de atraso que termina quando o canal esvaziar
+static void relay_mark_arrival(RelayChannel *channel, ssize_t bytes_read) {
+    if (channel->delay && channel->pending == (size_t)bytes_read) channel->pending_since_ns = latency_now_ns();
+}
+
+// Lê da origem até limit bytes (limit cabe no espaço livre do canal)
+static ssize_t relay_read_limited(RelayChannel *channel, int src_fd, size_t limit) {
+    ssize_t bytes_read;
+    size_t space = limit;
+
+    #ifdef SPLICE_F_MOVE
+        if (channel->mode == RELAY_MODE_SPLICE) {
+            do {
+                bytes_read = splice(src_fd, NULL, channel->pipe_fds[1], NULL, space, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            } while (bytes_read < 0 && errno == EINTR);
+
+            if (bytes_read >= 0 || (errno != EINVAL && errno != ENOSYS) || channel->pending > 0) {
+                if (bytes_read > 0) {
+                    channel->pending += bytes_read;
+                    relay_mark_arrival(channel, bytes_read);
+                }
+                return bytes_read;
+            }
+
+            relay_fallback_to_copy(channel);
+            space = limit < channel->capacity ? limit : channel->capacity;
+        }
+    #endif
+
+    if (relay_acquire_buffer(channel) < 0) return -1;
+
+    // Espaço livre do buffer circular: do fim dos dados até o fim do buffer, e do início até os dados
+    size_t tail = (channel->start + channel->pending) % channel->capacity;
+    struct iovec iov[2];
+    int iov_count = 1;
+
+    iov[0].iov_base = channel->data + tail;
+
+    if (tail >= channel->start) {
+        iov[0].iov_len = channel->capacity - tail;
+        iov[1].iov_base = channel->data;
+        iov[1].iov_len = channel->start;
+    } else {
+        iov[0].iov_len = channel->start - tail;
+        iov[1].iov_len = 0;
+    }
+
+    if (iov[0].iov_len > space) iov[0].iov_len = space;
+    if (iov[1].iov_len > space - iov[0].iov_len) iov[1].iov_len = space - iov[0].iov_len;
+    if (iov[1].iov_len > 0) iov_count = 2;
+
+    do {
+        // O SSL_read entrega no máximo um registro por chamada: basta o primeiro trecho livre
+        if (channel->tls_source) bytes_read = tls_session_read(channel->tls_source, iov[0].iov_base, iov[0].iov_len);
+        else bytes_read = readv(src_fd, iov, iov_count);
+    } while (bytes_read < 0 && errno == EINTR);
+
+    if (bytes_read > 0) {
+        channel->pending += bytes_read;
+        relay_mark_arrival(channel, bytes_read);
+        if (channel->pending > channel->peak) channel->peak = channel->pending;
+        if (channel->impairment) impairment_enqueue(channel->impairment, bytes_read, impairment_now_us());
+    }
+
+    return bytes_read;
+}
+
+ssize_t relay_read(RelayChannel *channel, int src_fd) {
+    size_t space = channel->capacity - channel->pending;
+
+    if (space == 0 || (channel->impairment && !impairment_can_enqueue(channel->impairment))) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    if (!channel->bandwidth) {
+        ssize_t bytes_read = relay_read_limited(channel, src_fd, space);
+        relay_trace_io(channel, FLIGHT_EVENT_READ, bytes_read);
+        return bytes_read;
+    }
+
+    // Escalonador de banda: só lê o que os tokens do cliente permitem agora; o resto fica no
+    // buffer de recepção do socket e a janela anunciada à origem encolhe
+    size_t granted = bandwidth_take(channel->bandwidth, &channel->quota, space);
+
+    if (granted == 0) {
+        channel->throttled = 1;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    ssize_t bytes_read = relay_read_limited(channel, src_fd, granted);
+    int saved_errno = errno;
+
+    relay_trace_io(channel, FLIGHT_EVENT_READ, bytes_read);
+
+    // Sem borda nova do epoll, quem parou nos tokens com dados na origem é bombeado de novo pela espera
+    channel->throttled = bytes_read > 0 && (size_t)bytes_read == granted && granted < space;
+
+    bandwidth_settle(channel->bandwidth, &channel->quota, space, granted, bytes_read > 0 ? (size_t)bytes_read : 0);
+    errno = saved_errno;
+    return bytes_read;
+}
+
+int relay_flush(RelayChannel *channel, int dest_fd) {
+    while (channel->pending > 0) {
+        ssize_t sent;
+
+        // Com emulação, só os bytes cujo atraso já passou (e que cabem na taxa) podem sair
+        size_t sendable = channel->impairment ? impairment_sendable(channel->impairment, impairment_now_us()) : channel->pending;
+        if (sendable == 0) return 0;
+
+        #ifdef SPLICE_F_MOVE
+            if (channel->mode == RELAY_MODE_SPLICE) {
+                sent = splice(channel->pipe_fds[0], NULL, dest_fd, NULL, channel->pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            } else
+        #endif
+            {
+                // Dados pendentes podem dar a volta no buffer circular
+                struct iovec iov[2];
+                struct msghdr message;
+                size_t first = channel->capacity - channel->start;
+
+                memset(&message, 0, sizeof(message));
+                iov[0].iov_base = channel->data + channel->start;
+                iov[0].iov_len = sendable < first ? sendable : first;
+                iov[1].iov_base = channel->data;
+                iov[1].iov_len = sendable - iov[0].iov_len;
+                message.msg_iov = iov;
+                message.msg_iovlen = iov[1].iov_len > 0 ? 2 : 1;
+
+                // O primeiro trecho só cresce entre tentativas, como o SSL_write exige depois de EAGAIN
+                if (channel->tls_dest && !tls_session_ktls_send(channel->tls_dest)) {
+                    sent = tls_session_write(channel->tls_dest, iov[0].iov_base, iov[0].iov_len);
+                } else {
+                    sent = sendmsg(dest_fd, &message, MSG_NOSIGNAL);
+                }
+            }
+
+        if (sent < 0 && errno == EINTR) continue;
+        relay_trace_io(channel, FLIGHT_EVENT_WRITE, sent);
+
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                relay_trace_blocked(channel);
+                return 0;
+            }
+            return -1;
+        }
+
+        relay_trace_unblocked(channel);
+
+        channel->start = (channel->start + sent) % channel->capacity;
+        channel->pending -= sent;
+        if (channel->impairment) impairment_consume(channel->impairment, sent);
+    }
+
+    // Buffer vazio: recomeça do início para maximizar leituras contíguas
+    channel->start = 0;
+
+    if (channel->pending_since_ns) {
+        uint64_t delay = latency_now_ns() - channel->pending_since_ns;
+
+        latency_record(LATENCY_RELAY, delay);
+        latency_summary_add(channel->delay, delay);
+        channel->pending_since_ns = 0;
+    }
+    return 0;
+}
+
+int relay_pump(RelayChannel *channel, int src_fd, int dest_fd, unsigned long *byte_counter) {
+    if (relay_flush(channel, dest_fd) < 0) return -1;
+
+    unsigned long bytes_before = *byte_counter;
+
+    // O destino levou parte do que estava pendente: a origem volta a ser lida
+    if (channel->paused_since_ns && channel->pending < channel->capacity) {
+        uint64_t now = latency_now_ns();
+        flight_record_at(now, channel->trace_id, FLIGHT_EVENT_RESUMED, relay_source_side(channel), 0, (int64_t)(now - channel->paused_since_ns));
+        channel->paused_since_ns = 0;
+    }
+
+    // Lê enquanto houver espaço; o que o destino não aceitar fica no canal
+    while (!channel->read_closed && channel->pending < channel->capacity) {
+        ssize_t bytes_read = relay_read(channel, src_fd);
+
+        if (bytes_read == 0) {
+            channel->read_closed = 1; // FIN da origem
+            break;
+        }
+
+        if (bytes_read < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+
+        *byte_counter += bytes_read;
+
+        if (relay_flush(channel, dest_fd) < 0) return -1;
+
+        // Leitura encheu o buffer e o destino levou tudo: troca por um maior antes da próxima leitura
+        if (channel->pending == 0 && channel->peak >= channel->capacity) relay_release_buffer(channel);
+    }
+
+    // Canal cheio (backpressure): a origem só volta a ser lida quando o destino aceitar mais
+    if (channel->trace_id && !channel->read_closed && channel->pending >= channel->capacity && !channel->paused_since_ns) {
+        channel->paused_since_ns = latency_now_ns();
+        flight_record_at(channel->paused_since_ns, channel->trace_id, FLIGHT_EVENT_PAUSED, relay_source_side(channel), 0, (int64_t)channel->pending);
+    }
+
+    // A origem recebe o ACK agora, não após o atraso do delayed ACK (uma chamada por rodada, não por leitura)
+    if (channel->quickack && *byte_counter != bytes_before) latency_quickack(src_fd);
+
+    // Tudo entregue: a direção não precisa de buffer até a origem enviar de novo
+    if (channel->pending == 0) relay_release_buffer(channel);
+
+    // Half-close: só propaga o FIN depois de entregar tudo que a origem enviou
+    if (channel->read_closed && channel->pending == 0 && !channel->write_closed && !channel->hold_fin) {
+        if (channel->tls_dest) tls_session_shutdown(channel->tls_dest);
+        shutdown(dest_fd, SHUT_WR);
+        channel->write_closed = 1;
+        if (channel->trace_id) flight_record(channel->trace_id, FLIGHT_EVENT_SHUTDOWN, relay_dest_side(channel), 0, 0);
+    }
+
+    return 0;
+}
+
+int relay_wants_read(const RelayChannel *channel) {
+    return !channel->read_closed && channel->pending < channel->capacity &&
+           !(channel->bandwidth && bandwidth_blocked(channel->bandwidth, &channel->quota));
+}
+
+int relay_wants_write(RelayChannel *channel) {
+    if (channel->pending == 0) return 0;
+    return !channel->impairment || impairment_sendable(channel->impairment, impairment_now_us()) > 0;
+}
+
+int relay_wait_ms(RelayChannel *channel) {
+    int wait = -1;
+
+    if (channel->impairment && channel->pending > 0) wait = impairment_wait_ms(channel->impairment, impairment_now_us());
+
+    // Leitura parada por falta de tokens: volta quando o escalonador repuser a parcela do cliente
+    if (channel->throttled && !channel->read_closed && channel->pending < channel->capacity) {
+        int refill = bandwidth_blocked(channel->bandwidth, &channel->quota) ? bandwidth_wait_ms() : 0;
+        if (wait < 0 || refill < wait) wait = refill;
+    }
+
+    // O resto de um registro já decifrado está no OpenSSL, não no socket: o poll() não acordaria para ele
+    if (channel->tls_source && relay_wants_read(channel) && tls_session_pending(channel->tls_source) > 0) wait = 0;
+
+    return wait;
+}
+
+int relay_is_done(const RelayChannel *channel) {
+    return channel->write_closed;
+}
+
+size_t relay_buffer_bytes(const RelayChannel *channel) {
+    if (!channel->data) return 0;
+    return channel->impairment ? channel->capacity : slab_class_size(channel->capacity);
+}
+
+const char* relay_mode_name(RelayMode mode) {
+    return mode == RELAY_MODE_SPLICE ? "splice" : "cópia";
+}
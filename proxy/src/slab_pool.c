@@ -0,0 +1,263 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "../include/slab_pool.h"
+
+#define SLAB_MIN_OBJECT 64
+#define SLAB_CLASS_COUNT 25        // 64, 96, 128, 192, ... , 192 KB, 256 KB (potências de 2 e 1,5x)
+#define SLAB_RELEASE_MIN (16 * 1024) // Só classes com várias páginas devolvem memória ao kernel
+
+// Estado global de uma classe: lista de livres "quentes", lista de livres sem páginas e o chunk em uso
+typedef struct {
+    pthread_mutex_t lock;
+    size_t size;
+    void *free_list;
+    size_t free_bytes;
+    void *cold_list;               // Livres cujas páginas (exceto a primeira) já voltaram ao kernel
+    char *chunk_cursor;
+    size_t chunk_left;
+} SlabClass;
+
+// Cache local de uma classe: objetos livres que a thread reutiliza sem lock
+typedef struct {
+    void *head;
+    unsigned count;
+} SlabCache;
+
+static SlabClass classes[SLAB_CLASS_COUNT];
+static pthread_once_t classes_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static __thread SlabCache thread_cache[SLAB_CLASS_COUNT];
+static __thread int thread_cache_registered = 0;
+
+static size_t stat_in_use = 0;
+static size_t stat_reserved = 0;
+static size_t stat_released = 0;
+static unsigned long stat_objects = 0;
+
+static size_t page_size = 4096;
+
+// Encadeamento das listas de livres: fica na primeira palavra do próprio objeto
+static inline void* slab_next(void *object) {
+    return *(void**)object;
+}
+
+static inline void slab_set_next(void *object, void *next) {
+    *(void**)object = next;
+}
+
+static void slab_thread_exit(void *unused);
+
+static void slab_init_classes(void) {
+    size_t size = SLAB_MIN_OBJECT;
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        // Alterna entre a potência de 2 e 1,5x ela: desperdício máximo de ~33% por objeto
+        classes[i].size = (i % 2 == 0) ? size : size + size / 2;
+        if (i % 2 == 1) size *= 2;
+        pthread_mutex_init(&classes[i].lock, NULL);
+    }
+
+    long system_page = sysconf(_SC_PAGESIZE);
+    if (system_page > 0) page_size = (size_t)system_page;
+
+    pthread_key_create(&cache_key, slab_thread_exit);
+}
+
+static int slab_class_index(size_t size) {
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        if (size <= classes[i].size) return i;
+    }
+    return -1;
+}
+
+size_t slab_class_size(size_t size) {
+    pthread_once(&classes_once, slab_init_classes);
+    int index = slab_class_index(size);
+    return index >= 0 ? classes[index].size : size;
+}
+
+// Devolve ao kernel as páginas de um objeto livre, mantendo a primeira (onde fica o encadeamento)
+static void slab_release_pages(SlabClass *slab_class, void *object) {
+    madvise((char*)object + page_size, slab_class->size - page_size, MADV_DONTNEED);
+    __atomic_add_fetch(&stat_released, slab_class->size - page_size, __ATOMIC_RELAXED);
+}
+
+// Coloca um objeto na lista global da classe (lock já adquirido)
+static void slab_push_global(SlabClass *slab_class, void *object) {
+    if (slab_class->size >= SLAB_RELEASE_MIN && slab_class->free_bytes >= SLAB_IDLE_BYTES) {
+        slab_release_pages(slab_class, object);
+        slab_set_next(object, slab_class->cold_list);
+        slab_class->cold_list = object;
+        return;
+    }
+
+    slab_set_next(object, slab_class->free_list);
+    slab_class->free_list = object;
+    slab_class->free_bytes += slab_class->size;
+}
+
+// Retira um objeto da classe: livre quente, livre frio ou um pedaço novo do chunk (lock já adquirido)
+static void* slab_pop_global(SlabClass *slab_class) {
+    void *object = slab_class->free_list;
+
+    if (object) {
+        slab_class->free_list = slab_next(object);
+        slab_class->free_bytes -= slab_class->size;
+        return object;
+    }
+
+    object = slab_class->cold_list;
+
+    if (object) {
+        slab_class->cold_list = slab_next(object);
+        __atomic_sub_fetch(&stat_released, slab_class->size - page_size, __ATOMIC_RELAXED);
+        return object;
+    }
+
+    if (slab_class->chunk_left < slab_class->size) {
+        size_t chunk_size = SLAB_CHUNK_SIZE - SLAB_CHUNK_SIZE % slab_class->size;
+        char *chunk = mmap(NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (chunk == MAP_FAILED) return NULL;
+
+        slab_class->chunk_cursor = chunk;
+        slab_class->chunk_left = chunk_size;
+        __atomic_add_fetch(&stat_reserved, chunk_size, __ATOMIC_RELAXED);
+    }
+
+    object = slab_class->chunk_cursor;
+    slab_class->chunk_cursor += slab_class->size;
+    slab_class->chunk_left -= slab_class->size;
+    return object;
+}
+
+static unsigned slab_cache_limit(const SlabClass *slab_class) {
+    unsigned limit = (unsigned)(SLAB_THREAD_CACHE_BYTES / slab_class->size);
+    return limit < 4 ? 4 : limit;
+}
+
+// Devolve `count` objetos do cache local para a lista global
+static void slab_cache_flush(int index, unsigned count) {
+    SlabCache *cache = &thread_cache[index];
+    SlabClass *slab_class = &classes[index];
+
+    pthread_mutex_lock(&slab_class->lock);
+    while (count-- > 0 && cache->head) {
+        void *object = cache->head;
+        cache->head = slab_next(object);
+        cache->count--;
+        slab_push_global(slab_class, object);
+    }
+    pthread_mutex_unlock(&slab_class->lock);
+}
+
+// Threads que terminam (engine threads) devolvem o cache para as outras reaproveitarem
+static void slab_thread_exit(void *unused) {
+    (void)unused;
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        if (thread_cache[i].count > 0) slab_cache_flush(i, thread_cache[i].count);
+    }
+}
+
+void* slab_alloc(size_t size) {
+    pthread_once(&classes_once, slab_init_classes);
+
+    int index = slab_class_index(size);
+
+    if (index < 0) {
+        void *object = malloc(size);
+        if (object) {
+            __atomic_add_fetch(&stat_in_use, size, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&stat_objects, 1, __ATOMIC_RELAXED);
+        }
+        return object;
+    }
+
+    if (!thread_cache_registered) {
+        pthread_setspecific(cache_key, thread_cache);
+        thread_cache_registered = 1;
+    }
+
+    SlabClass *slab_class = &classes[index];
+    SlabCache *cache = &thread_cache[index];
+
+    // Cache vazio: busca meio cache de uma vez para amortizar o lock
+    if (!cache->head) {
+        unsigned batch = slab_cache_limit(slab_class) / 2;
+
+        pthread_mutex_lock(&slab_class->lock);
+        for (unsigned i = 0; i < batch; i++) {
+            void *object = slab_pop_global(slab_class);
+            if (!object) break;
+            slab_set_next(object, cache->head);
+            cache->head = object;
+            cache->count++;
+        }
+        pthread_mutex_unlock(&slab_class->lock);
+
+        if (!cache->head) return NULL;
+    }
+
+    void *object = cache->head;
+    cache->head = slab_next(object);
+    cache->count--;
+
+    __atomic_add_fetch(&stat_in_use, slab_class->size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stat_objects, 1, __ATOMIC_RELAXED);
+    return object;
+}
+
+void slab_free(void *ptr, size_t size) {
+    if (!ptr) return;
+
+    int index = slab_class_index(size);
+
+    if (index < 0) {
+        free(ptr);
+        __atomic_sub_fetch(&stat_in_use, size, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&stat_objects, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    SlabClass *slab_class = &classes[index];
+    SlabCache *cache = &thread_cache[index];
+
+    if (!thread_cache_registered) {
+        pthread_setspecific(cache_key, thread_cache);
+        thread_cache_registered = 1;
+    }
+
+    slab_set_next(ptr, cache->head);
+    cache->head = ptr;
+    cache->count++;
+
+    __atomic_sub_fetch(&stat_in_use, slab_class->size, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&stat_objects, 1, __ATOMIC_RELAXED);
+
+    // Cache cheio: metade volta para a lista global (e pode chegar a outro worker)
+    unsigned limit = slab_cache_limit(slab_class);
+    if (cache->count > limit) slab_cache_flush(index, cache->count - limit / 2);
+}
+
+void slab_get_stats(SlabStats *stats) {
+    stats->in_use_bytes = __atomic_load_n(&stat_in_use, __ATOMIC_RELAXED);
+    stats->reserved_bytes = __atomic_load_n(&stat_reserved, __ATOMIC_RELAXED);
+    stats->released_bytes = __atomic_load_n(&stat_released, __ATOMIC_RELAXED);
+    stats->objects = __atomic_load_n(&stat_objects, __ATOMIC_RELAXED);
+}
+
+size_t slab_process_rss(void) {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+
+    unsigned long total_pages = 0, resident_pages = 0;
+    int fields = fscanf(statm, "%lu %lu", &total_pages, &resident_pages);
+    fclose(statm);
+
+    return fields == 2 ? resident_pages * page_size : 0;
+}
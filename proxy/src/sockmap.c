@@ -0,0 +1,408 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>   // struct tcp_info completa (tcpi_bytes_acked)
+#include <linux/bpf.h>
+#include <linux/sockios.h>
+
+#include "../include/sockmap.h"
+
+#define SOCKMAP_LOG_SIZE 4096            // Log do verificador guardado quando o carregamento falha
+
+// Chave da tabela de pares: a conexão vista pelo socket que recebe (campos de __sk_buff)
+typedef struct {
+    uint32_t remote_ip4;                 // Ordem de rede
+    uint32_t local_ip4;                  // Ordem de rede
+    uint32_t remote_port;                // Ordem de rede; em little-endian o kernel entrega a porta nos 16 bits altos
+    uint32_t local_port;                 // Ordem do host
+} SockmapKey;
+
+// Valor da tabela de pares: para onde redirecionar e onde contar os bytes
+typedef struct {
+    uint32_t peer_index;                 // Índice do outro socket do par no sockmap
+    uint32_t own_index;                  // Índice deste socket (contador de bytes recebidos)
+} SockmapPeer;
+
+// Vaga de um par: o cliente fica no índice 2*vaga do sockmap e o servidor em 2*vaga+1
+typedef struct {
+    SockmapKey client_key;
+    SockmapKey server_key;
+} SockmapSlot;
+
+static int sock_map_fd = -1;             // BPF_MAP_TYPE_SOCKMAP com os sockets
+static int peer_map_fd = -1;             // BPF_MAP_TYPE_HASH: SockmapKey -> SockmapPeer
+static int bytes_map_fd = -1;            // BPF_MAP_TYPE_ARRAY: bytes recebidos por índice do sockmap
+static int program_fd = -1;
+
+static SockmapSlot *slots = NULL;
+static int *free_slots = NULL;           // Pilha de vagas livres
+static int free_count = 0;
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long stat_active = 0;
+static unsigned long stat_attached = 0;
+static unsigned long stat_refused = 0;
+
+// Montagem das instruções eBPF (os mesmos campos de struct bpf_insn que o clang geraria)
+#define INSN(CODE, DST, SRC, OFF, IMM) \
+    ((struct bpf_insn){ .code = (CODE), .dst_reg = (DST), .src_reg = (SRC), .off = (OFF), .imm = (IMM) })
+#define MOV64_REG(DST, SRC)        INSN(BPF_ALU64 | BPF_MOV | BPF_X, DST, SRC, 0, 0)
+#define MOV64_IMM(DST, IMM)        INSN(BPF_ALU64 | BPF_MOV | BPF_K, DST, 0, 0, IMM)
+#define ADD64_IMM(DST, IMM)        INSN(BPF_ALU64 | BPF_ADD | BPF_K, DST, 0, 0, IMM)
+#define LDX_W(DST, SRC, OFF)       INSN(BPF_LDX | BPF_W | BPF_MEM, DST, SRC, OFF, 0)
+#define STX_W(DST, SRC, OFF)       INSN(BPF_STX | BPF_W | BPF_MEM, DST, SRC, OFF, 0)
+#define ATOMIC_ADD_DW(DST, SRC)    INSN(BPF_STX | BPF_DW | BPF_ATOMIC, DST, SRC, 0, BPF_ADD)
+#define LD_MAP_FD(DST, FD)         INSN(BPF_LD | BPF_DW | BPF_IMM, DST, BPF_PSEUDO_MAP_FD, 0, FD), INSN(0, 0, 0, 0, 0)
+#define JEQ_IMM(DST, IMM, OFF)     INSN(BPF_JMP | BPF_JEQ | BPF_K, DST, 0, OFF, IMM)
+#define JNE_IMM(DST, IMM, OFF)     INSN(BPF_JMP | BPF_JNE | BPF_K, DST, 0, OFF, IMM)
+#define CALL(FUNC)                 INSN(BPF_JMP | BPF_CALL, 0, 0, 0, FUNC)
+#define EXIT()                     INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+#define SKB_FIELD(FIELD) ((int16_t)offsetof(struct __sk_buff, FIELD))
+
+static long bpf_call(int command, union bpf_attr *attr) {
+    return syscall(__NR_bpf, command, attr, sizeof(*attr));
+}
+
+static int sockmap_create_map(uint32_t type, uint32_t key_size, uint32_t value_size, uint32_t max_entries, const char *name) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = type;
+    attr.key_size = key_size;
+    attr.value_size = value_size;
+    attr.max_entries = max_entries;
+    snprintf(attr.map_name, sizeof(attr.map_name), "%s", name);
+    return (int)bpf_call(BPF_MAP_CREATE, &attr);
+}
+
+static int sockmap_update(int map_fd, const void *key, const void *value) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = (uint64_t)(uintptr_t)key;
+    attr.value = (uint64_t)(uintptr_t)value;
+    attr.flags = BPF_ANY;
+    return (int)bpf_call(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+static int sockmap_lookup(int map_fd, const void *key, void *value) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = (uint64_t)(uintptr_t)key;
+    attr.value = (uint64_t)(uintptr_t)value;
+    return (int)bpf_call(BPF_MAP_LOOKUP_ELEM, &attr);
+}
+
+static void sockmap_delete(int map_fd, const void *key) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = (uint64_t)(uintptr_t)key;
+    bpf_call(BPF_MAP_DELETE_ELEM, &attr);
+}
+
+/**
+ * Programa de veredito (sk_skb), para cada segmento recebido por um socket do sockmap:
+ *   skb->len == 0 -> SK_DROP (só o FIN, que o estado TCP do socket já registrou: redirecionado ou
+ *                    devolvido à fila do socket, o kernel o trata como EPIPE e descarta o que ainda
+ *                    espera na fila de saída; o relay vê o fim pelo EPOLLRDHUP/recv 0 de sempre)
+ *   peer = peers[4-tupla do socket]; sem par ainda -> SK_PASS (fica na fila do próprio socket)
+ *   bytes[peer.own_index] += skb->len
+ *   return bpf_sk_redirect_map(skb, sockmap, peer.peer_index, 0)  // saída do outro socket
+ */
+static int sockmap_load_program(char *log, size_t log_len, int with_log) {
+    struct bpf_insn program[] = {
+        MOV64_REG(BPF_REG_6, BPF_REG_1),
+
+        // Segmento sem dados (FIN): descartado, o estado do socket já registrou o fim
+        LDX_W(BPF_REG_2, BPF_REG_6, SKB_FIELD(len)),
+        JNE_IMM(BPF_REG_2, 0, 2),
+        MOV64_IMM(BPF_REG_0, SK_DROP),
+        EXIT(),
+
+        // Chave na pilha (r10 - 16): a conexão vista por este socket
+        LDX_W(BPF_REG_2, BPF_REG_6, SKB_FIELD(remote_ip4)),
+        STX_W(BPF_REG_10, BPF_REG_2, -16),
+        LDX_W(BPF_REG_2, BPF_REG_6, SKB_FIELD(local_ip4)),
+        STX_W(BPF_REG_10, BPF_REG_2, -12),
+        LDX_W(BPF_REG_2, BPF_REG_6, SKB_FIELD(remote_port)),
+        STX_W(BPF_REG_10, BPF_REG_2, -8),
+        LDX_W(BPF_REG_2, BPF_REG_6, SKB_FIELD(local_port)),
+        STX_W(BPF_REG_10, BPF_REG_2, -4),
+
+        LD_MAP_FD(BPF_REG_1, peer_map_fd),
+        MOV64_REG(BPF_REG_2, BPF_REG_10),
+        ADD64_IMM(BPF_REG_2, -16),
+        CALL(BPF_FUNC_map_lookup_elem),
+        JNE_IMM(BPF_REG_0, 0, 2),
+        MOV64_IMM(BPF_REG_0, SK_PASS),
+        EXIT(),
+        MOV64_REG(BPF_REG_7, BPF_REG_0),
+
+        // Contador de bytes recebidos por este socket (r10 - 20 = own_index)
+        LDX_W(BPF_REG_2, BPF_REG_7, offsetof(SockmapPeer, own_index)),
+        STX_W(BPF_REG_10, BPF_REG_2, -20),
+        LD_MAP_FD(BPF_REG_1, bytes_map_fd),
+        MOV64_REG(BPF_REG_2, BPF_REG_10),
+        ADD64_IMM(BPF_REG_2, -20),
+        CALL(BPF_FUNC_map_lookup_elem),
+        JEQ_IMM(BPF_REG_0, 0, 2),
+        LDX_W(BPF_REG_1, BPF_REG_6, SKB_FIELD(len)),
+        ATOMIC_ADD_DW(BPF_REG_0, BPF_REG_1),
+
+        // Redireciona para a saída do outro socket do par
+        LDX_W(BPF_REG_3, BPF_REG_7, offsetof(SockmapPeer, peer_index)),
+        MOV64_REG(BPF_REG_1, BPF_REG_6),
+        LD_MAP_FD(BPF_REG_2, sock_map_fd),
+        MOV64_IMM(BPF_REG_4, 0),
+        CALL(BPF_FUNC_sk_redirect_map),
+        EXIT(),
+    };
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_SK_SKB;
+    attr.insns = (uint64_t)(uintptr_t)program;
+    attr.insn_cnt = sizeof(program) / sizeof(program[0]);
+    attr.license = (uint64_t)(uintptr_t)"GPL";
+    if (with_log) {
+        attr.log_buf = (uint64_t)(uintptr_t)log;
+        attr.log_size = (uint32_t)log_len;
+        attr.log_level = 1;
+    }
+    snprintf(attr.prog_name, sizeof(attr.prog_name), "proxy_verdict");
+
+    return (int)bpf_call(BPF_PROG_LOAD, &attr);
+}
+
+static void sockmap_cleanup(void) {
+    if (program_fd >= 0) close(program_fd);
+    if (sock_map_fd >= 0) close(sock_map_fd);
+    if (peer_map_fd >= 0) close(peer_map_fd);
+    if (bytes_map_fd >= 0) close(bytes_map_fd);
+    program_fd = sock_map_fd = peer_map_fd = bytes_map_fd = -1;
+
+    free(slots);
+    free(free_slots);
+    slots = NULL;
+    free_slots = NULL;
+}
+
+int sockmap_init(char *reason, size_t reason_len) {
+    uint32_t sockets = 2 * SOCKMAP_MAX_PAIRS;
+
+    sock_map_fd = sockmap_create_map(BPF_MAP_TYPE_SOCKMAP, sizeof(uint32_t), sizeof(uint32_t), sockets, "proxy_socks");
+    if (sock_map_fd < 0) {
+        snprintf(reason, reason_len, "sockmap não criado (%s)", strerror(errno));
+        sockmap_cleanup();
+        return -1;
+    }
+
+    peer_map_fd = sockmap_create_map(BPF_MAP_TYPE_HASH, sizeof(SockmapKey), sizeof(SockmapPeer), sockets, "proxy_peers");
+    bytes_map_fd = sockmap_create_map(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t), sizeof(uint64_t), sockets, "proxy_bytes");
+
+    if (peer_map_fd < 0 || bytes_map_fd < 0) {
+        snprintf(reason, reason_len, "mapas BPF não criados (%s)", strerror(errno));
+        sockmap_cleanup();
+        return -1;
+    }
+
+    program_fd = sockmap_load_program(NULL, 0, 0);
+    if (program_fd < 0) {
+        // Carrega de novo só para obter o log do verificador (a última linha costuma dizer o motivo)
+        int load_errno = errno;
+        char *log = calloc(1, SOCKMAP_LOG_SIZE);
+        if (log) sockmap_load_program(log, SOCKMAP_LOG_SIZE, 1);
+
+        char *last_line = log ? strrchr(log, '\n') : NULL;
+        while (last_line && last_line > log && last_line[1] == '\0') {
+            *last_line = '\0';
+            last_line = strrchr(log, '\n');
+        }
+        snprintf(reason, reason_len, "programa sk_skb recusado (%s)%s%s", strerror(load_errno),
+                 log && log[0] ? ": " : "", log ? (last_line ? last_line + 1 : log) : "");
+        free(log);
+        sockmap_cleanup();
+        return -1;
+    }
+
+    // Veredito sem stream parser: cada segmento é redirecionado como chegou
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.target_fd = sock_map_fd;
+    attr.attach_bpf_fd = program_fd;
+    attr.attach_type = BPF_SK_SKB_VERDICT;
+
+    if (bpf_call(BPF_PROG_ATTACH, &attr) < 0) {
+        snprintf(reason, reason_len, "programa não anexado ao sockmap (%s)", strerror(errno));
+        sockmap_cleanup();
+        return -1;
+    }
+
+    slots = calloc(SOCKMAP_MAX_PAIRS, sizeof(SockmapSlot));
+    free_slots = malloc(SOCKMAP_MAX_PAIRS * sizeof(int));
+
+    if (!slots || !free_slots) {
+        snprintf(reason, reason_len, "sem memória");
+        sockmap_cleanup();
+        return -1;
+    }
+
+    // Vagas baixas primeiro (topo da pilha)
+    for (int i = 0; i < SOCKMAP_MAX_PAIRS; i++) free_slots[i] = SOCKMAP_MAX_PAIRS - 1 - i;
+    free_count = SOCKMAP_MAX_PAIRS;
+    return 0;
+}
+
+int sockmap_available(void) {
+    return program_fd >= 0;
+}
+
+// A chave que o programa monta para um segmento recebido por este socket
+static int sockmap_socket_key(int sock_fd, SockmapKey *key) {
+    struct sockaddr_in local, remote;
+    socklen_t local_len = sizeof(local), remote_len = sizeof(remote);
+
+    if (getsockname(sock_fd, (struct sockaddr*)&local, &local_len) < 0 || local.sin_family != AF_INET) return -1;
+    if (getpeername(sock_fd, (struct sockaddr*)&remote, &remote_len) < 0 || remote.sin_family != AF_INET) return -1;
+
+    memset(key, 0, sizeof(*key));
+    key->remote_ip4 = remote.sin_addr.s_addr;
+    key->local_ip4 = local.sin_addr.s_addr;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    key->remote_port = (uint32_t)remote.sin_port << 16;
+#else
+    key->remote_port = remote.sin_port;
+#endif
+    key->local_port = ntohs(local.sin_port);
+    return 0;
+}
+
+// Dados já na fila de recepção (antes ou durante a entrada no sockmap) ficam com o relay
+static int sockmap_socket_has_data(int sock_fd) {
+    char byte;
+    return recv(sock_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) > 0;
+}
+
+static void sockmap_release_slot(int slot) {
+    pthread_mutex_lock(&slots_lock);
+    free_slots[free_count++] = slot;
+    pthread_mutex_unlock(&slots_lock);
+}
+
+int sockmap_attach(int client_socket, int server_socket) {
+    if (!sockmap_available()) return SOCKMAP_REFUSED;
+
+    SockmapKey client_key, server_key;
+
+    if (sockmap_socket_key(client_socket, &client_key) < 0 || sockmap_socket_key(server_socket, &server_key) < 0) {
+        __atomic_add_fetch(&stat_refused, 1, __ATOMIC_RELAXED);
+        return SOCKMAP_REFUSED;
+    }
+
+    if (sockmap_socket_has_data(client_socket) || sockmap_socket_has_data(server_socket)) return SOCKMAP_BUSY;
+
+    pthread_mutex_lock(&slots_lock);
+    int slot = free_count > 0 ? free_slots[--free_count] : -1;
+    pthread_mutex_unlock(&slots_lock);
+
+    if (slot < 0) {
+        __atomic_add_fetch(&stat_refused, 1, __ATOMIC_RELAXED);
+        return SOCKMAP_REFUSED;
+    }
+
+    uint32_t client_index = 2 * (uint32_t)slot, server_index = client_index + 1;
+    uint32_t client_fd = (uint32_t)client_socket, server_fd = (uint32_t)server_socket;
+    uint64_t zero = 0;
+
+    sockmap_update(bytes_map_fd, &client_index, &zero);
+    sockmap_update(bytes_map_fd, &server_index, &zero);
+
+    // Sockets primeiro, pares por último: até o par existir o veredito devolve SK_PASS e o segmento
+    // fica na fila do próprio socket, para o relay (nada é redirecionado para um socket fora do mapa)
+    if (sockmap_update(sock_map_fd, &client_index, &client_fd) < 0) {
+        __atomic_add_fetch(&stat_refused, 1, __ATOMIC_RELAXED);
+        sockmap_release_slot(slot);
+        return SOCKMAP_REFUSED;
+    }
+
+    if (sockmap_update(sock_map_fd, &server_index, &server_fd) < 0) {
+        sockmap_delete(sock_map_fd, &client_index);
+        __atomic_add_fetch(&stat_refused, 1, __ATOMIC_RELAXED);
+        sockmap_release_slot(slot);
+        return SOCKMAP_REFUSED;
+    }
+
+    SockmapPeer client_peer = { .peer_index = server_index, .own_index = client_index };
+    SockmapPeer server_peer = { .peer_index = client_index, .own_index = server_index };
+
+    if (sockmap_update(peer_map_fd, &client_key, &client_peer) < 0 || sockmap_update(peer_map_fd, &server_key, &server_peer) < 0) {
+        sockmap_delete(peer_map_fd, &client_key);
+        sockmap_delete(sock_map_fd, &client_index);
+        sockmap_delete(sock_map_fd, &server_index);
+        __atomic_add_fetch(&stat_refused, 1, __ATOMIC_RELAXED);
+        sockmap_release_slot(slot);
+        return SOCKMAP_REFUSED;
+    }
+
+    slots[slot].client_key = client_key;
+    slots[slot].server_key = server_key;
+
+    __atomic_add_fetch(&stat_active, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stat_attached, 1, __ATOMIC_RELAXED);
+    return slot;
+}
+
+void sockmap_detach(int slot) {
+    if (slot < 0 || !sockmap_available()) return;
+
+    uint32_t client_index = 2 * (uint32_t)slot, server_index = client_index + 1;
+
+    sockmap_delete(peer_map_fd, &slots[slot].client_key);
+    sockmap_delete(peer_map_fd, &slots[slot].server_key);
+    sockmap_delete(sock_map_fd, &client_index);
+    sockmap_delete(sock_map_fd, &server_index);
+
+    __atomic_sub_fetch(&stat_active, 1, __ATOMIC_RELAXED);
+    sockmap_release_slot(slot);
+}
+
+int sockmap_read_bytes(int slot, unsigned long *client_to_server, unsigned long *server_to_client) {
+    uint32_t client_index = 2 * (uint32_t)slot, server_index = client_index + 1;
+    uint64_t from_client = 0, from_server = 0;
+
+    if (sockmap_lookup(bytes_map_fd, &client_index, &from_client) < 0) return -1;
+    if (sockmap_lookup(bytes_map_fd, &server_index, &from_server) < 0) return -1;
+
+    *client_to_server = (unsigned long)from_client;
+    *server_to_client = (unsigned long)from_server;
+    return 0;
+}
+
+long sockmap_socket_written(int sock_fd) {
+    struct tcp_info info;
+    socklen_t info_len = sizeof(info);
+    int queued = 0;
+
+    if (getsockopt(sock_fd, IPPROTO_TCP, TCP_INFO, &info, &info_len) < 0) return -1;
+    if (ioctl(sock_fd, SIOCOUTQ, &queued) < 0) return -1;
+
+    return (long)info.tcpi_bytes_acked + queued;
+}
+
+void sockmap_get_stats(SockmapStats *stats) {
+    stats->active = __atomic_load_n(&stat_active, __ATOMIC_RELAXED);
+    stats->attached = __atomic_load_n(&stat_attached, __ATOMIC_RELAXED);
+    stats->refused = __atomic_load_n(&stat_refused, __ATOMIC_RELAXED);
+}
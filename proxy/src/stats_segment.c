@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/stats_segment.h"
+
+#define STATS_READ_RETRIES 64       // Tentativas de cópia antes de desistir de uma vaga em escrita contínua
+
+static unsigned int next_slot_hint = 0;
+
+static size_t stats_segment_size(void) {
+    return sizeof(StatsHeader) + (size_t)STATS_SEGMENT_SLOTS * sizeof(StatsSlot);
+}
+
+StatsSegment* stats_segment_create(int listen_port, const char *engine, char *path_out, size_t path_len) {
+    char path[128];
+    snprintf(path, sizeof(path), STATS_SEGMENT_PATH_FORMAT, listen_port);
+    if (path_out) snprintf(path_out, path_len, "%s", path);
+
+    // Recria do zero: um segmento de uma execução anterior teria vagas ocupadas por conexões que não existem mais
+    unlink(path);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("[Stats] Erro ao criar segmento de estatísticas");
+        return NULL;
+    }
+
+    size_t size = stats_segment_size();
+
+    if (ftruncate(fd, (off_t)size) < 0) {
+        perror("[Stats] Erro ao dimensionar segmento de estatísticas");
+        close(fd);
+        unlink(path);
+        return NULL;
+    }
+
+    StatsSegment *segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (segment == MAP_FAILED) {
+        perror("[Stats] Erro ao mapear segmento de estatísticas");
+        unlink(path);
+        return NULL;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    StatsHeader *header = &segment->header;
+    header->version = STATS_SEGMENT_VERSION;
+    header->header_size = sizeof(StatsHeader);
+    header->slot_size = sizeof(StatsSlot);
+    header->slot_count = STATS_SEGMENT_SLOTS;
+    header->pid = getpid();
+    header->listen_port = listen_port;
+    header->start_ms = (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+    snprintf(header->engine, sizeof(header->engine), "%s", engine);
+
+    // O magic por último: quem abrir o arquivo antes disso o considera inválido
+    __atomic_store_n(&header->magic, STATS_SEGMENT_MAGIC, __ATOMIC_RELEASE);
+    return segment;
+}
+
+const StatsSegment* stats_segment_attach(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0 || (size_t)file_stat.st_size < stats_segment_size()) {
+        close(fd);
+        return NULL;
+    }
+
+    const StatsSegment *segment = mmap(NULL, stats_segment_size(), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (segment == MAP_FAILED) return NULL;
+
+    const StatsHeader *header = &segment->header;
+
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != STATS_SEGMENT_MAGIC || header->version != STATS_SEGMENT_VERSION ||
+        header->header_size != sizeof(StatsHeader) || header->slot_size != sizeof(StatsSlot) ||
+        header->slot_count != STATS_SEGMENT_SLOTS) {
+        munmap((void*)segment, stats_segment_size());
+        return NULL;
+    }
+
+    return segment;
+}
+
+int stats_segment_acquire_slot(StatsSegment *segment) {
+    // Começa de onde a última reserva parou: as vagas à frente tendem a estar livres
+    unsigned int start = __atomic_fetch_add(&next_slot_hint, 1, __ATOMIC_RELAXED);
+
+    for (unsigned int i = 0; i < STATS_SEGMENT_SLOTS; i++) {
+        unsigned int index = (start + i) % STATS_SEGMENT_SLOTS;
+        uint32_t expected = 0;
+
+        if (__atomic_compare_exchange_n(&segment->slots[index].in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&next_slot_hint, index + 1, __ATOMIC_RELAXED);
+            return (int)index;
+        }
+    }
+
+    __atomic_add_fetch(&segment->header.slots_exhausted, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+void stats_segment_release_slot(StatsSegment *segment, int slot) {
+    if (slot < 0) return;
+    __atomic_store_n(&segment->slots[slot].in_use, 0, __ATOMIC_RELEASE);
+}
+
+void stats_slot_write_begin(StatsSlot *slot) {
+    __atomic_store_n(&slot->sequence, slot->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void stats_slot_write_end(StatsSlot *slot) {
+    __atomic_store_n(&slot->sequence, slot->sequence + 1, __ATOMIC_RELEASE);
+}
+
+int stats_slot_read(const StatsSlot *slot, StatsSlot *copy) {
+    for (int attempt = 0; attempt < STATS_READ_RETRIES; attempt++) {
+        uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+
+        memcpy(copy, slot, sizeof(StatsSlot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == before) {
+            return copy->in_use ? 0 : -1;
+        }
+    }
+
+    return -1;
+}
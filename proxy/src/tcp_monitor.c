@@ -4,13 +4,15 @@
 #include <sys/socket.h>
 // Inclui cabeçalhos diferentes dependendo do SO
 #ifdef __linux__
-    #include <netinet/tcp.h> // Linux: tem TCP_INFO e struct tcp_info
+    #include <netinet/in.h>
+    #include <linux/tcp.h>   // Linux: struct tcp_info completa (a de netinet/tcp.h não tem delivery_rate/min_rtt)
 #else
     // macOS/Outros: Não tem TCP_INFO padrão do Linux
     // Definir um dummy ou ignorar
 #endif
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 #include "../include/tcp_monitor.h"
 
 unsigned long get_timestamp_ms() {
@@ -20,10 +22,24 @@ unsigned long get_timestamp_ms() {
     return (unsigned long)(tv.tv_sec * 1000) + (unsigned long)(tv.tv_usec / 1000);
 }
 
+unsigned long get_monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long)now.tv_sec * 1000 + (unsigned long)(now.tv_nsec / 1000000);
+}
+
+unsigned long get_coarse_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    return (unsigned long)now.tv_sec * 1000 + (unsigned long)(now.tv_nsec / 1000000);
+}
+
 void monitor_init_metrics(ConnectionMetrics *metrics) {
     memset(metrics, 0, sizeof(ConnectionMetrics));
     metrics->timestamp_ms = get_timestamp_ms(); // Atribui novo timestamp
-    metrics->last_timestamp_ms = metrics->timestamp_ms; // Registra timestamp antigo
+    metrics->last_sample_ms = get_monotonic_ms(); // Base do primeiro intervalo
 }
 
 int monitor_get_tcp_info(int sock_fd, ConnectionMetrics *metrics) {
@@ -45,6 +61,17 @@ int monitor_get_tcp_info(int sock_fd, ConnectionMetrics *metrics) {
         metrics->retransmits = info.tcpi_retrans;
         metrics->cwnd_segments = info.tcpi_snd_cwnd;
         metrics->ssthresh = info.tcpi_snd_ssthresh;
+        metrics->delivery_rate_bytes_sec = (double)info.tcpi_delivery_rate;
+        metrics->delivery_app_limited = info.tcpi_delivery_rate_app_limited;
+        metrics->min_rtt_ms = (double)info.tcpi_min_rtt / 1000.0;
+        metrics->total_retrans = info.tcpi_total_retrans;
+        metrics->segs_out = info.tcpi_segs_out;
+        metrics->bytes_acked = info.tcpi_bytes_acked;
+        metrics->bytes_retrans = info.tcpi_bytes_retrans;
+        metrics->notsent_bytes = info.tcpi_notsent_bytes;
+        metrics->busy_time_us = info.tcpi_busy_time;
+        metrics->rwnd_limited_us = info.tcpi_rwnd_limited;
+        metrics->sndbuf_limited_us = info.tcpi_sndbuf_limited;
 
         return 0;
     #else
@@ -57,6 +84,17 @@ int monitor_get_tcp_info(int sock_fd, ConnectionMetrics *metrics) {
         metrics->retransmits = 0;
         metrics->cwnd_segments = 10;
         metrics->ssthresh = 65535;
+        metrics->delivery_rate_bytes_sec = 0;
+        metrics->delivery_app_limited = 1;
+        metrics->min_rtt_ms = 15.0;
+        metrics->total_retrans = 0;
+        metrics->segs_out = 0;
+        metrics->bytes_acked = 0;
+        metrics->bytes_retrans = 0;
+        metrics->notsent_bytes = 0;
+        metrics->busy_time_us = 0;
+        metrics->rwnd_limited_us = 0;
+        metrics->sndbuf_limited_us = 0;
         
         printf("[Aviso] Monitoramento simulado (não-Linux detectado)\n");
 
@@ -64,13 +102,34 @@ int monitor_get_tcp_info(int sock_fd, ConnectionMetrics *metrics) {
     #endif
 }
 
-void monitor_calculate_throughput(ConnectionMetrics *metrics, unsigned long total_bytes_forwarded) {
-    metrics->timestamp_ms = get_timestamp_ms(); // Registra timestamp
-    
-    unsigned long interval_ms = metrics->timestamp_ms - metrics->last_timestamp_ms;
+// O kernel divide o busy_time (tempo com dados em voo) entre três cronômetros exclusivos:
+// limitado pela janela do receptor, limitado pelo buffer de envio e o restante (rede)
+LimitedBy monitor_classify_limit(const ConnectionMetrics *metrics, unsigned long interval_ms) {
+    if (interval_ms == 0) return LIMITED_UNKNOWN;
+
+    unsigned long busy_us = metrics->busy_time_us - metrics->last_busy_time_us;
+    unsigned long rwnd_us = metrics->rwnd_limited_us - metrics->last_rwnd_limited_us;
+    unsigned long sndbuf_us = metrics->sndbuf_limited_us - metrics->last_sndbuf_limited_us;
+
+    // Ocioso na maior parte do intervalo: não havia o que enviar
+    if ((double)busy_us < interval_ms * 1000.0 * MONITOR_BUSY_MIN_FRACTION) return LIMITED_APP;
+
+    unsigned long network_us = busy_us > rwnd_us + sndbuf_us ? busy_us - rwnd_us - sndbuf_us : 0;
+
+    if (rwnd_us >= sndbuf_us && rwnd_us > network_us) return LIMITED_RWND;
+    if (sndbuf_us > rwnd_us && sndbuf_us > network_us) return LIMITED_SNDBUF;
+    return LIMITED_NETWORK;
+}
+
+void monitor_calculate_throughput(ConnectionMetrics *metrics, unsigned long total_bytes_sent, unsigned long total_bytes_received) {
+    metrics->timestamp_ms = get_timestamp_ms(); // Registra timestamp (relógio de parede, vai para o log)
+
+    // O intervalo vem do relógio monotônico: um ajuste do relógio de parede não distorce as taxas
+    unsigned long now_ms = get_monotonic_ms();
+    unsigned long interval_ms = now_ms - metrics->last_sample_ms;
     if (interval_ms == 0) return; // Evita divisão por zero
 
-    metrics->bytes_transferred_total = total_bytes_forwarded;
+    metrics->bytes_transferred_total = total_bytes_sent;
     unsigned long bytes_this_interval = metrics->bytes_transferred_total - metrics->last_bytes_total;
 
     // Calcula Kbps: (bytes * 8 bits/byte) / (intervalo_em_ms / 1000 s/ms) / 1.000.000 bits/Mbit
@@ -78,11 +137,36 @@ void monitor_calculate_throughput(ConnectionMetrics *metrics, unsigned long tota
     double bits_per_sec = (double)(bytes_this_interval * 8) / interval_sec;
     double kbps = bits_per_sec / 1000.0;
 
-    // No proxy, os bytes encaminhados são o "goodput" (payload)
     metrics->throughput_kbps = kbps;
-    metrics->goodput_kbps = kbps;
+    metrics->received_kbps = (double)(total_bytes_received - metrics->last_bytes_received) * 8 / interval_sec / 1000.0;
+
+    // Goodput: só o que o par confirmou, sem retransmissões (tcpi_bytes_acked não conta bytes repetidos)
+    metrics->goodput_kbps = (double)(metrics->bytes_acked - metrics->last_bytes_acked) * 8 / interval_sec / 1000.0;
+    metrics->retrans_kbps = (double)(metrics->bytes_retrans - metrics->last_bytes_retrans) * 8 / interval_sec / 1000.0;
+
+    metrics->limited_by = monitor_classify_limit(metrics, interval_ms);
+
+    // ssthresh ainda não alcançado e a janela cresceu desde a amostra anterior
+    metrics->slow_start = metrics->cwnd_segments < metrics->ssthresh && metrics->cwnd_segments > metrics->last_cwnd_segments;
 
     // Atualiza valores para o próximo cálculo
     metrics->last_bytes_total = metrics->bytes_transferred_total;
-    metrics->last_timestamp_ms = metrics->timestamp_ms;
+    metrics->last_bytes_received = total_bytes_received;
+    metrics->last_sample_ms = now_ms;
+    metrics->last_cwnd_segments = metrics->cwnd_segments;
+    metrics->last_bytes_acked = metrics->bytes_acked;
+    metrics->last_bytes_retrans = metrics->bytes_retrans;
+    metrics->last_busy_time_us = metrics->busy_time_us;
+    metrics->last_rwnd_limited_us = metrics->rwnd_limited_us;
+    metrics->last_sndbuf_limited_us = metrics->sndbuf_limited_us;
+}
+
+const char* monitor_limited_by_name(LimitedBy limited_by) {
+    switch (limited_by) {
+        case LIMITED_APP: return "aplicação";
+        case LIMITED_RWND: return "receptor";
+        case LIMITED_SNDBUF: return "buffer envio";
+        case LIMITED_NETWORK: return "rede";
+        default: return "-";
+    }
 }
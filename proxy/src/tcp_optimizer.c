@@ -4,16 +4,25 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
+#include <string.h>
+#include <errno.h>
 #include "../include/tcp_optimizer.h"
+#include "../include/proxy.h"
+#include "../include/flight_recorder.h"
 
-void apply_tcp_pacing(int sock_fd, long rate_bytes_per_sec) {
+void apply_tcp_pacing(int sock_fd, unsigned long rate_bytes_per_sec) {
     // TCP Pacing é uma funcionalidade específica do Linux, por isso a condição para testar no Mac
     #ifdef SO_MAX_PACING_RATE
-        if (setsockopt(sock_fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate_bytes_per_sec, sizeof(rate_bytes_per_sec)) < 0) {
+        int result = setsockopt(sock_fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate_bytes_per_sec, sizeof(rate_bytes_per_sec));
+
+        // ~0 (sem limite) aparece como -1 na linha do tempo
+        flight_record_socket(FLIGHT_EVENT_PACING, sock_fd, result < 0 ? errno : 0, (int64_t)rate_bytes_per_sec);
+
+        if (result < 0) {
             perror("[Optimizer] Erro ao aplicar TCP Pacing");
         } else {
             // Descomente para debugar se necessário
-            // printf("[Optimizer] Pacing aplicado: %ld bytes/s\n", rate_bytes_per_sec);
+            // printf("[Optimizer] Pacing aplicado: %lu bytes/s\n", rate_bytes_per_sec);
         }
     #else
         // No macOS ou sistemas sem essa opção, não aplica nada
@@ -26,9 +35,10 @@ void apply_buffer_tuning(int sock_fd, int send_buffer_size, int recv_buffer_size
     
     // 1. Ajusta buffer de envio (Send Buffer)
     if (send_buffer_size > 0) {
-        if (setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size)) < 0) {
-            perror("[Optimizer] Erro ao ajustar SO_SNDBUF");
-        }
+        int result = setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size));
+
+        flight_record_socket(FLIGHT_EVENT_BUFFER, sock_fd, result < 0 ? errno : 0, send_buffer_size);
+        if (result < 0) perror("[Optimizer] Erro ao ajustar SO_SNDBUF");
     }
 
     // 2. Ajusta buffer de recebimento (Receive Buffer)
@@ -38,3 +48,207 @@ void apply_buffer_tuning(int sock_fd, int send_buffer_size, int recv_buffer_size
         }
     }
 }
+
+static const char* leg_name(const OptimizerLeg *leg) {
+    return leg->is_server_leg ? "Proxy -> Servidor" : "Cliente -> Proxy";
+}
+
+// Único ponto que escreve SO_MAX_PACING_RATE no socket de um trecho: política e parcela de banda
+// não passam uma por cima da outra, e o setsockopt só acontece quando o valor efetivo muda
+static void leg_apply_pacing(OptimizerLeg *leg, int sock_fd) {
+    unsigned long rate = leg->policy_pacing;
+    if (leg->share_pacing > 0 && (rate == 0 || leg->share_pacing < rate)) rate = leg->share_pacing;
+
+    if (leg->pacing_set && rate == leg->effective_pacing) return;
+
+    apply_tcp_pacing(sock_fd, rate > 0 ? rate : OPTIMIZER_PACING_UNLIMITED);
+    leg->effective_pacing = rate;
+    leg->pacing_set = 1;
+}
+
+// Pacing pedido pela política do trecho (0 = nenhum)
+static void leg_request_pacing(OptimizerLeg *leg, int sock_fd, unsigned long rate_bytes_sec) {
+    leg->policy_pacing = rate_bytes_sec;
+    leg_apply_pacing(leg, sock_fd);
+}
+
+// === Política legada: heurística original, só no trecho Proxy <-> Servidor ===
+
+static void legacy_init(OptimizerLeg *leg, int sock_fd) {
+    (void)leg;
+    (void)sock_fd;
+}
+
+static void legacy_on_sample(OptimizerLeg *leg, int sock_fd, const ConnectionMetrics *metrics) {
+    if (!leg->is_server_leg) return;
+
+    // Cálculo do BDP (Bandwidth-Delay Product) para a conexão Proxy <-> Servidor
+    // BDP = Banda (bytes/s) * RTT (s), pela direção mais rápida: os dois buffers recebem o mesmo tamanho
+    double rate_kbps = metrics->throughput_kbps > metrics->received_kbps ? metrics->throughput_kbps : metrics->received_kbps;
+    double throughput_bytes_sec = (rate_kbps * 1000.0) / 8.0;
+    double rtt_sec = metrics->rtt_ms / 1000.0;
+
+    if (throughput_bytes_sec > 0 && rtt_sec > 0) {
+        int bdp = (int)(throughput_bytes_sec * rtt_sec);
+
+        // Buffer Tuning: Define o buffer como 2x o BDP para garantir fluxo contínuo, limitado para evitar bufferbloat
+        // Limitado a um mínimo de 64 KB
+        int optimal_buffer = bdp * 2;
+        if (optimal_buffer < OPTIMIZER_MIN_BUFFER) optimal_buffer = OPTIMIZER_MIN_BUFFER;
+
+        // Aplica no socket que vai para o servidor
+        apply_buffer_tuning(sock_fd, optimal_buffer, optimal_buffer);
+
+        // Log
+        printf("[Otimização] BDP Calculado: %d bytes | Novo Buffer: %d bytes\n", bdp, optimal_buffer);
+    }
+
+    // TCP Pacing:
+    // Se detectar que o RTT está muito alto (ex: > 100ms), limita a taxa para tentar descongestionar a rede
+    if (metrics->rtt_ms > 100.0) {
+        // Limita a 1 MB/s (valor arbitrário para teste)
+        unsigned long pacing_rate = 1024 * 1024;
+        leg_request_pacing(leg, sock_fd, pacing_rate);
+
+        printf("[Otimização] RTT Alto (%.2fms). Pacing ativado: 1MB/s\n", metrics->rtt_ms);
+    } else {
+        // Remove o pacing da política (a parcela de banda, se houver, continua valendo)
+        leg_request_pacing(leg, sock_fd, 0);
+    }
+}
+
+static void legacy_on_close(OptimizerLeg *leg, int sock_fd) {
+    (void)leg;
+    (void)sock_fd;
+}
+
+// === Política de modelo (estilo BBR) ===
+// BtlBw vem do tcpi_delivery_rate (taxa que a rede realmente entregou, não a nossa vazão),
+// RTprop do tcpi_min_rtt. Com eles o BDP não fica preso à taxa atual da conexão.
+
+#define MODEL_CWND_GAIN 2.0        // Buffer = 2x BDP (folga para a taxa crescer)
+#define MODEL_PROBE_GAIN 1.25      // Pacing acima do BtlBw para descobrir banda nova
+#define MODEL_DRAIN_GAIN 1.0       // Pacing no BtlBw quando há fila se formando
+#define MODEL_PROBE_EVERY 4        // Com fila, 1 amostra em cada 4 sonda com MODEL_PROBE_GAIN (cabe na janela do BtlBw)
+#define MODEL_QUEUE_FACTOR 1.25    // RTT acima de RTprop * fator indica fila no gargalo
+#define MODEL_CHANGE_THRESHOLD 0.25 // Só reaplica com variação acima de 25% (evita setsockopt a cada amostra)
+
+static void model_init(OptimizerLeg *leg, int sock_fd) {
+    (void)sock_fd;
+    memset(leg->bw_samples, 0, sizeof(leg->bw_samples));
+    leg->bw_next = 0;
+    leg->btl_bw_bytes_sec = 0;
+    leg->rt_prop_ms = 0;
+}
+
+static int model_changed(double current, double applied) {
+    if (applied <= 0) return 1;
+    double ratio = current / applied;
+    return ratio > 1.0 + MODEL_CHANGE_THRESHOLD || ratio < 1.0 - MODEL_CHANGE_THRESHOLD;
+}
+
+static void model_on_sample(OptimizerLeg *leg, int sock_fd, const ConnectionMetrics *metrics) {
+    // RTprop: o kernel já mantém o mínimo em janela; sem ele usa o RTT suavizado
+    double rt_prop_ms = metrics->min_rtt_ms > 0 ? metrics->min_rtt_ms : metrics->rtt_ms;
+    if (rt_prop_ms > 0) leg->rt_prop_ms = rt_prop_ms;
+
+    // BtlBw: amostras limitadas pela aplicação subestimam a banda e só entram se superarem a estimativa
+    double delivery_rate = metrics->delivery_rate_bytes_sec;
+
+    if (delivery_rate > 0 && (!metrics->delivery_app_limited || delivery_rate > leg->btl_bw_bytes_sec)) {
+        leg->bw_samples[leg->bw_next] = delivery_rate;
+        leg->bw_next = (leg->bw_next + 1) % OPTIMIZER_BW_WINDOW;
+
+        leg->btl_bw_bytes_sec = 0;
+        for (int i = 0; i < OPTIMIZER_BW_WINDOW; i++) {
+            if (leg->bw_samples[i] > leg->btl_bw_bytes_sec) leg->btl_bw_bytes_sec = leg->bw_samples[i];
+        }
+    }
+
+    if (leg->btl_bw_bytes_sec <= 0 || leg->rt_prop_ms <= 0) return; // Modelo ainda sem dados
+
+    double bdp = leg->btl_bw_bytes_sec * leg->rt_prop_ms / 1000.0;
+
+    int buffer = (int)(bdp * MODEL_CWND_GAIN);
+    if (buffer < OPTIMIZER_MIN_BUFFER) buffer = OPTIMIZER_MIN_BUFFER;
+    if (buffer > OPTIMIZER_MAX_BUFFER) buffer = OPTIMIZER_MAX_BUFFER;
+
+    // Trecho limitado pela aplicação: a rede não é o gargalo, então não há por que limitar a taxa
+    unsigned long pacing = 0;
+
+    double gain = 0;
+
+    if (!metrics->delivery_app_limited) {
+        // A entrega nunca passa do pacing: drenando sempre no BtlBw, a estimativa só cairia (RTT com jitter
+        // ou fila persistente). A sondagem periódica deixa a janela do máximo ver a banda que sobrar
+        int queue_building = metrics->rtt_ms > leg->rt_prop_ms * MODEL_QUEUE_FACTOR;
+        gain = queue_building && leg->samples % MODEL_PROBE_EVERY != 0 ? MODEL_DRAIN_GAIN : MODEL_PROBE_GAIN;
+        pacing = (unsigned long)(leg->btl_bw_bytes_sec * gain);
+    }
+
+    // A troca de fase sempre é aplicada: a diferença entre os ganhos fica no limite de variação
+    int buffer_changed = model_changed(buffer, leg->applied_buffer);
+    int pacing_changed = (pacing == 0) != (leg->policy_pacing == 0) ||
+                         (pacing > 0 && (gain != leg->applied_gain ||
+                                         model_changed((double)pacing, (double)leg->policy_pacing)));
+
+    if (buffer_changed) {
+        apply_buffer_tuning(sock_fd, buffer, buffer);
+        leg->applied_buffer = buffer;
+    }
+
+    if (pacing_changed) {
+        leg_request_pacing(leg, sock_fd, pacing);
+        leg->applied_gain = gain;
+    }
+
+    if (buffer_changed || pacing_changed) {
+        printf("[Otimização] %s | BtlBw: %.2f Mbps | RTprop: %.3f ms | BDP: %.0f bytes | Buffer: %d | Pacing: %s%s\n",
+               leg_name(leg), leg->btl_bw_bytes_sec * 8 / 1e6, leg->rt_prop_ms, bdp, buffer,
+               pacing == 0 ? "livre" : gain > MODEL_DRAIN_GAIN ? "sondando" : "drenando",
+               leg->effective_pacing != pacing ? " (limitado pela parcela de banda)" : "");
+    }
+}
+
+static void model_on_close(OptimizerLeg *leg, int sock_fd) {
+    (void)sock_fd;
+
+    if (leg->btl_bw_bytes_sec > 0) {
+        printf("[Otimização] Modelo final %s | BtlBw: %.2f Mbps | RTprop: %.3f ms | Amostras: %d\n",
+               leg_name(leg), leg->btl_bw_bytes_sec * 8 / 1e6, leg->rt_prop_ms, leg->samples);
+    }
+}
+
+static const OptimizerPolicy model_policy = { "model", model_init, model_on_sample, model_on_close };
+static const OptimizerPolicy legacy_policy = { "legacy", legacy_init, legacy_on_sample, legacy_on_close };
+
+const OptimizerPolicy* optimizer_policy_get(OptimizerPolicyType type) {
+    return type == OPTIMIZER_POLICY_LEGACY ? &legacy_policy : &model_policy;
+}
+
+void optimizer_leg_init(OptimizerLeg *leg, const OptimizerPolicy *policy, int is_server_leg, int sock_fd) {
+    memset(leg, 0, sizeof(OptimizerLeg));
+    leg->policy = policy;
+    leg->is_server_leg = is_server_leg;
+
+    if (policy) policy->init(leg, sock_fd);
+}
+
+void optimizer_leg_sample(OptimizerLeg *leg, int sock_fd, const ConnectionMetrics *metrics) {
+    if (!leg->policy) return;
+
+    leg->samples++;
+    leg->policy->on_sample(leg, sock_fd, metrics);
+}
+
+void optimizer_leg_set_share(OptimizerLeg *leg, int sock_fd, unsigned long rate_bytes_sec) {
+    leg->share_pacing = rate_bytes_sec;
+    leg_apply_pacing(leg, sock_fd);
+}
+
+void optimizer_leg_close(OptimizerLeg *leg, int sock_fd) {
+    if (!leg->policy) return;
+
+    leg->policy->on_close(leg, sock_fd);
+    leg->policy = NULL;
+}
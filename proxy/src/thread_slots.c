@@ -0,0 +1,54 @@
+#include <stdlib.h>
+
+#include "../include/thread_slots.h"
+
+void* thread_slots_acquire(ThreadSlots *slots) {
+    void *item = NULL;
+
+    pthread_mutex_lock(&slots->lock);
+
+    for (int i = 0; i < slots->count && !item; i++) {
+        if (!slots->in_use[i]) {
+            slots->in_use[i] = 1;
+            item = slots->items[i];
+        }
+    }
+
+    if (!item && slots->count < slots->capacity && slots->count < THREAD_SLOTS_MAX) {
+        item = calloc(1, slots->item_size);
+        if (item) {
+            slots->in_use[slots->count] = 1;
+            slots->items[slots->count++] = item;
+        }
+    }
+
+    pthread_mutex_unlock(&slots->lock);
+
+    return item ? item : slots->overflow;
+}
+
+void thread_slots_release(ThreadSlots *slots, void *item) {
+    if (!item || item == slots->overflow) return;
+
+    pthread_mutex_lock(&slots->lock);
+    for (int i = 0; i < slots->count; i++) {
+        if (slots->items[i] == item) {
+            slots->in_use[i] = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&slots->lock);
+}
+
+int thread_slots_snapshot(ThreadSlots *slots, int *in_use_out) {
+    pthread_mutex_lock(&slots->lock);
+
+    int count = slots->count;
+    if (in_use_out) {
+        *in_use_out = 0;
+        for (int i = 0; i < count; i++) *in_use_out += slots->in_use[i];
+    }
+
+    pthread_mutex_unlock(&slots->lock);
+    return count;
+}
@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "../include/timer_wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+// Mesmo relógio do timerfd: o tick calculado aqui é o que o kernel usa para acordar o worker
+static unsigned long timer_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000 + (unsigned long)(now.tv_nsec / 1000000);
+}
+
+static void timer_list_init(TimerEntry *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+int timer_wheel_init(TimerWheel *wheel, int use_timerfd) {
+    memset(wheel, 0, sizeof(TimerWheel));
+
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) timer_list_init(&wheel->slots[level][slot]);
+    }
+
+    wheel->current = timer_now_ms() / TIMER_WHEEL_TICK_MS;
+    wheel->timer_fd = -1;
+
+    if (use_timerfd) {
+        wheel->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (wheel->timer_fd < 0) {
+            perror("Erro ao criar timerfd do worker");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void timer_wheel_entry_init(TimerEntry *entry, int kind, void *owner) {
+    memset(entry, 0, sizeof(TimerEntry));
+    entry->kind = kind;
+    entry->owner = owner;
+}
+
+int timer_wheel_pending(const TimerEntry *entry) {
+    return entry->next != NULL;
+}
+
+// Posição pela distância até o vencimento: o nível é o menor cuja volta ainda alcança o tick
+static void timer_wheel_insert(TimerWheel *wheel, TimerEntry *entry) {
+    unsigned long max_delta = (1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+    if (entry->expires < wheel->current) entry->expires = wheel->current;
+    if (entry->expires - wheel->current > max_delta) entry->expires = wheel->current + max_delta;
+
+    unsigned long delta = entry->expires - wheel->current;
+    int level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1UL << (TIMER_WHEEL_BITS * (level + 1)))) level++;
+
+    int slot = (int)((entry->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+    TimerEntry *head = &wheel->slots[level][slot];
+
+    entry->level = level;
+    entry->slot = slot;
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+
+    if (level == 0) {
+        wheel->occupied |= 1ULL << slot;
+        wheel->level0_count++;
+    }
+}
+
+static void timer_wheel_unlink(TimerWheel *wheel, TimerEntry *entry) {
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+
+    // level < 0: já separado para vencer (timer_wheel_advance), a posição original não conta mais
+    if (entry->level == 0) {
+        TimerEntry *head = &wheel->slots[0][entry->slot];
+        if (head->next == head) wheel->occupied &= ~(1ULL << entry->slot);
+        wheel->level0_count--;
+    }
+
+    entry->next = entry->prev = NULL;
+    wheel->count--;
+}
+
+// Próximo tick que precisa ser processado: a primeira posição ocupada do nível 0 ou a próxima cascata
+static unsigned long timer_wheel_next_tick(const TimerWheel *wheel) {
+    if (wheel->count == 0) return 0;
+
+    unsigned long next = 0;
+
+    if (wheel->level0_count > 0) {
+        unsigned index = (unsigned)(wheel->current & TIMER_WHEEL_MASK);
+        uint64_t rotated = index ? (wheel->occupied >> index) | (wheel->occupied << (TIMER_WHEEL_SLOTS - index)) : wheel->occupied;
+        next = wheel->current + (unsigned long)__builtin_ctzll(rotated);
+    }
+
+    if (wheel->count > wheel->level0_count) {
+        unsigned long cascade = (wheel->current + TIMER_WHEEL_MASK) & ~(unsigned long)TIMER_WHEEL_MASK;
+        if (!next || cascade < next) next = cascade;
+    }
+
+    return next;
+}
+
+static void timer_wheel_arm(TimerWheel *wheel, unsigned long tick) {
+    if (wheel->timer_fd < 0 || tick == wheel->armed) return;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    // tick == 0 desarma; um tick já passado dispara na hora
+    if (tick) {
+        unsigned long at_ms = tick * TIMER_WHEEL_TICK_MS;
+        spec.it_value.tv_sec = (time_t)(at_ms / 1000);
+        spec.it_value.tv_nsec = (long)(at_ms % 1000) * 1000000L;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1;
+    }
+
+    if (timerfd_settime(wheel->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == 0) wheel->armed = tick;
+}
+
+void timer_wheel_schedule(TimerWheel *wheel, TimerEntry *entry, unsigned long delay_ms) {
+    if (entry->next) timer_wheel_unlink(wheel, entry);
+
+    unsigned long granularity = 1;
+    while ((granularity << 1) * TIMER_WHEEL_TICK_MS <= delay_ms >> TIMER_WHEEL_SLACK_SHIFT) granularity <<= 1;
+
+    entry->expires = (timer_now_ms() + delay_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    entry->expires = (entry->expires + granularity - 1) & ~(granularity - 1);
+    timer_wheel_insert(wheel, entry);
+    wheel->count++;
+
+    // Só antecipa o timerfd: um despertar adiantado demais é inofensivo (o advance rearma)
+    unsigned long next = timer_wheel_next_tick(wheel);
+    if (next && (!wheel->armed || next < wheel->armed)) timer_wheel_arm(wheel, next);
+}
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerEntry *entry) {
+    if (entry->next) timer_wheel_unlink(wheel, entry);
+}
+
+// Redistribui uma posição de um nível superior pelos níveis de baixo
+static void timer_wheel_cascade(TimerWheel *wheel, int level, int slot) {
+    TimerEntry *head = &wheel->slots[level][slot];
+    TimerEntry *entry = head->next;
+
+    timer_list_init(head);
+
+    while (entry != head) {
+        TimerEntry *next = entry->next;
+        timer_wheel_insert(wheel, entry);
+        entry = next;
+    }
+}
+
+int timer_wheel_advance(TimerWheel *wheel, TimerCallback callback, void *context) {
+    unsigned long now_tick = timer_now_ms() / TIMER_WHEEL_TICK_MS;
+    int fired = 0;
+
+    // Zera o contador do timerfd (o worker só foi avisado de que ele está legível)
+    if (wheel->timer_fd >= 0) {
+        uint64_t expirations;
+        while (read(wheel->timer_fd, &expirations, sizeof(expirations)) > 0);
+        wheel->armed = 0;
+    }
+
+    while (wheel->current <= now_tick) {
+        if (wheel->count == 0) {
+            wheel->current = now_tick + 1;
+            break;
+        }
+
+        unsigned index = (unsigned)(wheel->current & TIMER_WHEEL_MASK);
+
+        // Nível 0 vazio: pula direto para a próxima cascata
+        if (wheel->level0_count == 0 && index != 0) {
+            unsigned long cascade = (wheel->current + TIMER_WHEEL_MASK) & ~(unsigned long)TIMER_WHEEL_MASK;
+            wheel->current = cascade <= now_tick ? cascade : now_tick + 1;
+            continue;
+        }
+
+        // Volta completa do nível 0: desce a posição atual do nível 1 (e a do 2, se o 1 também deu a volta...)
+        if (index == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                int slot = (int)((wheel->current >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+                timer_wheel_cascade(wheel, level, slot);
+                if (slot != 0) break;
+            }
+        }
+
+        TimerEntry *head = &wheel->slots[0][index];
+
+        if (head->next != head) {
+            // Separa a posição: o callback pode agendar (em outras posições) ou cancelar timers desta lista
+            TimerEntry expired;
+            expired.next = head->next;
+            expired.prev = head->prev;
+            expired.next->prev = &expired;
+            expired.prev->next = &expired;
+            timer_list_init(head);
+            wheel->occupied &= ~(1ULL << index);
+
+            for (TimerEntry *entry = expired.next; entry != &expired; entry = entry->next) {
+                entry->level = -1;
+                wheel->level0_count--;
+            }
+
+            while (expired.next != &expired) {
+                TimerEntry *entry = expired.next;
+                timer_wheel_unlink(wheel, entry);
+                callback(entry, context);
+                fired++;
+            }
+        }
+
+        wheel->current++;
+    }
+
+    timer_wheel_arm(wheel, timer_wheel_next_tick(wheel));
+    return fired;
+}
+
+int timer_wheel_wait_ms(const TimerWheel *wheel) {
+    unsigned long next = timer_wheel_next_tick(wheel);
+    if (!next) return -1;
+
+    unsigned long now = timer_now_ms();
+    unsigned long at_ms = next * TIMER_WHEEL_TICK_MS;
+    return at_ms > now ? (int)(at_ms - now) : 0;
+}
@@ -0,0 +1,270 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "../include/tls_session.h"
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+struct TlsSession {
+    SSL *ssl;
+    int ktls_send;
+    int ktls_recv;
+};
+
+static SSL_CTX *server_context = NULL;     // Trecho do cliente (o proxy é o servidor TLS)
+static SSL_CTX *client_context = NULL;     // Trecho do backend (o proxy é o cliente TLS)
+static TlsConfig settings;
+
+static unsigned long handshakes = 0;       // Atômicos
+static unsigned long failures = 0;
+static unsigned long ktls_send_sessions = 0;
+static unsigned long ktls_recv_sessions = 0;
+
+// Opções comuns: TLS 1.2 ou superior, escrita parcial (o relay reenvia o resto) e FIN sem close_notify como EOF
+static void tls_context_setup(SSL_CTX *context) {
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_RELEASE_BUFFERS);
+    SSL_CTX_set_options(context, SSL_OP_IGNORE_UNEXPECTED_EOF);
+
+    #ifdef SSL_OP_ENABLE_KTLS
+        if (settings.ktls) SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+    #endif
+}
+
+int tls_init(const TlsConfig *config) {
+    settings = *config;
+    if (!settings.cert_file && !settings.backend) return 0;
+
+    if (settings.cert_file) {
+        const char *key_file = settings.key_file ? settings.key_file : settings.cert_file;
+
+        server_context = SSL_CTX_new(TLS_server_method());
+        if (!server_context) {
+            ERR_print_errors_fp(stderr);
+            return -1;
+        }
+
+        tls_context_setup(server_context);
+
+        if (SSL_CTX_use_certificate_chain_file(server_context, settings.cert_file) != 1 ||
+            SSL_CTX_use_PrivateKey_file(server_context, key_file, SSL_FILETYPE_PEM) != 1 ||
+            SSL_CTX_check_private_key(server_context) != 1) {
+            fprintf(stderr, "Erro ao carregar certificado '%s' e chave '%s':\n", settings.cert_file, key_file);
+            ERR_print_errors_fp(stderr);
+            return -1;
+        }
+    }
+
+    if (settings.backend) {
+        client_context = SSL_CTX_new(TLS_client_method());
+        if (!client_context) {
+            ERR_print_errors_fp(stderr);
+            return -1;
+        }
+
+        tls_context_setup(client_context);
+
+        if (settings.backend_ca) {
+            // Só a cadeia não basta: qualquer certificado emitido pela mesma CA seria aceito para qualquer backend
+            if (!settings.backend_name) {
+                fprintf(stderr, "Erro: '--tls-backend-ca' requer '--tls-backend-name' (nome exigido no certificado dos backends).\n");
+                return -1;
+            }
+
+            if (SSL_CTX_load_verify_locations(client_context, settings.backend_ca, NULL) != 1) {
+                fprintf(stderr, "Erro ao carregar as CAs dos backends '%s':\n", settings.backend_ca);
+                ERR_print_errors_fp(stderr);
+                return -1;
+            }
+            SSL_CTX_set_verify(client_context, SSL_VERIFY_PEER, NULL);
+        }
+    }
+
+    return 0;
+}
+
+int tls_terminates(void) {
+    return server_context != NULL;
+}
+
+int tls_originates(void) {
+    return client_context != NULL;
+}
+
+int tls_ktls_available(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+
+    int result = setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls"));
+    int available = result == 0 || errno == ENOTCONN;
+
+    close(fd);
+    return available;
+}
+
+// Limita o tempo de cada leitura e escrita bloqueante do handshake (0 = sem limite)
+static void tls_set_timeout(int fd, int timeout_ms) {
+    struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static TlsSession* tls_session_handshake(SSL_CTX *context, int fd, int is_server) {
+    SSL *ssl = SSL_new(context);
+
+    if (!ssl || SSL_set_fd(ssl, fd) != 1) {
+        SSL_free(ssl);
+        __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    if (!is_server && settings.backend_name) {
+        SSL_set_tlsext_host_name(ssl, settings.backend_name);
+        if (settings.backend_ca && SSL_set1_host(ssl, settings.backend_name) != 1) {
+            SSL_free(ssl);
+            __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    }
+
+    // Sem Nagle durante o handshake: os tickets de sessão saem em escritas separadas depois do
+    // Finished e esperariam o delayed ACK do par (~40 ms por handshake). Depois volta ao que era
+    int nodelay = 0, enable = 1;
+    socklen_t nodelay_len = sizeof(nodelay);
+    getsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, &nodelay_len);
+    if (!nodelay) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    tls_set_timeout(fd, TLS_HANDSHAKE_TIMEOUT_MS);
+    int result = is_server ? SSL_accept(ssl) : SSL_connect(ssl);
+    tls_set_timeout(fd, 0);
+
+    if (!nodelay) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    if (result != 1) {
+        unsigned long error = ERR_peek_last_error();
+
+        fprintf(stderr, "[TLS] Handshake com o %s falhou: %s\n", is_server ? "cliente" : "backend",
+                error ? ERR_reason_error_string(error) : strerror(errno));
+        ERR_clear_error();
+        SSL_free(ssl);
+        __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    TlsSession *session = malloc(sizeof(TlsSession));
+    if (!session) {
+        SSL_free(ssl);
+        return NULL;
+    }
+
+    // O OpenSSL já tentou passar as chaves ao kernel na troca de chaves do handshake (SSL_OP_ENABLE_KTLS)
+    session->ssl = ssl;
+    session->ktls_send = BIO_get_ktls_send(SSL_get_wbio(ssl)) > 0;
+    session->ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(ssl)) > 0;
+
+    __atomic_add_fetch(&handshakes, 1, __ATOMIC_RELAXED);
+    if (session->ktls_send) __atomic_add_fetch(&ktls_send_sessions, 1, __ATOMIC_RELAXED);
+    if (session->ktls_recv) __atomic_add_fetch(&ktls_recv_sessions, 1, __ATOMIC_RELAXED);
+
+    return session;
+}
+
+TlsSession* tls_session_accept(int fd) {
+    return server_context ? tls_session_handshake(server_context, fd, 1) : NULL;
+}
+
+TlsSession* tls_session_connect(int fd) {
+    return client_context ? tls_session_handshake(client_context, fd, 0) : NULL;
+}
+
+// Traduz o resultado de SSL_read/SSL_write para a convenção de recv()/send()
+static ssize_t tls_session_result(TlsSession *session, int result) {
+    if (result > 0) return result;
+
+    switch (SSL_get_error(session->ssl, result)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        case SSL_ERROR_SYSCALL:
+            // errno do socket (ECONNRESET, EPIPE...); sem ele, a origem simplesmente fechou
+            ERR_clear_error();
+            if (errno == 0) return 0;
+            return -1;
+        default:
+            ERR_clear_error();
+            errno = EPROTO;
+            return -1;
+    }
+}
+
+ssize_t tls_session_read(TlsSession *session, void *buffer, size_t length) {
+    ERR_clear_error();
+    errno = 0;
+    return tls_session_result(session, SSL_read(session->ssl, buffer, length > INT32_MAX ? INT32_MAX : (int)length));
+}
+
+ssize_t tls_session_write(TlsSession *session, const void *buffer, size_t length) {
+    ERR_clear_error();
+    errno = 0;
+    ssize_t result = tls_session_result(session, SSL_write(session->ssl, buffer, length > INT32_MAX ? INT32_MAX : (int)length));
+
+    // Escrever depois do FIN do destino não é EOF: para o relay é erro, como no send()
+    if (result == 0) {
+        errno = EPIPE;
+        return -1;
+    }
+    return result;
+}
+
+size_t tls_session_pending(const TlsSession *session) {
+    return (size_t)SSL_pending(session->ssl);
+}
+
+int tls_session_ktls_send(const TlsSession *session) {
+    return session->ktls_send;
+}
+
+void tls_session_shutdown(TlsSession *session) {
+    // Só o envio: a outra direção continua recebendo até o FIN do par
+    ERR_clear_error();
+    SSL_shutdown(session->ssl);
+    ERR_clear_error();
+}
+
+void tls_session_free(TlsSession *session) {
+    if (!session) return;
+
+    SSL_free(session->ssl);
+    free(session);
+}
+
+void tls_session_describe(const TlsSession *session, char *out, size_t out_len) {
+    const char *where = session->ktls_send && session->ktls_recv ? "kTLS tx/rx" :
+                        session->ktls_send ? "kTLS tx" : session->ktls_recv ? "kTLS rx" : "user space";
+
+    snprintf(out, out_len, "%s %s, %s", SSL_get_version(session->ssl), SSL_get_cipher_name(session->ssl), where);
+}
+
+void tls_get_stats(TlsStats *stats) {
+    stats->handshakes = __atomic_load_n(&handshakes, __ATOMIC_RELAXED);
+    stats->failures = __atomic_load_n(&failures, __ATOMIC_RELAXED);
+    stats->ktls_send = __atomic_load_n(&ktls_send_sessions, __ATOMIC_RELAXED);
+    stats->ktls_recv = __atomic_load_n(&ktls_recv_sessions, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../include/upstream_pool.h"
+#include "../include/backends.h"
+#include "../include/tcp_monitor.h"
+
+typedef struct {
+    int socket;
+    Backend *backend;            // Backend ao qual o socket está conectado
+    unsigned long connected_at_ms;
+} PooledSocket;
+
+static ProxyConfig *pool_config = NULL;
+static PooledSocket *pool_sockets = NULL;   // Pilha: o mais recente fica no topo (mais provável de estar vivo)
+static int pool_idle = 0;
+static int pool_target = 0;                 // Alvo de ociosos: cresce com misses (até pool_max) e volta a pool_min
+static unsigned long pool_misses_seen = 0;  // Misses já considerados no ajuste do alvo
+static int pool_next_backend = 0;           // Reposição alterna entre os backends saudáveis
+static UpstreamPoolStats pool_stats;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_refill_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t pool_thread;
+
+// Um socket ocioso está saudável se o servidor não enviou FIN nem erro
+// (dados já enviados pelo servidor, como um banner, são mantidos e repassados ao cliente)
+static int pool_socket_healthy(int sock_fd) {
+    char probe;
+    ssize_t result = recv(sock_fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    if (result > 0) return 1;
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 1;
+    return 0;
+}
+
+// Próximo backend saudável a receber um socket de reserva (NULL se todos estão ejetados)
+static Backend* pool_next_refill_backend(void) {
+    int count = backends_count();
+
+    for (int attempt = 0; attempt < count; attempt++) {
+        Backend *backend = backends_get(pool_next_backend++ % count);
+        if (backends_is_healthy(backend)) return backend;
+    }
+
+    return NULL;
+}
+
+/**
+ * Abre uma nova conexão com o backend: connect não-bloqueante com timeout, para que um backend que
+ * descarta o SYN não trave a reposição e a verificação dos ociosos durante as retransmissões do SYN.
+ * Os buffers ficam com o autotuning do kernel: um SO_RCVBUF fixo antes do connect travaria o window
+ * scaling, e o otimizador ajusta o socket quando ele for entregue a um cliente
+ * @return O socket conectado (bloqueante), ou -1 se falhou ou passou de POOL_CONNECT_TIMEOUT_MS
+ */
+static int pool_connect(Backend *backend) {
+    int server_socket = socket(backend->address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_socket < 0) return -1;
+
+    int connected = connect(server_socket, (struct sockaddr*)&backend->address, backend->address_len) == 0;
+
+    if (!connected && errno == EINPROGRESS) {
+        struct pollfd poll_fd = { .fd = server_socket, .events = POLLOUT };
+
+        if (poll(&poll_fd, 1, POOL_CONNECT_TIMEOUT_MS) == 1) {
+            int socket_error = 0;
+            socklen_t error_len = sizeof(socket_error);
+            getsockopt(server_socket, SOL_SOCKET, SO_ERROR, &socket_error, &error_len);
+            connected = socket_error == 0;
+        }
+    }
+
+    if (!connected) {
+        close(server_socket);
+        return -1;
+    }
+
+    fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL, 0) & ~O_NONBLOCK);
+    return server_socket;
+}
+
+// Fecha sockets ociosos mortos, antigos demais ou de backends ejetados (chamada com o lock)
+static void pool_check_idle(unsigned long now) {
+    int kept = 0;
+
+    for (int i = 0; i < pool_idle; i++) {
+        PooledSocket *pooled = &pool_sockets[i];
+
+        if (pool_socket_healthy(pooled->socket) && now - pooled->connected_at_ms < POOL_MAX_IDLE_MS &&
+            backends_is_healthy(pooled->backend)) {
+            pool_sockets[kept++] = *pooled;
+        } else {
+            close(pooled->socket);
+            pool_stats.discarded++;
+        }
+    }
+
+    pool_idle = kept;
+    pool_stats.idle = pool_idle;
+}
+
+// Thread de reposição: mantém pool_target sockets ociosos, entre pool_min e pool_max
+static void* pool_refill_main(void *args) {
+    (void)args;
+
+    while (1) {
+        pthread_mutex_lock(&pool_lock);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += POOL_REFILL_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (long)(POOL_REFILL_INTERVAL_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        // Acorda quando um socket é retirado ou no intervalo de verificação
+        if (pool_idle >= pool_target) {
+            pthread_cond_timedwait(&pool_refill_cond, &pool_lock, &deadline);
+        }
+
+        // Rajada de misses aumenta o alvo; sem misses ele volta aos poucos para pool_min
+        if (pool_stats.misses > pool_misses_seen) {
+            pool_target += (int)(pool_stats.misses - pool_misses_seen);
+            if (pool_target > pool_config->pool_max) pool_target = pool_config->pool_max;
+        } else if (pool_target > pool_config->pool_min) {
+            pool_target--;
+        }
+        pool_misses_seen = pool_stats.misses;
+
+        pool_check_idle(get_monotonic_ms());
+        int missing = pool_target - pool_idle;
+        pthread_mutex_unlock(&pool_lock);
+
+        // O connect é feito fora do lock para não travar quem está retirando sockets
+        for (int i = 0; i < missing; i++) {
+            Backend *backend = pool_next_refill_backend();
+            int server_socket = backend ? pool_connect(backend) : -1;
+
+            if (server_socket < 0) {
+                // Servidor fora do ar: tenta de novo no próximo intervalo
+                usleep(POOL_REFILL_INTERVAL_MS * 1000);
+                break;
+            }
+
+            pthread_mutex_lock(&pool_lock);
+
+            if (pool_idle < pool_config->pool_max) {
+                pool_sockets[pool_idle].socket = server_socket;
+                pool_sockets[pool_idle].backend = backend;
+                pool_sockets[pool_idle].connected_at_ms = get_monotonic_ms();
+                pool_idle++;
+                pool_stats.created++;
+                pool_stats.idle = pool_idle;
+                server_socket = -1;
+            }
+
+            pthread_mutex_unlock(&pool_lock);
+
+            if (server_socket >= 0) close(server_socket);
+        }
+    }
+
+    return NULL;
+}
+
+int upstream_pool_start(ProxyConfig *config) {
+    if (config->pool_min <= 0) return 0;
+
+    if (config->pool_max < config->pool_min) config->pool_max = config->pool_min;
+
+    pool_config = config;
+    pool_target = config->pool_min;
+    pool_sockets = calloc(config->pool_max, sizeof(PooledSocket));
+
+    if (!pool_sockets) {
+        perror("Erro ao alocar pool de conexões");
+        return -1;
+    }
+
+    if (pthread_create(&pool_thread, NULL, pool_refill_main, NULL) != 0) {
+        perror("Erro ao criar thread do pool de conexões");
+        return -1;
+    }
+
+    pthread_detach(pool_thread);
+    return 0;
+}
+
+int upstream_pool_enabled(void) {
+    return pool_sockets != NULL;
+}
+
+int upstream_pool_acquire(Backend *backend) {
+    if (!pool_sockets) return -1;
+
+    int server_socket = -1;
+
+    pthread_mutex_lock(&pool_lock);
+
+    // Procura do topo para a base o socket mais recente do backend escolhido
+    for (int i = pool_idle - 1; i >= 0 && server_socket < 0; i--) {
+        if (pool_sockets[i].backend != backend) continue;
+
+        int candidate = pool_sockets[i].socket;
+        pool_sockets[i] = pool_sockets[--pool_idle];
+
+        if (pool_socket_healthy(candidate)) {
+            server_socket = candidate;
+        } else {
+            close(candidate);
+            pool_stats.discarded++;
+        }
+    }
+
+    if (server_socket >= 0) pool_stats.hits++;
+    else pool_stats.misses++;
+    pool_stats.idle = pool_idle;
+
+    // Pede reposição imediata
+    pthread_cond_signal(&pool_refill_cond);
+    pthread_mutex_unlock(&pool_lock);
+
+    return server_socket;
+}
+
+void upstream_pool_get_stats(UpstreamPoolStats *stats) {
+    pthread_mutex_lock(&pool_lock);
+    *stats = pool_stats;
+    pthread_mutex_unlock(&pool_lock);
+}
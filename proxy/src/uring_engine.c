@@ -0,0 +1,861 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+
+#include "../include/uring_engine.h"
+#include "../include/connection_handler.h"
+#include "../include/tcp_monitor.h"
+#include "../include/upstream_pool.h"
+#include "../include/listener.h"
+#include "../include/slab_pool.h"
+#include "../include/latency_profile.h"
+#include "../include/admission.h"
+#include "../include/latency_stats.h"
+#include "../include/timer_wheel.h"
+#include "../include/flight_recorder.h"
+
+#define URING_QUEUE_DEPTH 1024        // Entradas da fila de submissão por worker
+#define URING_BUFFER_COUNT 512        // Buffers fornecidos ao kernel por worker (potência de 2)
+#define URING_BUFFER_SIZE 16384       // Tamanho de cada buffer fornecido
+#define URING_BUFFER_GROUP 0          // Grupo de buffers usado nos recv
+#define URING_HEADER_INTERVAL_MS 500  // Publicação dos agregados do segmento enquanto o worker tem conexões
+
+// Tipo da operação, guardado nos 3 bits baixos de user_data (o resto é o ponteiro da conexão)
+enum {
+    OP_ACCEPT = 0,
+    OP_TIMER,
+    OP_CONNECT,
+    OP_RECV_CLIENT,
+    OP_RECV_SERVER,
+    OP_SEND_SERVER,
+    OP_SEND_CLIENT,
+    OP_CANCEL
+};
+#define OP_MASK 7ULL
+
+// Timers da roda do worker (TimerEntry.kind)
+enum {
+    URING_TIMER_SAMPLE = 0,          // Coleta de métricas de uma conexão (intervalo adaptativo)
+    URING_TIMER_IDLE,                // Prazo do --idle-timeout de uma conexão
+    URING_TIMER_HEADER               // Cabeçalho do segmento de estatísticas (owner == NULL)
+};
+
+// Anel io_uring mapeado em memória (sem liburing, direto pelas syscalls)
+typedef struct {
+    int fd;
+    void *sq_map;                    // Mapeamentos do anel (cq_map == sq_map com IORING_FEAT_SINGLE_MMAP)
+    void *cq_map;
+    size_t sq_map_size;
+    size_t cq_map_size;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sqe_tail;               // Próxima SQE local (publicada em sq_tail no submit)
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+} UringRing;
+
+// Estado de uma direção: no máximo um recv ou um send em andamento (backpressure natural)
+typedef struct {
+    int to_server;                   // 1 = Cliente -> Servidor, 0 = Servidor -> Cliente
+    int buffer_id;                   // Buffer fornecido com dados a enviar (-1 se nenhum)
+    unsigned length;                 // Bytes recebidos no buffer
+    unsigned offset;                 // Bytes já enviados
+    int eof;                         // Origem enviou FIN e ele foi propagado
+    int starved;                     // recv falhou por falta de buffers (ENOBUFS)
+    uint64_t received_ns;            // Conclusão do recv do bloco em envio (com --stats-port)
+} UringDirection;
+
+typedef struct UringConnection {
+    ConnectionPair pair;
+    int connected;
+    int closing;
+    int connect_slot;                    // 1 enquanto ocupa uma vaga de connect() (--max-connecting)
+    int inflight;                        // Operações submetidas e ainda sem CQE
+
+    TimerEntry sample_timer;             // Próxima coleta de métricas (só conectada)
+    TimerEntry idle_timer;               // Prazo de ociosidade (reavaliado pela atividade real no vencimento)
+
+    UringDirection to_server;
+    UringDirection to_client;
+
+    struct UringConnection *prev;        // Lista de conexões do worker
+    struct UringConnection *next;
+} UringConnection;
+
+// Conexão aceita à espera de uma vaga de connect()
+typedef struct {
+    int id;
+    pthread_t thread;
+    int listen_fd;
+    ProxyConfig *config;
+
+    UringRing ring;
+    struct io_uring_buf_ring *buf_ring;
+    unsigned buf_tail;
+    char *buffer_memory;
+    int starved_count;                   // Direções esperando buffers livres
+
+    TimerWheel timers;                   // Coletas, ociosidade e cabeçalho, acordadas pelo poll do timerfd
+    TimerEntry header_timer;
+    struct __kernel_timespec retry_timeout;
+    int retry_armed;                     // Timer curto da fila de connect() submetido
+
+    AdmissionQueue waiting;              // Fila de connect() do worker
+    UringConnection *connections;
+} UringWorker;
+
+static int ring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+// Desfaz os mapeamentos e fecha o anel (aceita um anel inicializado pela metade)
+static void ring_free(UringRing *ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map) munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->fd >= 0) close(ring->fd);
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static int ring_init(UringRing *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4; // Folga para CQEs de muitas conexões ao mesmo tempo
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return -1;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+    if (single_mmap) {
+        if (cq_size > sq_size) sq_size = cq_size;
+        cq_size = sq_size;
+    }
+
+    char *sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) goto fail;
+    ring->sq_map = sq_ptr;
+    ring->sq_map_size = sq_size;
+
+    char *cq_ptr = sq_ptr;
+    if (!single_mmap) {
+        cq_ptr = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) goto fail;
+    }
+    ring->cq_map = cq_ptr;
+    ring->cq_map_size = cq_size;
+
+    size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    struct io_uring_sqe *sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) goto fail;
+    ring->sqes = sqes;
+    ring->sqes_size = sqes_size;
+
+    ring->sq_head = (unsigned*)(sq_ptr + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq_ptr + params.sq_off.tail);
+    ring->sq_mask = *(unsigned*)(sq_ptr + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_array = (unsigned*)(sq_ptr + params.sq_off.array);
+    ring->sqe_tail = *ring->sq_tail;
+
+    ring->cq_head = (unsigned*)(cq_ptr + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq_ptr + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq_ptr + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq_ptr + params.cq_off.cqes);
+
+    return 0;
+
+fail:
+    ring_free(ring);
+    return -1;
+}
+
+// Publica as SQEs pendentes e, se wait_nr > 0, espera por CQEs
+static int ring_submit(UringRing *ring, unsigned wait_nr) {
+    unsigned to_submit = ring->sqe_tail - *ring->sq_tail;
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+    int ret;
+    do {
+        ret = ring_enter(ring->fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    } while (ret < 0 && errno == EINTR && wait_nr == 0);
+
+    return ret;
+}
+
+static struct io_uring_sqe* ring_get_sqe(UringRing *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    // Fila cheia: submete o que já foi preparado para liberar espaço
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        ring_submit(ring, 0);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sqe_tail - head >= ring->sq_entries) return NULL;
+    }
+
+    unsigned index = ring->sqe_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+
+    return sqe;
+}
+
+static uint64_t encode_user_data(UringConnection *connection, int op) {
+    return (uint64_t)(uintptr_t)connection | (uint64_t)op;
+}
+
+// Devolve um buffer ao anel de buffers fornecidos
+static void buffer_recycle(UringWorker *worker, int buffer_id) {
+    struct io_uring_buf *buf = &worker->buf_ring->bufs[worker->buf_tail & (URING_BUFFER_COUNT - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(worker->buffer_memory + (size_t)buffer_id * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = (uint16_t)buffer_id;
+
+    worker->buf_tail++;
+    __atomic_store_n(&worker->buf_ring->tail, (uint16_t)worker->buf_tail, __ATOMIC_RELEASE);
+}
+
+// Cria o anel de buffers fornecidos e registra no io_uring
+static int buffers_init(UringWorker *worker) {
+    size_t ring_size = URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+
+    worker->buf_ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (worker->buf_ring == MAP_FAILED) return -1;
+
+    struct io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = (uint64_t)(uintptr_t)worker->buf_ring;
+    registration.ring_entries = URING_BUFFER_COUNT;
+    registration.bgid = URING_BUFFER_GROUP;
+
+    if (syscall(__NR_io_uring_register, worker->ring.fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        munmap(worker->buf_ring, ring_size);
+        return -1;
+    }
+
+    worker->buffer_memory = malloc((size_t)URING_BUFFER_COUNT * URING_BUFFER_SIZE);
+    if (!worker->buffer_memory) return -1;
+
+    worker->buf_tail = 0;
+    for (int i = 0; i < URING_BUFFER_COUNT; i++) {
+        buffer_recycle(worker, i);
+    }
+
+    return 0;
+}
+
+static int prep_accept(UringWorker *worker) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = worker->listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT; // Um único SQE gera um CQE por conexão aceita
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = encode_user_data(NULL, OP_ACCEPT);
+    return 0;
+}
+
+// Espera o timerfd da roda (armado só para o próximo vencimento); o poll é de uma vez só e
+// volta a ser submetido depois de cada avanço da roda
+static int prep_timer(UringWorker *worker) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = worker->timers.timer_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = encode_user_data(NULL, OP_TIMER);
+    return 0;
+}
+
+// Timer curto enquanto há conexões na fila de connect(): as vagas são liberadas por outros
+// workers e nada acordaria este. Usa OP_TIMER com o ponteiro do próprio timespec para se
+// distinguir do poll da roda
+static int prep_retry_timer(UringWorker *worker) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    worker->retry_timeout.tv_sec = 0;
+    worker->retry_timeout.tv_nsec = ADMISSION_RETRY_MS * 1000000LL;
+
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&worker->retry_timeout;
+    sqe->len = 1;
+    sqe->user_data = encode_user_data((UringConnection*)(void*)&worker->retry_timeout, OP_TIMER);
+    worker->retry_armed = 1;
+    return 0;
+}
+
+static int prep_connect(UringWorker *worker, UringConnection *connection) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = connection->pair.server_socket;
+    // O endereço do backend é resolvido na inicialização e vive até o fim do processo
+    sqe->addr = (uint64_t)(uintptr_t)&connection->pair.backend->address;
+    sqe->off = connection->pair.backend->address_len;
+    sqe->user_data = encode_user_data(connection, OP_CONNECT);
+    connection->inflight++;
+    return 0;
+}
+
+static int prep_recv(UringWorker *worker, UringConnection *connection, UringDirection *direction) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    // O kernel escolhe o buffer do grupo no momento em que os dados chegam
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = direction->to_server ? connection->pair.client_socket : connection->pair.server_socket;
+    sqe->len = URING_BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = encode_user_data(connection, direction->to_server ? OP_RECV_CLIENT : OP_RECV_SERVER);
+    connection->inflight++;
+    return 0;
+}
+
+static int prep_send(UringWorker *worker, UringConnection *connection, UringDirection *direction) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    char *data = worker->buffer_memory + (size_t)direction->buffer_id * URING_BUFFER_SIZE;
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = direction->to_server ? connection->pair.server_socket : connection->pair.client_socket;
+    sqe->addr = (uint64_t)(uintptr_t)(data + direction->offset);
+    sqe->len = direction->length - direction->offset;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = encode_user_data(connection, direction->to_server ? OP_SEND_SERVER : OP_SEND_CLIENT);
+    connection->inflight++;
+    return 0;
+}
+
+// Cancela todas as operações pendentes em um socket
+static int prep_cancel_fd(UringWorker *worker, int fd) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&worker->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = encode_user_data(NULL, OP_CANCEL);
+    return 0;
+}
+
+// Sem SQE para o cancelamento: o shutdown faz o kernel concluir sozinho o recv, o send e o connect
+// pendentes no socket (senão inflight nunca chegaria a 0 e a conexão nunca seria liberada)
+static void cancel_fd(UringWorker *worker, int fd) {
+    if (fd >= 0 && prep_cancel_fd(worker, fd) < 0) shutdown(fd, SHUT_RDWR);
+}
+
+// connect() concluído (ou abandonado): devolve a vaga ao controle de admissão
+static void connection_release_connect_slot(UringConnection *connection) {
+    if (!connection->connect_slot) return;
+
+    connection->connect_slot = 0;
+    admission_connect_done();
+}
+
+// Libera a conexão quando não há mais operações do kernel referenciando sua memória
+static void connection_maybe_free(UringWorker *worker, UringConnection *connection) {
+    if (!connection->closing || connection->inflight > 0) return;
+
+    connection_release_connect_slot(connection);
+    timer_wheel_cancel(&worker->timers, &connection->sample_timer);
+    timer_wheel_cancel(&worker->timers, &connection->idle_timer);
+
+    if (connection->prev) connection->prev->next = connection->next;
+    else worker->connections = connection->next;
+    if (connection->next) connection->next->prev = connection->prev;
+
+    if (connection->to_server.buffer_id >= 0) buffer_recycle(worker, connection->to_server.buffer_id);
+    if (connection->to_client.buffer_id >= 0) buffer_recycle(worker, connection->to_client.buffer_id);
+    if (connection->to_server.starved) worker->starved_count--;
+    if (connection->to_client.starved) worker->starved_count--;
+
+    connection_pair_close(&connection->pair);
+    slab_free(connection, sizeof(UringConnection));
+}
+
+// Marca a conexão para encerramento e cancela o que estiver pendente no kernel.
+// A liberação acontece em connection_maybe_free, quando a última CQE chegar
+static void connection_close(UringWorker *worker, UringConnection *connection) {
+    if (connection->closing) return;
+
+    connection->closing = 1;
+    cancel_fd(worker, connection->pair.client_socket);
+    cancel_fd(worker, connection->pair.server_socket);
+}
+
+// Direção terminou de enviar: devolve o buffer e volta a ler da origem
+static void direction_rearm(UringWorker *worker, UringConnection *connection, UringDirection *direction) {
+    if (direction->buffer_id >= 0) {
+        buffer_recycle(worker, direction->buffer_id);
+        direction->buffer_id = -1;
+    }
+
+    if (prep_recv(worker, connection, direction) < 0) {
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_INTERNAL, 0);
+        connection_close(worker, connection);
+    }
+}
+
+// Buffers voltaram ao anel: tenta de novo os recv que falharam com ENOBUFS
+static void worker_retry_starved(UringWorker *worker) {
+    UringConnection *connection = worker->connections;
+
+    while (connection && worker->starved_count > 0) {
+        UringConnection *next = connection->next;
+        UringDirection *directions[2] = { &connection->to_server, &connection->to_client };
+
+        for (int i = 0; i < 2; i++) {
+            if (!directions[i]->starved || connection->closing) continue;
+            directions[i]->starved = 0;
+            worker->starved_count--;
+            direction_rearm(worker, connection, directions[i]);
+        }
+
+        connection_maybe_free(worker, connection);
+        connection = next;
+    }
+}
+
+static void handle_connect(UringWorker *worker, UringConnection *connection, int result) {
+    connection_release_connect_slot(connection);
+
+    if (connection->closing) return;
+
+    if (result < 0) {
+        fprintf(stderr, "Erro ao conectar ao servidor real %s: %s\n", connection->pair.backend->address_str, strerror(-result));
+        backends_report_failure(connection->pair.backend);
+        connection_pair_connect_failed(&connection->pair, -result);
+        connection_close(worker, connection);
+        return;
+    }
+
+    connection->connected = 1;
+    connection_pair_connected(&connection->pair);
+    timer_wheel_schedule(&worker->timers, &connection->sample_timer, connection->pair.sample_interval_ms);
+    printf("[+] Conexão (Cliente %d <-> Servidor %d, %s) estabelecida.\n", connection->pair.client_socket, connection->pair.server_socket,
+           connection->pair.backend->address_str);
+
+    direction_rearm(worker, connection, &connection->to_server);
+    direction_rearm(worker, connection, &connection->to_client);
+}
+
+// Inicia a conexão com o backend (a vaga de connect() já está reservada; AdmissionStartCallback)
+static void worker_start_connection(void *context, int client_fd, const struct sockaddr_in *client_address, uint64_t accepted_ns) {
+    UringWorker *worker = context;
+    char client_ip_str[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &(client_address->sin_addr), client_ip_str, INET_ADDRSTRLEN);
+    printf("[+] Nova conexão de %s:%d (worker %d, io_uring)\n", client_ip_str, ntohs(client_address->sin_port), worker->id);
+
+    unsigned long connection_id = connection_accepted(client_fd, accepted_ns);
+    UringConnection *connection = slab_alloc(sizeof(UringConnection));
+
+    if (!connection) {
+        perror("Erro ao alocar conexão");
+        connection_aborted(connection_id, FLIGHT_CLOSE_INTERNAL, ENOMEM);
+        close(client_fd);
+        admission_connect_done();
+        admission_release();
+        return;
+    }
+
+    memset(connection, 0, sizeof(UringConnection));
+    connection->connect_slot = 1;
+
+    Backend *backend = backends_acquire();
+
+    // Socket do pool já está conectado e dispensa o IORING_OP_CONNECT
+    int server_socket = upstream_pool_acquire(backend);
+    int pooled = server_socket >= 0;
+
+    if (!pooled) {
+        server_socket = socket(backend->address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (server_socket >= 0) latency_apply_upstream(server_socket, worker->config);
+    }
+
+    if (server_socket < 0) {
+        int error = errno;
+        perror("Erro ao criar socket para o servidor");
+        connection_connect_aborted(connection_id, accepted_ns, error);
+        backends_release(backend);
+        close(client_fd);
+        slab_free(connection, sizeof(UringConnection));
+        admission_connect_done();
+        admission_release();
+        return;
+    }
+
+    // O IORING_OP_CONNECT (ou o socket do pool) vem logo depois, ainda nesta passada do loop
+    flight_record(connection_id, FLIGHT_EVENT_CONNECT_START, FLIGHT_SIDE_SERVER, 0, server_socket);
+    connection_pair_init(&connection->pair, worker->config, connection_id, client_fd, server_socket, client_address, backend, accepted_ns);
+    connection->to_server.to_server = 1;
+    connection->to_server.buffer_id = -1;
+    connection->to_client.to_server = 0;
+    connection->to_client.buffer_id = -1;
+
+    timer_wheel_entry_init(&connection->sample_timer, URING_TIMER_SAMPLE, connection);
+    timer_wheel_entry_init(&connection->idle_timer, URING_TIMER_IDLE, connection);
+    if (worker->config->idle_timeout_ms > 0) timer_wheel_schedule(&worker->timers, &connection->idle_timer, worker->config->idle_timeout_ms);
+    if (!timer_wheel_pending(&worker->header_timer)) timer_wheel_schedule(&worker->timers, &worker->header_timer, URING_HEADER_INTERVAL_MS);
+
+    connection->next = worker->connections;
+    if (worker->connections) worker->connections->prev = connection;
+    worker->connections = connection;
+
+    if (pooled) {
+        handle_connect(worker, connection, 0);
+    } else if (prep_connect(worker, connection) < 0) {
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_INTERNAL, 0);
+        connection_close(worker, connection);
+    }
+
+    connection_maybe_free(worker, connection);
+}
+
+// Admite a conexão recém-aceita e a entrega à fila de connect() do worker
+static void worker_accept(UringWorker *worker, int client_fd) {
+    uint64_t accepted_ns = latency_now_ns();
+    AdmissionVerdict verdict = admission_accept();
+
+    if (verdict != ADMISSION_ADMIT) {
+        admission_reject(client_fd, verdict);
+        return;
+    }
+
+    // O endereço vem do socket: o accept do io_uring não o devolve
+    struct sockaddr_in client_address;
+    socklen_t address_len = sizeof(client_address);
+    memset(&client_address, 0, sizeof(client_address));
+    getpeername(client_fd, (struct sockaddr*)&client_address, &address_len);
+
+    admission_queue_admit(&worker->waiting, client_fd, &client_address, accepted_ns, worker_start_connection, worker);
+}
+
+static void handle_recv(UringWorker *worker, UringConnection *connection, UringDirection *direction, int result, unsigned flags) {
+    if (flags & IORING_CQE_F_BUFFER) {
+        direction->buffer_id = flags >> IORING_CQE_BUFFER_SHIFT;
+    }
+
+    if (connection->closing) return;
+
+    if (result == -ENOBUFS) {
+        // Todos os buffers estão em uso: espera algum voltar ao anel
+        direction->starved = 1;
+        worker->starved_count++;
+        return;
+    }
+
+    flight_record(connection->pair.connection_id, FLIGHT_EVENT_READ, direction->to_server ? FLIGHT_SIDE_CLIENT : FLIGHT_SIDE_SERVER,
+                  result < 0 ? -result : 0, result < 0 ? -1 : result);
+
+    if (result < 0) {
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_ERROR, -result);
+        connection_close(worker, connection);
+        return;
+    }
+
+    int dest_fd = direction->to_server ? connection->pair.server_socket : connection->pair.client_socket;
+
+    if (result == 0) {
+        // Half-close: propaga o FIN (não há send pendente nesta direção)
+        shutdown(dest_fd, SHUT_WR);
+        direction->eof = 1;
+        flight_record(connection->pair.connection_id, FLIGHT_EVENT_SHUTDOWN, direction->to_server ? FLIGHT_SIDE_SERVER : FLIGHT_SIDE_CLIENT, 0, 0);
+
+        if (connection->to_server.eof && connection->to_client.eof) {
+            connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_DONE, 0);
+            connection_close(worker, connection);
+        }
+        return;
+    }
+
+    if (direction->to_server) connection->pair.bytes_client_to_server += result;
+    else connection->pair.bytes_server_to_client += result;
+    connection->pair.last_activity_time = get_coarse_ms();
+
+    if (connection->pair.latency_timed) {
+        direction->received_ns = latency_now_ns();
+        if (direction->to_server) connection_ttfb_update(&connection->pair, 0);
+    }
+
+    if (worker->config->latency_profile) {
+        latency_quickack(direction->to_server ? connection->pair.client_socket : connection->pair.server_socket);
+    }
+
+    direction->length = result;
+    direction->offset = 0;
+
+    if (prep_send(worker, connection, direction) < 0) {
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_INTERNAL, 0);
+        connection_close(worker, connection);
+    }
+}
+
+static void handle_send(UringWorker *worker, UringConnection *connection, UringDirection *direction, int result) {
+    if (connection->closing) return;
+
+    flight_record(connection->pair.connection_id, FLIGHT_EVENT_WRITE, direction->to_server ? FLIGHT_SIDE_SERVER : FLIGHT_SIDE_CLIENT,
+                  result < 0 ? -result : 0, result < 0 ? -1 : result);
+
+    if (result < 0) {
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_ERROR, -result);
+        connection_close(worker, connection);
+        return;
+    }
+
+    direction->offset += result;
+    if (!direction->to_server) connection_ttfb_update(&connection->pair, direction->offset);
+
+    // Envio parcial: continua de onde parou antes de ler mais da origem
+    if (direction->offset < direction->length) {
+        if (prep_send(worker, connection, direction) < 0) {
+            connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_INTERNAL, 0);
+            connection_close(worker, connection);
+        }
+        return;
+    }
+
+    // Bloco entregue: atraso desde a conclusão do recv (o relay do io_uring tem um bloco por direção)
+    if (connection->pair.latency_timed) {
+        uint64_t delay = latency_now_ns() - direction->received_ns;
+
+        latency_record(LATENCY_RELAY, delay);
+        latency_summary_add(direction->to_server ? &connection->pair.delay_to_server : &connection->pair.delay_to_client, delay);
+    }
+
+    direction_rearm(worker, connection, direction);
+}
+
+// Vencimento de um timer da roda. A ociosidade é reavaliada pela atividade real: cada recv só
+// atualiza last_activity_time, e o timer volta para a roda com o que falta do prazo
+static void worker_timer_fired(TimerEntry *entry, void *context) {
+    UringWorker *worker = (UringWorker*)context;
+
+    if (entry->kind == URING_TIMER_HEADER) {
+        connection_stats_publish_header();
+        if (worker->connections) timer_wheel_schedule(&worker->timers, entry, URING_HEADER_INTERVAL_MS);
+        return;
+    }
+
+    UringConnection *connection = (UringConnection*)entry->owner;
+    if (connection->closing) return;
+
+    if (entry->kind == URING_TIMER_IDLE) {
+        int remaining = connection_idle_remaining_ms(&connection->pair, worker->config);
+
+        if (remaining != 0) {
+            if (remaining > 0) timer_wheel_schedule(&worker->timers, entry, (unsigned long)remaining);
+            return;
+        }
+
+        // Ociosa demais: cancela as operações; a liberação vem com as últimas CQEs
+        printf("[-] Conexão (Cliente %d <-> Servidor %d) ociosa há %d s, encerrando.\n",
+               connection->pair.client_socket, connection->pair.server_socket, worker->config->idle_timeout_ms / 1000);
+        connection_pair_set_close_reason(&connection->pair, FLIGHT_CLOSE_IDLE, 0);
+        connection_close(worker, connection);
+        connection_maybe_free(worker, connection);
+        return;
+    }
+
+    connection_monitor_tick(&connection->pair, worker->config);
+    connection->pair.last_monitor_time = get_monotonic_ms();
+    timer_wheel_schedule(&worker->timers, entry, connection->pair.sample_interval_ms);
+}
+
+static void worker_handle_cqe(UringWorker *worker, uint64_t user_data, int result, unsigned flags) {
+    int op = (int)(user_data & OP_MASK);
+    UringConnection *connection = (UringConnection*)(uintptr_t)(user_data & ~OP_MASK);
+
+    switch (op) {
+        case OP_ACCEPT:
+            if (result >= 0) worker_accept(worker, result);
+            else if (result != -EAGAIN) fprintf(stderr, "Erro no accept: %s\n", strerror(-result));
+
+            // Sem IORING_CQE_F_MORE o accept multishot foi desarmado e precisa ser submetido de novo
+            if (!(flags & IORING_CQE_F_MORE)) prep_accept(worker);
+            return;
+
+        case OP_TIMER:
+            // Timer da fila de connect(): a fila é drenada depois do lote de CQEs
+            if (connection) {
+                worker->retry_armed = 0;
+                return;
+            }
+
+            timer_wheel_advance(&worker->timers, worker_timer_fired, worker);
+            prep_timer(worker);
+            return;
+
+        case OP_CANCEL:
+            return;
+    }
+
+    connection->inflight--;
+
+    switch (op) {
+        case OP_CONNECT:
+            handle_connect(worker, connection, result);
+            break;
+        case OP_RECV_CLIENT:
+            handle_recv(worker, connection, &connection->to_server, result, flags);
+            break;
+        case OP_RECV_SERVER:
+            handle_recv(worker, connection, &connection->to_client, result, flags);
+            break;
+        case OP_SEND_SERVER:
+            handle_send(worker, connection, &connection->to_server, result);
+            break;
+        case OP_SEND_CLIENT:
+            handle_send(worker, connection, &connection->to_client, result);
+            break;
+    }
+
+    connection_maybe_free(worker, connection);
+}
+
+static void* worker_main(void *args) {
+    UringWorker *worker = (UringWorker*)args;
+    UringRing *ring = &worker->ring;
+
+    if (worker->config->pin_cpus) listener_pin_worker(worker->id);
+
+    prep_accept(worker);
+    prep_timer(worker);
+
+    while (1) {
+        if (ring_submit(ring, 1) < 0 && errno != EINTR && errno != EBUSY) {
+            perror("Erro no io_uring_enter");
+            break;
+        }
+
+        unsigned head = *ring->cq_head;
+
+        while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+            uint64_t user_data = cqe->user_data;
+            int result = cqe->res;
+            unsigned flags = cqe->flags;
+
+            // Libera a entrada antes de tratar, o tratamento pode gerar novas submissões
+            head++;
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+            worker_handle_cqe(worker, user_data, result, flags);
+        }
+
+        // Buffers devolvidos neste lote podem destravar recv que falharam com ENOBUFS
+        if (worker->starved_count > 0) worker_retry_starved(worker);
+
+        // Vagas de connect() liberadas neste lote (ou por outros workers) atendem a fila
+        if (worker->waiting.head) {
+            admission_queue_drain(&worker->waiting, worker_start_connection, worker);
+            if (worker->waiting.head && !worker->retry_armed) prep_retry_timer(worker);
+        }
+    }
+
+    return NULL;
+}
+
+int uring_engine_available(void) {
+    UringWorker probe;
+    memset(&probe, 0, sizeof(probe));
+
+    if (ring_init(&probe.ring, 8) < 0) return 0;
+
+    struct io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+
+    void *buf_ring = mmap(NULL, 8 * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    registration.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+    registration.ring_entries = 8;
+    registration.bgid = URING_BUFFER_GROUP;
+
+    int available = buf_ring != MAP_FAILED &&
+                    syscall(__NR_io_uring_register, probe.ring.fd, IORING_REGISTER_PBUF_RING, &registration, 1) == 0;
+
+    if (buf_ring != MAP_FAILED) munmap(buf_ring, 8 * sizeof(struct io_uring_buf));
+    ring_free(&probe.ring);
+
+    return available;
+}
+
+int uring_engine_run(ProxyConfig *config, int listen_fd) {
+    int worker_count = config->num_workers > 0 ? config->num_workers : 1;
+    UringWorker *workers = calloc(worker_count, sizeof(UringWorker));
+
+    if (!workers) {
+        perror("Erro ao alocar workers");
+        return -1;
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        UringWorker *worker = &workers[i];
+        worker->id = i;
+        worker->listen_fd = listen_fd;
+        worker->config = config;
+
+        // Com SO_REUSEPORT cada worker tem o próprio socket de escuta e o kernel distribui as conexões
+        if (config->reuseport) {
+            worker->listen_fd = listener_open(config, 1);
+            if (worker->listen_fd < 0) return -1;
+
+            if (config->incoming_cpu) listener_set_incoming_cpu(worker->listen_fd, listener_worker_cpu(i));
+        }
+
+        if (ring_init(&worker->ring, URING_QUEUE_DEPTH) < 0 || buffers_init(worker) < 0) {
+            perror("Erro ao inicializar io_uring do worker");
+            ring_free(&worker->ring);
+            return -1;
+        }
+
+        if (timer_wheel_init(&worker->timers, 1) < 0) return -1;
+        timer_wheel_entry_init(&worker->header_timer, URING_TIMER_HEADER, NULL);
+
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            perror("Erro ao criar thread do worker");
+            return -1;
+        }
+    }
+
+    // Os workers aceitam as conexões sozinhos; a thread principal só espera
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#!/bin/bash
+# Mede o custo adicionado pelo proxy: a mesma carga do loadgen direto no servidor e através do proxy_app
+# (uma rodada por engine), tudo em loopback. Configuração por variáveis de ambiente:
+#   MODE=rr|stream  CONNS=16  THREADS=2  SIZE=1024  SPLIT=1  CHURN=0  DURATION=5
+#   ENGINES="epoll uring threads"  PROXY_ARGS="--relay splice"  SERVER_PORT=9900  PROXY_PORT=9901 (+1 por rodada)
+#   LATENCY_COMPARE=1 repete cada engine com --latency --client-first (rodada proxy-<engine>-lat; a carga é do cliente)
+set -e
+cd "$(dirname "$0")/.."
+
+PROXY=${PROXY:-./proxy_app}
+BENCH_SERVER=${BENCH_SERVER:-./bench_server}
+LOADGEN=${LOADGEN:-./loadgen}
+
+MODE=${MODE:-rr}
+CONNS=${CONNS:-16}
+THREADS=${THREADS:-2}
+SIZE=${SIZE:-1024}
+SPLIT=${SPLIT:-1}
+CHURN=${CHURN:-0}
+DURATION=${DURATION:-5}
+ENGINES=${ENGINES:-"epoll uring threads"}
+PROXY_ARGS=${PROXY_ARGS:-}
+SERVER_PORT=${SERVER_PORT:-9900}
+PROXY_PORT=${PROXY_PORT:-9901}
+LATENCY_COMPARE=${LATENCY_COMPARE:-0}
+
+RESULTS=$(mktemp)
+SERVER_PID=""
+PROXY_PID=""
+
+cleanup() {
+    if [ -n "$PROXY_PID" ]; then kill "$PROXY_PID" 2>/dev/null || true; fi
+    if [ -n "$SERVER_PID" ]; then kill "$SERVER_PID" 2>/dev/null || true; fi
+    rm -f "$RESULTS"
+}
+trap cleanup EXIT INT TERM
+
+# Espera a porta aceitar conexões (até ~3 s)
+wait_port() {
+    for _ in $(seq 30); do
+        if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then return 0; fi
+        sleep 0.1
+    done
+}
+
+run_load() {
+    "$LOADGEN" 127.0.0.1 "$1" --mode "$MODE" --conns "$CONNS" --threads "$THREADS" \
+        --size "$SIZE" --split "$SPLIT" --churn "$CHURN" --duration "$DURATION" --label "$2" | tee -a "$RESULTS"
+    echo
+}
+
+if [ "$MODE" = "stream" ]; then SERVER_MODE=sink; else SERVER_MODE=echo; fi
+
+"$BENCH_SERVER" "$SERVER_PORT" "$SERVER_MODE" > /dev/null &
+SERVER_PID=$!
+wait_port "$SERVER_PORT"
+
+run_load "$SERVER_PORT" direto
+
+# Uma rodada do proxy: engine, nome e argumentos extras
+run_proxy() {
+    # Uma porta por rodada: o kernel pode liberar o socket de escuta do io_uring só depois do fim do processo
+    # O console do proxy (métricas a cada 3 s) não interessa aqui
+    "$PROXY" "$port" 127.0.0.1 "$SERVER_PORT" --engine "$1" $PROXY_ARGS $3 > /dev/null 2>&1 &
+    PROXY_PID=$!
+    wait_port "$port"
+
+    run_load "$port" "$2"
+    port=$((port + 1))
+
+    kill "$PROXY_PID" 2>/dev/null
+    wait "$PROXY_PID" 2>/dev/null || true
+    PROXY_PID=""
+}
+
+port=$PROXY_PORT
+for engine in $ENGINES; do
+    run_proxy "$engine" "proxy-$engine"
+    if [ "$LATENCY_COMPARE" = "1" ]; then run_proxy "$engine" "proxy-$engine-lat" --latency --client-first; fi
+done
+
+# Tabela final: cada rodada contra a conexão direta
+echo "Comparação (custo do proxy = rodada - direto):"
+grep '^RESUMO' "$RESULTS" | awk '
+function field(name,   i, pair) {
+    for (i = 3; i <= NF; i++) { split($i, pair, "="); if (pair[1] == name) return pair[2] }
+    return 0
+}
+{
+    label = $2; req = field("req_s"); conn = field("conn_s"); mbit = field("mbit_s")
+    p50 = field("p50_us"); p99 = field("p99_us"); p999 = field("p999_us")
+    if (NR == 1) { base_p50 = p50; base_p99 = p99; base_mbit = mbit
+        printf "%-16s %10s %10s %12s %10s %10s %10s %12s %12s\n", "rodada", "req/s", "conn/s", "Mbit/s", "p50 us", "p99 us", "p99.9 us", "+p50 us", "+p99 us" }
+    printf "%-16s %10s %10s %12s %10s %10s %10s %12.1f %12.1f\n", label, req, conn, mbit, p50, p99, p999, p50 - base_p50, p99 - base_p99
+}'
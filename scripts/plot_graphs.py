@@ -3,7 +3,7 @@ import matplotlib.pyplot as plt
 import sys
 import os
 
-def plot_metrics(csv_file):
+def plot_metrics(csv_file, connection_id=None):
     if not os.path.exists(csv_file):
         print(f"Erro: Arquivo {csv_file} não encontrado.")
         return
@@ -17,6 +17,13 @@ def plot_metrics(csv_file):
 
     # Limpa espaços em branco nos nomes das colunas
     df.columns = df.columns.str.strip()
+
+    # O log único tem várias conexões: usa a pedida ou a com mais amostras
+    if 'ConnectionId' in df.columns:
+        if connection_id is None:
+            connection_id = int(df['ConnectionId'].value_counts().idxmax())
+        df = df[df['ConnectionId'] == connection_id].sort_values('TimestampMS')
+        print(f"Conexão {connection_id}: {len(df)} amostras")
     
     # Ajusta o tempo para começar em 0 segundos (tempo relativo)
     start_time = df['TimestampMS'].iloc[0]
@@ -73,12 +80,14 @@ def plot_metrics(csv_file):
 
     # Salva o gráfico
     output_img = csv_file.replace('.csv', '.png')
+    if 'ConnectionId' in df.columns:
+        output_img = output_img.replace('.png', f'_conn{connection_id}.png')
     plt.tight_layout()
     plt.savefig(output_img)
     print(f"[Sucesso] Gráfico salvo em: {output_img}")
 
 if __name__ == "__main__":
     if len(sys.argv) < 2:
-        print("Uso: python3 plot_graphs.py <arquivo_log.csv>")
+        print("Uso: python3 plot_graphs.py <arquivo_log.csv> [connection_id]")
     else:
-        plot_metrics(sys.argv[1])
\ No newline at end of file
+        plot_metrics(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else None)
\ No newline at end of file